@@ -0,0 +1,223 @@
+#include "AssetPack.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <stdexcept>
+
+#include "Hash.h"
+
+
+// Hash Asset Name ----------------------------------------------------------------------------------------
+uint64_t hashAssetName(std::string_view name)
+{
+    uint64_t hash = HASH_SEED;
+    for (char c : name) {
+        const char normalized = c == '\\' ? '/' : c;
+        hash = hashBytes(hash, &normalized, 1);
+    }
+    return hash;
+}
+
+
+
+// LZ4 Block Decompression ----------------------------------------------------------------------------------------
+// Plain LZ4 block format (no frame header), as produced by tools/pack_assets.py.
+static void decompressLz4Block(const uint8_t* src, size_t srcSize, uint8_t* dst, size_t dstSize)
+{
+    const uint8_t* ip = src;
+    const uint8_t* const ipEnd = src + srcSize;
+    uint8_t* op = dst;
+    uint8_t* const opEnd = dst + dstSize;
+
+    auto readLength = [&](size_t length) {
+        if (length == 15) {
+            uint8_t extra;
+            do {
+                if (ip >= ipEnd) {
+                    throw std::runtime_error("corrupt lz4 block!");
+                }
+                extra = *ip++;
+                length += extra;
+            } while (extra == 255);
+        }
+        return length;
+    };
+
+    while (ip < ipEnd) {
+        const uint8_t token = *ip++;
+
+        size_t literalLength = readLength(token >> 4);
+        if (literalLength > static_cast<size_t>(ipEnd - ip) || literalLength > static_cast<size_t>(opEnd - op)) {
+            throw std::runtime_error("corrupt lz4 block!");
+        }
+        memcpy(op, ip, literalLength);
+        ip += literalLength;
+        op += literalLength;
+
+        // The last sequence carries literals only.
+        if (ip == ipEnd) {
+            break;
+        }
+
+        if (ipEnd - ip < 2) {
+            throw std::runtime_error("corrupt lz4 block!");
+        }
+        const size_t offset = ip[0] | (ip[1] << 8);
+        ip += 2;
+
+        size_t matchLength = readLength(token & 0x0f) + 4;
+        if (offset == 0 || offset > static_cast<size_t>(op - dst) || matchLength > static_cast<size_t>(opEnd - op)) {
+            throw std::runtime_error("corrupt lz4 block!");
+        }
+
+        const uint8_t* match = op - offset;
+        if (offset >= matchLength) {
+            memcpy(op, match, matchLength);
+            op += matchLength;
+        }
+        else {
+            // Overlapping copy repeats the last `offset` bytes.
+            while (matchLength--) {
+                *op++ = *match++;
+            }
+        }
+    }
+
+    if (op != opEnd) {
+        throw std::runtime_error("lz4 block decompressed to the wrong size!");
+    }
+}
+
+
+
+// Open Pack ----------------------------------------------------------------------------------------
+AssetPack::AssetPack(const std::string& filename)
+    : file(filename)
+{
+    if (file.size() < sizeof(PackHeader)) {
+        throw std::runtime_error("asset pack is truncated: " + filename);
+    }
+
+    PackHeader header;
+    memcpy(&header, file.data(), sizeof(header));
+
+    if (header.magic != ASSET_PACK_MAGIC || header.version != ASSET_PACK_VERSION) {
+        throw std::runtime_error("not a supported asset pack: " + filename);
+    }
+
+    const size_t indexSize = static_cast<size_t>(header.entryCount) * sizeof(PackEntry);
+    if (file.size() - sizeof(PackHeader) < indexSize) {
+        throw std::runtime_error("asset pack index is truncated: " + filename);
+    }
+
+    // The header is 16 bytes and the mapping is page aligned, so the index can be used in place.
+    entries = { reinterpret_cast<const PackEntry*>(file.data() + sizeof(PackHeader)), header.entryCount };
+
+    for (const auto& entry : entries) {
+        if (entry.offset > file.size() || entry.storedSize > file.size() - entry.offset) {
+            throw std::runtime_error("asset pack entry is out of bounds: " + filename);
+        }
+    }
+}
+
+
+
+// Find ----------------------------------------------------------------------------------------
+const PackEntry* AssetPack::find(std::string_view name) const
+{
+    const uint64_t hash = hashAssetName(name);
+
+    auto it = std::lower_bound(entries.begin(), entries.end(), hash, [](const PackEntry& entry, uint64_t value) {
+        return entry.hash < value;
+    });
+
+    if (it == entries.end() || it->hash != hash) {
+        return nullptr;
+    }
+
+    return &*it;
+}
+
+
+
+// Stored / Read ----------------------------------------------------------------------------------------
+std::span<const std::byte> AssetPack::stored(const PackEntry& entry) const
+{
+    return file.bytes().subspan(entry.offset, entry.storedSize);
+}
+
+void AssetPack::read(const PackEntry& entry, std::span<std::byte> dst) const
+{
+    if (dst.size() < entry.rawSize) {
+        throw std::runtime_error("asset read buffer is too small!");
+    }
+
+    auto src = stored(entry);
+
+    if (entry.flags & ASSET_ENTRY_LZ4) {
+        decompressLz4Block(reinterpret_cast<const uint8_t*>(src.data()), src.size(), reinterpret_cast<uint8_t*>(dst.data()), entry.rawSize);
+    }
+    else {
+        memcpy(dst.data(), src.data(), src.size());
+    }
+}
+
+
+
+// Asset Words ----------------------------------------------------------------------------------------
+std::span<const uint32_t> Asset::words() const
+{
+    if (view.size() % sizeof(uint32_t) != 0 || reinterpret_cast<uintptr_t>(view.data()) % alignof(uint32_t) != 0) {
+        throw std::runtime_error("asset is not a 4-byte aligned word stream!");
+    }
+
+    return { reinterpret_cast<const uint32_t*>(view.data()), view.size() / sizeof(uint32_t) };
+}
+
+
+
+// Asset Loader ----------------------------------------------------------------------------------------
+AssetLoader::AssetLoader(const std::string& packFile, const std::string& looseRoot, bool usePack)
+    : looseRoot(looseRoot)
+{
+    if (usePack && std::filesystem::exists(packFile)) {
+        pack = AssetPack(packFile);
+    }
+}
+
+Asset AssetLoader::load(std::string_view name) const
+{
+    Asset asset;
+
+    if (pack.isOpen()) {
+        const PackEntry* entry = pack.find(name);
+        if (entry == nullptr) {
+            throw std::runtime_error("asset not found in pack: " + std::string(name));
+        }
+
+        if (entry->flags & ASSET_ENTRY_LZ4) {
+            asset.storage.resize((entry->rawSize + sizeof(uint32_t) - 1) / sizeof(uint32_t));
+            auto dst = std::as_writable_bytes(std::span(asset.storage)).first(entry->rawSize);
+            pack.read(*entry, dst);
+            asset.view = dst;
+        }
+        else {
+            asset.view = pack.stored(*entry);
+        }
+
+        return asset;
+    }
+
+    asset.file = MappedFile(looseRoot + "/" + std::string(name));
+    asset.view = asset.file.bytes();
+    return asset;
+}
+
+bool AssetLoader::exists(std::string_view name) const
+{
+    if (pack.isOpen()) {
+        return pack.find(name) != nullptr;
+    }
+    return std::filesystem::exists(looseRoot + "/" + std::string(name));
+}
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "MappedFile.h"
+
+
+//  Pack Format -----------------------------------------------------------------------------------
+// res.pak layout, written by tools/pack_assets.py:
+//   PackHeader | PackEntry[entryCount] sorted by hash | 16-byte aligned payloads
+// Names are hashed with hashBytes() (64-bit FNV-1a) over the path relative to res/, using '/'.
+const uint32_t ASSET_PACK_MAGIC = 0x4b504750; // "PGPK"
+const uint32_t ASSET_PACK_VERSION = 1;
+const uint32_t ASSET_PACK_ALIGNMENT = 16;
+
+const uint32_t ASSET_ENTRY_LZ4 = 1u << 0;
+
+struct PackHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t entryCount;
+    uint32_t reserved;
+};
+
+struct PackEntry {
+    uint64_t hash;
+    uint64_t offset;
+    uint32_t storedSize;
+    uint32_t rawSize;
+    uint32_t flags;
+    uint32_t reserved;
+};
+
+static_assert(sizeof(PackHeader) == 16, "PackHeader must match tools/pack_assets.py");
+static_assert(sizeof(PackEntry) == 32, "PackEntry must match tools/pack_assets.py");
+
+uint64_t hashAssetName(std::string_view name);
+
+
+
+//  CLASS #########################################################################################
+// One mapping of the whole pack; lookups are a binary search over the index.
+class AssetPack
+{
+
+ // Public ----------------------------------------------------------------------------------------
+public:
+    AssetPack() = default;
+    explicit AssetPack(const std::string& filename);
+
+    bool isOpen() const { return !file.empty(); }
+
+    const PackEntry* find(std::string_view name) const;
+
+    // Stored bytes of an entry; only meaningful as content when the entry is not compressed.
+    std::span<const std::byte> stored(const PackEntry& entry) const;
+
+    // Decompresses (or copies) an entry into dst, which must hold entry.rawSize bytes.
+    // dst may point straight into a mapped staging buffer.
+    void read(const PackEntry& entry, std::span<std::byte> dst) const;
+
+
+ // Private ----------------------------------------------------------------------------------------
+private:
+    MappedFile file;
+    std::span<const PackEntry> entries;
+};
+
+
+
+//  CLASS #########################################################################################
+// Bytes of one loaded asset. Uncompressed pack entries are borrowed from the pack mapping;
+// loose files keep their own mapping; compressed entries own a decompressed buffer.
+class Asset
+{
+
+ // Public ----------------------------------------------------------------------------------------
+public:
+    std::span<const std::byte> bytes() const { return view; }
+    std::span<const uint32_t> words() const;
+    size_t size() const { return view.size(); }
+
+
+ // Private ----------------------------------------------------------------------------------------
+private:
+    friend class AssetLoader;
+
+    std::span<const std::byte> view;
+    MappedFile file;
+    std::vector<uint32_t> storage;
+};
+
+
+
+//  CLASS #########################################################################################
+// Resolves asset names like "shaders/vert.spv" against res.pak, or against the loose res/
+// directory when no pack is used (debug builds, or the pack was not built).
+class AssetLoader
+{
+
+ // Public ----------------------------------------------------------------------------------------
+public:
+    AssetLoader(const std::string& packFile, const std::string& looseRoot, bool usePack);
+
+    Asset load(std::string_view name) const;
+
+    // For optional assets, e.g. textures that are only there once the asset build produced them.
+    bool exists(std::string_view name) const;
+
+    const AssetPack& getPack() const { return pack; }
+
+
+ // Private ----------------------------------------------------------------------------------------
+private:
+    AssetPack pack;
+    std::string looseRoot;
+};
@@ -0,0 +1,153 @@
+#include "BindlessTextures.h"
+
+#include <algorithm>
+#include <functional>
+#include <stdexcept>
+
+
+// Init / Cleanup ----------------------------------------------------------------------------------------
+void BindlessTextures::init(VkDevice device, PipelineLayoutCache& layoutCache, DeletionQueue& deletionQueue, uint32_t capacity,
+                            const VkAllocationCallbacks* allocator)
+{
+    this->device = device;
+    this->allocator = allocator;
+    this->deletionQueue = &deletionQueue;
+    this->capacity = capacity;
+
+    VkDescriptorSetLayoutBinding textures{};
+    textures.binding = 0;
+    textures.descriptorType = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+    textures.descriptorCount = capacity;
+    textures.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+
+    VkDescriptorSetLayoutBinding samplerBinding{};
+    samplerBinding.binding = 1;
+    samplerBinding.descriptorType = VK_DESCRIPTOR_TYPE_SAMPLER;
+    samplerBinding.descriptorCount = 1;
+    samplerBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+
+    layoutDesc.bindings = { textures, samplerBinding };
+    layoutDesc.bindingFlags = {
+        VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT_EXT | VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT_EXT | VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT_EXT,
+        0,
+    };
+    layoutDesc.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT_EXT;
+    setLayout = layoutCache.getSetLayout(layoutDesc);
+
+    VkDescriptorPoolSize poolSizes[2]{};
+    poolSizes[0].type = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+    poolSizes[0].descriptorCount = capacity;
+    poolSizes[1].type = VK_DESCRIPTOR_TYPE_SAMPLER;
+    poolSizes[1].descriptorCount = 1;
+
+    VkDescriptorPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT_EXT;
+    poolInfo.maxSets = 1;
+    poolInfo.poolSizeCount = 2;
+    poolInfo.pPoolSizes = poolSizes;
+
+    if (vkCreateDescriptorPool(device, &poolInfo, allocator, &descriptorPool) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create bindless descriptor pool!");
+    }
+
+    VkDescriptorSetAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorPool = descriptorPool;
+    allocInfo.descriptorSetCount = 1;
+    allocInfo.pSetLayouts = &setLayout;
+
+    if (vkAllocateDescriptorSets(device, &allocInfo, &descriptorSet) != VK_SUCCESS) {
+        throw std::runtime_error("failed to allocate bindless descriptor set!");
+    }
+
+    VkSamplerCreateInfo samplerInfo{};
+    samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+    samplerInfo.magFilter = VK_FILTER_LINEAR;
+    samplerInfo.minFilter = VK_FILTER_LINEAR;
+    samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+    samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.maxLod = VK_LOD_CLAMP_NONE;
+
+    if (vkCreateSampler(device, &samplerInfo, allocator, &sampler) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create bindless sampler!");
+    }
+
+    VkDescriptorImageInfo samplerDescriptor{};
+    samplerDescriptor.sampler = sampler;
+
+    VkWriteDescriptorSet write{};
+    write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    write.dstSet = descriptorSet;
+    write.dstBinding = 1;
+    write.descriptorCount = 1;
+    write.descriptorType = VK_DESCRIPTOR_TYPE_SAMPLER;
+    write.pImageInfo = &samplerDescriptor;
+    vkUpdateDescriptorSets(device, 1, &write, 0, nullptr);
+
+    freeSlots.resize(capacity);
+    for (uint32_t i = 0; i < capacity; i++) {
+        freeSlots[i] = capacity - 1 - i;
+    }
+}
+
+void BindlessTextures::cleanup()
+{
+    vkDestroySampler(device, sampler, allocator);
+    vkDestroyDescriptorPool(device, descriptorPool, allocator);
+    sampler = VK_NULL_HANDLE;
+    descriptorPool = VK_NULL_HANDLE;
+    descriptorSet = VK_NULL_HANDLE;
+    freeSlots.clear();
+    used = 0;
+}
+
+
+
+// Add / Remove ----------------------------------------------------------------------------------------
+uint32_t BindlessTextures::add(VkImageView imageView)
+{
+    if (freeSlots.empty()) {
+        throw std::runtime_error("bindless texture array is full!");
+    }
+
+    const uint32_t index = freeSlots.back();
+    freeSlots.pop_back();
+    used++;
+
+    VkDescriptorImageInfo imageInfo{};
+    imageInfo.imageView = imageView;
+    imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+    VkWriteDescriptorSet write{};
+    write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    write.dstSet = descriptorSet;
+    write.dstBinding = 0;
+    write.dstArrayElement = index;
+    write.descriptorCount = 1;
+    write.descriptorType = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+    write.pImageInfo = &imageInfo;
+    vkUpdateDescriptorSets(device, 1, &write, 0, nullptr);
+
+    return index;
+}
+
+void BindlessTextures::remove(uint32_t index)
+{
+    used--;
+
+    // Frames in flight may still sample the slot.
+    deletionQueue->defer([this, index]() {
+        freeSlots.insert(std::upper_bound(freeSlots.begin(), freeSlots.end(), index, std::greater<uint32_t>()), index);
+    });
+}
+
+
+
+// Bind ----------------------------------------------------------------------------------------
+void BindlessTextures::bind(VkCommandBuffer commandBuffer, VkPipelineLayout layout, uint32_t set)
+{
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, layout, set, 1, &descriptorSet, 0, nullptr);
+}
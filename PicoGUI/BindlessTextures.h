@@ -0,0 +1,60 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <cstdint>
+#include <vector>
+
+#include "DeletionQueue.h"
+#include "PipelineLayoutCache.h"
+
+
+//  CLASS #########################################################################################
+// One descriptor set holding a large, partially bound array of sampled images plus a shared
+// sampler, for devices with VK_EXT_descriptor_indexing. The set is bound once and shaders index
+// the array with a per-instance texture index, so quads using any mix of textures still render in
+// one draw.
+//
+// The array binding is UPDATE_AFTER_BIND and UPDATE_UNUSED_WHILE_PENDING: add() writes a new slot
+// while frames that do not use it are in flight. Removed slots are reused only after every frame
+// that could still sample them has finished.
+class BindlessTextures
+{
+
+ // Public ----------------------------------------------------------------------------------------
+public:
+    void init(VkDevice device, PipelineLayoutCache& layoutCache, DeletionQueue& deletionQueue, uint32_t capacity,
+              const VkAllocationCallbacks* allocator = nullptr);
+    void cleanup();
+
+    // The set layout shaders must declare: binding 0 texture2D[], binding 1 sampler.
+    const DescriptorSetLayoutDesc& getLayoutDesc() const { return layoutDesc; }
+
+    // Returns the array index of the view. Slots are handed out lowest first.
+    uint32_t add(VkImageView imageView);
+
+    // The slot goes back to the free list through the deletion queue.
+    void remove(uint32_t index);
+
+    void bind(VkCommandBuffer commandBuffer, VkPipelineLayout layout, uint32_t set);
+    VkDescriptorSet getDescriptorSet() const { return descriptorSet; }
+
+    uint32_t getCapacity() const { return capacity; }
+    uint32_t size() const { return used; }
+
+
+ // Private ----------------------------------------------------------------------------------------
+private:
+    VkDevice device = VK_NULL_HANDLE;
+    const VkAllocationCallbacks* allocator = nullptr;
+    uint32_t capacity = 0;
+    DeletionQueue* deletionQueue = nullptr;
+
+    DescriptorSetLayoutDesc layoutDesc;
+    VkDescriptorSetLayout setLayout = VK_NULL_HANDLE;
+    VkDescriptorPool descriptorPool = VK_NULL_HANDLE;
+    VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+    VkSampler sampler = VK_NULL_HANDLE;
+
+    std::vector<uint32_t> freeSlots;        // descending, so the lowest index is at the back
+    uint32_t used = 0;
+};
@@ -0,0 +1,151 @@
+#include "DeletionQueue.h"
+
+#include <algorithm>
+#include <iterator>
+
+
+// Init / Cleanup ----------------------------------------------------------------------------------------
+void DeletionQueue::init(VkDevice device, GpuAllocator& gpuAllocator, uint32_t framesInFlight)
+{
+    this->device = device;
+    this->gpuAllocator = &gpuAllocator;
+    this->framesInFlight = framesInFlight;
+}
+
+void DeletionQueue::cleanup()
+{
+    // Callbacks may queue more work, which lands in new batches, so drain until nothing is left.
+    while (!batches.empty()) {
+        retireFront();
+    }
+}
+
+
+
+// Begin Frame ----------------------------------------------------------------------------------------
+void DeletionQueue::beginFrame(uint64_t frameNumber)
+{
+    this->frameNumber = frameNumber;
+
+    while (!batches.empty() && batches.front().retireFrame <= frameNumber) {
+        retireFront();
+    }
+}
+
+
+
+// Queue ----------------------------------------------------------------------------------------
+void DeletionQueue::destroyPipeline(VkPipeline pipeline, const VkAllocationCallbacks* allocator, uint64_t lastUsedFrame)
+{
+    batchFor(lastUsedFrame).pipelines.emplace_back(pipeline, allocator);
+}
+
+void DeletionQueue::destroyFramebuffer(VkFramebuffer framebuffer, const VkAllocationCallbacks* allocator, uint64_t lastUsedFrame)
+{
+    batchFor(lastUsedFrame).framebuffers.emplace_back(framebuffer, allocator);
+}
+
+void DeletionQueue::destroyImageView(VkImageView imageView, const VkAllocationCallbacks* allocator, uint64_t lastUsedFrame)
+{
+    batchFor(lastUsedFrame).imageViews.emplace_back(imageView, allocator);
+}
+
+void DeletionQueue::destroySampler(VkSampler sampler, const VkAllocationCallbacks* allocator, uint64_t lastUsedFrame)
+{
+    batchFor(lastUsedFrame).samplers.emplace_back(sampler, allocator);
+}
+
+void DeletionQueue::destroyDescriptorPool(VkDescriptorPool descriptorPool, const VkAllocationCallbacks* allocator, uint64_t lastUsedFrame)
+{
+    batchFor(lastUsedFrame).descriptorPools.emplace_back(descriptorPool, allocator);
+}
+
+void DeletionQueue::destroyBuffer(VkBuffer buffer, const GpuAllocation& allocation, uint64_t lastUsedFrame)
+{
+    batchFor(lastUsedFrame).buffers.emplace_back(buffer, allocation);
+}
+
+void DeletionQueue::destroyImage(VkImage image, const GpuAllocation& allocation, uint64_t lastUsedFrame)
+{
+    batchFor(lastUsedFrame).images.emplace_back(image, allocation);
+}
+
+void DeletionQueue::free(const GpuAllocation& allocation, uint64_t lastUsedFrame)
+{
+    batchFor(lastUsedFrame).allocations.push_back(allocation);
+}
+
+void DeletionQueue::defer(std::function<void()> callback, uint64_t lastUsedFrame)
+{
+    batchFor(lastUsedFrame).callbacks.push_back(std::move(callback));
+}
+
+DeletionQueue::Batch& DeletionQueue::batchFor(uint64_t lastUsedFrame)
+{
+    // Frame N's fence is waited on when its slot is reused by frame N + framesInFlight.
+    const uint64_t retireFrame = std::min(lastUsedFrame, frameNumber) + framesInFlight;
+    stats.queued++;
+    stats.pending++;
+
+    // Nearly everything is queued for the current frame, which is the newest batch.
+    auto it = batches.end();
+    while (it != batches.begin() && std::prev(it)->retireFrame > retireFrame) {
+        --it;
+    }
+    if (it != batches.begin() && std::prev(it)->retireFrame == retireFrame) {
+        return *std::prev(it);
+    }
+
+    Batch batch;
+    batch.retireFrame = retireFrame;
+    return *batches.insert(it, std::move(batch));
+}
+
+
+
+// Destroy ----------------------------------------------------------------------------------------
+void DeletionQueue::retireFront()
+{
+    // Take the batch out of the deque first: a callback that calls defer() may insert into it,
+    // which would invalidate a reference to the front or append to the vector being iterated.
+    Batch batch = std::move(batches.front());
+    batches.pop_front();
+    destroyBatch(batch);
+}
+
+void DeletionQueue::destroyBatch(Batch& batch)
+{
+    for (auto& [pipeline, allocator] : batch.pipelines) {
+        vkDestroyPipeline(device, pipeline, allocator);
+    }
+    for (auto& [framebuffer, allocator] : batch.framebuffers) {
+        vkDestroyFramebuffer(device, framebuffer, allocator);
+    }
+    for (auto& [imageView, allocator] : batch.imageViews) {
+        vkDestroyImageView(device, imageView, allocator);
+    }
+    for (auto& [sampler, allocator] : batch.samplers) {
+        vkDestroySampler(device, sampler, allocator);
+    }
+    for (auto& [descriptorPool, allocator] : batch.descriptorPools) {
+        vkDestroyDescriptorPool(device, descriptorPool, allocator);
+    }
+    for (auto& [buffer, allocation] : batch.buffers) {
+        gpuAllocator->destroyBuffer(buffer, allocation);
+    }
+    for (auto& [image, allocation] : batch.images) {
+        gpuAllocator->destroyImage(image, allocation);
+    }
+    for (GpuAllocation& allocation : batch.allocations) {
+        gpuAllocator->free(allocation);
+    }
+    for (auto& callback : batch.callbacks) {
+        callback();
+    }
+
+    const size_t count = batch.pipelines.size() + batch.framebuffers.size() + batch.imageViews.size() + batch.samplers.size()
+        + batch.descriptorPools.size() + batch.buffers.size() + batch.images.size() + batch.allocations.size() + batch.callbacks.size();
+    stats.destroyed += count;
+    stats.pending -= static_cast<uint32_t>(count);
+    stats.batches++;
+}
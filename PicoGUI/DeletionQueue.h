@@ -0,0 +1,92 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <utility>
+#include <vector>
+
+#include "GpuAllocator.h"
+
+
+//  CLASS #########################################################################################
+// Destroys Vulkan objects once no frame in flight can still use them, so a resource can be
+// released in the middle of a session without vkDeviceWaitIdle. Each handle is queued with the
+// frame that last used it, by default the frame being recorded, and is destroyed at beginFrame()
+// of the frame that reuses that frame's slot, whose fence has then been waited on.
+//
+// Handles retiring in the same frame are kept in one batch and destroyed together, dependents
+// first: pipelines and views before the images and memory they refer to, callbacks last. Handles
+// are queued with the allocation callbacks they were created with.
+class DeletionQueue
+{
+
+ // Public ----------------------------------------------------------------------------------------
+public:
+    // Pass as lastUsedFrame for resources used by the frame being recorded.
+    static constexpr uint64_t CURRENT_FRAME = UINT64_MAX;
+
+    struct Stats {
+        uint64_t queued = 0;
+        uint64_t destroyed = 0;
+        uint64_t batches = 0;
+        uint32_t pending = 0;
+    };
+
+    void init(VkDevice device, GpuAllocator& gpuAllocator, uint32_t framesInFlight);
+
+    // Destroys everything still queued. Call after vkDeviceWaitIdle, before the owners of queued
+    // callbacks are cleaned up.
+    void cleanup();
+
+    // Call first thing each frame, after waiting for the frame's fence.
+    void beginFrame(uint64_t frameNumber);
+
+    void destroyPipeline(VkPipeline pipeline, const VkAllocationCallbacks* allocator, uint64_t lastUsedFrame = CURRENT_FRAME);
+    void destroyFramebuffer(VkFramebuffer framebuffer, const VkAllocationCallbacks* allocator, uint64_t lastUsedFrame = CURRENT_FRAME);
+    void destroyImageView(VkImageView imageView, const VkAllocationCallbacks* allocator, uint64_t lastUsedFrame = CURRENT_FRAME);
+    void destroySampler(VkSampler sampler, const VkAllocationCallbacks* allocator, uint64_t lastUsedFrame = CURRENT_FRAME);
+    void destroyDescriptorPool(VkDescriptorPool descriptorPool, const VkAllocationCallbacks* allocator, uint64_t lastUsedFrame = CURRENT_FRAME);
+    void destroyBuffer(VkBuffer buffer, const GpuAllocation& allocation, uint64_t lastUsedFrame = CURRENT_FRAME);
+    void destroyImage(VkImage image, const GpuAllocation& allocation, uint64_t lastUsedFrame = CURRENT_FRAME);
+    void free(const GpuAllocation& allocation, uint64_t lastUsedFrame = CURRENT_FRAME);
+
+    // For anything else that must wait for the GPU, e.g. returning a descriptor slot to a free list.
+    // Callbacks may themselves queue more work; it is retired with a later batch.
+    void defer(std::function<void()> callback, uint64_t lastUsedFrame = CURRENT_FRAME);
+
+    uint64_t getFrameNumber() const { return frameNumber; }
+    const Stats& getStats() const { return stats; }
+
+
+ // Private ----------------------------------------------------------------------------------------
+private:
+    template<typename Handle>
+    using Queued = std::pair<Handle, const VkAllocationCallbacks*>;
+
+    struct Batch {
+        uint64_t retireFrame = 0;
+        std::vector<Queued<VkPipeline>> pipelines;
+        std::vector<Queued<VkFramebuffer>> framebuffers;
+        std::vector<Queued<VkImageView>> imageViews;
+        std::vector<Queued<VkSampler>> samplers;
+        std::vector<Queued<VkDescriptorPool>> descriptorPools;
+        std::vector<std::pair<VkBuffer, GpuAllocation>> buffers;
+        std::vector<std::pair<VkImage, GpuAllocation>> images;
+        std::vector<GpuAllocation> allocations;
+        std::vector<std::function<void()>> callbacks;
+    };
+
+    VkDevice device = VK_NULL_HANDLE;
+    GpuAllocator* gpuAllocator = nullptr;
+    uint32_t framesInFlight = 1;
+    uint64_t frameNumber = 0;
+
+    std::deque<Batch> batches;      // ordered by retireFrame
+    Stats stats;
+
+    Batch& batchFor(uint64_t lastUsedFrame);
+    void retireFront();
+    void destroyBatch(Batch& batch);
+};
@@ -0,0 +1,223 @@
+#include "DescriptorAllocator.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+
+namespace {
+
+constexpr uint32_t FIRST_POOL_SETS = 64;
+constexpr uint32_t MAX_POOL_SETS = 4096;
+
+// Descriptors of each type per set in a pool; generous for UI sets, which hold a handful each.
+struct PoolRatio {
+    VkDescriptorType type;
+    float perSet;
+};
+
+constexpr PoolRatio POOL_RATIOS[] = {
+    { VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1.0f },
+    { VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1.0f },
+    { VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1.0f },
+    { VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, 1.0f },
+    { VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 2.0f },
+    { VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, 2.0f },
+    { VK_DESCRIPTOR_TYPE_SAMPLER, 1.0f },
+    { VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 0.5f },
+};
+
+void hashCombine(size_t& seed, uint64_t value)
+{
+    seed ^= std::hash<uint64_t>{}(value) + 0x9e3779b97f4a7c15ull + (seed << 6) + (seed >> 2);
+}
+
+bool isImageDescriptor(VkDescriptorType type)
+{
+    return type == VK_DESCRIPTOR_TYPE_SAMPLER || type == VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER
+        || type == VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE || type == VK_DESCRIPTOR_TYPE_STORAGE_IMAGE
+        || type == VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
+}
+
+} // namespace
+
+
+
+// Descriptor Writes ----------------------------------------------------------------------------------------
+DescriptorWrite DescriptorWrite::bufferWrite(uint32_t binding, VkDescriptorType type, VkBuffer buffer, VkDeviceSize offset, VkDeviceSize range)
+{
+    DescriptorWrite write;
+    write.binding = binding;
+    write.type = type;
+    write.buffer.buffer = buffer;
+    write.buffer.offset = offset;
+    write.buffer.range = range;
+    return write;
+}
+
+DescriptorWrite DescriptorWrite::imageWrite(uint32_t binding, VkDescriptorType type, VkImageView imageView, VkSampler sampler, VkImageLayout layout)
+{
+    DescriptorWrite write;
+    write.binding = binding;
+    write.type = type;
+    write.image.imageView = imageView;
+    write.image.sampler = sampler;
+    write.image.imageLayout = layout;
+    return write;
+}
+
+bool DescriptorWrite::operator==(const DescriptorWrite& other) const
+{
+    return binding == other.binding && type == other.type
+        && buffer.buffer == other.buffer.buffer && buffer.offset == other.buffer.offset && buffer.range == other.buffer.range
+        && image.imageView == other.image.imageView && image.sampler == other.image.sampler && image.imageLayout == other.image.imageLayout;
+}
+
+size_t DescriptorAllocator::SetKeyHash::operator()(const SetKey& key) const
+{
+    size_t seed = 0;
+    hashCombine(seed, reinterpret_cast<uint64_t>(key.layout));
+    for (const auto& write : key.writes) {
+        hashCombine(seed, (uint64_t(write.binding) << 32) | write.type);
+        hashCombine(seed, reinterpret_cast<uint64_t>(write.buffer.buffer));
+        hashCombine(seed, write.buffer.offset ^ (write.buffer.range << 1));
+        hashCombine(seed, reinterpret_cast<uint64_t>(write.image.imageView));
+        hashCombine(seed, reinterpret_cast<uint64_t>(write.image.sampler));
+    }
+    return seed;
+}
+
+
+
+// Init / Cleanup ----------------------------------------------------------------------------------------
+void DescriptorAllocator::init(VkDevice device, PipelineLayoutCache& layoutCache, uint32_t framesInFlight,
+                               const VkAllocationCallbacks* allocator)
+{
+    this->device = device;
+    this->allocator = allocator;
+    this->layoutCache = &layoutCache;
+    frames.resize(framesInFlight);
+}
+
+void DescriptorAllocator::cleanup()
+{
+    for (Frame& frame : frames) {
+        for (VkDescriptorPool pool : frame.pools) {
+            vkDestroyDescriptorPool(device, pool, allocator);
+        }
+    }
+    frames.clear();
+    stats.poolCount = 0;
+}
+
+
+
+// Begin Frame ----------------------------------------------------------------------------------------
+void DescriptorAllocator::beginFrame(uint32_t frameIndex)
+{
+    this->frameIndex = frameIndex;
+
+    Frame& frame = frames[frameIndex];
+    for (size_t i = 0; i <= frame.activePool && i < frame.pools.size(); i++) {
+        vkResetDescriptorPool(device, frame.pools[i], 0);
+    }
+    frame.activePool = 0;
+    frame.cache.clear();
+}
+
+
+
+// Get ----------------------------------------------------------------------------------------
+VkDescriptorSet DescriptorAllocator::get(const DescriptorSetLayoutDesc& layout, std::span<const DescriptorWrite> writes)
+{
+    return get(layoutCache->getSetLayout(layout), writes);
+}
+
+VkDescriptorSet DescriptorAllocator::get(VkDescriptorSetLayout layout, std::span<const DescriptorWrite> writes)
+{
+    Frame& frame = frames[frameIndex];
+
+    SetKey key{ layout, std::vector<DescriptorWrite>(writes.begin(), writes.end()) };
+    auto it = frame.cache.find(key);
+    if (it != frame.cache.end()) {
+        stats.cacheHits++;
+        return it->second;
+    }
+
+    VkDescriptorSet set = allocate(layout);
+
+    std::vector<VkWriteDescriptorSet> descriptorWrites(writes.size());
+    for (size_t i = 0; i < writes.size(); i++) {
+        VkWriteDescriptorSet& write = descriptorWrites[i];
+        write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        write.dstSet = set;
+        write.dstBinding = writes[i].binding;
+        write.descriptorCount = 1;
+        write.descriptorType = writes[i].type;
+        if (isImageDescriptor(writes[i].type)) {
+            write.pImageInfo = &writes[i].image;
+        }
+        else {
+            write.pBufferInfo = &writes[i].buffer;
+        }
+    }
+    vkUpdateDescriptorSets(device, static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
+
+    frame.cache.emplace(std::move(key), set);
+    return set;
+}
+
+VkDescriptorSet DescriptorAllocator::allocate(VkDescriptorSetLayout layout)
+{
+    Frame& frame = frames[frameIndex];
+
+    VkDescriptorSetAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorSetCount = 1;
+    allocInfo.pSetLayouts = &layout;
+
+    while (true) {
+        const bool newPool = frame.activePool == frame.pools.size();
+        if (newPool) {
+            // Each pool doubles the previous one, so a busy frame settles on a few large pools.
+            const uint32_t maxSets = std::min(FIRST_POOL_SETS << std::min<size_t>(frame.pools.size(), 16), MAX_POOL_SETS);
+            frame.pools.push_back(createPool(maxSets));
+        }
+
+        allocInfo.descriptorPool = frame.pools[frame.activePool];
+
+        VkDescriptorSet set;
+        const VkResult result = vkAllocateDescriptorSets(device, &allocInfo, &set);
+        if (result == VK_SUCCESS) {
+            stats.setsAllocated++;
+            return set;
+        }
+
+        if ((result != VK_ERROR_OUT_OF_POOL_MEMORY && result != VK_ERROR_FRAGMENTED_POOL) || newPool) {
+            throw std::runtime_error("failed to allocate descriptor set!");
+        }
+
+        frame.activePool++;
+    }
+}
+
+VkDescriptorPool DescriptorAllocator::createPool(uint32_t maxSets)
+{
+    std::vector<VkDescriptorPoolSize> poolSizes;
+    for (const PoolRatio& ratio : POOL_RATIOS) {
+        poolSizes.push_back({ ratio.type, std::max(1u, static_cast<uint32_t>(ratio.perSet * maxSets)) });
+    }
+
+    VkDescriptorPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.maxSets = maxSets;
+    poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+    poolInfo.pPoolSizes = poolSizes.data();
+
+    VkDescriptorPool pool;
+    if (vkCreateDescriptorPool(device, &poolInfo, allocator, &pool) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create descriptor pool!");
+    }
+
+    stats.poolCount++;
+    return pool;
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <cstdint>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+#include "PipelineLayoutCache.h"
+
+
+//  Descriptor Writes -----------------------------------------------------------------------------
+// Contents of one binding of a transient descriptor set. Fill buffer or image to match type.
+struct DescriptorWrite {
+    uint32_t binding = 0;
+    VkDescriptorType type = VK_DESCRIPTOR_TYPE_MAX_ENUM;
+    VkDescriptorBufferInfo buffer{};
+    VkDescriptorImageInfo image{};
+
+    static DescriptorWrite bufferWrite(uint32_t binding, VkDescriptorType type, VkBuffer buffer, VkDeviceSize offset, VkDeviceSize range);
+    static DescriptorWrite imageWrite(uint32_t binding, VkDescriptorType type, VkImageView imageView, VkSampler sampler,
+                                      VkImageLayout layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+
+    bool operator==(const DescriptorWrite& other) const;
+};
+
+
+
+//  CLASS #########################################################################################
+// Hands out descriptor sets that live for one frame. Each frame in flight owns a list of pools;
+// sets are bump-allocated from them, a new, larger pool is added when the current one runs out,
+// and beginFrame() resets the whole list with one vkResetDescriptorPool per pool once the GPU is
+// done with that frame. Nothing is ever freed individually, so pools cannot fragment no matter
+// how long the application runs.
+//
+// Requests for a set with the same layout and contents as one already handed out this frame get
+// that set back instead of a new one. Layouts come from the PipelineLayoutCache, so equal layout
+// descriptions share one handle.
+class DescriptorAllocator
+{
+
+ // Public ----------------------------------------------------------------------------------------
+public:
+    struct Stats {
+        uint64_t setsAllocated = 0;
+        uint64_t cacheHits = 0;
+        uint32_t poolCount = 0;
+    };
+
+    void init(VkDevice device, PipelineLayoutCache& layoutCache, uint32_t framesInFlight, const VkAllocationCallbacks* allocator = nullptr);
+    void cleanup();
+
+    // Call after waiting for the fence of the frame that last used frameIndex.
+    void beginFrame(uint32_t frameIndex);
+
+    VkDescriptorSet get(VkDescriptorSetLayout layout, std::span<const DescriptorWrite> writes);
+    VkDescriptorSet get(const DescriptorSetLayoutDesc& layout, std::span<const DescriptorWrite> writes);
+
+    const Stats& getStats() const { return stats; }
+
+
+ // Private ----------------------------------------------------------------------------------------
+private:
+    struct SetKey {
+        VkDescriptorSetLayout layout;
+        std::vector<DescriptorWrite> writes;
+
+        bool operator==(const SetKey& other) const { return layout == other.layout && writes == other.writes; }
+    };
+
+    struct SetKeyHash {
+        size_t operator()(const SetKey& key) const;
+    };
+
+    struct Frame {
+        std::vector<VkDescriptorPool> pools;
+        size_t activePool = 0;
+        std::unordered_map<SetKey, VkDescriptorSet, SetKeyHash> cache;
+    };
+
+    VkDevice device = VK_NULL_HANDLE;
+    const VkAllocationCallbacks* allocator = nullptr;
+    PipelineLayoutCache* layoutCache = nullptr;
+    std::vector<Frame> frames;
+    uint32_t frameIndex = 0;
+    Stats stats;
+
+    VkDescriptorSet allocate(VkDescriptorSetLayout layout);
+    VkDescriptorPool createPool(uint32_t maxSets);
+};
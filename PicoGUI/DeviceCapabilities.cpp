@@ -0,0 +1,177 @@
+#include "DeviceCapabilities.h"
+
+#include <algorithm>
+#include <cstring>
+
+
+// Has Device Extension ----------------------------------------------------------------------------------------
+bool hasDeviceExtension(const std::vector<VkExtensionProperties>& extensions, const char* name)
+{
+    for (const auto& extension : extensions) {
+        if (strcmp(extension.extensionName, name) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+
+
+// Query Device Capabilities ----------------------------------------------------------------------------------------
+DeviceCapabilities queryDeviceCapabilities(VkPhysicalDevice physicalDevice)
+{
+    DeviceCapabilities capabilities;
+
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+    capabilities.apiVersion = properties.apiVersion;
+
+    VkPhysicalDeviceFeatures features;
+    vkGetPhysicalDeviceFeatures(physicalDevice, &features);
+    capabilities.textureCompressionBC = features.textureCompressionBC;
+
+    // Everything below is queried through the Vulkan 1.1 *2 entry points.
+    if (properties.apiVersion < VK_API_VERSION_1_1) {
+        return capabilities;
+    }
+
+    uint32_t extensionCount;
+    vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, nullptr);
+
+    std::vector<VkExtensionProperties> extensions(extensionCount);
+    vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, extensions.data());
+
+    VkPhysicalDeviceFeatures2 features2{};
+    features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+
+    VkPhysicalDeviceProperties2 properties2{};
+    properties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+
+    auto chainIf = [](bool supported, auto& head, void* next) {
+        if (supported) {
+            static_cast<VkBaseOutStructure*>(next)->pNext = static_cast<VkBaseOutStructure*>(head.pNext);
+            head.pNext = next;
+        }
+    };
+
+    VkPhysicalDeviceGraphicsPipelineLibraryFeaturesEXT graphicsPipelineLibraryFeatures{};
+    graphicsPipelineLibraryFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_GRAPHICS_PIPELINE_LIBRARY_FEATURES_EXT;
+
+    VkPhysicalDeviceGraphicsPipelineLibraryPropertiesEXT graphicsPipelineLibraryProperties{};
+    graphicsPipelineLibraryProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_GRAPHICS_PIPELINE_LIBRARY_PROPERTIES_EXT;
+
+    const bool hasGraphicsPipelineLibrary = hasDeviceExtension(extensions, VK_KHR_PIPELINE_LIBRARY_EXTENSION_NAME) && hasDeviceExtension(extensions, VK_EXT_GRAPHICS_PIPELINE_LIBRARY_EXTENSION_NAME);
+    chainIf(hasGraphicsPipelineLibrary, features2, &graphicsPipelineLibraryFeatures);
+    chainIf(hasGraphicsPipelineLibrary, properties2, &graphicsPipelineLibraryProperties);
+
+    VkPhysicalDeviceExtendedDynamicStateFeaturesEXT extendedDynamicStateFeatures{};
+    extendedDynamicStateFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTENDED_DYNAMIC_STATE_FEATURES_EXT;
+
+    const bool hasExtendedDynamicState = hasDeviceExtension(extensions, VK_EXT_EXTENDED_DYNAMIC_STATE_EXTENSION_NAME);
+    chainIf(hasExtendedDynamicState, features2, &extendedDynamicStateFeatures);
+
+    VkPhysicalDeviceExtendedDynamicState2FeaturesEXT extendedDynamicState2Features{};
+    extendedDynamicState2Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTENDED_DYNAMIC_STATE_2_FEATURES_EXT;
+
+    const bool hasExtendedDynamicState2 = hasDeviceExtension(extensions, VK_EXT_EXTENDED_DYNAMIC_STATE_2_EXTENSION_NAME);
+    chainIf(hasExtendedDynamicState2, features2, &extendedDynamicState2Features);
+
+    // Promoted to Vulkan 1.2, but the instance targets 1.1, so it is always enabled as the extension.
+    VkPhysicalDeviceDescriptorIndexingFeaturesEXT descriptorIndexingFeatures{};
+    descriptorIndexingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES_EXT;
+
+    VkPhysicalDeviceDescriptorIndexingPropertiesEXT descriptorIndexingProperties{};
+    descriptorIndexingProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES_EXT;
+
+    const bool hasDescriptorIndexing = hasDeviceExtension(extensions, VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME);
+    chainIf(hasDescriptorIndexing, features2, &descriptorIndexingFeatures);
+    chainIf(hasDescriptorIndexing, properties2, &descriptorIndexingProperties);
+
+    vkGetPhysicalDeviceFeatures2(physicalDevice, &features2);
+    vkGetPhysicalDeviceProperties2(physicalDevice, &properties2);
+
+    capabilities.graphicsPipelineLibrary = hasGraphicsPipelineLibrary && graphicsPipelineLibraryFeatures.graphicsPipelineLibrary;
+    capabilities.graphicsPipelineLibraryFastLinking = capabilities.graphicsPipelineLibrary && graphicsPipelineLibraryProperties.graphicsPipelineLibraryFastLinking;
+
+    capabilities.extendedDynamicState = hasExtendedDynamicState && extendedDynamicStateFeatures.extendedDynamicState;
+    capabilities.extendedDynamicState2 = hasExtendedDynamicState2 && extendedDynamicState2Features.extendedDynamicState2;
+
+    capabilities.memoryBudget = hasDeviceExtension(extensions, VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+
+    capabilities.incrementalPresent = hasDeviceExtension(extensions, VK_KHR_INCREMENTAL_PRESENT_EXTENSION_NAME);
+
+    capabilities.descriptorIndexing = hasDescriptorIndexing
+        && descriptorIndexingFeatures.shaderSampledImageArrayNonUniformIndexing
+        && descriptorIndexingFeatures.descriptorBindingSampledImageUpdateAfterBind
+        && descriptorIndexingFeatures.descriptorBindingUpdateUnusedWhilePending
+        && descriptorIndexingFeatures.descriptorBindingPartiallyBound
+        && descriptorIndexingFeatures.runtimeDescriptorArray;
+    capabilities.maxBindlessTextures = capabilities.descriptorIndexing
+        ? std::min(descriptorIndexingProperties.maxDescriptorSetUpdateAfterBindSampledImages, descriptorIndexingProperties.maxPerStageDescriptorUpdateAfterBindSampledImages)
+        : 0;
+
+    return capabilities;
+}
+
+
+
+// Device Enable Info ----------------------------------------------------------------------------------------
+DeviceEnableInfo::DeviceEnableInfo(const DeviceCapabilities& capabilities, const std::vector<const char*>& requiredExtensions)
+    : extensions(requiredExtensions)
+{
+    features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    features2.features.textureCompressionBC = capabilities.textureCompressionBC;
+
+    if (capabilities.graphicsPipelineLibrary) {
+        extensions.push_back(VK_KHR_PIPELINE_LIBRARY_EXTENSION_NAME);
+        extensions.push_back(VK_EXT_GRAPHICS_PIPELINE_LIBRARY_EXTENSION_NAME);
+
+        graphicsPipelineLibraryFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_GRAPHICS_PIPELINE_LIBRARY_FEATURES_EXT;
+        graphicsPipelineLibraryFeatures.graphicsPipelineLibrary = VK_TRUE;
+        chain(&graphicsPipelineLibraryFeatures);
+    }
+
+    if (capabilities.extendedDynamicState) {
+        extensions.push_back(VK_EXT_EXTENDED_DYNAMIC_STATE_EXTENSION_NAME);
+
+        extendedDynamicStateFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTENDED_DYNAMIC_STATE_FEATURES_EXT;
+        extendedDynamicStateFeatures.extendedDynamicState = VK_TRUE;
+        chain(&extendedDynamicStateFeatures);
+    }
+
+    if (capabilities.extendedDynamicState2) {
+        extensions.push_back(VK_EXT_EXTENDED_DYNAMIC_STATE_2_EXTENSION_NAME);
+
+        extendedDynamicState2Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTENDED_DYNAMIC_STATE_2_FEATURES_EXT;
+        extendedDynamicState2Features.extendedDynamicState2 = VK_TRUE;
+        chain(&extendedDynamicState2Features);
+    }
+
+    if (capabilities.memoryBudget) {
+        extensions.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+    }
+
+    if (capabilities.incrementalPresent) {
+        extensions.push_back(VK_KHR_INCREMENTAL_PRESENT_EXTENSION_NAME);
+    }
+
+    if (capabilities.descriptorIndexing) {
+        extensions.push_back(VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME);
+
+        descriptorIndexingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES_EXT;
+        descriptorIndexingFeatures.shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
+        descriptorIndexingFeatures.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+        descriptorIndexingFeatures.descriptorBindingUpdateUnusedWhilePending = VK_TRUE;
+        descriptorIndexingFeatures.descriptorBindingPartiallyBound = VK_TRUE;
+        descriptorIndexingFeatures.runtimeDescriptorArray = VK_TRUE;
+        chain(&descriptorIndexingFeatures);
+    }
+}
+
+void DeviceEnableInfo::chain(void* feature)
+{
+    // Every Vulkan feature struct starts with sType followed by pNext.
+    auto* header = static_cast<VkBaseOutStructure*>(feature);
+    header->pNext = static_cast<VkBaseOutStructure*>(features2.pNext);
+    features2.pNext = header;
+}
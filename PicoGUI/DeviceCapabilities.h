@@ -0,0 +1,60 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <vector>
+
+
+//  Device Capabilities ---------------------------------------------------------------------------
+// Optional device features PicoGUI can take advantage of. Everything here has a fallback,
+// so a device missing all of them is still suitable.
+struct DeviceCapabilities {
+    uint32_t apiVersion = VK_API_VERSION_1_0;
+
+    bool graphicsPipelineLibrary = false;
+    bool graphicsPipelineLibraryFastLinking = false;
+
+    bool extendedDynamicState = false;          // cull mode, front face, primitive topology
+    bool extendedDynamicState2 = false;         // primitive restart
+
+    bool memoryBudget = false;                  // VK_EXT_memory_budget
+
+    bool incrementalPresent = false;            // VK_KHR_incremental_present, damage hints for the compositor
+
+    bool textureCompressionBC = false;          // BC1 - BC7 sampled images
+
+    bool descriptorIndexing = false;            // update-after-bind, partially bound, non-uniform sampled image arrays
+    uint32_t maxBindlessTextures = 0;
+};
+
+DeviceCapabilities queryDeviceCapabilities(VkPhysicalDevice physicalDevice);
+
+bool hasDeviceExtension(const std::vector<VkExtensionProperties>& extensions, const char* name);
+
+
+
+//  CLASS #########################################################################################
+// Extension names and feature structs to pass to vkCreateDevice for a set of capabilities.
+// The feature structs point at each other, so this object must not be moved or copied.
+class DeviceEnableInfo
+{
+
+ // Public ----------------------------------------------------------------------------------------
+public:
+    DeviceEnableInfo(const DeviceCapabilities& capabilities, const std::vector<const char*>& requiredExtensions);
+
+    DeviceEnableInfo(const DeviceEnableInfo&) = delete;
+    DeviceEnableInfo& operator=(const DeviceEnableInfo&) = delete;
+
+    std::vector<const char*> extensions;
+    VkPhysicalDeviceFeatures2 features2{};
+
+
+ // Private ----------------------------------------------------------------------------------------
+private:
+    VkPhysicalDeviceGraphicsPipelineLibraryFeaturesEXT graphicsPipelineLibraryFeatures{};
+    VkPhysicalDeviceExtendedDynamicStateFeaturesEXT extendedDynamicStateFeatures{};
+    VkPhysicalDeviceExtendedDynamicState2FeaturesEXT extendedDynamicState2Features{};
+    VkPhysicalDeviceDescriptorIndexingFeaturesEXT descriptorIndexingFeatures{};
+
+    void chain(void* feature);
+};
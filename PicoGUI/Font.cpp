@@ -0,0 +1,398 @@
+#include "Font.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+
+namespace {
+
+constexpr uint32_t tag(const char (&name)[5])
+{
+    return uint32_t(uint8_t(name[0])) << 24 | uint32_t(uint8_t(name[1])) << 16 | uint32_t(uint8_t(name[2])) << 8 | uint8_t(name[3]);
+}
+
+// Simple glyph point flags
+constexpr uint8_t ON_CURVE = 0x01;
+constexpr uint8_t X_SHORT = 0x02;
+constexpr uint8_t Y_SHORT = 0x04;
+constexpr uint8_t REPEAT = 0x08;
+constexpr uint8_t X_SAME_OR_POSITIVE = 0x10;
+constexpr uint8_t Y_SAME_OR_POSITIVE = 0x20;
+
+// Composite glyph component flags
+constexpr uint16_t ARGS_ARE_WORDS = 0x0001;
+constexpr uint16_t ARGS_ARE_XY_VALUES = 0x0002;
+constexpr uint16_t HAS_SCALE = 0x0008;
+constexpr uint16_t MORE_COMPONENTS = 0x0020;
+constexpr uint16_t HAS_XY_SCALE = 0x0040;
+constexpr uint16_t HAS_TWO_BY_TWO = 0x0080;
+
+// Components may nest; deeper than this the font is taken to be broken.
+constexpr uint32_t MAX_COMPONENT_DEPTH = 8;
+
+struct OutlinePoint {
+    glm::vec2 position;
+    bool onCurve;
+};
+
+// Turns TrueType points into edges. Two off-curve points in a row imply an on-curve point halfway.
+GlyphContour toEdges(const std::vector<OutlinePoint>& points)
+{
+    GlyphContour contour;
+    const size_t count = points.size();
+    if (count < 2) {
+        return contour;
+    }
+
+    // Start from an on-curve point, or the implied one between the first two points.
+    size_t first = 0;
+    while (first < count && !points[first].onCurve) {
+        first++;
+    }
+    glm::vec2 start = first < count ? points[first].position : (points[0].position + points[1].position) * 0.5f;
+    if (first == count) {
+        first = 0;
+    }
+
+    glm::vec2 current = start;
+    for (size_t i = 1; i <= count; i++) {
+        const OutlinePoint& point = points[(first + i) % count];
+        if (point.onCurve) {
+            if (point.position != current) {
+                contour.push_back({ current, point.position, point.position, false });
+            }
+            current = point.position;
+            continue;
+        }
+
+        const OutlinePoint& next = points[(first + i + 1) % count];
+        const glm::vec2 end = next.onCurve ? next.position : (point.position + next.position) * 0.5f;
+        contour.push_back({ current, point.position, end, true });
+        current = end;
+        if (next.onCurve) {
+            i++;
+        }
+    }
+
+    if (current != start) {
+        contour.push_back({ current, start, start, false });
+    }
+    return contour;
+}
+
+} // namespace
+
+
+
+// Load ----------------------------------------------------------------------------------------
+void Font::load(std::span<const std::byte> file)
+{
+    *this = Font();
+    data.assign(reinterpret_cast<const uint8_t*>(file.data()), reinterpret_cast<const uint8_t*>(file.data()) + file.size());
+
+    const uint32_t version = read32(0);
+    if (version != 0x00010000 && version != tag("true")) {
+        throw std::runtime_error(version == tag("OTTO") ? "failed to parse font: CFF outlines are not supported!" : "failed to parse font: not a TrueType file!");
+    }
+
+    uint32_t head = 0, maxp = 0, hhea = 0, cmap = 0, kern = 0;
+    const uint32_t tableCount = read16(4);
+    for (uint32_t i = 0; i < tableCount; i++) {
+        const size_t record = 12 + i * 16;
+        const uint32_t offset = read32(record + 8);
+        const uint32_t length = read32(record + 12);
+        if (uint64_t(offset) + length > data.size()) {
+            throw std::runtime_error("failed to parse font: file is truncated!");
+        }
+
+        switch (read32(record)) {
+        case tag("head"): head = offset; break;
+        case tag("maxp"): maxp = offset; break;
+        case tag("hhea"): hhea = offset; break;
+        case tag("hmtx"): hmtxOffset = offset; break;
+        case tag("cmap"): cmap = offset; break;
+        case tag("loca"): locaOffset = offset; break;
+        case tag("glyf"): glyfOffset = offset; glyfSize = length; break;
+        case tag("kern"): kern = offset; break;
+        default: break;
+        }
+    }
+    if (head == 0 || maxp == 0 || hhea == 0 || hmtxOffset == 0 || cmap == 0 || locaOffset == 0 || glyfOffset == 0) {
+        throw std::runtime_error("failed to parse font: a required table is missing!");
+    }
+
+    emScale = 1.0f / std::max<uint16_t>(read16(head + 18), 1);
+    longOffsets = read16(head + 50) != 0;
+    glyphCount = read16(maxp + 4);
+
+    metrics.ascender = int16_t(read16(hhea + 4)) * emScale;
+    metrics.descender = int16_t(read16(hhea + 6)) * emScale;
+    metrics.lineGap = int16_t(read16(hhea + 8)) * emScale;
+    horizontalMetricCount = std::max<uint16_t>(read16(hhea + 34), 1);
+
+    // Prefer a full Unicode subtable (format 12), then the BMP one (format 4).
+    const uint32_t subtableCount = read16(cmap + 2);
+    for (uint32_t i = 0; i < subtableCount; i++) {
+        const uint32_t platform = read16(cmap + 4 + i * 8);
+        const uint32_t encoding = read16(cmap + 4 + i * 8 + 2);
+        const uint32_t offset = cmap + read32(cmap + 4 + i * 8 + 4);
+        const bool unicode = platform == 0 || (platform == 3 && (encoding == 1 || encoding == 10));
+        const uint32_t format = read16(offset);
+
+        if (unicode && (format == 12 || (format == 4 && cmapFormat != 12))) {
+            cmapOffset = offset;
+            cmapFormat = format;
+        }
+    }
+    if (cmapFormat == 0) {
+        throw std::runtime_error("failed to parse font: no Unicode character map!");
+    }
+
+    // Only the horizontal format 0 subtable of the old kern table; GPOS kerning is not read.
+    kerning.clear();
+    if (kern != 0 && read16(kern) == 0) {
+        size_t subtable = kern + 4;
+        for (uint32_t i = 0, count = read16(kern + 2); i < count; i++) {
+            const uint32_t length = read16(subtable + 2);
+            const uint32_t coverage = read16(subtable + 4);
+            if ((coverage >> 8) == 0 && (coverage & 0x7) == 0x1) {
+                const uint32_t pairCount = read16(subtable + 6);
+                for (uint32_t pair = 0; pair < pairCount; pair++) {
+                    const size_t entry = subtable + 14 + pair * 6;
+                    kerning.push_back({ read32(entry), int16_t(read16(entry + 4)) });
+                }
+            }
+            subtable += length;
+        }
+        std::sort(kerning.begin(), kerning.end(), [](const KerningPair& a, const KerningPair& b) { return a.glyphs < b.glyphs; });
+    }
+}
+
+uint8_t Font::read8(size_t offset) const
+{
+    if (offset >= data.size()) {
+        throw std::runtime_error("failed to parse font: file is truncated!");
+    }
+    return data[offset];
+}
+
+uint16_t Font::read16(size_t offset) const
+{
+    if (offset + 2 > data.size()) {
+        throw std::runtime_error("failed to parse font: file is truncated!");
+    }
+    return uint16_t(data[offset] << 8 | data[offset + 1]);
+}
+
+uint32_t Font::read32(size_t offset) const
+{
+    return uint32_t(read16(offset)) << 16 | read16(offset + 2);
+}
+
+
+
+// Characters ----------------------------------------------------------------------------------------
+uint32_t Font::findGlyph(uint32_t codepoint) const
+{
+    if (cmapFormat == 12) {
+        // Sequential groups sorted by start code.
+        uint32_t low = 0;
+        uint32_t high = read32(cmapOffset + 12);
+        while (low < high) {
+            const uint32_t middle = (low + high) / 2;
+            const size_t group = cmapOffset + 16 + middle * 12;
+            if (codepoint < read32(group)) {
+                high = middle;
+            }
+            else if (codepoint > read32(group + 4)) {
+                low = middle + 1;
+            }
+            else {
+                const uint32_t glyph = read32(group + 8) + (codepoint - read32(group));
+                return glyph < glyphCount ? glyph : 0;
+            }
+        }
+        return 0;
+    }
+
+    if (codepoint > 0xFFFF) {
+        return 0;
+    }
+
+    // Segments sorted by end code; each maps through a delta, or through the glyph id array.
+    const uint32_t segmentCount = read16(cmapOffset + 6) / 2;
+    const size_t endCodes = cmapOffset + 14;
+    const size_t startCodes = endCodes + segmentCount * 2 + 2;
+    const size_t deltas = startCodes + segmentCount * 2;
+    const size_t rangeOffsets = deltas + segmentCount * 2;
+
+    uint32_t low = 0;
+    uint32_t high = segmentCount;
+    while (low < high) {
+        const uint32_t middle = (low + high) / 2;
+        if (read16(endCodes + middle * 2) < codepoint) {
+            low = middle + 1;
+        }
+        else {
+            high = middle;
+        }
+    }
+    if (low == segmentCount || read16(startCodes + low * 2) > codepoint) {
+        return 0;
+    }
+
+    const uint32_t delta = read16(deltas + low * 2);
+    const uint32_t rangeOffset = read16(rangeOffsets + low * 2);
+    uint32_t glyph;
+    if (rangeOffset == 0) {
+        glyph = (codepoint + delta) & 0xFFFF;
+    }
+    else {
+        glyph = read16(rangeOffsets + low * 2 + rangeOffset + (codepoint - read16(startCodes + low * 2)) * 2);
+        glyph = glyph != 0 ? (glyph + delta) & 0xFFFF : 0;
+    }
+    return glyph < glyphCount ? glyph : 0;
+}
+
+float Font::getAdvance(uint32_t glyph) const
+{
+    // Glyphs past the last metric share its advance.
+    const uint32_t metric = std::min(glyph, horizontalMetricCount - 1);
+    return read16(hmtxOffset + metric * 4) * emScale;
+}
+
+float Font::getKerning(uint32_t left, uint32_t right) const
+{
+    const uint32_t glyphs = left << 16 | right;
+    auto it = std::lower_bound(kerning.begin(), kerning.end(), glyphs, [](const KerningPair& pair, uint32_t value) {
+        return pair.glyphs < value;
+    });
+    return it != kerning.end() && it->glyphs == glyphs ? it->value * emScale : 0.0f;
+}
+
+
+
+// Outlines ----------------------------------------------------------------------------------------
+std::vector<GlyphContour> Font::getOutline(uint32_t glyph) const
+{
+    std::vector<GlyphContour> contours;
+    addOutline(glyph, glm::mat3x2(glm::vec2(emScale, 0.0f), glm::vec2(0.0f, emScale), glm::vec2(0.0f)), 0, contours);
+    return contours;
+}
+
+void Font::addOutline(uint32_t glyph, const glm::mat3x2& transform, uint32_t depth, std::vector<GlyphContour>& contours) const
+{
+    if (glyph >= glyphCount || depth > MAX_COMPONENT_DEPTH) {
+        return;
+    }
+
+    const uint32_t begin = longOffsets ? read32(locaOffset + glyph * 4) : read16(locaOffset + glyph * 2) * 2u;
+    const uint32_t end = longOffsets ? read32(locaOffset + glyph * 4 + 4) : read16(locaOffset + glyph * 2 + 2) * 2u;
+    if (end <= begin || end > glyfSize) {
+        return;                     // no outline, like a space
+    }
+
+    size_t offset = glyfOffset + begin;
+    const int16_t contourCount = int16_t(read16(offset));
+    offset += 10;
+
+    if (contourCount < 0) {
+        for (uint16_t flags = MORE_COMPONENTS; flags & MORE_COMPONENTS;) {
+            flags = read16(offset);
+            const uint32_t component = read16(offset + 2);
+            offset += 4;
+
+            // Point matching (offsets that are not xy values) is not supported and taken as no offset.
+            glm::vec2 translation(0.0f);
+            if (flags & ARGS_ARE_WORDS) {
+                if (flags & ARGS_ARE_XY_VALUES) {
+                    translation = glm::vec2(int16_t(read16(offset)), int16_t(read16(offset + 2)));
+                }
+                offset += 4;
+            }
+            else {
+                if (flags & ARGS_ARE_XY_VALUES) {
+                    translation = glm::vec2(int8_t(read8(offset)), int8_t(read8(offset + 1)));
+                }
+                offset += 2;
+            }
+
+            // F2Dot14 scale factors.
+            auto f2dot14 = [&](size_t at) { return int16_t(read16(at)) / 16384.0f; };
+            glm::mat2 linear(1.0f);
+            if (flags & HAS_SCALE) {
+                linear = glm::mat2(f2dot14(offset));
+                offset += 2;
+            }
+            else if (flags & HAS_XY_SCALE) {
+                linear = glm::mat2(glm::vec2(f2dot14(offset), 0.0f), glm::vec2(0.0f, f2dot14(offset + 2)));
+                offset += 4;
+            }
+            else if (flags & HAS_TWO_BY_TWO) {
+                linear = glm::mat2(glm::vec2(f2dot14(offset), f2dot14(offset + 2)), glm::vec2(f2dot14(offset + 4), f2dot14(offset + 6)));
+                offset += 8;
+            }
+
+            const glm::mat2 parentLinear(transform[0], transform[1]);
+            const glm::mat3x2 componentTransform(parentLinear * linear[0], parentLinear * linear[1], transform * glm::vec3(translation, 1.0f));
+            addOutline(component, componentTransform, depth + 1, contours);
+        }
+        return;
+    }
+
+    std::vector<uint16_t> endPoints(contourCount);
+    for (int16_t i = 0; i < contourCount; i++) {
+        endPoints[i] = read16(offset + i * 2);
+    }
+    offset += contourCount * 2;
+    const uint32_t pointCount = contourCount > 0 ? endPoints.back() + 1u : 0u;
+    offset += 2 + read16(offset);   // instructions
+
+    std::vector<uint8_t> flags(pointCount);
+    for (uint32_t i = 0; i < pointCount;) {
+        const uint8_t flag = read8(offset);
+        offset++;
+        uint32_t repeat = 1;
+        if (flag & REPEAT) {
+            repeat += read8(offset);
+            offset++;
+        }
+        for (; repeat > 0 && i < pointCount; repeat--) {
+            flags[i++] = flag;
+        }
+    }
+
+    // Coordinates are deltas, all x first, then all y.
+    std::vector<glm::vec2> positions(pointCount);
+    for (int axis = 0; axis < 2; axis++) {
+        const uint8_t shortBit = axis == 0 ? X_SHORT : Y_SHORT;
+        const uint8_t sameBit = axis == 0 ? X_SAME_OR_POSITIVE : Y_SAME_OR_POSITIVE;
+        int32_t value = 0;
+        for (uint32_t i = 0; i < pointCount; i++) {
+            if (flags[i] & shortBit) {
+                const int32_t delta = read8(offset);
+                value += flags[i] & sameBit ? delta : -delta;
+                offset++;
+            }
+            else if (!(flags[i] & sameBit)) {
+                value += int16_t(read16(offset));
+                offset += 2;
+            }
+            positions[i][axis] = static_cast<float>(value);
+        }
+    }
+
+    uint32_t first = 0;
+    for (int16_t i = 0; i < contourCount; i++) {
+        std::vector<OutlinePoint> points;
+        for (uint32_t point = first; point <= endPoints[i] && point < pointCount; point++) {
+            points.push_back({ transform * glm::vec3(positions[point], 1.0f), (flags[point] & ON_CURVE) != 0 });
+        }
+        first = endPoints[i] + 1u;
+
+        GlyphContour contour = toEdges(points);
+        if (!contour.empty()) {
+            contours.push_back(std::move(contour));
+        }
+    }
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+
+//  Glyph Outlines --------------------------------------------------------------------------------
+// Positions are in ems, y up, relative to the pen position on the baseline.
+struct GlyphEdge {
+    glm::vec2 p0;
+    glm::vec2 p1;               // control point of a curve; the end point of a line
+    glm::vec2 p2;               // end point of a curve
+    bool curved;                // quadratic Bezier, otherwise a line from p0 to p1
+};
+
+using GlyphContour = std::vector<GlyphEdge>;
+
+// In ems; the descender is negative.
+struct FontMetrics {
+    float ascender = 0.0f;
+    float descender = 0.0f;
+    float lineGap = 0.0f;
+};
+
+
+
+//  CLASS #########################################################################################
+// Minimal TrueType reader: enough of cmap (formats 4 and 12), hmtx, kern (format 0), loca and glyf
+// to map characters to glyphs, advance and kern them, and get their outlines, simple or composite.
+// Fonts with CFF outlines, collections, and OpenType layout tables are not supported.
+//
+// The font keeps its own copy of the file. Everything but load() only reads it, so one font may
+// be used from several threads at once.
+class Font
+{
+
+ // Public ----------------------------------------------------------------------------------------
+public:
+    // Throws std::runtime_error on files it cannot read.
+    void load(std::span<const std::byte> file);
+
+    // Glyph 0, the missing glyph, for characters the font does not have.
+    uint32_t findGlyph(uint32_t codepoint) const;
+    uint32_t getGlyphCount() const { return glyphCount; }
+
+    float getAdvance(uint32_t glyph) const;
+    float getKerning(uint32_t left, uint32_t right) const;
+    const FontMetrics& getMetrics() const { return metrics; }
+
+    std::vector<GlyphContour> getOutline(uint32_t glyph) const;
+
+
+ // Private ----------------------------------------------------------------------------------------
+private:
+    struct KerningPair {
+        uint32_t glyphs;            // left << 16 | right
+        int16_t value;
+    };
+
+    std::vector<uint8_t> data;
+    float emScale = 0.0f;           // 1 / units per em
+    uint32_t glyphCount = 0;
+    uint32_t horizontalMetricCount = 0;
+    bool longOffsets = false;       // loca format
+
+    uint32_t cmapOffset = 0;        // of the chosen subtable
+    uint32_t cmapFormat = 0;
+    uint32_t hmtxOffset = 0;
+    uint32_t locaOffset = 0;
+    uint32_t glyfOffset = 0;
+    uint32_t glyfSize = 0;
+
+    FontMetrics metrics;
+    std::vector<KerningPair> kerning;   // sorted
+
+    uint8_t read8(size_t offset) const;
+    uint16_t read16(size_t offset) const;
+    uint32_t read32(size_t offset) const;
+    void addOutline(uint32_t glyph, const glm::mat3x2& transform, uint32_t depth, std::vector<GlyphContour>& contours) const;
+};
@@ -0,0 +1,751 @@
+#include "GpuAllocator.h"
+
+#include <algorithm>
+#include <bit>
+#include <stdexcept>
+
+
+namespace {
+
+VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment)
+{
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+} // namespace
+
+
+
+// TLSF Init ----------------------------------------------------------------------------------------
+void TlsfAllocator::init(uint64_t size)
+{
+    this->size = size & ~((1ull << ALIGN_LOG2) - 1);
+    usedSize = 0;
+    allocationCount = 0;
+
+    nodes.clear();
+    unusedNodes.clear();
+    firstLevelBitmap = 0;
+    std::fill(std::begin(secondLevelBitmaps), std::end(secondLevelBitmaps), 0u);
+    for (auto& heads : freeHeads) {
+        std::fill(std::begin(heads), std::end(heads), None);
+    }
+
+    if (this->size >= (1ull << (FL_COUNT + FL_SHIFT - 1))) {
+        throw std::runtime_error("tlsf range is too large!");
+    }
+
+    if (this->size > 0) {
+        insertFree(createNode(0, this->size));
+    }
+}
+
+
+
+// TLSF Mapping ----------------------------------------------------------------------------------------
+// Sizes below 512 bytes share first level 0 in 16-byte steps; above that, each power of two is
+// split into 32 second-level classes.
+void TlsfAllocator::mapping(uint64_t size, uint32_t& firstLevel, uint32_t& secondLevel)
+{
+    if (size < (1ull << FL_SHIFT)) {
+        firstLevel = 0;
+        secondLevel = static_cast<uint32_t>(size >> ALIGN_LOG2);
+        return;
+    }
+
+    const uint32_t log2 = static_cast<uint32_t>(std::bit_width(size)) - 1;
+    secondLevel = static_cast<uint32_t>(size >> (log2 - SL_LOG2)) ^ SL_COUNT;
+    firstLevel = log2 - (FL_SHIFT - 1);
+}
+
+// Rounds size up to the next class boundary so every range in the found class is large enough.
+void TlsfAllocator::mappingSearch(uint64_t size, uint32_t& firstLevel, uint32_t& secondLevel)
+{
+    if (size >= (1ull << FL_SHIFT)) {
+        const uint32_t log2 = static_cast<uint32_t>(std::bit_width(size)) - 1;
+        size += (1ull << (log2 - SL_LOG2)) - 1;
+    }
+    mapping(size, firstLevel, secondLevel);
+}
+
+
+
+// TLSF Allocate ----------------------------------------------------------------------------------------
+uint32_t TlsfAllocator::allocate(uint64_t requestSize, uint64_t alignment, uint64_t& offset)
+{
+    const uint64_t minSize = 1ull << ALIGN_LOG2;
+    requestSize = alignUp(std::max(requestSize, minSize), minSize);
+    alignment = std::max(alignment, minSize);
+
+    // Offsets are always 16-byte aligned, so at most alignment - 16 bytes of padding are needed.
+    uint32_t firstLevel, secondLevel;
+    mappingSearch(requestSize + alignment - minSize, firstLevel, secondLevel);
+    if (firstLevel >= FL_COUNT) {
+        return NoSpace;
+    }
+
+    uint32_t secondLevelMap = secondLevelBitmaps[firstLevel] & (~0u << secondLevel);
+    if (secondLevelMap == 0) {
+        const uint64_t firstLevelMap = firstLevelBitmap & (~0ull << (firstLevel + 1));
+        if (firstLevelMap == 0) {
+            return NoSpace;
+        }
+        firstLevel = static_cast<uint32_t>(std::countr_zero(firstLevelMap));
+        secondLevelMap = secondLevelBitmaps[firstLevel];
+    }
+    secondLevel = static_cast<uint32_t>(std::countr_zero(secondLevelMap));
+
+    const uint32_t index = freeHeads[firstLevel][secondLevel];
+    removeFree(index);
+
+    // Split off the alignment padding in front and the unused tail as free ranges. Neither can
+    // have a free physical neighbour, since free ranges are always merged.
+    const uint64_t alignedOffset = alignUp(nodes[index].offset, alignment);
+    const uint64_t padding = alignedOffset - nodes[index].offset;
+    if (padding > 0) {
+        const uint32_t front = createNode(nodes[index].offset, padding);
+        nodes[front].prevPhysical = nodes[index].prevPhysical;
+        nodes[front].nextPhysical = index;
+        if (nodes[index].prevPhysical != None) {
+            nodes[nodes[index].prevPhysical].nextPhysical = front;
+        }
+        nodes[index].prevPhysical = front;
+        nodes[index].offset = alignedOffset;
+        nodes[index].size -= padding;
+        insertFree(front);
+    }
+
+    if (nodes[index].size - requestSize >= minSize) {
+        const uint32_t tail = createNode(nodes[index].offset + requestSize, nodes[index].size - requestSize);
+        nodes[tail].prevPhysical = index;
+        nodes[tail].nextPhysical = nodes[index].nextPhysical;
+        if (nodes[index].nextPhysical != None) {
+            nodes[nodes[index].nextPhysical].prevPhysical = tail;
+        }
+        nodes[index].nextPhysical = tail;
+        nodes[index].size = requestSize;
+        insertFree(tail);
+    }
+
+    nodes[index].free = false;
+    usedSize += nodes[index].size;
+    allocationCount++;
+
+    offset = nodes[index].offset;
+    return index;
+}
+
+
+
+// TLSF Free ----------------------------------------------------------------------------------------
+void TlsfAllocator::free(uint32_t handle)
+{
+    if (handle >= nodes.size() || nodes[handle].free) {
+        throw std::runtime_error("invalid tlsf handle!");
+    }
+
+    usedSize -= nodes[handle].size;
+    allocationCount--;
+
+    uint32_t index = handle;
+
+    const uint32_t prev = nodes[index].prevPhysical;
+    if (prev != None && nodes[prev].free) {
+        removeFree(prev);
+        nodes[prev].size += nodes[index].size;
+        nodes[prev].nextPhysical = nodes[index].nextPhysical;
+        if (nodes[index].nextPhysical != None) {
+            nodes[nodes[index].nextPhysical].prevPhysical = prev;
+        }
+        releaseNode(index);
+        index = prev;
+    }
+
+    const uint32_t next = nodes[index].nextPhysical;
+    if (next != None && nodes[next].free) {
+        removeFree(next);
+        nodes[index].size += nodes[next].size;
+        nodes[index].nextPhysical = nodes[next].nextPhysical;
+        if (nodes[next].nextPhysical != None) {
+            nodes[nodes[next].nextPhysical].prevPhysical = index;
+        }
+        releaseNode(next);
+    }
+
+    insertFree(index);
+}
+
+uint64_t TlsfAllocator::getLargestFreeRange() const
+{
+    if (firstLevelBitmap == 0) {
+        return 0;
+    }
+
+    const uint32_t firstLevel = 63 - static_cast<uint32_t>(std::countl_zero(firstLevelBitmap));
+    const uint32_t secondLevel = 31 - static_cast<uint32_t>(std::countl_zero(secondLevelBitmaps[firstLevel]));
+
+    uint64_t largest = 0;
+    for (uint32_t index = freeHeads[firstLevel][secondLevel]; index != None; index = nodes[index].nextFree) {
+        largest = std::max(largest, nodes[index].size);
+    }
+    return largest;
+}
+
+
+
+// TLSF Nodes ----------------------------------------------------------------------------------------
+uint32_t TlsfAllocator::createNode(uint64_t offset, uint64_t size)
+{
+    uint32_t index;
+    if (!unusedNodes.empty()) {
+        index = unusedNodes.back();
+        unusedNodes.pop_back();
+    }
+    else {
+        index = static_cast<uint32_t>(nodes.size());
+        nodes.emplace_back();
+    }
+
+    nodes[index] = { offset, size, None, None, None, None, false };
+    return index;
+}
+
+void TlsfAllocator::releaseNode(uint32_t index)
+{
+    unusedNodes.push_back(index);
+}
+
+void TlsfAllocator::insertFree(uint32_t index)
+{
+    uint32_t firstLevel, secondLevel;
+    mapping(nodes[index].size, firstLevel, secondLevel);
+
+    const uint32_t head = freeHeads[firstLevel][secondLevel];
+    nodes[index].free = true;
+    nodes[index].prevFree = None;
+    nodes[index].nextFree = head;
+    if (head != None) {
+        nodes[head].prevFree = index;
+    }
+
+    freeHeads[firstLevel][secondLevel] = index;
+    firstLevelBitmap |= 1ull << firstLevel;
+    secondLevelBitmaps[firstLevel] |= 1u << secondLevel;
+}
+
+void TlsfAllocator::removeFree(uint32_t index)
+{
+    uint32_t firstLevel, secondLevel;
+    mapping(nodes[index].size, firstLevel, secondLevel);
+
+    Node& node = nodes[index];
+    if (node.prevFree != None) {
+        nodes[node.prevFree].nextFree = node.nextFree;
+    }
+    else {
+        freeHeads[firstLevel][secondLevel] = node.nextFree;
+    }
+    if (node.nextFree != None) {
+        nodes[node.nextFree].prevFree = node.prevFree;
+    }
+
+    if (freeHeads[firstLevel][secondLevel] == None) {
+        secondLevelBitmaps[firstLevel] &= ~(1u << secondLevel);
+        if (secondLevelBitmaps[firstLevel] == 0) {
+            firstLevelBitmap &= ~(1ull << firstLevel);
+        }
+    }
+
+    node.free = false;
+}
+
+
+
+// Init / Cleanup ----------------------------------------------------------------------------------------
+void GpuAllocator::init(VkPhysicalDevice physicalDevice, VkDevice device, uint32_t framesInFlight,
+                        VkDeviceSize preferredBlockSize, const VkAllocationCallbacks* allocator)
+{
+    this->device = device;
+    this->allocator = allocator;
+    this->framesInFlight = std::max(framesInFlight, 1u);
+    this->preferredBlockSize = preferredBlockSize;
+
+    vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
+
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+    bufferImageGranularity = properties.limits.bufferImageGranularity;
+    nonCoherentAtomSize = properties.limits.nonCoherentAtomSize;
+    maxMemoryAllocationCount = properties.limits.maxMemoryAllocationCount;
+
+    types.resize(memoryProperties.memoryTypeCount);
+    for (TypeState& type : types) {
+        type.linear.resize(this->framesInFlight);
+    }
+}
+
+void GpuAllocator::cleanup()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    for (Block& block : blocks) {
+        if (block.memory != VK_NULL_HANDLE) {
+            freeDeviceMemory(block.memory, block.mapped != nullptr);
+        }
+    }
+    for (TypeState& type : types) {
+        for (auto& frame : type.linear) {
+            for (LinearBlock& block : frame) {
+                freeDeviceMemory(block.memory, block.mapped != nullptr);
+            }
+        }
+    }
+
+    blocks.clear();
+    unusedBlocks.clear();
+    types.clear();
+}
+
+
+
+// Allocate ----------------------------------------------------------------------------------------
+GpuAllocation GpuAllocator::allocate(const VkMemoryRequirements& requirements, ResourceTiling tiling, const GpuAllocationInfo& info)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    allocateCalls++;
+
+    GpuAllocation allocation;
+    allocation.lifetime = info.lifetime;
+
+    // Fall back from the preferred flags to any type with the required ones, including when the
+    // preferred type's heap is full.
+    uint32_t typeBits = requirements.memoryTypeBits;
+    while (true) {
+        uint32_t memoryType = findMemoryType(typeBits & info.preferredTypeBits, info.requiredFlags, info.preferredFlags);
+        if (memoryType == UINT32_MAX) {
+            memoryType = findMemoryType(typeBits, info.requiredFlags, info.preferredFlags);
+        }
+        if (memoryType == UINT32_MAX) {
+            throw std::runtime_error("failed to allocate gpu memory!");
+        }
+
+        const VkMemoryPropertyFlags flags = memoryProperties.memoryTypes[memoryType].propertyFlags;
+
+        // Keep mapped ranges of non-coherent memory flushable without touching a neighbour.
+        VkDeviceSize alignment = requirements.alignment;
+        if ((flags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) && !(flags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT)) {
+            alignment = std::max(alignment, nonCoherentAtomSize);
+        }
+
+        bool allocated;
+        if (info.lifetime == AllocationLifetime::Transient) {
+            allocated = allocateLinear(memoryType, requirements, alignment, tiling, allocation);
+        }
+        else if (requirements.size > blockSize(memoryType) / 2) {
+            allocated = allocateDedicated(memoryType, requirements, allocation);
+        }
+        else {
+            allocated = allocateFromBlocks(memoryType, requirements, alignment, tiling, allocation);
+        }
+
+        if (allocated) {
+            allocation.memoryType = memoryType;
+            allocation.propertyFlags = flags;
+            return allocation;
+        }
+
+        typeBits &= ~(1u << memoryType);
+    }
+}
+
+bool GpuAllocator::allocateFromBlocks(uint32_t memoryType, const VkMemoryRequirements& requirements, VkDeviceSize alignment,
+                                      ResourceTiling tiling, GpuAllocation& allocation)
+{
+    TypeState& type = types[memoryType];
+
+    auto place = [&](uint32_t blockIndex) {
+        Block& block = blocks[blockIndex];
+        if (separateTiling() && block.tiling != tiling) {
+            return false;
+        }
+
+        uint64_t offset;
+        const uint32_t handle = block.tlsf.allocate(requirements.size, alignment, offset);
+        if (handle == TlsfAllocator::NoSpace) {
+            return false;
+        }
+
+        allocation.memory = block.memory;
+        allocation.offset = offset;
+        allocation.size = requirements.size;
+        allocation.mapped = block.mapped ? static_cast<char*>(block.mapped) + offset : nullptr;
+        allocation.block = blockIndex;
+        allocation.handle = handle;
+
+        type.counters.allocationCount++;
+        type.counters.allocationBytes += requirements.size;
+        return true;
+    };
+
+    // Newest blocks first: older ones are usually the fullest.
+    for (auto it = type.blocks.rbegin(); it != type.blocks.rend(); ++it) {
+        if (place(*it)) {
+            return true;
+        }
+    }
+
+    VkDeviceSize size;
+    void* mapped;
+    VkDeviceMemory memory = allocateDeviceMemory(memoryType, blockSize(memoryType), requirements.size + alignment, size, &mapped);
+    if (memory == VK_NULL_HANDLE) {
+        return false;
+    }
+
+    uint32_t blockIndex;
+    if (!unusedBlocks.empty()) {
+        blockIndex = unusedBlocks.back();
+        unusedBlocks.pop_back();
+    }
+    else {
+        blockIndex = static_cast<uint32_t>(blocks.size());
+        blocks.emplace_back();
+    }
+
+    Block& block = blocks[blockIndex];
+    block.memory = memory;
+    block.mapped = mapped;
+    block.memoryType = memoryType;
+    block.tiling = tiling;
+    block.tlsf.init(size);
+
+    type.blocks.push_back(blockIndex);
+    type.counters.blockCount++;
+    type.counters.blockBytes += size;
+
+    return place(blockIndex);
+}
+
+bool GpuAllocator::allocateLinear(uint32_t memoryType, const VkMemoryRequirements& requirements, VkDeviceSize alignment,
+                                  ResourceTiling tiling, GpuAllocation& allocation)
+{
+    std::vector<LinearBlock>& frame = types[memoryType].linear[frameSlot];
+
+    auto place = [&](LinearBlock& block) {
+        VkDeviceSize offset = alignUp(block.cursor, alignment);
+        if (block.cursor > 0 && block.lastTiling != tiling) {
+            offset = alignUp(offset, bufferImageGranularity);
+        }
+        if (offset + requirements.size > block.size) {
+            return false;
+        }
+
+        block.cursor = offset + requirements.size;
+        block.lastTiling = tiling;
+
+        allocation.memory = block.memory;
+        allocation.offset = offset;
+        allocation.size = requirements.size;
+        allocation.mapped = block.mapped ? static_cast<char*>(block.mapped) + offset : nullptr;
+        return true;
+    };
+
+    for (LinearBlock& block : frame) {
+        if (place(block)) {
+            return true;
+        }
+    }
+
+    LinearBlock block;
+    block.memory = allocateDeviceMemory(memoryType, std::max(blockSize(memoryType), requirements.size), requirements.size, block.size, &block.mapped);
+    if (block.memory == VK_NULL_HANDLE) {
+        return false;
+    }
+
+    types[memoryType].counters.blockCount++;
+    types[memoryType].counters.blockBytes += block.size;
+
+    frame.push_back(block);
+    return place(frame.back());
+}
+
+bool GpuAllocator::allocateDedicated(uint32_t memoryType, const VkMemoryRequirements& requirements, GpuAllocation& allocation)
+{
+    VkDeviceSize size;
+    void* mapped;
+    VkDeviceMemory memory = allocateDeviceMemory(memoryType, requirements.size, requirements.size, size, &mapped);
+    if (memory == VK_NULL_HANDLE) {
+        return false;
+    }
+
+    allocation.memory = memory;
+    allocation.offset = 0;
+    allocation.size = requirements.size;
+    allocation.mapped = mapped;
+    allocation.block = UINT32_MAX;
+
+    types[memoryType].counters.dedicatedCount++;
+    types[memoryType].counters.dedicatedBytes += size;
+    return true;
+}
+
+
+
+// Free ----------------------------------------------------------------------------------------
+void GpuAllocator::free(GpuAllocation& allocation)
+{
+    if (allocation.memory == VK_NULL_HANDLE) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    freeCalls++;
+
+    // Transient memory is reclaimed as a whole by beginFrame().
+    if (allocation.lifetime == AllocationLifetime::Persistent) {
+        TypeState& type = types[allocation.memoryType];
+
+        if (allocation.block == UINT32_MAX) {
+            freeDeviceMemory(allocation.memory, allocation.mapped != nullptr);
+            type.counters.dedicatedCount--;
+            type.counters.dedicatedBytes -= allocation.size;
+        }
+        else {
+            Block& block = blocks[allocation.block];
+            block.tlsf.free(allocation.handle);
+            type.counters.allocationCount--;
+            type.counters.allocationBytes -= allocation.size;
+
+            // Keep one empty block per memory type around so a single resource being recreated
+            // does not allocate and free device memory every time.
+            if (block.tlsf.empty()) {
+                const bool otherEmpty = std::any_of(type.blocks.begin(), type.blocks.end(), [&](uint32_t index) {
+                    return index != allocation.block && blocks[index].tlsf.empty();
+                });
+
+                if (otherEmpty) {
+                    type.counters.blockCount--;
+                    type.counters.blockBytes -= block.tlsf.getSize();
+                    freeDeviceMemory(block.memory, block.mapped != nullptr);
+                    block = Block{};
+
+                    type.blocks.erase(std::find(type.blocks.begin(), type.blocks.end(), allocation.block));
+                    unusedBlocks.push_back(allocation.block);
+                }
+            }
+        }
+    }
+
+    allocation = GpuAllocation{};
+}
+
+
+
+// Buffers / Images ----------------------------------------------------------------------------------------
+VkBuffer GpuAllocator::createBuffer(const VkBufferCreateInfo& createInfo, const GpuAllocationInfo& info, GpuAllocation& allocation)
+{
+    VkBuffer buffer;
+    if (vkCreateBuffer(device, &createInfo, allocator, &buffer) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create buffer!");
+    }
+
+    VkMemoryRequirements requirements;
+    vkGetBufferMemoryRequirements(device, buffer, &requirements);
+
+    allocation = allocate(requirements, ResourceTiling::Linear, info);
+
+    if (vkBindBufferMemory(device, buffer, allocation.memory, allocation.offset) != VK_SUCCESS) {
+        throw std::runtime_error("failed to bind buffer memory!");
+    }
+
+    return buffer;
+}
+
+VkImage GpuAllocator::createImage(const VkImageCreateInfo& createInfo, const GpuAllocationInfo& info, GpuAllocation& allocation)
+{
+    VkImage image;
+    if (vkCreateImage(device, &createInfo, allocator, &image) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create image!");
+    }
+
+    VkMemoryRequirements requirements;
+    vkGetImageMemoryRequirements(device, image, &requirements);
+
+    const ResourceTiling tiling = createInfo.tiling == VK_IMAGE_TILING_LINEAR ? ResourceTiling::Linear : ResourceTiling::Optimal;
+    allocation = allocate(requirements, tiling, info);
+
+    if (vkBindImageMemory(device, image, allocation.memory, allocation.offset) != VK_SUCCESS) {
+        throw std::runtime_error("failed to bind image memory!");
+    }
+
+    return image;
+}
+
+void GpuAllocator::destroyBuffer(VkBuffer buffer, GpuAllocation& allocation)
+{
+    vkDestroyBuffer(device, buffer, allocator);
+    free(allocation);
+}
+
+void GpuAllocator::destroyImage(VkImage image, GpuAllocation& allocation)
+{
+    vkDestroyImage(device, image, allocator);
+    free(allocation);
+}
+
+
+
+// Begin Frame ----------------------------------------------------------------------------------------
+void GpuAllocator::beginFrame(uint64_t frameNumber)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    frameSlot = static_cast<uint32_t>(frameNumber % framesInFlight);
+
+    for (TypeState& type : types) {
+        for (LinearBlock& block : type.linear[frameSlot]) {
+            block.cursor = 0;
+        }
+    }
+}
+
+
+VkDeviceSize GpuAllocator::trim(uint32_t heapIndex)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    VkDeviceSize released = 0;
+    for (uint32_t memoryType = 0; memoryType < types.size(); memoryType++) {
+        if (memoryProperties.memoryTypes[memoryType].heapIndex != heapIndex) {
+            continue;
+        }
+
+        TypeState& type = types[memoryType];
+        std::erase_if(type.blocks, [&](uint32_t index) {
+            Block& block = blocks[index];
+            if (!block.tlsf.empty()) {
+                return false;
+            }
+
+            released += block.tlsf.getSize();
+            type.counters.blockCount--;
+            type.counters.blockBytes -= block.tlsf.getSize();
+            freeDeviceMemory(block.memory, block.mapped != nullptr);
+            block = Block{};
+            unusedBlocks.push_back(index);
+            return true;
+        });
+    }
+
+    return released;
+}
+
+
+
+// Memory Types ----------------------------------------------------------------------------------------
+uint32_t GpuAllocator::findMemoryType(uint32_t typeBits, VkMemoryPropertyFlags requiredFlags, VkMemoryPropertyFlags preferredFlags) const
+{
+    const VkMemoryPropertyFlags wanted = requiredFlags | preferredFlags;
+
+    for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; i++) {
+        if ((typeBits & (1u << i)) && (memoryProperties.memoryTypes[i].propertyFlags & wanted) == wanted) {
+            return i;
+        }
+    }
+    for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; i++) {
+        if ((typeBits & (1u << i)) && (memoryProperties.memoryTypes[i].propertyFlags & requiredFlags) == requiredFlags) {
+            return i;
+        }
+    }
+
+    return UINT32_MAX;
+}
+
+VkDeviceSize GpuAllocator::blockSize(uint32_t memoryType) const
+{
+    // Small heaps such as the 256 MB host-visible VRAM window get proportionally smaller blocks.
+    const VkDeviceSize heapSize = memoryProperties.memoryHeaps[memoryProperties.memoryTypes[memoryType].heapIndex].size;
+    return std::min(preferredBlockSize, std::bit_floor(std::max<VkDeviceSize>(heapSize / 8, 1ull << 20)));
+}
+
+
+
+// Device Memory ----------------------------------------------------------------------------------------
+VkDeviceMemory GpuAllocator::allocateDeviceMemory(uint32_t memoryType, VkDeviceSize size, VkDeviceSize minSize,
+                                                  VkDeviceSize& allocatedSize, void** mapped)
+{
+    if (deviceMemoryCount >= maxMemoryAllocationCount) {
+        throw std::runtime_error("failed to allocate device memory: maxMemoryAllocationCount reached!");
+    }
+
+    VkMemoryAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.memoryTypeIndex = memoryType;
+
+    // Retry with smaller blocks while they still fit the request, as the heap may be nearly full.
+    VkDeviceMemory memory = VK_NULL_HANDLE;
+    allocInfo.allocationSize = size;
+    while (vkAllocateMemory(device, &allocInfo, allocator, &memory) != VK_SUCCESS) {
+        if (allocInfo.allocationSize <= minSize) {
+            return VK_NULL_HANDLE;
+        }
+        allocInfo.allocationSize = std::max(allocInfo.allocationSize / 2, minSize);
+    }
+
+    *mapped = nullptr;
+    if (memoryProperties.memoryTypes[memoryType].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) {
+        if (vkMapMemory(device, memory, 0, VK_WHOLE_SIZE, 0, mapped) != VK_SUCCESS) {
+            vkFreeMemory(device, memory, allocator);
+            throw std::runtime_error("failed to map device memory!");
+        }
+    }
+
+    deviceMemoryCount++;
+    allocatedSize = allocInfo.allocationSize;
+    return memory;
+}
+
+void GpuAllocator::freeDeviceMemory(VkDeviceMemory memory, bool mapped)
+{
+    if (mapped) {
+        vkUnmapMemory(device, memory);
+    }
+    vkFreeMemory(device, memory, allocator);
+    deviceMemoryCount--;
+}
+
+
+
+// Stats ----------------------------------------------------------------------------------------
+GpuMemoryStats GpuAllocator::getStats() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    GpuMemoryStats stats;
+    stats.memoryTypes.resize(types.size());
+    stats.deviceMemoryCount = deviceMemoryCount;
+    stats.allocateCalls = allocateCalls;
+    stats.freeCalls = freeCalls;
+
+    for (size_t i = 0; i < types.size(); i++) {
+        GpuMemoryStats::Counters counters = types[i].counters;
+
+        for (uint32_t blockIndex : types[i].blocks) {
+            counters.largestFreeRange = std::max(counters.largestFreeRange, blocks[blockIndex].tlsf.getLargestFreeRange());
+        }
+        for (const LinearBlock& block : types[i].linear[frameSlot]) {
+            counters.transientBytes += block.cursor;
+        }
+
+        stats.memoryTypes[i] = counters;
+        stats.total.blockCount += counters.blockCount;
+        stats.total.blockBytes += counters.blockBytes;
+        stats.total.allocationCount += counters.allocationCount;
+        stats.total.allocationBytes += counters.allocationBytes;
+        stats.total.dedicatedCount += counters.dedicatedCount;
+        stats.total.dedicatedBytes += counters.dedicatedBytes;
+        stats.total.transientBytes += counters.transientBytes;
+        stats.total.largestFreeRange = std::max(stats.total.largestFreeRange, counters.largestFreeRange);
+    }
+
+    return stats;
+}
@@ -0,0 +1,219 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+
+//  CLASS #########################################################################################
+// Two-level segregated fit allocator over an abstract range of offsets. Free ranges are binned by
+// size class, and two bitmaps find the smallest suitable bin, so allocate() and free() are O(1)
+// no matter how many allocations the range holds. Neighbouring free ranges are merged on free.
+class TlsfAllocator
+{
+
+ // Public ----------------------------------------------------------------------------------------
+public:
+    static constexpr uint32_t NoSpace = UINT32_MAX;
+
+    void init(uint64_t size);
+
+    // Returns a handle for free(), or NoSpace. Offsets and sizes are rounded to 16 bytes.
+    uint32_t allocate(uint64_t size, uint64_t alignment, uint64_t& offset);
+    void free(uint32_t handle);
+
+    uint64_t getSize() const { return size; }
+    uint64_t getUsedSize() const { return usedSize; }
+    uint32_t getAllocationCount() const { return allocationCount; }
+    uint64_t getLargestFreeRange() const;
+    bool empty() const { return allocationCount == 0; }
+
+
+ // Private ----------------------------------------------------------------------------------------
+private:
+    static constexpr uint32_t ALIGN_LOG2 = 4;
+    static constexpr uint32_t SL_LOG2 = 5;
+    static constexpr uint32_t SL_COUNT = 1u << SL_LOG2;
+    static constexpr uint32_t FL_SHIFT = SL_LOG2 + ALIGN_LOG2;
+    static constexpr uint32_t FL_COUNT = 40;
+    static constexpr uint32_t None = UINT32_MAX;
+
+    struct Node {
+        uint64_t offset;
+        uint64_t size;
+        uint32_t prevPhysical;
+        uint32_t nextPhysical;
+        uint32_t prevFree;
+        uint32_t nextFree;
+        bool free;
+    };
+
+    uint64_t size = 0;
+    uint64_t usedSize = 0;
+    uint32_t allocationCount = 0;
+
+    std::vector<Node> nodes;
+    std::vector<uint32_t> unusedNodes;
+
+    uint64_t firstLevelBitmap = 0;
+    uint32_t secondLevelBitmaps[FL_COUNT] = {};
+    uint32_t freeHeads[FL_COUNT][SL_COUNT];
+
+    static void mapping(uint64_t size, uint32_t& firstLevel, uint32_t& secondLevel);
+    static void mappingSearch(uint64_t size, uint32_t& firstLevel, uint32_t& secondLevel);
+
+    uint32_t createNode(uint64_t offset, uint64_t size);
+    void releaseNode(uint32_t index);
+    void insertFree(uint32_t index);
+    void removeFree(uint32_t index);
+};
+
+
+
+//  GPU Allocation --------------------------------------------------------------------------------
+enum class AllocationLifetime : uint32_t {
+    Persistent,     // freed individually; sub-allocated with TLSF
+    Transient,      // valid for the frame it was allocated in; bump-allocated and reclaimed by beginFrame()
+};
+
+// Buffers and linear images must not share a bufferImageGranularity page with optimal images.
+enum class ResourceTiling : uint32_t {
+    Linear,
+    Optimal,
+};
+
+struct GpuAllocationInfo {
+    VkMemoryPropertyFlags requiredFlags = 0;
+    VkMemoryPropertyFlags preferredFlags = 0;
+    uint32_t preferredTypeBits = UINT32_MAX;   // memory types tried before the others
+    AllocationLifetime lifetime = AllocationLifetime::Persistent;
+};
+
+struct GpuAllocation {
+    VkDeviceMemory memory = VK_NULL_HANDLE;
+    VkDeviceSize offset = 0;
+    VkDeviceSize size = 0;
+    void* mapped = nullptr;                 // persistently mapped pointer to offset, or nullptr
+    uint32_t memoryType = UINT32_MAX;
+    VkMemoryPropertyFlags propertyFlags = 0;
+
+    // Owned by GpuAllocator.
+    AllocationLifetime lifetime = AllocationLifetime::Persistent;
+    uint32_t block = UINT32_MAX;            // UINT32_MAX for dedicated allocations
+    uint32_t handle = UINT32_MAX;
+};
+
+struct GpuMemoryStats {
+    struct Counters {
+        uint32_t blockCount = 0;
+        VkDeviceSize blockBytes = 0;
+        uint32_t allocationCount = 0;
+        VkDeviceSize allocationBytes = 0;
+        uint32_t dedicatedCount = 0;
+        VkDeviceSize dedicatedBytes = 0;
+        VkDeviceSize transientBytes = 0;    // bump-allocated in the current frame
+        VkDeviceSize largestFreeRange = 0;
+    };
+
+    std::vector<Counters> memoryTypes;      // indexed by memory type
+    Counters total;
+    uint32_t deviceMemoryCount = 0;         // live vkAllocateMemory objects
+    uint64_t allocateCalls = 0;
+    uint64_t freeCalls = 0;
+};
+
+
+
+//  CLASS #########################################################################################
+// Sub-allocates device memory so a resource does not cost a vkAllocateMemory. Each memory type
+// gets large blocks that persistent resources share through a TlsfAllocator; transient resources
+// are bump-allocated from per-frame-in-flight linear blocks that are recycled as a whole.
+// Resources larger than half a block get a dedicated allocation.
+//
+// When bufferImageGranularity is larger than the alignment every resource already has, persistent
+// blocks hold either linear or optimal resources, never both, and linear blocks pad between
+// resources of different tiling. Host-visible blocks are mapped once for their whole lifetime.
+class GpuAllocator
+{
+
+ // Public ----------------------------------------------------------------------------------------
+public:
+    void init(VkPhysicalDevice physicalDevice, VkDevice device, uint32_t framesInFlight,
+              VkDeviceSize preferredBlockSize = 64ull << 20, const VkAllocationCallbacks* allocator = nullptr);
+    void cleanup();
+
+    GpuAllocation allocate(const VkMemoryRequirements& requirements, ResourceTiling tiling, const GpuAllocationInfo& info);
+    void free(GpuAllocation& allocation);
+
+    VkBuffer createBuffer(const VkBufferCreateInfo& createInfo, const GpuAllocationInfo& info, GpuAllocation& allocation);
+    VkImage createImage(const VkImageCreateInfo& createInfo, const GpuAllocationInfo& info, GpuAllocation& allocation);
+    void destroyBuffer(VkBuffer buffer, GpuAllocation& allocation);
+    void destroyImage(VkImage image, GpuAllocation& allocation);
+
+    // Recycles the transient memory of the frame that last used this frame slot. Call after
+    // waiting for that frame's fence.
+    void beginFrame(uint64_t frameNumber);
+
+    // Releases the empty blocks kept for reuse on one heap; returns the bytes given back.
+    VkDeviceSize trim(uint32_t heapIndex);
+
+    // Returns UINT32_MAX if no memory type has the required flags.
+    uint32_t findMemoryType(uint32_t typeBits, VkMemoryPropertyFlags requiredFlags, VkMemoryPropertyFlags preferredFlags = 0) const;
+
+    const VkPhysicalDeviceMemoryProperties& getMemoryProperties() const { return memoryProperties; }
+    GpuMemoryStats getStats() const;
+
+
+ // Private ----------------------------------------------------------------------------------------
+private:
+    struct Block {
+        VkDeviceMemory memory = VK_NULL_HANDLE;
+        void* mapped = nullptr;
+        uint32_t memoryType = 0;
+        ResourceTiling tiling = ResourceTiling::Linear;
+        TlsfAllocator tlsf;
+    };
+
+    struct LinearBlock {
+        VkDeviceMemory memory = VK_NULL_HANDLE;
+        void* mapped = nullptr;
+        VkDeviceSize size = 0;
+        VkDeviceSize cursor = 0;
+        ResourceTiling lastTiling = ResourceTiling::Linear;
+    };
+
+    struct TypeState {
+        std::vector<uint32_t> blocks;                       // indices into blocks
+        std::vector<std::vector<LinearBlock>> linear;       // per frame slot
+        GpuMemoryStats::Counters counters;
+    };
+
+    VkDevice device = VK_NULL_HANDLE;
+    const VkAllocationCallbacks* allocator = nullptr;
+    VkPhysicalDeviceMemoryProperties memoryProperties{};
+    VkDeviceSize bufferImageGranularity = 1;
+    VkDeviceSize nonCoherentAtomSize = 1;
+    uint32_t maxMemoryAllocationCount = 0;
+    VkDeviceSize preferredBlockSize = 0;
+    uint32_t framesInFlight = 1;
+    uint32_t frameSlot = 0;
+
+    mutable std::mutex mutex;
+    std::vector<Block> blocks;
+    std::vector<uint32_t> unusedBlocks;
+    std::vector<TypeState> types;
+    uint32_t deviceMemoryCount = 0;
+    uint64_t allocateCalls = 0;
+    uint64_t freeCalls = 0;
+
+    VkDeviceSize blockSize(uint32_t memoryType) const;
+    bool separateTiling() const { return bufferImageGranularity > 16; }
+
+    VkDeviceMemory allocateDeviceMemory(uint32_t memoryType, VkDeviceSize size, VkDeviceSize minSize, VkDeviceSize& allocatedSize, void** mapped);
+    void freeDeviceMemory(VkDeviceMemory memory, bool mapped);
+
+    bool allocateFromBlocks(uint32_t memoryType, const VkMemoryRequirements& requirements, VkDeviceSize alignment, ResourceTiling tiling, GpuAllocation& allocation);
+    bool allocateLinear(uint32_t memoryType, const VkMemoryRequirements& requirements, VkDeviceSize alignment, ResourceTiling tiling, GpuAllocation& allocation);
+    bool allocateDedicated(uint32_t memoryType, const VkMemoryRequirements& requirements, GpuAllocation& allocation);
+};
@@ -0,0 +1,608 @@
+#include "GraphicsPipelines.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+
+// Desc Equality / Hash ----------------------------------------------------------------------------------------
+static void hashCombine(size_t& seed, uint64_t value)
+{
+    seed ^= std::hash<uint64_t>{}(value) + 0x9e3779b97f4a7c15ull + (seed << 6) + (seed >> 2);
+}
+
+bool GraphicsPipelineDesc::operator==(const GraphicsPipelineDesc& other) const
+{
+    auto sameBinding = [](const VkVertexInputBindingDescription& a, const VkVertexInputBindingDescription& b) {
+        return a.binding == b.binding && a.stride == b.stride && a.inputRate == b.inputRate;
+    };
+    auto sameAttribute = [](const VkVertexInputAttributeDescription& a, const VkVertexInputAttributeDescription& b) {
+        return a.location == b.location && a.binding == b.binding && a.format == b.format && a.offset == b.offset;
+    };
+
+    return vertexShader == other.vertexShader && fragmentShader == other.fragmentShader
+        && vertexEntryPoint == other.vertexEntryPoint && fragmentEntryPoint == other.fragmentEntryPoint
+        && layout == other.layout && topology == other.topology && primitiveRestart == other.primitiveRestart && cullMode == other.cullMode
+        && frontFace == other.frontFace && blendMode == other.blendMode
+        && std::equal(vertexInput.bindings.begin(), vertexInput.bindings.end(), other.vertexInput.bindings.begin(), other.vertexInput.bindings.end(), sameBinding)
+        && std::equal(vertexInput.attributes.begin(), vertexInput.attributes.end(), other.vertexInput.attributes.begin(), other.vertexInput.attributes.end(), sameAttribute);
+}
+
+size_t GraphicsPipelineCache::DescHash::operator()(const GraphicsPipelineDesc& desc) const
+{
+    size_t seed = std::hash<std::string>{}(desc.vertexEntryPoint) ^ std::hash<std::string>{}(desc.fragmentEntryPoint);
+    hashCombine(seed, reinterpret_cast<uint64_t>(desc.vertexShader));
+    hashCombine(seed, reinterpret_cast<uint64_t>(desc.fragmentShader));
+    hashCombine(seed, reinterpret_cast<uint64_t>(desc.layout));
+    hashCombine(seed, (uint64_t(desc.topology) << 32) | (uint64_t(desc.primitiveRestart) << 31) | desc.cullMode);
+    hashCombine(seed, (uint64_t(desc.frontFace) << 32) | static_cast<uint32_t>(desc.blendMode));
+    for (const auto& binding : desc.vertexInput.bindings) {
+        hashCombine(seed, (uint64_t(binding.binding) << 40) | (uint64_t(binding.inputRate) << 32) | binding.stride);
+    }
+    for (const auto& attribute : desc.vertexInput.attributes) {
+        hashCombine(seed, (uint64_t(attribute.location) << 32) | attribute.binding);
+        hashCombine(seed, (uint64_t(attribute.format) << 32) | attribute.offset);
+    }
+    return seed;
+}
+
+
+
+// Color Blend Attachment ----------------------------------------------------------------------------------------
+VkPipelineColorBlendAttachmentState colorBlendAttachment(BlendMode blendMode)
+{
+    VkPipelineColorBlendAttachmentState attachment{};
+    attachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+    attachment.blendEnable = blendMode == BlendMode::Opaque ? VK_FALSE : VK_TRUE;
+    attachment.colorBlendOp = VK_BLEND_OP_ADD;
+    attachment.alphaBlendOp = VK_BLEND_OP_ADD;
+
+    switch (blendMode) {
+    case BlendMode::Opaque:
+        attachment.srcColorBlendFactor = VK_BLEND_FACTOR_ONE;
+        attachment.dstColorBlendFactor = VK_BLEND_FACTOR_ZERO;
+        attachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+        attachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
+        break;
+    case BlendMode::Alpha:
+        attachment.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
+        attachment.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+        attachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+        attachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+        break;
+    case BlendMode::PremultipliedAlpha:
+        attachment.srcColorBlendFactor = VK_BLEND_FACTOR_ONE;
+        attachment.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+        attachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+        attachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+        break;
+    case BlendMode::Additive:
+        attachment.srcColorBlendFactor = VK_BLEND_FACTOR_ONE;
+        attachment.dstColorBlendFactor = VK_BLEND_FACTOR_ONE;
+        attachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+        attachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+        break;
+    }
+
+    return attachment;
+}
+
+
+
+// Fixed Function State ----------------------------------------------------------------------------------------
+namespace {
+
+// All create-info structs of one pipeline. Members point at each other, so it stays in place.
+struct PipelineState {
+    VkPipelineShaderStageCreateInfo vertShaderStageInfo{};
+    VkPipelineShaderStageCreateInfo fragShaderStageInfo{};
+    VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
+    VkPipelineInputAssemblyStateCreateInfo inputAssembly{};
+    VkPipelineViewportStateCreateInfo viewportState{};
+    VkPipelineRasterizationStateCreateInfo rasterizer{};
+    VkPipelineMultisampleStateCreateInfo multisampling{};
+    VkPipelineColorBlendAttachmentState blendAttachment{};
+    VkPipelineColorBlendStateCreateInfo colorBlending{};
+    std::vector<VkDynamicState> dynamicStates;
+    VkPipelineDynamicStateCreateInfo dynamicState{};
+
+    PipelineState(const GraphicsPipelineDesc& desc, const std::vector<VkDynamicState>& dynamic)
+    {
+        vertShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+        vertShaderStageInfo.stage = VK_SHADER_STAGE_VERTEX_BIT;
+        vertShaderStageInfo.module = desc.vertexShader;
+        vertShaderStageInfo.pName = desc.vertexEntryPoint.c_str();
+
+        fragShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+        fragShaderStageInfo.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+        fragShaderStageInfo.module = desc.fragmentShader;
+        fragShaderStageInfo.pName = desc.fragmentEntryPoint.c_str();
+
+        vertexInputInfo = desc.vertexInput.createInfo();
+
+        inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+        inputAssembly.topology = desc.topology;
+        inputAssembly.primitiveRestartEnable = desc.primitiveRestart;
+
+        viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+        viewportState.viewportCount = 1;
+        viewportState.scissorCount = 1;
+
+        rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+        rasterizer.depthClampEnable = VK_FALSE;
+        rasterizer.rasterizerDiscardEnable = VK_FALSE;
+        rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
+        rasterizer.lineWidth = 1.0f;
+        rasterizer.cullMode = desc.cullMode;
+        rasterizer.frontFace = desc.frontFace;
+        rasterizer.depthBiasEnable = VK_FALSE;
+
+        multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+        multisampling.sampleShadingEnable = VK_FALSE;
+        multisampling.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+
+        blendAttachment = colorBlendAttachment(desc.blendMode);
+
+        colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+        colorBlending.logicOpEnable = VK_FALSE;
+        colorBlending.logicOp = VK_LOGIC_OP_COPY;
+        colorBlending.attachmentCount = 1;
+        colorBlending.pAttachments = &blendAttachment;
+
+        dynamicStates = dynamic;
+        dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+        dynamicState.dynamicStateCount = static_cast<uint32_t>(dynamicStates.size());
+        dynamicState.pDynamicStates = dynamicStates.data();
+    }
+
+    PipelineState(const PipelineState&) = delete;
+    PipelineState& operator=(const PipelineState&) = delete;
+};
+
+// The part of a desc one library depends on; everything else is reset so that
+// descs differing only in other parts share the library.
+GraphicsPipelineDesc libraryKey(const GraphicsPipelineDesc& desc, VkGraphicsPipelineLibraryFlagsEXT part)
+{
+    GraphicsPipelineDesc key;
+    key.vertexShader = VK_NULL_HANDLE;
+    key.fragmentShader = VK_NULL_HANDLE;
+
+    switch (part) {
+    case VK_GRAPHICS_PIPELINE_LIBRARY_VERTEX_INPUT_INTERFACE_BIT_EXT:
+        key.vertexInput = desc.vertexInput;
+        key.topology = desc.topology;
+        key.primitiveRestart = desc.primitiveRestart;
+        break;
+    case VK_GRAPHICS_PIPELINE_LIBRARY_PRE_RASTERIZATION_SHADERS_BIT_EXT:
+        key.vertexShader = desc.vertexShader;
+        key.vertexEntryPoint = desc.vertexEntryPoint;
+        key.layout = desc.layout;
+        key.cullMode = desc.cullMode;
+        key.frontFace = desc.frontFace;
+        break;
+    case VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_SHADER_BIT_EXT:
+        key.fragmentShader = desc.fragmentShader;
+        key.fragmentEntryPoint = desc.fragmentEntryPoint;
+        key.layout = desc.layout;
+        break;
+    case VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_OUTPUT_INTERFACE_BIT_EXT:
+        key.blendMode = desc.blendMode;
+        break;
+    }
+
+    return key;
+}
+
+uint32_t libraryIndex(VkGraphicsPipelineLibraryFlagsEXT part)
+{
+    switch (part) {
+    case VK_GRAPHICS_PIPELINE_LIBRARY_VERTEX_INPUT_INTERFACE_BIT_EXT: return 0;
+    case VK_GRAPHICS_PIPELINE_LIBRARY_PRE_RASTERIZATION_SHADERS_BIT_EXT: return 1;
+    case VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_SHADER_BIT_EXT: return 2;
+    default: return 3;
+    }
+}
+
+const VkGraphicsPipelineLibraryFlagsEXT libraryParts[] = {
+    VK_GRAPHICS_PIPELINE_LIBRARY_VERTEX_INPUT_INTERFACE_BIT_EXT,
+    VK_GRAPHICS_PIPELINE_LIBRARY_PRE_RASTERIZATION_SHADERS_BIT_EXT,
+    VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_SHADER_BIT_EXT,
+    VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_OUTPUT_INTERFACE_BIT_EXT,
+};
+
+} // namespace
+
+
+
+// Init / Cleanup ----------------------------------------------------------------------------------------
+void GraphicsPipelineCache::init(VkDevice device, const DeviceCapabilities& capabilities, VkRenderPass renderPass, DeletionQueue& deletionQueue,
+                                 const VkAllocationCallbacks* allocator)
+{
+    this->device = device;
+    this->capabilities = capabilities;
+    this->renderPass = renderPass;
+    this->deletionQueue = &deletionQueue;
+    this->allocator = allocator;
+
+    // Without fast linking a library link costs about as much as a full compile.
+    useLibraries = capabilities.graphicsPipelineLibrary && capabilities.graphicsPipelineLibraryFastLinking;
+
+    VkPipelineCacheCreateInfo cacheInfo{};
+    cacheInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+
+    if (vkCreatePipelineCache(device, &cacheInfo, allocator, &pipelineCache) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create pipeline cache!");
+    }
+
+    if (capabilities.extendedDynamicState) {
+        cmdSetCullMode = (PFN_vkCmdSetCullModeEXT)vkGetDeviceProcAddr(device, "vkCmdSetCullModeEXT");
+        cmdSetFrontFace = (PFN_vkCmdSetFrontFaceEXT)vkGetDeviceProcAddr(device, "vkCmdSetFrontFaceEXT");
+        cmdSetPrimitiveTopology = (PFN_vkCmdSetPrimitiveTopologyEXT)vkGetDeviceProcAddr(device, "vkCmdSetPrimitiveTopologyEXT");
+    }
+    if (capabilities.extendedDynamicState2) {
+        cmdSetPrimitiveRestartEnable = (PFN_vkCmdSetPrimitiveRestartEnableEXT)vkGetDeviceProcAddr(device, "vkCmdSetPrimitiveRestartEnableEXT");
+    }
+
+    if (useLibraries) {
+        stopping = false;
+        worker = std::thread(&GraphicsPipelineCache::workerLoop, this);
+    }
+}
+
+void GraphicsPipelineCache::cleanup()
+{
+    if (worker.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(workerMutex);
+            stopping = true;
+            jobs.clear();
+        }
+        workerSignal.notify_all();
+        worker.join();
+    }
+
+    for (auto& result : results) {
+        vkDestroyPipeline(device, result.pipeline, allocator);
+    }
+    for (auto& [desc, pipeline] : pipelines) {
+        vkDestroyPipeline(device, pipeline, allocator);
+    }
+    for (auto& parts : libraries) {
+        for (auto& [desc, library] : parts) {
+            vkDestroyPipeline(device, library, allocator);
+        }
+        parts.clear();
+    }
+
+    results.clear();
+    pipelines.clear();
+
+    vkDestroyPipelineCache(device, pipelineCache, allocator);
+    pipelineCache = VK_NULL_HANDLE;
+}
+
+
+
+// Get ----------------------------------------------------------------------------------------
+VkPipeline GraphicsPipelineCache::get(const GraphicsPipelineDesc& desc)
+{
+    GraphicsPipelineDesc key = withoutDynamicState(desc);
+
+    auto it = pipelines.find(key);
+    if (it != pipelines.end()) {
+        return it->second;
+    }
+
+    VkPipeline pipeline;
+    if (useLibraries) {
+        std::vector<VkPipeline> parts;
+        for (auto part : libraryParts) {
+            parts.push_back(getLibrary(key, part));
+        }
+
+        pipeline = link(key, parts, false);
+        stats.fastLinked++;
+
+        {
+            std::lock_guard<std::mutex> lock(workerMutex);
+            jobs.push_back({ key, parts });
+        }
+        workerSignal.notify_one();
+    }
+    else {
+        pipeline = createMonolithic(key);
+        stats.monolithic++;
+    }
+
+    pipelines.emplace(std::move(key), pipeline);
+    return pipeline;
+}
+
+
+
+// Bind ----------------------------------------------------------------------------------------
+void GraphicsPipelineCache::bind(VkCommandBuffer commandBuffer, const GraphicsPipelineDesc& desc, BindState& state)
+{
+    VkPipeline pipeline = get(desc);
+    if (pipeline != state.pipeline) {
+        vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+        state.pipeline = pipeline;
+    }
+
+    // Dynamic state survives pipeline binds, so only changed values are set.
+    const bool all = !state.dynamicValid;
+    GraphicsPipelineDesc& bound = state.dynamic;
+
+    if (capabilities.extendedDynamicState) {
+        if (all || bound.topology != desc.topology) {
+            cmdSetPrimitiveTopology(commandBuffer, desc.topology);
+        }
+        if (all || bound.cullMode != desc.cullMode) {
+            cmdSetCullMode(commandBuffer, desc.cullMode);
+        }
+        if (all || bound.frontFace != desc.frontFace) {
+            cmdSetFrontFace(commandBuffer, desc.frontFace);
+        }
+    }
+
+    if (capabilities.extendedDynamicState2) {
+        if (all || bound.primitiveRestart != desc.primitiveRestart) {
+            cmdSetPrimitiveRestartEnable(commandBuffer, desc.primitiveRestart);
+        }
+    }
+
+    bound.topology = desc.topology;
+    bound.primitiveRestart = desc.primitiveRestart;
+    bound.cullMode = desc.cullMode;
+    bound.frontFace = desc.frontFace;
+    state.dynamicValid = true;
+}
+
+
+
+// Dynamic State ----------------------------------------------------------------------------------------
+GraphicsPipelineDesc GraphicsPipelineCache::withoutDynamicState(const GraphicsPipelineDesc& desc) const
+{
+    GraphicsPipelineDesc key = desc;
+
+    if (capabilities.extendedDynamicState) {
+        // Dynamic topology must stay within the topology class the pipeline was created with.
+        switch (desc.topology) {
+        case VK_PRIMITIVE_TOPOLOGY_POINT_LIST:
+            key.topology = VK_PRIMITIVE_TOPOLOGY_POINT_LIST;
+            break;
+        case VK_PRIMITIVE_TOPOLOGY_LINE_LIST:
+        case VK_PRIMITIVE_TOPOLOGY_LINE_STRIP:
+        case VK_PRIMITIVE_TOPOLOGY_LINE_LIST_WITH_ADJACENCY:
+        case VK_PRIMITIVE_TOPOLOGY_LINE_STRIP_WITH_ADJACENCY:
+            key.topology = VK_PRIMITIVE_TOPOLOGY_LINE_LIST;
+            break;
+        case VK_PRIMITIVE_TOPOLOGY_PATCH_LIST:
+            break;
+        default:
+            key.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+            break;
+        }
+
+        key.cullMode = VK_CULL_MODE_NONE;
+        key.frontFace = VK_FRONT_FACE_CLOCKWISE;
+    }
+
+    if (capabilities.extendedDynamicState2) {
+        key.primitiveRestart = VK_FALSE;
+    }
+
+    return key;
+}
+
+std::vector<VkDynamicState> GraphicsPipelineCache::dynamicStates(VkGraphicsPipelineLibraryFlagsEXT parts) const
+{
+    std::vector<VkDynamicState> states;
+
+    if (parts & VK_GRAPHICS_PIPELINE_LIBRARY_VERTEX_INPUT_INTERFACE_BIT_EXT) {
+        if (capabilities.extendedDynamicState) {
+            states.push_back(VK_DYNAMIC_STATE_PRIMITIVE_TOPOLOGY_EXT);
+        }
+        if (capabilities.extendedDynamicState2) {
+            states.push_back(VK_DYNAMIC_STATE_PRIMITIVE_RESTART_ENABLE_EXT);
+        }
+    }
+
+    if (parts & VK_GRAPHICS_PIPELINE_LIBRARY_PRE_RASTERIZATION_SHADERS_BIT_EXT) {
+        states.push_back(VK_DYNAMIC_STATE_VIEWPORT);
+        states.push_back(VK_DYNAMIC_STATE_SCISSOR);
+        if (capabilities.extendedDynamicState) {
+            states.push_back(VK_DYNAMIC_STATE_CULL_MODE_EXT);
+            states.push_back(VK_DYNAMIC_STATE_FRONT_FACE_EXT);
+        }
+    }
+
+    return states;
+}
+
+
+
+// Begin Frame ----------------------------------------------------------------------------------------
+void GraphicsPipelineCache::beginFrame()
+{
+    std::vector<OptimizeResult> finished;
+    {
+        std::lock_guard<std::mutex> lock(workerMutex);
+        finished.swap(results);
+    }
+
+    for (auto& result : finished) {
+        auto it = pipelines.find(result.desc);
+        if (it == pipelines.end()) {
+            vkDestroyPipeline(device, result.pipeline, allocator);
+            continue;
+        }
+
+        // Frames in flight may still use the pipeline being replaced.
+        deletionQueue->destroyPipeline(it->second, allocator);
+        it->second = result.pipeline;
+        stats.optimized++;
+    }
+}
+
+
+
+// Create Monolithic ----------------------------------------------------------------------------------------
+VkPipeline GraphicsPipelineCache::createMonolithic(const GraphicsPipelineDesc& desc)
+{
+    const VkGraphicsPipelineLibraryFlagsEXT allParts = VK_GRAPHICS_PIPELINE_LIBRARY_VERTEX_INPUT_INTERFACE_BIT_EXT | VK_GRAPHICS_PIPELINE_LIBRARY_PRE_RASTERIZATION_SHADERS_BIT_EXT
+        | VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_SHADER_BIT_EXT | VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_OUTPUT_INTERFACE_BIT_EXT;
+    PipelineState state(desc, dynamicStates(allParts));
+    VkPipelineShaderStageCreateInfo shaderStages[] = { state.vertShaderStageInfo, state.fragShaderStageInfo };
+
+    VkGraphicsPipelineCreateInfo pipelineInfo{};
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+    pipelineInfo.stageCount = 2;
+    pipelineInfo.pStages = shaderStages;
+    pipelineInfo.pVertexInputState = &state.vertexInputInfo;
+    pipelineInfo.pInputAssemblyState = &state.inputAssembly;
+    pipelineInfo.pViewportState = &state.viewportState;
+    pipelineInfo.pRasterizationState = &state.rasterizer;
+    pipelineInfo.pMultisampleState = &state.multisampling;
+    pipelineInfo.pColorBlendState = &state.colorBlending;
+    pipelineInfo.pDynamicState = &state.dynamicState;
+    pipelineInfo.layout = desc.layout;
+    pipelineInfo.renderPass = renderPass;
+    pipelineInfo.subpass = 0;
+    pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
+
+    VkPipeline pipeline;
+    if (vkCreateGraphicsPipelines(device, pipelineCache, 1, &pipelineInfo, allocator, &pipeline) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create graphics pipeline!");
+    }
+
+    return pipeline;
+}
+
+
+
+// Libraries ----------------------------------------------------------------------------------------
+VkPipeline GraphicsPipelineCache::getLibrary(const GraphicsPipelineDesc& desc, VkGraphicsPipelineLibraryFlagsEXT part)
+{
+    auto& parts = libraries[libraryIndex(part)];
+    GraphicsPipelineDesc key = libraryKey(desc, part);
+
+    auto it = parts.find(key);
+    if (it != parts.end()) {
+        return it->second;
+    }
+
+    VkPipeline library = createLibrary(desc, part);
+    parts.emplace(std::move(key), library);
+    stats.libraries++;
+    return library;
+}
+
+VkPipeline GraphicsPipelineCache::createLibrary(const GraphicsPipelineDesc& desc, VkGraphicsPipelineLibraryFlagsEXT part)
+{
+    PipelineState state(desc, dynamicStates(part));
+
+    VkGraphicsPipelineLibraryCreateInfoEXT libraryInfo{};
+    libraryInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_LIBRARY_CREATE_INFO_EXT;
+    libraryInfo.flags = part;
+
+    VkGraphicsPipelineCreateInfo pipelineInfo{};
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+    pipelineInfo.pNext = &libraryInfo;
+    pipelineInfo.flags = VK_PIPELINE_CREATE_LIBRARY_BIT_KHR | VK_PIPELINE_CREATE_RETAIN_LINK_TIME_OPTIMIZATION_INFO_BIT_EXT;
+    pipelineInfo.pDynamicState = state.dynamicStates.empty() ? nullptr : &state.dynamicState;
+
+    switch (part) {
+    case VK_GRAPHICS_PIPELINE_LIBRARY_VERTEX_INPUT_INTERFACE_BIT_EXT:
+        pipelineInfo.pVertexInputState = &state.vertexInputInfo;
+        pipelineInfo.pInputAssemblyState = &state.inputAssembly;
+        break;
+
+    case VK_GRAPHICS_PIPELINE_LIBRARY_PRE_RASTERIZATION_SHADERS_BIT_EXT:
+        pipelineInfo.stageCount = 1;
+        pipelineInfo.pStages = &state.vertShaderStageInfo;
+        pipelineInfo.pViewportState = &state.viewportState;
+        pipelineInfo.pRasterizationState = &state.rasterizer;
+        pipelineInfo.layout = desc.layout;
+        pipelineInfo.renderPass = renderPass;
+        break;
+
+    case VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_SHADER_BIT_EXT:
+        pipelineInfo.stageCount = 1;
+        pipelineInfo.pStages = &state.fragShaderStageInfo;
+        pipelineInfo.pMultisampleState = &state.multisampling;
+        pipelineInfo.layout = desc.layout;
+        pipelineInfo.renderPass = renderPass;
+        break;
+
+    case VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_OUTPUT_INTERFACE_BIT_EXT:
+        pipelineInfo.pMultisampleState = &state.multisampling;
+        pipelineInfo.pColorBlendState = &state.colorBlending;
+        pipelineInfo.renderPass = renderPass;
+        break;
+    }
+
+    VkPipeline library;
+    if (vkCreateGraphicsPipelines(device, pipelineCache, 1, &pipelineInfo, allocator, &library) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create graphics pipeline library!");
+    }
+
+    return library;
+}
+
+
+
+// Link ----------------------------------------------------------------------------------------
+VkPipeline GraphicsPipelineCache::link(const GraphicsPipelineDesc& desc, const std::vector<VkPipeline>& parts, bool optimize)
+{
+    VkPipelineLibraryCreateInfoKHR linkInfo{};
+    linkInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LIBRARY_CREATE_INFO_KHR;
+    linkInfo.libraryCount = static_cast<uint32_t>(parts.size());
+    linkInfo.pLibraries = parts.data();
+
+    VkGraphicsPipelineCreateInfo pipelineInfo{};
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+    pipelineInfo.pNext = &linkInfo;
+    pipelineInfo.flags = optimize ? VK_PIPELINE_CREATE_LINK_TIME_OPTIMIZATION_BIT_EXT : 0;
+    pipelineInfo.layout = desc.layout;
+
+    VkPipeline pipeline;
+    if (vkCreateGraphicsPipelines(device, pipelineCache, 1, &pipelineInfo, allocator, &pipeline) != VK_SUCCESS) {
+        throw std::runtime_error("failed to link graphics pipeline!");
+    }
+
+    return pipeline;
+}
+
+
+
+// Worker ----------------------------------------------------------------------------------------
+void GraphicsPipelineCache::workerLoop()
+{
+    for (;;) {
+        OptimizeJob job;
+        {
+            std::unique_lock<std::mutex> lock(workerMutex);
+            workerSignal.wait(lock, [this] { return stopping || !jobs.empty(); });
+
+            if (stopping) {
+                return;
+            }
+
+            job = std::move(jobs.front());
+            jobs.pop_front();
+        }
+
+        // Libraries are only destroyed in cleanup(), after this thread has been joined.
+        VkPipeline pipeline = VK_NULL_HANDLE;
+        try {
+            pipeline = link(job.desc, job.libraries, true);
+        }
+        catch (const std::exception&) {
+            // Keep using the fast-linked pipeline.
+            continue;
+        }
+
+        std::lock_guard<std::mutex> lock(workerMutex);
+        results.push_back({ std::move(job.desc), pipeline });
+    }
+}
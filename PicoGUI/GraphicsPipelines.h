@@ -0,0 +1,143 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "DeletionQueue.h"
+#include "DeviceCapabilities.h"
+#include "ShaderReflection.h"
+
+
+//  Pipeline Description --------------------------------------------------------------------------
+enum class BlendMode : uint32_t {
+    Opaque,
+    Alpha,
+    PremultipliedAlpha,
+    Additive,
+};
+
+struct GraphicsPipelineDesc {
+    VkShaderModule vertexShader = VK_NULL_HANDLE;
+    VkShaderModule fragmentShader = VK_NULL_HANDLE;
+    std::string vertexEntryPoint = "main";
+    std::string fragmentEntryPoint = "main";
+    VkPipelineLayout layout = VK_NULL_HANDLE;
+
+    VertexInputDesc vertexInput;
+    VkPrimitiveTopology topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+    VkBool32 primitiveRestart = VK_FALSE;
+    VkCullModeFlags cullMode = VK_CULL_MODE_BACK_BIT;
+    VkFrontFace frontFace = VK_FRONT_FACE_CLOCKWISE;
+    BlendMode blendMode = BlendMode::Opaque;
+
+    bool operator==(const GraphicsPipelineDesc& other) const;
+};
+
+VkPipelineColorBlendAttachmentState colorBlendAttachment(BlendMode blendMode);
+
+
+
+//  CLASS #########################################################################################
+// Creates and owns every graphics pipeline of the renderer.
+//
+// With VK_EXT_graphics_pipeline_library the four pipeline parts (vertex input, pre-rasterization,
+// fragment shader, fragment output) are compiled once each and cached separately. A new
+// combination is then fast-linked from existing parts on first use, while a link-time optimized
+// version is built on a worker thread and swapped in by beginFrame(). Without the extension,
+// pipelines are created monolithically on first use.
+//
+// With VK_EXT_extended_dynamic_state (and 2) topology, primitive restart, cull mode and front
+// face are set per draw by bind() instead of being baked, so descs that differ only in those
+// fields share one pipeline. Blending is always baked, as is everything without the extensions.
+class GraphicsPipelineCache
+{
+
+ // Public ----------------------------------------------------------------------------------------
+public:
+    // Last state bound by bind() in one command buffer; start each command buffer with a fresh one.
+    struct BindState {
+        VkPipeline pipeline = VK_NULL_HANDLE;
+        GraphicsPipelineDesc dynamic;
+        bool dynamicValid = false;
+    };
+
+    struct Stats {
+        uint32_t monolithic = 0;
+        uint32_t fastLinked = 0;
+        uint32_t optimized = 0;
+        uint32_t libraries = 0;
+    };
+
+    void init(VkDevice device, const DeviceCapabilities& capabilities, VkRenderPass renderPass, DeletionQueue& deletionQueue,
+              const VkAllocationCallbacks* allocator = nullptr);
+    void cleanup();
+
+    VkPipeline get(const GraphicsPipelineDesc& desc);
+
+    // Binds the pipeline for desc and sets whatever part of desc is dynamic on this device,
+    // skipping anything already bound in the same command buffer.
+    void bind(VkCommandBuffer commandBuffer, const GraphicsPipelineDesc& desc, BindState& state);
+
+    // Swaps in finished optimized pipelines; the ones they replace go to the deletion queue.
+    void beginFrame();
+
+    const Stats& getStats() const { return stats; }
+
+
+ // Private ----------------------------------------------------------------------------------------
+private:
+    struct DescHash {
+        size_t operator()(const GraphicsPipelineDesc& desc) const;
+    };
+
+    struct OptimizeJob {
+        GraphicsPipelineDesc desc;
+        std::vector<VkPipeline> libraries;
+    };
+
+    struct OptimizeResult {
+        GraphicsPipelineDesc desc;
+        VkPipeline pipeline;
+    };
+
+    VkDevice device = VK_NULL_HANDLE;
+    DeviceCapabilities capabilities;
+    VkRenderPass renderPass = VK_NULL_HANDLE;
+    VkPipelineCache pipelineCache = VK_NULL_HANDLE;
+    DeletionQueue* deletionQueue = nullptr;
+    const VkAllocationCallbacks* allocator = nullptr;
+    bool useLibraries = false;
+
+    std::unordered_map<GraphicsPipelineDesc, VkPipeline, DescHash> pipelines;
+    std::unordered_map<GraphicsPipelineDesc, VkPipeline, DescHash> libraries[4];   // one map per library part
+    Stats stats;
+
+    std::thread worker;
+    std::mutex workerMutex;
+    std::condition_variable workerSignal;
+    std::deque<OptimizeJob> jobs;
+    std::vector<OptimizeResult> results;
+    bool stopping = false;
+
+    PFN_vkCmdSetCullModeEXT cmdSetCullMode = nullptr;
+    PFN_vkCmdSetFrontFaceEXT cmdSetFrontFace = nullptr;
+    PFN_vkCmdSetPrimitiveTopologyEXT cmdSetPrimitiveTopology = nullptr;
+    PFN_vkCmdSetPrimitiveRestartEnableEXT cmdSetPrimitiveRestartEnable = nullptr;
+
+    GraphicsPipelineDesc withoutDynamicState(const GraphicsPipelineDesc& desc) const;
+    std::vector<VkDynamicState> dynamicStates(VkGraphicsPipelineLibraryFlagsEXT parts) const;
+
+    VkPipeline createMonolithic(const GraphicsPipelineDesc& desc);
+    VkPipeline getLibrary(const GraphicsPipelineDesc& desc, VkGraphicsPipelineLibraryFlagsEXT part);
+    VkPipeline createLibrary(const GraphicsPipelineDesc& desc, VkGraphicsPipelineLibraryFlagsEXT part);
+    VkPipeline link(const GraphicsPipelineDesc& desc, const std::vector<VkPipeline>& parts, bool optimize);
+    void workerLoop();
+};
@@ -0,0 +1,21 @@
+#include "Hash.h"
+
+
+namespace {
+
+constexpr uint64_t HASH_PRIME = 0x100000001b3ull;
+
+} // namespace
+
+
+
+// Hash ----------------------------------------------------------------------------------------
+uint64_t hashBytes(uint64_t hash, const void* data, size_t size)
+{
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    for (size_t i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= HASH_PRIME;
+    }
+    return hash;
+}
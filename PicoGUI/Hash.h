@@ -0,0 +1,12 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+
+//  Hash ------------------------------------------------------------------------------------------
+// 64-bit FNV-1a, shared by asset names, widget IDs and cache keys. Hashes chain: pass the result
+// back in to hash the next bytes, starting from HASH_SEED.
+constexpr uint64_t HASH_SEED = 0xcbf29ce484222325ull;
+
+uint64_t hashBytes(uint64_t hash, const void* data, size_t size);
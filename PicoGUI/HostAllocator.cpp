@@ -0,0 +1,239 @@
+#include "HostAllocator.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+
+namespace {
+
+constexpr size_t ARENA_SIZE = 64 << 10;
+constexpr size_t MIN_ALIGNMENT = 16;
+
+// Sits right before every pointer handed to Vulkan.
+struct Header {
+    void* base;             // what malloc returned, or nullptr for arena allocations
+    size_t size;
+    uint32_t tag;
+    uint32_t scope;
+};
+
+// Command-scope allocations are freed before the call that made them returns, on the same thread.
+struct CommandArena {
+    alignas(MIN_ALIGNMENT) unsigned char storage[ARENA_SIZE];
+    size_t cursor = 0;
+    uint32_t live = 0;
+};
+
+thread_local CommandArena commandArena;
+
+uintptr_t alignUp(uintptr_t value, size_t alignment)
+{
+    return (value + alignment - 1) & ~(uintptr_t(alignment) - 1);
+}
+
+Header* headerOf(void* memory)
+{
+    return reinterpret_cast<Header*>(static_cast<unsigned char*>(memory) - sizeof(Header));
+}
+
+} // namespace
+
+
+
+// Constructor ----------------------------------------------------------------------------------------
+HostAllocator::HostAllocator()
+{
+    for (uint32_t i = 0; i < HOST_ALLOCATION_TAG_COUNT; i++) {
+        tagData[i].owner = this;
+        tagData[i].tag = static_cast<HostAllocationTag>(i);
+
+        VkAllocationCallbacks& callbacks = tagCallbacks[i];
+        callbacks.pUserData = &tagData[i];
+        callbacks.pfnAllocation = allocationCallback;
+        callbacks.pfnReallocation = reallocationCallback;
+        callbacks.pfnFree = freeCallback;
+        callbacks.pfnInternalAllocation = internalAllocationCallback;
+        callbacks.pfnInternalFree = internalFreeCallback;
+    }
+}
+
+
+
+// Stats ----------------------------------------------------------------------------------------
+void HostAllocator::beginFrame()
+{
+    uint64_t allocations = 0;
+    for (auto& tag : counters) {
+        for (AtomicCounters& cell : tag) {
+            allocations += cell.allocations.load(std::memory_order_relaxed);
+        }
+    }
+
+    lastFrameAllocations = allocations - frameStartAllocations;
+    frameStartAllocations = allocations;
+}
+
+HostAllocationStats HostAllocator::getStats() const
+{
+    HostAllocationStats stats;
+
+    for (uint32_t tag = 0; tag < HOST_ALLOCATION_TAG_COUNT; tag++) {
+        for (uint32_t scope = 0; scope < HOST_ALLOCATION_SCOPE_COUNT; scope++) {
+            const AtomicCounters& cell = counters[tag][scope];
+
+            HostAllocationStats::Counters value;
+            value.allocations = cell.allocations.load(std::memory_order_relaxed);
+            value.frees = cell.frees.load(std::memory_order_relaxed);
+            value.liveCount = value.allocations - std::min(value.allocations, value.frees);
+            value.liveBytes = cell.liveBytes.load(std::memory_order_relaxed);
+            value.totalBytes = cell.totalBytes.load(std::memory_order_relaxed);
+
+            for (HostAllocationStats::Counters* sum : { &stats.tags[tag], &stats.scopes[scope], &stats.total }) {
+                sum->allocations += value.allocations;
+                sum->frees += value.frees;
+                sum->liveCount += value.liveCount;
+                sum->liveBytes += value.liveBytes;
+                sum->totalBytes += value.totalBytes;
+            }
+        }
+    }
+
+    stats.peakBytes = peakBytes.load(std::memory_order_relaxed);
+    stats.internalBytes = internalBytes.load(std::memory_order_relaxed);
+    stats.arenaAllocations = arenaAllocations.load(std::memory_order_relaxed);
+    stats.lastFrameAllocations = lastFrameAllocations;
+    return stats;
+}
+
+void HostAllocator::count(HostAllocationTag tag, VkSystemAllocationScope scope, int64_t bytes)
+{
+    AtomicCounters& cell = counters[static_cast<uint32_t>(tag)][std::min<uint32_t>(scope, HOST_ALLOCATION_SCOPE_COUNT - 1)];
+
+    if (bytes >= 0) {
+        cell.allocations.fetch_add(1, std::memory_order_relaxed);
+        cell.liveBytes.fetch_add(bytes, std::memory_order_relaxed);
+        cell.totalBytes.fetch_add(bytes, std::memory_order_relaxed);
+
+        const uint64_t live = liveBytes.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+        uint64_t peak = peakBytes.load(std::memory_order_relaxed);
+        while (live > peak && !peakBytes.compare_exchange_weak(peak, live, std::memory_order_relaxed)) {
+        }
+    }
+    else {
+        cell.frees.fetch_add(1, std::memory_order_relaxed);
+        cell.liveBytes.fetch_sub(-bytes, std::memory_order_relaxed);
+        liveBytes.fetch_sub(-bytes, std::memory_order_relaxed);
+    }
+}
+
+
+
+// Allocate / Free ----------------------------------------------------------------------------------------
+void* HostAllocator::allocate(HostAllocationTag tag, size_t size, size_t alignment, VkSystemAllocationScope scope)
+{
+    if (size == 0) {
+        return nullptr;
+    }
+    alignment = std::max(alignment, MIN_ALIGNMENT);
+
+    unsigned char* memory = nullptr;
+    void* base = nullptr;
+
+    if (useCommandArena && scope == VK_SYSTEM_ALLOCATION_SCOPE_COMMAND) {
+        CommandArena& arena = commandArena;
+        const uintptr_t start = reinterpret_cast<uintptr_t>(arena.storage);
+        const uintptr_t aligned = alignUp(start + arena.cursor + sizeof(Header), alignment);
+        if (aligned + size <= start + ARENA_SIZE) {
+            memory = reinterpret_cast<unsigned char*>(aligned);
+            arena.cursor = aligned + size - start;
+            arena.live++;
+            arenaAllocations.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    if (!memory) {
+        base = std::malloc(size + sizeof(Header) + alignment);
+        if (!base) {
+            return nullptr;
+        }
+        memory = reinterpret_cast<unsigned char*>(alignUp(reinterpret_cast<uintptr_t>(base) + sizeof(Header), alignment));
+    }
+
+    Header* header = headerOf(memory);
+    header->base = base;
+    header->size = size;
+    header->tag = static_cast<uint32_t>(tag);
+    header->scope = scope;
+
+    count(tag, scope, static_cast<int64_t>(size));
+    return memory;
+}
+
+void* HostAllocator::reallocate(HostAllocationTag tag, void* original, size_t size, size_t alignment, VkSystemAllocationScope scope)
+{
+    if (!original) {
+        return allocate(tag, size, alignment, scope);
+    }
+    if (size == 0) {
+        free(original);
+        return nullptr;
+    }
+
+    void* memory = allocate(tag, size, alignment, scope);
+    if (memory) {
+        std::memcpy(memory, original, std::min(size, headerOf(original)->size));
+        free(original);
+    }
+    return memory;
+}
+
+void HostAllocator::free(void* memory)
+{
+    if (!memory) {
+        return;
+    }
+
+    const Header header = *headerOf(memory);
+    count(static_cast<HostAllocationTag>(header.tag), static_cast<VkSystemAllocationScope>(header.scope), -static_cast<int64_t>(header.size));
+
+    if (header.base) {
+        std::free(header.base);
+        return;
+    }
+
+    CommandArena& arena = commandArena;
+    if (--arena.live == 0) {
+        arena.cursor = 0;
+    }
+}
+
+
+
+// Callbacks ----------------------------------------------------------------------------------------
+VKAPI_ATTR void* VKAPI_CALL HostAllocator::allocationCallback(void* userData, size_t size, size_t alignment, VkSystemAllocationScope scope)
+{
+    TagData* data = static_cast<TagData*>(userData);
+    return data->owner->allocate(data->tag, size, alignment, scope);
+}
+
+VKAPI_ATTR void* VKAPI_CALL HostAllocator::reallocationCallback(void* userData, void* original, size_t size, size_t alignment, VkSystemAllocationScope scope)
+{
+    TagData* data = static_cast<TagData*>(userData);
+    return data->owner->reallocate(data->tag, original, size, alignment, scope);
+}
+
+VKAPI_ATTR void VKAPI_CALL HostAllocator::freeCallback(void* userData, void* memory)
+{
+    static_cast<TagData*>(userData)->owner->free(memory);
+}
+
+VKAPI_ATTR void VKAPI_CALL HostAllocator::internalAllocationCallback(void* userData, size_t size, VkInternalAllocationType, VkSystemAllocationScope)
+{
+    static_cast<TagData*>(userData)->owner->internalBytes.fetch_add(size, std::memory_order_relaxed);
+}
+
+VKAPI_ATTR void VKAPI_CALL HostAllocator::internalFreeCallback(void* userData, size_t size, VkInternalAllocationType, VkSystemAllocationScope)
+{
+    static_cast<TagData*>(userData)->owner->internalBytes.fetch_sub(size, std::memory_order_relaxed);
+}
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+
+//  Allocation Tags -------------------------------------------------------------------------------
+// What kind of object a set of callbacks is handed to. Vulkan itself only reports the scope.
+enum class HostAllocationTag : uint32_t {
+    Instance,       // instance, debug messenger, surface
+    Device,
+    Swapchain,      // swapchain, its image views and framebuffers
+    Resource,       // buffers, images, their views and samplers, descriptor pools and device memory
+    Pipeline,       // pipelines, their caches, layouts, shader modules and render passes
+    Command,        // command pools, and the transfer queue's batches
+    Sync,           // fences and semaphores
+    Count,
+};
+
+constexpr uint32_t HOST_ALLOCATION_TAG_COUNT = static_cast<uint32_t>(HostAllocationTag::Count);
+constexpr uint32_t HOST_ALLOCATION_SCOPE_COUNT = VK_SYSTEM_ALLOCATION_SCOPE_INSTANCE + 1;
+
+struct HostAllocationStats {
+    struct Counters {
+        uint64_t allocations = 0;       // including reallocations
+        uint64_t frees = 0;
+        uint64_t liveCount = 0;
+        uint64_t liveBytes = 0;
+        uint64_t totalBytes = 0;        // ever allocated
+    };
+
+    Counters tags[HOST_ALLOCATION_TAG_COUNT];
+    Counters scopes[HOST_ALLOCATION_SCOPE_COUNT];     // indexed by VkSystemAllocationScope
+    Counters total;
+    uint64_t peakBytes = 0;
+    uint64_t internalBytes = 0;         // driver allocations reported through the notifications
+    uint64_t arenaAllocations = 0;      // command-scope allocations served by the thread arenas
+    uint64_t lastFrameAllocations = 0;  // allocations between the last two beginFrame() calls
+};
+
+
+
+//  CLASS #########################################################################################
+// VkAllocationCallbacks that count how much host memory the loader, layers and driver use. Each
+// tag has its own callbacks whose pUserData names the tag, so allocations are counted by the kind
+// of object created with them as well as by the scope Vulkan reports.
+//
+// Command-scope allocations only live for the duration of one Vulkan call, so with
+// useCommandArena they are bump-allocated from a small thread-local arena, which is rewound
+// whenever its last allocation is freed. Requests the arena cannot hold fall back to the heap.
+//
+// Objects must be destroyed with the same callbacks they were created with.
+class HostAllocator
+{
+
+ // Public ----------------------------------------------------------------------------------------
+public:
+    HostAllocator();
+    HostAllocator(const HostAllocator&) = delete;
+    HostAllocator& operator=(const HostAllocator&) = delete;
+
+    void setCommandArena(bool enabled) { useCommandArena = enabled; }
+
+    const VkAllocationCallbacks* callbacks(HostAllocationTag tag) const { return &tagCallbacks[static_cast<uint32_t>(tag)]; }
+
+    // Call once per frame to update lastFrameAllocations.
+    void beginFrame();
+
+    HostAllocationStats getStats() const;
+
+
+ // Private ----------------------------------------------------------------------------------------
+private:
+    struct AtomicCounters {
+        std::atomic<uint64_t> allocations = 0;
+        std::atomic<uint64_t> frees = 0;
+        std::atomic<uint64_t> liveBytes = 0;
+        std::atomic<uint64_t> totalBytes = 0;
+    };
+
+    struct TagData {
+        HostAllocator* owner;
+        HostAllocationTag tag;
+    };
+
+    TagData tagData[HOST_ALLOCATION_TAG_COUNT];
+    VkAllocationCallbacks tagCallbacks[HOST_ALLOCATION_TAG_COUNT];
+    bool useCommandArena = true;
+
+    AtomicCounters counters[HOST_ALLOCATION_TAG_COUNT][HOST_ALLOCATION_SCOPE_COUNT];
+    std::atomic<uint64_t> liveBytes = 0;
+    std::atomic<uint64_t> peakBytes = 0;
+    std::atomic<uint64_t> internalBytes = 0;
+    std::atomic<uint64_t> arenaAllocations = 0;
+    uint64_t frameStartAllocations = 0;
+    uint64_t lastFrameAllocations = 0;
+
+    void* allocate(HostAllocationTag tag, size_t size, size_t alignment, VkSystemAllocationScope scope);
+    void* reallocate(HostAllocationTag tag, void* original, size_t size, size_t alignment, VkSystemAllocationScope scope);
+    void free(void* memory);
+    void count(HostAllocationTag tag, VkSystemAllocationScope scope, int64_t bytes);
+
+    static VKAPI_ATTR void* VKAPI_CALL allocationCallback(void* userData, size_t size, size_t alignment, VkSystemAllocationScope scope);
+    static VKAPI_ATTR void* VKAPI_CALL reallocationCallback(void* userData, void* original, size_t size, size_t alignment, VkSystemAllocationScope scope);
+    static VKAPI_ATTR void VKAPI_CALL freeCallback(void* userData, void* memory);
+    static VKAPI_ATTR void VKAPI_CALL internalAllocationCallback(void* userData, size_t size, VkInternalAllocationType type, VkSystemAllocationScope scope);
+    static VKAPI_ATTR void VKAPI_CALL internalFreeCallback(void* userData, size_t size, VkInternalAllocationType type, VkSystemAllocationScope scope);
+};
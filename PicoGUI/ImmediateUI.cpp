@@ -0,0 +1,225 @@
+#include "ImmediateUI.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+#include "Hash.h"
+
+
+namespace {
+
+// ID of the container the UI is built in.
+constexpr uint64_t ROOT_ID = HASH_SEED;
+
+template<typename T>
+uint64_t hashValue(uint64_t hash, const T& value)
+{
+    return hashBytes(hash, &value, sizeof(value));
+}
+
+// Field by field, so padding between the fields never reaches the hash.
+uint64_t hashStyle(uint64_t hash, const WidgetStyle& style)
+{
+    hash = hashValue(hash, static_cast<uint32_t>(style.direction));
+    hash = hashValue(hash, static_cast<uint32_t>(style.wrap));
+    hash = hashValue(hash, static_cast<uint32_t>(style.justify));
+    hash = hashValue(hash, static_cast<uint32_t>(style.alignItems));
+    hash = hashValue(hash, style.padding);
+    hash = hashValue(hash, style.gap);
+
+    hash = hashValue(hash, style.width);
+    hash = hashValue(hash, style.height);
+    hash = hashValue(hash, style.minWidth);
+    hash = hashValue(hash, style.minHeight);
+    hash = hashValue(hash, style.maxWidth);
+    hash = hashValue(hash, style.maxHeight);
+    hash = hashValue(hash, style.grow);
+    hash = hashValue(hash, style.shrink);
+    hash = hashValue(hash, style.basis);
+    hash = hashValue(hash, static_cast<uint32_t>(style.alignSelf));
+
+    hash = hashValue(hash, style.background);
+    hash = hashValue(hash, style.texture);
+    hash = hashValue(hash, style.uv);
+    hash = hashValue(hash, style.tint);
+    hash = hashValue(hash, static_cast<uint32_t>(style.paint));
+    hash = hashValue(hash, static_cast<uint32_t>(style.clipChildren));
+    return hash;
+}
+
+const float HOVER_SHADE = 1.15f;
+const float PRESS_SHADE = 0.8f;
+
+} // namespace
+
+
+
+// Init ----------------------------------------------------------------------------------------
+void ImmediateUI::init(WidgetTree& tree, WidgetId parent)
+{
+    this->tree = &tree;
+    this->parent = parent;
+}
+
+
+
+// Frame ----------------------------------------------------------------------------------------
+void ImmediateUI::beginFrame(const UiInput& input)
+{
+    this->input = input;
+    frame++;
+    stats = Stats{};
+
+    containers.assign(1, Container{ ROOT_ID, parent, NO_WIDGET });
+    idStack.assign(1, ROOT_ID);
+
+    hovered.clear();
+    for (WidgetId widget = tree->hitTest(input.mouse); widget != NO_WIDGET; widget = tree->getParent(widget)) {
+        hovered.push_back(widget);
+    }
+}
+
+void ImmediateUI::endFrame()
+{
+    if (containers.size() != 1 || idStack.size() != 1) {
+        throw std::runtime_error("unbalanced immediate UI scopes!");
+    }
+
+    // Widgets not declared this frame go. Destroying a container takes its children with it, so
+    // only those whose container stays are destroyed one by one.
+    for (auto it = entries.begin(); it != entries.end();) {
+        const Entry& entry = it->second;
+        if (entry.frame == frame) {
+            ++it;
+            continue;
+        }
+
+        const auto container = entries.find(entry.parent);
+        if (entry.parent == ROOT_ID || (container != entries.end() && container->second.frame == frame)) {
+            tree->destroy(entry.widget);
+        }
+        stats.destroyed++;
+        it = entries.erase(it);
+    }
+
+    if (!input.mouseDown) {
+        active = 0;
+    }
+    mouseWasDown = input.mouseDown;
+}
+
+
+
+// IDs ----------------------------------------------------------------------------------------
+void ImmediateUI::pushId(std::string_view label)
+{
+    idStack.push_back(makeId(label));
+}
+
+void ImmediateUI::pushId(uint64_t index)
+{
+    idStack.push_back(hashValue(idStack.back(), index));
+}
+
+void ImmediateUI::popId()
+{
+    if (idStack.size() <= containers.size()) {
+        throw std::runtime_error("popId without a matching pushId!");
+    }
+    idStack.pop_back();
+}
+
+uint64_t ImmediateUI::makeId(std::string_view label) const
+{
+    return hashBytes(idStack.back(), label.data(), label.size());
+}
+
+
+
+// Widgets ----------------------------------------------------------------------------------------
+void ImmediateUI::beginContainer(std::string_view label, const WidgetStyle& style, uint64_t contentHash)
+{
+    const uint64_t id = makeId(label);
+    const WidgetId widget = declare(id, style, contentHash);
+    containers.push_back({ id, widget, NO_WIDGET });
+    idStack.push_back(id);
+}
+
+void ImmediateUI::endContainer()
+{
+    if (containers.size() <= 1 || idStack.back() != containers.back().id) {
+        throw std::runtime_error("endContainer without a matching beginContainer!");
+    }
+    containers.pop_back();
+    idStack.pop_back();
+}
+
+WidgetId ImmediateUI::box(std::string_view label, const WidgetStyle& style, uint64_t contentHash)
+{
+    return declare(makeId(label), style, contentHash);
+}
+
+bool ImmediateUI::button(std::string_view label, const WidgetStyle& style, uint64_t contentHash)
+{
+    const uint64_t id = makeId(label);
+    const bool hover = isHovered(id);
+
+    if (hover && input.mouseDown && !mouseWasDown) {
+        active = id;
+    }
+    const bool pressed = active == id && input.mouseDown;
+    const bool clicked = active == id && hover && !input.mouseDown && mouseWasDown;
+
+    WidgetStyle shaded = style;
+    if (pressed || hover) {
+        const float shade = pressed ? PRESS_SHADE : HOVER_SHADE;
+        shaded.background = glm::vec4(glm::min(glm::vec3(style.background) * shade, glm::vec3(1.0f)), style.background.a);
+    }
+
+    declare(id, shaded, contentHash);
+    return clicked;
+}
+
+// Finds or creates the widget of an ID and brings it up to date with the inputs.
+WidgetId ImmediateUI::declare(uint64_t id, const WidgetStyle& style, uint64_t contentHash)
+{
+    Container& container = containers.back();
+    const uint64_t inputHash = hashStyle(hashValue(HASH_SEED, contentHash), style);
+    stats.declared++;
+
+    auto [it, created] = entries.try_emplace(id);
+    Entry& entry = it->second;
+    if (created) {
+        entry.widget = tree->create(container.widget, style);
+        entry.inputHash = inputHash;
+        stats.created++;
+    }
+    else if (entry.frame == frame) {
+        throw std::runtime_error("immediate UI ID declared twice in one frame!");
+    }
+    else if (entry.inputHash != inputHash) {
+        tree->setStyle(entry.widget, style);
+        entry.inputHash = inputHash;
+        stats.restyled++;
+    }
+    else {
+        stats.reused++;
+    }
+    entry.parent = container.id;
+    entry.frame = frame;
+
+    // Keep the widgets in the order they are declared in; those left over drift to the end.
+    const WidgetId expected = container.last != NO_WIDGET ? tree->getNextSibling(container.last) : tree->getFirstChild(container.widget);
+    if (entry.widget != expected) {
+        tree->move(entry.widget, container.widget, expected);
+        stats.moved++;
+    }
+    container.last = entry.widget;
+    return entry.widget;
+}
+
+bool ImmediateUI::isHovered(uint64_t id) const
+{
+    const auto it = entries.find(id);
+    return it != entries.end() && std::find(hovered.begin(), hovered.end(), it->second.widget) != hovered.end();
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "WidgetTree.h"
+
+
+//  Immediate UI ----------------------------------------------------------------------------------
+struct UiInput {
+    glm::vec2 mouse = glm::vec2(-1.0f);
+    bool mouseDown = false;
+};
+
+
+
+//  CLASS #########################################################################################
+// Immediate-mode front end over a WidgetTree. Tools code declares its whole UI every frame, as
+// if rebuilding it, but each call only looks up a retained widget:
+//
+//  - Every widget has a stable ID, the hash of its label and the IDs of the containers and
+//    pushId() scopes around it, so it finds its widget again in the next frame.
+//  - Its inputs, the style and an optional content hash, are hashed too. When they hash the same
+//    as last frame the widget is left alone, and the tree keeps its layout, its quads, and the
+//    instance records they became. Otherwise the new style goes to the tree.
+//  - Widgets declared in a new order are moved, and widgets no longer declared are destroyed
+//    in endFrame().
+//
+// The tree turns that diff into work and damage: only changed widgets are laid out and painted,
+// and WidgetTree::getDamage() covers only what they changed on screen.
+//
+// Input is one frame late: hit tests use the layout of the last update(), as in most immediate UIs.
+class ImmediateUI
+{
+
+ // Public ----------------------------------------------------------------------------------------
+public:
+    struct Stats {
+        uint32_t declared = 0;      // last frame
+        uint32_t reused = 0;        // inputs unchanged, last frame
+        uint32_t restyled = 0;      // last frame
+        uint32_t created = 0;       // last frame
+        uint32_t moved = 0;         // last frame
+        uint32_t destroyed = 0;     // last frame
+    };
+
+    // The UI builds its widgets under parent, which should hold nothing else.
+    void init(WidgetTree& tree, WidgetId parent);
+
+    void beginFrame(const UiInput& input);
+    void endFrame();
+
+    // Scopes the IDs of the widgets declared until popId(), e.g. for each item of a list.
+    void pushId(std::string_view label);
+    void pushId(uint64_t index);
+    void popId();
+
+    // A widget that holds the widgets declared until endContainer().
+    void beginContainer(std::string_view label, const WidgetStyle& style, uint64_t contentHash = 0);
+    void endContainer();
+
+    // A widget with no children; contentHash stands for inputs outside the style.
+    WidgetId box(std::string_view label, const WidgetStyle& style, uint64_t contentHash = 0);
+
+    // A box that lightens under the mouse and darkens while pressed; returns true on the frame it
+    // is clicked, that is released over after being pressed.
+    bool button(std::string_view label, const WidgetStyle& style, uint64_t contentHash = 0);
+
+    const Stats& getStats() const { return stats; }
+
+
+ // Private ----------------------------------------------------------------------------------------
+private:
+    struct Entry {
+        WidgetId widget = NO_WIDGET;
+        uint64_t parent = 0;        // ID of the container
+        uint64_t inputHash = 0;
+        uint64_t frame = 0;         // last declared
+    };
+
+    struct Container {
+        uint64_t id;
+        WidgetId widget;
+        WidgetId last;              // declared last this frame
+    };
+
+    WidgetTree* tree = nullptr;
+    WidgetId parent = NO_WIDGET;
+
+    std::unordered_map<uint64_t, Entry> entries;
+    std::vector<Container> containers;
+    std::vector<uint64_t> idStack;
+    uint64_t frame = 0;
+
+    UiInput input;
+    bool mouseWasDown = false;
+    std::vector<WidgetId> hovered;  // the widget under the mouse and its ancestors
+    uint64_t active = 0;            // ID of the pressed button
+
+    Stats stats;
+
+    uint64_t makeId(std::string_view label) const;
+    WidgetId declare(uint64_t id, const WidgetStyle& style, uint64_t contentHash);
+    bool isHovered(uint64_t id) const;
+};
@@ -0,0 +1,192 @@
+#include "LayoutBenchmark.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+
+#include "WidgetTree.h"
+
+
+namespace {
+
+const glm::vec2 VIEWPORT = glm::vec2(1280.0f, 720.0f);
+const glm::vec2 RESIZED_VIEWPORT = glm::vec2(1024.0f, 768.0f);
+
+// Layout recurses once per level; chains this deep fit any default stack.
+constexpr uint32_t DEEP_CHAIN_DEPTH = 100;
+constexpr uint32_t WIDE_ROW_SIZE = 1000;
+constexpr uint32_t TEXT_CARD_SIZE = 10;     // the card and its paragraphs
+
+constexpr float GLYPH_ADVANCE = 7.0f;
+constexpr float LINE_HEIGHT = 16.0f;
+
+// Fixed-pitch stand-in for shaped text: wraps at the available width, a glyph per character.
+WidgetTree::MeasureFunction measureText(uint32_t characters)
+{
+    return [characters](glm::vec2 available) {
+        const float length = static_cast<float>(characters);
+        if (std::isinf(available.x)) {
+            return glm::vec2(length * GLYPH_ADVANCE, LINE_HEIGHT);
+        }
+        const float perLine = std::max(1.0f, std::floor(available.x / GLYPH_ADVANCE));
+        return glm::vec2(std::min(length, perLine) * GLYPH_ADVANCE, std::ceil(length / perLine) * LINE_HEIGHT);
+    };
+}
+
+struct Scene {
+    std::unique_ptr<WidgetTree> tree;
+    WidgetId leaf = NO_WIDGET;              // changed in the one-leaf scenario
+};
+
+// Each tree fills the root with a list that overflows the viewport, as a scrolled list does, so
+// the children of the root do not shrink.
+
+// Chains of nested auto-sized columns, each level padded, ending in a fixed leaf.
+Scene buildDeep(uint32_t widgets)
+{
+    Scene scene;
+    scene.tree = std::make_unique<WidgetTree>();
+    WidgetTree& tree = *scene.tree;
+
+    WidgetStyle level;
+    level.padding = glm::vec4(1.0f);
+
+    WidgetStyle top = level;
+    top.shrink = 0.0f;
+
+    WidgetStyle leaf;
+    leaf.width = 10.0f;
+    leaf.height = 10.0f;
+    leaf.alignSelf = FlexAlign::Start;
+
+    for (uint32_t chain = 0; chain < widgets / DEEP_CHAIN_DEPTH; chain++) {
+        WidgetId parent = tree.create(tree.getRoot(), top);
+        for (uint32_t depth = 2; depth < DEEP_CHAIN_DEPTH; depth++) {
+            parent = tree.create(parent, level);
+        }
+        scene.leaf = tree.create(parent, leaf);
+    }
+    return scene;
+}
+
+// Wrapping rows of items that grow to fill each line.
+Scene buildWide(uint32_t widgets)
+{
+    Scene scene;
+    scene.tree = std::make_unique<WidgetTree>();
+    WidgetTree& tree = *scene.tree;
+
+    WidgetStyle row;
+    row.direction = LayoutDirection::Row;
+    row.wrap = true;
+    row.gap = 2.0f;
+    row.padding = glm::vec4(4.0f);
+    row.shrink = 0.0f;
+
+    WidgetStyle item;
+    item.height = 20.0f;
+    item.grow = 1.0f;
+
+    for (uint32_t i = 0; i < widgets / WIDE_ROW_SIZE; i++) {
+        const WidgetId parent = tree.create(tree.getRoot(), row);
+        for (uint32_t j = 1; j < WIDE_ROW_SIZE; j++) {
+            item.width = 24.0f + static_cast<float>(j % 7) * 8.0f;
+            scene.leaf = tree.create(parent, item);
+        }
+    }
+    return scene;
+}
+
+// Cards of wrapped paragraphs, each measured by its text.
+Scene buildText(uint32_t widgets)
+{
+    Scene scene;
+    scene.tree = std::make_unique<WidgetTree>();
+    WidgetTree& tree = *scene.tree;
+
+    WidgetStyle card;
+    card.padding = glm::vec4(8.0f);
+    card.gap = 4.0f;
+    card.shrink = 0.0f;
+
+    for (uint32_t i = 0; i < widgets / TEXT_CARD_SIZE; i++) {
+        const WidgetId parent = tree.create(tree.getRoot(), card);
+        for (uint32_t j = 1; j < TEXT_CARD_SIZE; j++) {
+            scene.leaf = tree.create(parent, WidgetStyle{});
+            tree.setMeasure(scene.leaf, measureText(20 + (i * 31 + j * 17) % 300));
+        }
+    }
+    return scene;
+}
+
+void changeLeaf(WidgetTree& tree, WidgetId leaf)
+{
+    WidgetStyle style = tree.getStyle(leaf);
+    if (style.width != WIDGET_AUTO) {
+        style.width += 10.0f;
+        tree.setStyle(leaf, style);
+    }
+    else {
+        tree.setMeasure(leaf, measureText(500));
+    }
+}
+
+// Runs one scenario and prints its row.
+template<typename Change>
+void runScenario(const char* treeName, uint32_t widgets, const char* scenario, WidgetTree& tree, QuadBatch& batch, Change change)
+{
+    const auto start = std::chrono::steady_clock::now();
+    change();
+    tree.update(batch);
+    const std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+
+    const WidgetTree::Stats& stats = tree.getStats();
+    std::cout << std::left << std::setw(6) << treeName
+              << std::right << std::setw(9) << widgets << "  "
+              << std::left << std::setw(16) << scenario
+              << std::right << std::setw(11) << std::fixed << std::setprecision(3) << elapsed.count()
+              << std::setw(10) << stats.laidOut
+              << std::setw(10) << stats.measured
+              << std::setw(10) << stats.measureHits << '\n';
+}
+
+} // namespace
+
+
+
+// Run ----------------------------------------------------------------------------------------
+int runLayoutBenchmark()
+{
+    struct TreeKind {
+        const char* name;
+        Scene (*build)(uint32_t widgets);
+    };
+    const TreeKind kinds[] = {
+        { "deep", buildDeep },
+        { "wide", buildWide },
+        { "text", buildText },
+    };
+
+    std::cout << "tree    widgets  scenario                 ms   laidOut  measured      hits\n";
+
+    for (const TreeKind& kind : kinds) {
+        for (uint32_t widgets : { 10'000u, 100'000u, 1'000'000u }) {
+            Scene scene = kind.build(widgets);
+            WidgetTree& tree = *scene.tree;
+            QuadBatch batch;
+
+            runScenario(kind.name, widgets, "full layout", tree, batch, [&]() { tree.setViewport(VIEWPORT); });
+            runScenario(kind.name, widgets, "one leaf", tree, batch, [&]() { changeLeaf(tree, scene.leaf); });
+            runScenario(kind.name, widgets, "resize", tree, batch, [&]() { tree.setViewport(RESIZED_VIEWPORT); });
+            runScenario(kind.name, widgets, "resize back", tree, batch, [&]() { tree.setViewport(VIEWPORT); });
+            runScenario(kind.name, widgets, "idle", tree, batch, []() {});
+        }
+    }
+
+    std::cout.flush();
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,9 @@
+#pragma once
+
+
+//  Layout Benchmark ------------------------------------------------------------------------------
+// Times WidgetTree layout on deep, wide, and text-heavy trees of 10k, 100k, and 1M widgets: the
+// first full layout, changing one leaf, resizing the viewport, resizing it back (served from the
+// measure caches), and an update with nothing to do. Prints one row per tree and scenario with
+// the time and how many widgets were laid out and measured. Run with --bench-layout.
+int runLayoutBenchmark();
@@ -0,0 +1,175 @@
+#include "MappedFile.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+
+// Open ----------------------------------------------------------------------------------------
+#ifdef _WIN32
+MappedFile::MappedFile(const std::string& filename)
+{
+    HANDLE file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        throw std::runtime_error("failed to open file: " + filename);
+    }
+    fileHandle = file;
+
+    LARGE_INTEGER fileSize{};
+    if (!GetFileSizeEx(file, &fileSize)) {
+        release();
+        throw std::runtime_error("failed to query file size: " + filename);
+    }
+
+    mappedSize = static_cast<size_t>(fileSize.QuadPart);
+    if (mappedSize == 0) {
+        return;
+    }
+
+    mappingHandle = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mappingHandle == nullptr) {
+        release();
+        throw std::runtime_error("failed to map file: " + filename);
+    }
+
+    mappedData = static_cast<const std::byte*>(MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0));
+    if (mappedData == nullptr) {
+        release();
+        throw std::runtime_error("failed to map file: " + filename);
+    }
+}
+#else
+MappedFile::MappedFile(const std::string& filename)
+{
+    int fd = open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        throw std::runtime_error("failed to open file: " + filename);
+    }
+
+    struct stat info {};
+    if (fstat(fd, &info) != 0) {
+        close(fd);
+        throw std::runtime_error("failed to query file size: " + filename);
+    }
+
+    mappedSize = static_cast<size_t>(info.st_size);
+    if (mappedSize == 0) {
+        close(fd);
+        return;
+    }
+
+    void* mapping = mmap(nullptr, mappedSize, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+
+    if (mapping == MAP_FAILED) {
+        mappedSize = 0;
+        throw std::runtime_error("failed to map file: " + filename);
+    }
+
+    mappedData = static_cast<const std::byte*>(mapping);
+}
+#endif
+
+
+
+// Move ----------------------------------------------------------------------------------------
+MappedFile::MappedFile(MappedFile&& other) noexcept
+{
+    *this = std::move(other);
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept
+{
+    if (this != &other) {
+        release();
+
+        mappedData = std::exchange(other.mappedData, nullptr);
+        mappedSize = std::exchange(other.mappedSize, 0);
+#ifdef _WIN32
+        fileHandle = std::exchange(other.fileHandle, nullptr);
+        mappingHandle = std::exchange(other.mappingHandle, nullptr);
+#endif
+    }
+
+    return *this;
+}
+
+MappedFile::~MappedFile()
+{
+    release();
+}
+
+
+
+// Words ----------------------------------------------------------------------------------------
+std::span<const uint32_t> MappedFile::words() const
+{
+    if (mappedSize % sizeof(uint32_t) != 0) {
+        throw std::runtime_error("file size is not a multiple of 4 bytes!");
+    }
+
+    return { reinterpret_cast<const uint32_t*>(mappedData), mappedSize / sizeof(uint32_t) };
+}
+
+
+
+// Will Need ----------------------------------------------------------------------------------------
+void MappedFile::willNeed(size_t offset, size_t size) const
+{
+    if (mappedData == nullptr || offset >= mappedSize) {
+        return;
+    }
+
+    size = std::min(size, mappedSize - offset);
+
+#ifdef _WIN32
+    WIN32_MEMORY_RANGE_ENTRY range{};
+    range.VirtualAddress = const_cast<std::byte*>(mappedData + offset);
+    range.NumberOfBytes = size;
+    PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+#else
+    // madvise wants a page aligned start address.
+    const uintptr_t pageSize = static_cast<uintptr_t>(sysconf(_SC_PAGESIZE));
+    const uintptr_t begin = reinterpret_cast<uintptr_t>(mappedData + offset) & ~(pageSize - 1);
+    const uintptr_t end = reinterpret_cast<uintptr_t>(mappedData + offset + size);
+    madvise(reinterpret_cast<void*>(begin), end - begin, MADV_WILLNEED);
+#endif
+}
+
+
+
+// Release ----------------------------------------------------------------------------------------
+void MappedFile::release()
+{
+#ifdef _WIN32
+    if (mappedData != nullptr) {
+        UnmapViewOfFile(mappedData);
+    }
+    if (mappingHandle != nullptr) {
+        CloseHandle(mappingHandle);
+    }
+    if (fileHandle != nullptr) {
+        CloseHandle(fileHandle);
+    }
+    mappingHandle = nullptr;
+    fileHandle = nullptr;
+#else
+    if (mappedData != nullptr) {
+        munmap(const_cast<std::byte*>(mappedData), mappedSize);
+    }
+#endif
+
+    mappedData = nullptr;
+    mappedSize = 0;
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+
+
+//  CLASS #########################################################################################
+// Read-only memory mapping of a whole file. The mapping is page aligned, so
+// words() can be handed straight to VkShaderModuleCreateInfo::pCode and
+// bytes() can be memcpy'd straight into a mapped staging buffer.
+class MappedFile
+{
+
+ // Public ----------------------------------------------------------------------------------------
+public:
+    MappedFile() = default;
+    explicit MappedFile(const std::string& filename);
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+
+    const std::byte* data() const { return mappedData; }
+    size_t size() const { return mappedSize; }
+    bool empty() const { return mappedSize == 0; }
+
+    std::span<const std::byte> bytes() const { return { mappedData, mappedSize }; }
+    std::span<const uint32_t> words() const;
+
+    // Hint the OS to page in [offset, offset + size) ahead of a sequential copy.
+    void willNeed(size_t offset, size_t size) const;
+
+
+ // Private ----------------------------------------------------------------------------------------
+private:
+    const std::byte* mappedData = nullptr;
+    size_t mappedSize = 0;
+
+#ifdef _WIN32
+    void* fileHandle = nullptr;
+    void* mappingHandle = nullptr;
+#endif
+
+    void release();
+};
@@ -0,0 +1,122 @@
+#include "MemoryBudget.h"
+
+#include <algorithm>
+
+
+namespace {
+
+// Without VK_EXT_memory_budget, assume the rest of the system leaves us this share of a heap.
+constexpr float FALLBACK_BUDGET_SHARE = 0.8f;
+
+} // namespace
+
+
+
+// Init ----------------------------------------------------------------------------------------
+void MemoryBudget::init(VkPhysicalDevice physicalDevice, GpuAllocator& gpuAllocator, bool budgetExtension, float highWater, float lowWater)
+{
+    this->physicalDevice = physicalDevice;
+    this->gpuAllocator = &gpuAllocator;
+    this->budgetExtension = budgetExtension;
+    this->highWater = highWater;
+    this->lowWater = lowWater;
+
+    const VkPhysicalDeviceMemoryProperties& memoryProperties = gpuAllocator.getMemoryProperties();
+    heaps.resize(memoryProperties.memoryHeapCount);
+    for (uint32_t i = 0; i < memoryProperties.memoryHeapCount; i++) {
+        heaps[i].size = memoryProperties.memoryHeaps[i].size;
+        heaps[i].deviceLocal = (memoryProperties.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) != 0;
+    }
+
+    query();
+}
+
+
+
+// Caches ----------------------------------------------------------------------------------------
+uint32_t MemoryBudget::registerCache(std::string name, CachePriority priority, EvictFunction evict)
+{
+    Cache cache{ nextCacheId++, std::move(name), priority, std::move(evict) };
+
+    auto position = std::upper_bound(caches.begin(), caches.end(), priority, [](CachePriority value, const Cache& other) {
+        return value < other.priority;
+    });
+    caches.insert(position, std::move(cache));
+    return nextCacheId - 1;
+}
+
+void MemoryBudget::unregisterCache(uint32_t id)
+{
+    std::erase_if(caches, [&](const Cache& cache) { return cache.id == id; });
+}
+
+
+
+// Begin Frame ----------------------------------------------------------------------------------------
+void MemoryBudget::beginFrame()
+{
+    query();
+
+    for (uint32_t heapIndex = 0; heapIndex < heaps.size(); heapIndex++) {
+        HeapBudget& heap = heaps[heapIndex];
+        if (heap.usage <= highWaterBytes(heapIndex)) {
+            continue;
+        }
+
+        // Evicting down to the low-water mark leaves room to grow before the next pass.
+        const VkDeviceSize target = static_cast<VkDeviceSize>(heap.budget * lowWater);
+        VkDeviceSize wanted = heap.usage - std::min(heap.usage, target);
+        stats.evictionPasses++;
+
+        for (Cache& cache : caches) {
+            const VkDeviceSize released = cache.evict(heapIndex, wanted);
+            stats.evictedBytes += released;
+            wanted -= std::min(wanted, released);
+            heap.usage -= std::min(heap.usage, released);
+
+            if (wanted == 0) {
+                break;
+            }
+        }
+
+        if (heap.usage > heap.budget) {
+            stats.framesOverBudget++;
+        }
+    }
+}
+
+void MemoryBudget::query()
+{
+    const VkPhysicalDeviceMemoryProperties& memoryProperties = gpuAllocator->getMemoryProperties();
+    const GpuMemoryStats allocatorStats = gpuAllocator->getStats();
+
+    for (HeapBudget& heap : heaps) {
+        heap.allocatorBytes = 0;
+    }
+    for (uint32_t type = 0; type < allocatorStats.memoryTypes.size(); type++) {
+        const GpuMemoryStats::Counters& counters = allocatorStats.memoryTypes[type];
+        heaps[memoryProperties.memoryTypes[type].heapIndex].allocatorBytes += counters.blockBytes + counters.dedicatedBytes;
+    }
+
+    if (!budgetExtension) {
+        for (HeapBudget& heap : heaps) {
+            heap.budget = static_cast<VkDeviceSize>(heap.size * FALLBACK_BUDGET_SHARE);
+            heap.usage = heap.allocatorBytes;
+        }
+        return;
+    }
+
+    VkPhysicalDeviceMemoryBudgetPropertiesEXT budgetProperties{};
+    budgetProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT;
+
+    VkPhysicalDeviceMemoryProperties2 memoryProperties2{};
+    memoryProperties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2;
+    memoryProperties2.pNext = &budgetProperties;
+    vkGetPhysicalDeviceMemoryProperties2(physicalDevice, &memoryProperties2);
+
+    for (uint32_t i = 0; i < heaps.size(); i++) {
+        // Some drivers report 0 for heaps they do not track; fall back to the heap size then.
+        heaps[i].budget = budgetProperties.heapBudget[i] != 0 ? budgetProperties.heapBudget[i] : heaps[i].size;
+        heaps[i].usage = std::max(budgetProperties.heapUsage[i], heaps[i].allocatorBytes);
+    }
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "GpuAllocator.h"
+
+
+//  Heap Budget -----------------------------------------------------------------------------------
+struct HeapBudget {
+    VkDeviceSize size = 0;
+    VkDeviceSize budget = 0;            // what this process can use before the driver starts paging
+    VkDeviceSize usage = 0;             // this process, as reported by the driver when it can
+    VkDeviceSize allocatorBytes = 0;    // held by GpuAllocator
+    bool deviceLocal = false;
+};
+
+// Lower priorities are evicted first.
+enum class CachePriority : uint32_t {
+    Low,        // cheap to rebuild, e.g. spare memory blocks
+    Normal,     // rebuilt from CPU data, e.g. glyph pages, decoded images
+    High,       // expensive to rebuild, e.g. layer caches of complex widgets
+};
+
+
+
+//  CLASS #########################################################################################
+// Tracks per-heap memory usage against the budget VK_EXT_memory_budget reports, and keeps usage
+// under it by asking registered caches to evict. Without the extension the budget is a fixed
+// share of each heap and usage is what GpuAllocator holds, which misses other allocations but
+// still keeps PicoGUI from filling a heap on its own.
+//
+// beginFrame() queries the budget. A heap above the high-water mark is brought back down to the
+// low-water mark by evicting from caches in priority order; each cache evicts its own least
+// recently used resources. Evicting caches must only release resources no frame in flight uses.
+class MemoryBudget
+{
+
+ // Public ----------------------------------------------------------------------------------------
+public:
+    // Asked to release at least bytes on a heap; returns what it actually released.
+    using EvictFunction = std::function<VkDeviceSize(uint32_t heapIndex, VkDeviceSize bytes)>;
+
+    struct Stats {
+        uint64_t evictionPasses = 0;
+        uint64_t evictedBytes = 0;
+        uint64_t framesOverBudget = 0;  // frames that stayed above budget after evicting
+    };
+
+    void init(VkPhysicalDevice physicalDevice, GpuAllocator& gpuAllocator, bool budgetExtension,
+              float highWater = 0.9f, float lowWater = 0.8f);
+
+    uint32_t registerCache(std::string name, CachePriority priority, EvictFunction evict);
+    void unregisterCache(uint32_t id);
+
+    // Call once per frame after waiting for the frame's fence.
+    void beginFrame();
+
+    const std::vector<HeapBudget>& getHeaps() const { return heaps; }
+    bool isUnderPressure(uint32_t heapIndex) const { return heaps[heapIndex].usage > highWaterBytes(heapIndex); }
+    const Stats& getStats() const { return stats; }
+
+
+ // Private ----------------------------------------------------------------------------------------
+private:
+    struct Cache {
+        uint32_t id;
+        std::string name;
+        CachePriority priority;
+        EvictFunction evict;
+    };
+
+    VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
+    GpuAllocator* gpuAllocator = nullptr;
+    bool budgetExtension = false;
+    float highWater = 0.9f;
+    float lowWater = 0.8f;
+
+    std::vector<HeapBudget> heaps;
+    std::vector<Cache> caches;          // sorted by priority, then registration order
+    uint32_t nextCacheId = 0;
+    Stats stats;
+
+    void query();
+    VkDeviceSize highWaterBytes(uint32_t heapIndex) const { return static_cast<VkDeviceSize>(heaps[heapIndex].budget * highWater); }
+};
@@ -0,0 +1,166 @@
+#include "MemoryStrategy.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+
+namespace {
+
+// Without resizable BAR, the host-visible window into VRAM is 256 MiB.
+constexpr VkDeviceSize SMALL_BAR_SIZE = 256ull << 20;
+
+constexpr VkDeviceSize BENCHMARK_WRITE_SIZE = 8ull << 20;
+constexpr VkDeviceSize BENCHMARK_READ_SIZE = 1ull << 20;    // reads from uncached memory run at tens of MB/s
+constexpr int BENCHMARK_PASSES = 3;
+
+// Writes over PCIe into VRAM may be this much slower than into system memory and still win, since
+// the GPU then reads them at full speed, once per draw.
+constexpr double DEVICE_WRITE_SHARE = 0.75;
+
+// Cached memory is snooped by the GPU; it only stages when its writes are clearly faster.
+constexpr double CACHED_WRITE_SHARE = 1.1;
+
+// First type with all of the flags in required and none in excluded, or UINT32_MAX.
+uint32_t findType(const VkPhysicalDeviceMemoryProperties& memoryProperties, VkMemoryPropertyFlags required, VkMemoryPropertyFlags excluded)
+{
+    for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; i++) {
+        const VkMemoryPropertyFlags flags = memoryProperties.memoryTypes[i].propertyFlags;
+        if ((flags & required) == required && (flags & excluded) == 0) {
+            return i;
+        }
+    }
+    return UINT32_MAX;
+}
+
+uint32_t typeBit(uint32_t memoryType)
+{
+    return memoryType == UINT32_MAX ? UINT32_MAX : 1u << memoryType;
+}
+
+// Best of BENCHMARK_PASSES, in GB/s.
+template<typename Copy>
+double timeCopies(VkDeviceSize size, Copy copy)
+{
+    double best = 0.0;
+    for (int pass = 0; pass < BENCHMARK_PASSES; pass++) {
+        const auto start = std::chrono::steady_clock::now();
+        copy();
+        const std::chrono::duration<double> seconds = std::chrono::steady_clock::now() - start;
+        if (seconds.count() > 0.0) {
+            best = std::max(best, size / seconds.count() * 1e-9);
+        }
+    }
+    return best;
+}
+
+} // namespace
+
+
+
+// Init ----------------------------------------------------------------------------------------
+void MemoryStrategy::init(VkPhysicalDevice physicalDevice, VkDevice device, GpuAllocator& gpuAllocator, bool benchmark,
+                          const VkAllocationCallbacks* allocator)
+{
+    this->device = device;
+    this->allocator = allocator;
+    this->gpuAllocator = &gpuAllocator;
+
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+    integrated = properties.deviceType == VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU;
+
+    const VkPhysicalDeviceMemoryProperties& memoryProperties = gpuAllocator.getMemoryProperties();
+    bandwidth.assign(memoryProperties.memoryTypeCount, Bandwidth{});
+
+    // Candidates for CPU writes: VRAM through the BAR, and system memory, uncached and cached.
+    // On integrated GPUs all of them are the same memory, flagged device-local.
+    const VkMemoryPropertyFlags systemExcluded = integrated ? 0 : VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+    const uint32_t barType = findType(memoryProperties, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, 0);
+    const uint32_t hostType = findType(memoryProperties, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                                       systemExcluded | VK_MEMORY_PROPERTY_HOST_CACHED_BIT);
+    const uint32_t cachedType = findType(memoryProperties, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT | VK_MEMORY_PROPERTY_HOST_CACHED_BIT,
+                                         systemExcluded);
+
+    resizableBar = !integrated && barType != UINT32_MAX
+        && memoryProperties.memoryHeaps[memoryProperties.memoryTypes[barType].heapIndex].size > SMALL_BAR_SIZE;
+
+    if (benchmark) {
+        for (uint32_t memoryType : { barType, hostType, cachedType }) {
+            if (memoryType != UINT32_MAX && bandwidth[memoryType].writeGBs == 0.0) {
+                bandwidth[memoryType] = measure(memoryType);
+            }
+        }
+    }
+
+    // Unmeasured types count as equally fast, which leaves the decision to the flags.
+    auto writeSpeed = [&](uint32_t memoryType) {
+        return memoryType == UINT32_MAX ? 0.0 : benchmark ? bandwidth[memoryType].writeGBs : 1.0;
+    };
+    const double hostWrite = writeSpeed(hostType);
+    const bool barWritesFast = barType != UINT32_MAX && writeSpeed(barType) >= hostWrite * DEVICE_WRITE_SHARE;
+
+    // Frame data: read by the GPU once or a few times, so it goes through the BAR only if that is fast.
+    MemoryPlan& frameData = plans[static_cast<uint32_t>(ResourceClass::FrameData)];
+    frameData.allocation.requiredFlags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
+    frameData.allocation.preferredFlags = VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+    frameData.allocation.preferredTypeBits = typeBit(integrated || barWritesFast ? barType : hostType);
+    frameData.path = UploadPath::DirectWrite;
+
+    // Static geometry: written in place where all of VRAM is mappable, so the BAR window stays free.
+    MemoryPlan& staticGeometry = plans[static_cast<uint32_t>(ResourceClass::StaticGeometry)];
+    if (integrated || (resizableBar && barWritesFast)) {
+        staticGeometry.allocation.requiredFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+        staticGeometry.path = UploadPath::DirectWrite;
+    }
+    else {
+        staticGeometry.allocation.requiredFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+        staticGeometry.path = UploadPath::StagedCopy;
+    }
+
+    MemoryPlan& texture = plans[static_cast<uint32_t>(ResourceClass::Texture)];
+    texture.allocation.requiredFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+    texture.path = UploadPath::StagedCopy;
+
+    // Staging: host-coherent, so copies never need flushes.
+    const bool cachedWritesFast = cachedType != UINT32_MAX && writeSpeed(cachedType) >= hostWrite * CACHED_WRITE_SHARE;
+    MemoryPlan& staging = plans[static_cast<uint32_t>(ResourceClass::Staging)];
+    staging.allocation.requiredFlags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+    staging.allocation.preferredTypeBits = typeBit(cachedWritesFast ? cachedType : hostType);
+    staging.path = UploadPath::DirectWrite;
+}
+
+
+
+// Benchmark ----------------------------------------------------------------------------------------
+MemoryStrategy::Bandwidth MemoryStrategy::measure(uint32_t memoryType)
+{
+    Bandwidth result;
+
+    VkMemoryAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.allocationSize = BENCHMARK_WRITE_SIZE;
+    allocInfo.memoryTypeIndex = memoryType;
+
+    // A full heap is not an error here; the type just goes unmeasured.
+    VkDeviceMemory memory;
+    if (vkAllocateMemory(device, &allocInfo, allocator, &memory) != VK_SUCCESS) {
+        return result;
+    }
+
+    void* mapped;
+    if (vkMapMemory(device, memory, 0, VK_WHOLE_SIZE, 0, &mapped) == VK_SUCCESS) {
+        std::vector<uint8_t> host(BENCHMARK_WRITE_SIZE);
+        for (size_t i = 0; i < host.size(); i++) {
+            host[i] = static_cast<uint8_t>(i * 31);
+        }
+
+        result.writeGBs = timeCopies(BENCHMARK_WRITE_SIZE, [&]() { memcpy(mapped, host.data(), BENCHMARK_WRITE_SIZE); });
+        result.readGBs = timeCopies(BENCHMARK_READ_SIZE, [&]() { memcpy(host.data(), mapped, BENCHMARK_READ_SIZE); });
+
+        vkUnmapMemory(device, memory);
+    }
+
+    vkFreeMemory(device, memory, allocator);
+    return result;
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <cstdint>
+#include <vector>
+
+#include "GpuAllocator.h"
+
+
+//  Resource Classes ------------------------------------------------------------------------------
+enum class ResourceClass : uint32_t {
+    FrameData,          // rewritten every frame: instances, uniforms, text vertices
+    StaticGeometry,     // written once, read for many frames
+    Texture,            // optimal-tiling images
+    Staging,            // source of transfer-queue copies
+    Count
+};
+
+enum class UploadPath : uint32_t {
+    DirectWrite,        // the CPU writes the resource's own mapping
+    StagedCopy,         // the CPU writes a staging buffer and the transfer queue copies it
+};
+
+struct MemoryPlan {
+    GpuAllocationInfo allocation;
+    UploadPath path = UploadPath::StagedCopy;
+};
+
+
+
+//  CLASS #########################################################################################
+// Picks the memory each class of resource lives in and how the CPU gets data into it. The choice
+// depends on what the device offers:
+//
+//  - Integrated GPUs share system memory, so everything the CPU writes is written in place and
+//    staging copies only cost bandwidth.
+//  - Discrete GPUs with resizable BAR map all of VRAM. Frame data and static geometry are written
+//    straight into device-local memory, as long as those writes are not slower than into system
+//    memory.
+//  - Other discrete GPUs map 256 MiB of VRAM at most. Frame data goes there if it writes fast, and
+//    static geometry is staged into unmapped device-local memory.
+//
+// Textures are always staged, because optimal tiling can only be written by a copy.
+//
+// With benchmark set, init() times CPU writes and reads through each candidate memory type, a few
+// milliseconds at startup, and the plans use the results; without it they go by the flags alone.
+class MemoryStrategy
+{
+
+ // Public ----------------------------------------------------------------------------------------
+public:
+    struct Bandwidth {
+        double writeGBs = 0.0;          // sequential memcpy into the mapping
+        double readGBs = 0.0;           // sequential memcpy out of it; uncached memory is slow here
+    };
+
+    void init(VkPhysicalDevice physicalDevice, VkDevice device, GpuAllocator& gpuAllocator, bool benchmark,
+              const VkAllocationCallbacks* allocator = nullptr);
+
+    const MemoryPlan& getPlan(ResourceClass resourceClass) const { return plans[static_cast<uint32_t>(resourceClass)]; }
+
+    bool isIntegrated() const { return integrated; }
+    bool hasResizableBar() const { return resizableBar; }
+
+    // Measured bandwidth of a memory type; zero for types that were not measured.
+    Bandwidth getBandwidth(uint32_t memoryType) const { return memoryType < bandwidth.size() ? bandwidth[memoryType] : Bandwidth{}; }
+
+
+ // Private ----------------------------------------------------------------------------------------
+private:
+    VkDevice device = VK_NULL_HANDLE;
+    const VkAllocationCallbacks* allocator = nullptr;
+    GpuAllocator* gpuAllocator = nullptr;
+    bool integrated = false;
+    bool resizableBar = false;
+
+    std::vector<Bandwidth> bandwidth;  // by memory type
+    MemoryPlan plans[static_cast<uint32_t>(ResourceClass::Count)];
+
+    Bandwidth measure(uint32_t memoryType);
+};
@@ -0,0 +1,385 @@
+#include "Msdf.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+
+namespace {
+
+// Edge colors, one bit per channel.
+constexpr uint32_t BLACK = 0;
+constexpr uint32_t RED = 1;
+constexpr uint32_t GREEN = 2;
+constexpr uint32_t BLUE = 4;
+constexpr uint32_t YELLOW = RED | GREEN;
+constexpr uint32_t MAGENTA = RED | BLUE;
+constexpr uint32_t CYAN = GREEN | BLUE;
+constexpr uint32_t WHITE = RED | GREEN | BLUE;
+
+// Edges meeting at more than about 8.1 degrees from straight form a corner.
+constexpr double CORNER_THRESHOLD = 0.1411200080598672;     // sin(3)
+
+constexpr double PI = 3.14159265358979323846;
+
+struct Edge {
+    glm::dvec2 p0;
+    glm::dvec2 p1;
+    glm::dvec2 p2;
+    bool curved;
+    uint32_t color;
+};
+
+// Distance to an edge, and how far the direction to the nearest point is from the edge's tangent;
+// of two equally near edges, the one met more orthogonally is closer.
+struct SignedDistance {
+    double distance = -std::numeric_limits<double>::max();
+    double dot = 1.0;
+
+    bool operator<(const SignedDistance& other) const {
+        return std::abs(distance) < std::abs(other.distance) || (std::abs(distance) == std::abs(other.distance) && dot < other.dot);
+    }
+};
+
+double cross(const glm::dvec2& a, const glm::dvec2& b)
+{
+    return a.x * b.y - a.y * b.x;
+}
+
+double nonZeroSign(double value)
+{
+    return value > 0.0 ? 1.0 : -1.0;
+}
+
+glm::dvec2 safeNormalize(const glm::dvec2& v)
+{
+    const double length = glm::length(v);
+    return length > 0.0 ? v / length : glm::dvec2(0.0, 1.0);
+}
+
+glm::dvec2 edgeEnd(const Edge& edge)
+{
+    return edge.curved ? edge.p2 : edge.p1;
+}
+
+glm::dvec2 edgePoint(const Edge& edge, double t)
+{
+    if (!edge.curved) {
+        return glm::mix(edge.p0, edge.p1, t);
+    }
+    return glm::mix(glm::mix(edge.p0, edge.p1, t), glm::mix(edge.p1, edge.p2, t), t);
+}
+
+glm::dvec2 edgeDirection(const Edge& edge, double t)
+{
+    if (!edge.curved) {
+        return edge.p1 - edge.p0;
+    }
+    const glm::dvec2 direction = glm::mix(edge.p1 - edge.p0, edge.p2 - edge.p1, t);
+    return direction != glm::dvec2(0.0) ? direction : edge.p2 - edge.p0;
+}
+
+void splitEdge(const Edge& edge, Edge& first, Edge& second)
+{
+    first = edge;
+    second = edge;
+    if (!edge.curved) {
+        first.p1 = second.p0 = (edge.p0 + edge.p1) * 0.5;
+        return;
+    }
+    const glm::dvec2 q0 = (edge.p0 + edge.p1) * 0.5;
+    const glm::dvec2 q1 = (edge.p1 + edge.p2) * 0.5;
+    const glm::dvec2 middle = (q0 + q1) * 0.5;
+    first.p1 = q0;
+    first.p2 = middle;
+    second.p0 = middle;
+    second.p1 = q1;
+}
+
+// Roots of a*x^2 + b*x + c and a*x^3 + b*x^2 + c*x + d.
+int solveQuadratic(double x[2], double a, double b, double c)
+{
+    if (a == 0.0 || std::abs(b) > 1e12 * std::abs(a)) {
+        if (b == 0.0) {
+            return 0;
+        }
+        x[0] = -c / b;
+        return 1;
+    }
+    double discriminant = b * b - 4.0 * a * c;
+    if (discriminant > 0.0) {
+        discriminant = std::sqrt(discriminant);
+        x[0] = (-b + discriminant) / (2.0 * a);
+        x[1] = (-b - discriminant) / (2.0 * a);
+        return 2;
+    }
+    if (discriminant == 0.0) {
+        x[0] = -b / (2.0 * a);
+        return 1;
+    }
+    return 0;
+}
+
+int solveCubicNormed(double x[3], double a, double b, double c)
+{
+    const double a2 = a * a;
+    double q = (a2 - 3.0 * b) / 9.0;
+    const double r = (a * (2.0 * a2 - 9.0 * b) + 27.0 * c) / 54.0;
+    const double r2 = r * r;
+    const double q3 = q * q * q;
+    a /= 3.0;
+    if (r2 < q3) {
+        const double t = std::acos(std::clamp(r / std::sqrt(q3), -1.0, 1.0));
+        q = -2.0 * std::sqrt(q);
+        x[0] = q * std::cos(t / 3.0) - a;
+        x[1] = q * std::cos((t + 2.0 * PI) / 3.0) - a;
+        x[2] = q * std::cos((t - 2.0 * PI) / 3.0) - a;
+        return 3;
+    }
+    const double u = (r < 0.0 ? 1.0 : -1.0) * std::pow(std::abs(r) + std::sqrt(r2 - q3), 1.0 / 3.0);
+    const double v = u == 0.0 ? 0.0 : q / u;
+    x[0] = (u + v) - a;
+    if (u == v || std::abs(u - v) < 1e-12 * std::abs(u + v)) {
+        x[1] = -0.5 * (u + v) - a;
+        return 2;
+    }
+    return 1;
+}
+
+int solveCubic(double x[3], double a, double b, double c, double d)
+{
+    if (a != 0.0 && std::abs(b / a) < 1e6) {
+        return solveCubicNormed(x, b / a, c / a, d / a);
+    }
+    return solveQuadratic(x, b, c, d);
+}
+
+// Signed distance from point to the edge; param is where on the edge, or its extension, it is nearest.
+SignedDistance edgeDistance(const Edge& edge, const glm::dvec2& point, double& param)
+{
+    if (!edge.curved) {
+        const glm::dvec2 aq = point - edge.p0;
+        const glm::dvec2 ab = edge.p1 - edge.p0;
+        param = glm::dot(aq, ab) / glm::dot(ab, ab);
+        const glm::dvec2 eq = (param > 0.5 ? edge.p1 : edge.p0) - point;
+        const double endpointDistance = glm::length(eq);
+        if (param > 0.0 && param < 1.0) {
+            const double orthoDistance = glm::dot(safeNormalize(glm::dvec2(ab.y, -ab.x)), aq);
+            if (std::abs(orthoDistance) < endpointDistance) {
+                return { orthoDistance, 0.0 };
+            }
+        }
+        return { nonZeroSign(cross(aq, ab)) * endpointDistance, std::abs(glm::dot(safeNormalize(ab), safeNormalize(eq))) };
+    }
+
+    const glm::dvec2 qa = edge.p0 - point;
+    const glm::dvec2 ab = edge.p1 - edge.p0;
+    const glm::dvec2 br = edge.p2 - edge.p1 - ab;
+    const double a = glm::dot(br, br);
+    const double b = 3.0 * glm::dot(ab, br);
+    const double c = 2.0 * glm::dot(ab, ab) + glm::dot(qa, br);
+    const double d = glm::dot(qa, ab);
+    double t[3];
+    const int solutions = solveCubic(t, a, b, c, d);
+
+    glm::dvec2 direction = edgeDirection(edge, 0.0);
+    double minDistance = nonZeroSign(cross(direction, qa)) * glm::length(qa);
+    param = -glm::dot(qa, direction) / glm::dot(direction, direction);
+
+    direction = edgeDirection(edge, 1.0);
+    const double endDistance = glm::length(edge.p2 - point);
+    if (endDistance < std::abs(minDistance)) {
+        minDistance = nonZeroSign(cross(direction, edge.p2 - point)) * endDistance;
+        param = glm::dot(point - edge.p1, direction) / glm::dot(direction, direction);
+    }
+
+    for (int i = 0; i < solutions; i++) {
+        if (t[i] > 0.0 && t[i] < 1.0) {
+            const glm::dvec2 qe = qa + 2.0 * t[i] * ab + t[i] * t[i] * br;
+            const double distance = glm::length(qe);
+            if (distance <= std::abs(minDistance)) {
+                minDistance = nonZeroSign(cross(ab + t[i] * br, qe)) * distance;
+                param = t[i];
+            }
+        }
+    }
+
+    if (param >= 0.0 && param <= 1.0) {
+        return { minDistance, 0.0 };
+    }
+    if (param < 0.5) {
+        return { minDistance, std::abs(glm::dot(safeNormalize(edgeDirection(edge, 0.0)), safeNormalize(qa))) };
+    }
+    return { minDistance, std::abs(glm::dot(safeNormalize(edgeDirection(edge, 1.0)), safeNormalize(edge.p2 - point))) };
+}
+
+// Beyond its ends, an edge is extended along its tangent, which keeps corners sharp.
+double pseudoDistance(const Edge& edge, const glm::dvec2& point, const SignedDistance& distance, double param)
+{
+    if (param < 0.0) {
+        const glm::dvec2 direction = safeNormalize(edgeDirection(edge, 0.0));
+        const glm::dvec2 aq = point - edge.p0;
+        if (glm::dot(aq, direction) < 0.0) {
+            const double pseudo = cross(aq, direction);
+            if (std::abs(pseudo) <= std::abs(distance.distance)) {
+                return pseudo;
+            }
+        }
+    }
+    else if (param > 1.0) {
+        const glm::dvec2 direction = safeNormalize(edgeDirection(edge, 1.0));
+        const glm::dvec2 bq = point - edgeEnd(edge);
+        if (glm::dot(bq, direction) > 0.0) {
+            const double pseudo = cross(bq, direction);
+            if (std::abs(pseudo) <= std::abs(distance.distance)) {
+                return pseudo;
+            }
+        }
+    }
+    return distance.distance;
+}
+
+void switchColor(uint32_t& color, uint64_t& seed, uint32_t banned = BLACK)
+{
+    const uint32_t combined = color & banned;
+    if (combined == RED || combined == GREEN || combined == BLUE) {
+        color = combined ^ WHITE;
+        return;
+    }
+    if (color == BLACK || color == WHITE) {
+        const uint32_t start[3] = { CYAN, MAGENTA, YELLOW };
+        color = start[seed % 3];
+        seed /= 3;
+        return;
+    }
+    const uint32_t shifted = color << (1 + (seed & 1));
+    color = (shifted | shifted >> 3) & WHITE;
+    seed >>= 1;
+}
+
+int symmetricalTrichotomy(size_t position, size_t count)
+{
+    return int(3 + 2.875 * position / (count - 1) - 1.4375 + 0.5) - 3;
+}
+
+// Colors a contour so that the two edges at every corner differ in at least two channels.
+void colorContour(std::vector<Edge>& edges, uint64_t& seed)
+{
+    std::vector<size_t> corners;
+    for (size_t i = 0; i < edges.size(); i++) {
+        const glm::dvec2 a = safeNormalize(edgeDirection(edges[(i + edges.size() - 1) % edges.size()], 1.0));
+        const glm::dvec2 b = safeNormalize(edgeDirection(edges[i], 0.0));
+        if (glm::dot(a, b) <= 0.0 || std::abs(cross(a, b)) > CORNER_THRESHOLD) {
+            corners.push_back(i);
+        }
+    }
+
+    if (corners.empty()) {
+        for (Edge& edge : edges) {
+            edge.color = WHITE;
+        }
+        return;
+    }
+
+    if (corners.size() == 1) {
+        // A teardrop: its one corner needs three colors along the contour, so short ones are split.
+        std::rotate(edges.begin(), edges.begin() + corners[0], edges.end());
+        while (edges.size() < 3) {
+            std::vector<Edge> split(edges.size() * 2);
+            for (size_t i = 0; i < edges.size(); i++) {
+                splitEdge(edges[i], split[i * 2], split[i * 2 + 1]);
+            }
+            edges.swap(split);
+        }
+
+        uint32_t colors[3] = { WHITE, WHITE, WHITE };
+        switchColor(colors[0], seed);
+        colors[2] = colors[0];
+        switchColor(colors[2], seed);
+        for (size_t i = 0; i < edges.size(); i++) {
+            edges[i].color = colors[1 + symmetricalTrichotomy(i, edges.size())];
+        }
+        return;
+    }
+
+    // Switch color at every corner; the last one must also differ from the first.
+    uint32_t color = WHITE;
+    switchColor(color, seed);
+    const uint32_t initialColor = color;
+    size_t spline = 0;
+    for (size_t i = 0; i < edges.size(); i++) {
+        const size_t index = (corners[0] + i) % edges.size();
+        if (spline + 1 < corners.size() && corners[spline + 1] == index) {
+            spline++;
+            switchColor(color, seed, spline == corners.size() - 1 ? initialColor : BLACK);
+        }
+        edges[index].color = color;
+    }
+}
+
+uint8_t toByte(double distance, double range)
+{
+    return static_cast<uint8_t>(std::clamp(distance / range + 0.5, 0.0, 1.0) * 255.0 + 0.5);
+}
+
+} // namespace
+
+
+
+// Generate MSDF ----------------------------------------------------------------------------------------
+std::vector<uint8_t> generateMsdf(std::span<const GlyphContour> contours, uint32_t width, uint32_t height, float scale, glm::vec2 origin, float range)
+{
+    std::vector<Edge> edges;
+    uint64_t seed = 0;
+    for (const GlyphContour& contour : contours) {
+        std::vector<Edge> colored;
+        for (const GlyphEdge& edge : contour) {
+            colored.push_back({ edge.p0, edge.p1, edge.p2, edge.curved, WHITE });
+        }
+        if (!colored.empty()) {
+            colorContour(colored, seed);
+            edges.insert(edges.end(), colored.begin(), colored.end());
+        }
+    }
+
+    std::vector<uint8_t> pixels(size_t(width) * height * 4);
+    const uint32_t channels[3] = { RED, GREEN, BLUE };
+
+    for (uint32_t y = 0; y < height; y++) {
+        for (uint32_t x = 0; x < width; x++) {
+            // Texel centers, with rows from the top and y up in the outline.
+            const glm::dvec2 point = glm::dvec2(origin) + glm::dvec2(x + 0.5, height - y - 0.5) / double(scale);
+
+            SignedDistance nearest[3];
+            const Edge* nearestEdge[3] = {};
+            double nearestParam[3] = {};
+            SignedDistance trueNearest;
+
+            for (const Edge& edge : edges) {
+                double param;
+                const SignedDistance distance = edgeDistance(edge, point, param);
+                if (distance < trueNearest) {
+                    trueNearest = distance;
+                }
+                for (int channel = 0; channel < 3; channel++) {
+                    if ((edge.color & channels[channel]) && distance < nearest[channel]) {
+                        nearest[channel] = distance;
+                        nearestEdge[channel] = &edge;
+                        nearestParam[channel] = param;
+                    }
+                }
+            }
+
+            uint8_t* pixel = &pixels[(size_t(y) * width + x) * 4];
+            const double texelRange = range / scale;
+            for (int channel = 0; channel < 3; channel++) {
+                const double distance = nearestEdge[channel] != nullptr
+                    ? pseudoDistance(*nearestEdge[channel], point, nearest[channel], nearestParam[channel])
+                    : -std::numeric_limits<double>::max();
+                pixel[channel] = toByte(distance, texelRange);
+            }
+            pixel[3] = toByte(trueNearest.distance, texelRange);
+        }
+    }
+    return pixels;
+}
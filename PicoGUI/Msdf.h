@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "Font.h"
+
+
+//  Multi-Channel Distance Fields -----------------------------------------------------------------
+// Distance range, in texels, of the fields generated for text; quad.frag must use the same value.
+constexpr float MSDF_RANGE = 4.0f;
+
+// Renders an outline as a multi-channel signed distance field (after Chlumsky, "Shape Decomposition
+// for Multi-channel Distance Fields"), as RGBA8 rows from the top. The edges are colored so that
+// every corner lies between two edges with different colors; R, G and B each hold the distance to
+// the edges of their color, and the median of the three keeps corners sharp at any magnification.
+// A holds the true distance. 0.5 is on the outline, inside is above, and range texels from it the
+// values reach 0 or 1.
+//
+// The outline is mapped with scale texels per em, and origin, in ems, at the bottom-left corner.
+// Contours must not overlap, as is the case in most fonts; there is no error correction pass.
+std::vector<uint8_t> generateMsdf(std::span<const GlyphContour> contours, uint32_t width, uint32_t height, float scale, glm::vec2 origin,
+                                  float range = MSDF_RANGE);
@@ -0,0 +1,264 @@
+#include "PersistentBuffer.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+
+namespace {
+
+VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment)
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+// Everything that may read a retained buffer: vertex and index fetch, and the shaders.
+constexpr VkPipelineStageFlags READER_STAGES = VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT
+    | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+constexpr VkAccessFlags READER_ACCESS = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT | VK_ACCESS_UNIFORM_READ_BIT
+    | VK_ACCESS_SHADER_READ_BIT;
+
+} // namespace
+
+
+
+// Init / Cleanup ----------------------------------------------------------------------------------------
+void PersistentBuffer::init(VkPhysicalDevice physicalDevice, VkDevice device, GpuAllocator& gpuAllocator, DeletionQueue& deletionQueue,
+                            const MemoryPlan& plan, VkBufferUsageFlags usage, uint32_t framesInFlight, VkDeviceSize pageSize)
+{
+    this->device = device;
+    this->gpuAllocator = &gpuAllocator;
+    this->deletionQueue = &deletionQueue;
+    this->plan = plan;
+    this->usage = usage;
+
+    // Pages are whole atoms, so a dirty run can be flushed as it is.
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+    this->pageSize = alignUp(pageSize, properties.limits.nonCoherentAtomSize);
+
+    if (plan.path == UploadPath::DirectWrite) {
+        this->plan.allocation.requiredFlags |= VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
+        copies.resize(framesInFlight);
+    }
+    else {
+        this->usage |= VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+        copies.resize(1);
+    }
+}
+
+void PersistentBuffer::cleanup()
+{
+    for (Copy& copy : copies) {
+        if (copy.buffer != VK_NULL_HANDLE) {
+            gpuAllocator->destroyBuffer(copy.buffer, copy.allocation);
+        }
+    }
+    copies.clear();
+    contents.clear();
+    capacity = 0;
+}
+
+
+
+// Write ----------------------------------------------------------------------------------------
+void PersistentBuffer::resize(VkDeviceSize size)
+{
+    const VkDeviceSize oldSize = contents.size();
+    contents.resize(size);
+
+    if (size > capacity) {
+        createCopies(alignUp(std::max(size, capacity + capacity / 2), pageSize));
+        return;
+    }
+
+    // The buffers still hold whatever was there before the last shrink.
+    for (VkDeviceSize page = oldSize / pageSize; oldSize < size && page * pageSize < size; page++) {
+        markDirty(page);
+    }
+}
+
+void PersistentBuffer::write(VkDeviceSize offset, std::span<const uint8_t> data)
+{
+    if (data.empty()) {
+        return;
+    }
+
+    const VkDeviceSize end = offset + data.size();
+    if (end > contents.size()) {
+        resize(end);
+    }
+
+    // Rewriting unchanged bytes, as a UI rebuilt every frame does, costs a compare and no upload.
+    for (VkDeviceSize page = offset / pageSize; page * pageSize < end; page++) {
+        const VkDeviceSize begin = std::max(offset, page * pageSize);
+        const VkDeviceSize size = std::min(end, (page + 1) * pageSize) - begin;
+
+        const uint8_t* source = data.data() + (begin - offset);
+        if (memcmp(contents.data() + begin, source, size) != 0) {
+            memcpy(contents.data() + begin, source, size);
+            markDirty(page);
+        }
+    }
+}
+
+void PersistentBuffer::markDirty(VkDeviceSize page)
+{
+    for (Copy& copy : copies) {
+        copy.dirty[page / 64] |= 1ull << (page % 64);
+    }
+}
+
+void PersistentBuffer::createCopies(VkDeviceSize size)
+{
+    capacity = size;
+    written = false;
+
+    VkBufferCreateInfo bufferInfo{};
+    bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferInfo.size = capacity;
+    bufferInfo.usage = usage;
+    bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    const VkDeviceSize pageCount = capacity / pageSize;
+    for (Copy& copy : copies) {
+        // Frames in flight may still read the old buffer.
+        if (copy.buffer != VK_NULL_HANDLE) {
+            deletionQueue->destroyBuffer(copy.buffer, copy.allocation);
+        }
+
+        copy.buffer = gpuAllocator->createBuffer(bufferInfo, plan.allocation, copy.allocation);
+        if (plan.path == UploadPath::DirectWrite && copy.allocation.mapped == nullptr) {
+            throw std::runtime_error("failed to map persistent buffer!");
+        }
+        copy.dirty.assign((pageCount + 63) / 64, 0);
+    }
+
+    for (VkDeviceSize page = 0; page * pageSize < contents.size(); page++) {
+        markDirty(page);
+    }
+}
+
+std::vector<PersistentBuffer::Run> PersistentBuffer::takeDirtyRuns(Copy& copy)
+{
+    std::vector<Run> runs;
+
+    // Pages past the contents stay dirty until resize() brings them back.
+    const VkDeviceSize pageCount = alignUp(contents.size(), pageSize) / pageSize;
+    VkDeviceSize page = 0;
+    while (page < pageCount) {
+        const uint64_t word = copy.dirty[page / 64] >> (page % 64);
+        if (word == 0) {
+            page = (page / 64 + 1) * 64;
+            continue;
+        }
+        if ((word & 1) == 0) {
+            page++;
+            continue;
+        }
+
+        const VkDeviceSize first = page;
+        while (page < pageCount && (copy.dirty[page / 64] >> (page % 64)) & 1) {
+            page++;
+        }
+        runs.push_back({ first * pageSize, (page - first) * pageSize });
+        stats.dirtyPages += page - first;
+    }
+
+    for (VkDeviceSize page = 0; page < pageCount; page += 64) {
+        copy.dirty[page / 64] &= page + 64 <= pageCount ? 0 : ~0ull << (pageCount - page);
+    }
+    return runs;
+}
+
+
+
+// Update ----------------------------------------------------------------------------------------
+void PersistentBuffer::update(uint32_t frameIndex, VkCommandBuffer commandBuffer, UploadRing& uploadRing)
+{
+    stats.dirtyPages = 0;
+    stats.uploadedBytes = 0;
+    stats.ranges = 0;
+
+    if (capacity == 0) {
+        return;
+    }
+
+    activeCopy = plan.path == UploadPath::DirectWrite ? frameIndex % static_cast<uint32_t>(copies.size()) : 0;
+    Copy& copy = copies[activeCopy];
+
+    const std::vector<Run> runs = takeDirtyRuns(copy);
+    if (runs.empty()) {
+        return;
+    }
+
+    // The last page may reach past the contents; only the contents are moved, the whole page is flushed.
+    auto contentBytes = [&](const Run& run) {
+        return std::min(run.offset + run.size, static_cast<VkDeviceSize>(contents.size())) - run.offset;
+    };
+
+    if (plan.path == UploadPath::DirectWrite) {
+        std::vector<VkMappedMemoryRange> ranges;
+        for (const Run& run : runs) {
+            memcpy(static_cast<uint8_t*>(copy.allocation.mapped) + run.offset, contents.data() + run.offset, contentBytes(run));
+            stats.uploadedBytes += contentBytes(run);
+
+            if (!(copy.allocation.propertyFlags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT)) {
+                VkMappedMemoryRange range{};
+                range.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+                range.memory = copy.allocation.memory;
+                range.offset = copy.allocation.offset + run.offset;
+                range.size = run.size;
+                ranges.push_back(range);
+            }
+        }
+
+        if (!ranges.empty() && vkFlushMappedMemoryRanges(device, static_cast<uint32_t>(ranges.size()), ranges.data()) != VK_SUCCESS) {
+            throw std::runtime_error("failed to flush persistent buffer!");
+        }
+        stats.ranges = static_cast<uint32_t>(ranges.size());
+    }
+    else {
+        // Stage every dirty run in one ring allocation and copy them with a single command.
+        VkDeviceSize totalBytes = 0;
+        for (const Run& run : runs) {
+            totalBytes += alignUp(contentBytes(run), 16);
+        }
+        UploadRing::Allocation staging = uploadRing.allocate(totalBytes, 16);
+
+        std::vector<VkBufferCopy> regions;
+        VkDeviceSize offset = 0;
+        for (const Run& run : runs) {
+            memcpy(static_cast<uint8_t*>(staging.data) + offset, contents.data() + run.offset, contentBytes(run));
+
+            VkBufferCopy region{};
+            region.srcOffset = staging.offset + offset;
+            region.dstOffset = run.offset;
+            region.size = contentBytes(run);
+            regions.push_back(region);
+
+            offset += alignUp(contentBytes(run), 16);
+            stats.uploadedBytes += contentBytes(run);
+        }
+
+        // Earlier frames may still be reading the ranges that are about to be overwritten.
+        const VkPipelineStageFlags srcStage = written ? READER_STAGES : VkPipelineStageFlags(VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT);
+
+        VkMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        barrier.srcAccessMask = 0;
+        barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        vkCmdPipelineBarrier(commandBuffer, srcStage, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+        vkCmdCopyBuffer(commandBuffer, staging.buffer, copy.buffer, static_cast<uint32_t>(regions.size()), regions.data());
+
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = READER_ACCESS;
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, READER_STAGES, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+        written = true;
+        stats.ranges = static_cast<uint32_t>(regions.size());
+    }
+
+    stats.totalUploadedBytes += stats.uploadedBytes;
+}
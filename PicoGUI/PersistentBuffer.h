@@ -0,0 +1,92 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "DeletionQueue.h"
+#include "GpuAllocator.h"
+#include "MemoryStrategy.h"
+#include "UploadRing.h"
+
+
+//  CLASS #########################################################################################
+// GPU buffer for retained data, such as the instances of a UI that mostly stays the same from one
+// frame to the next. The CPU keeps a copy of the contents; write() compares against it and marks
+// only the pages whose bytes actually change, and update() moves only those pages to the GPU.
+// Recoloring one button in a scene of 100k quads moves one page, not the whole buffer.
+//
+// With a DirectWrite plan the buffer lives in mapped memory, one copy per frame in flight so the
+// CPU never writes a copy the GPU may still be reading. Each copy tracks its own dirty pages and
+// catches up when its frame comes round; non-coherent memory is flushed per dirty run. With a
+// StagedCopy plan there is one device-local buffer, and update() stages the dirty runs in the
+// upload ring and records one vkCmdCopyBuffer with a region per run.
+class PersistentBuffer
+{
+
+ // Public ----------------------------------------------------------------------------------------
+public:
+    struct Stats {
+        uint64_t dirtyPages = 0;        // last update
+        uint64_t uploadedBytes = 0;     // last update
+        uint32_t ranges = 0;            // flushed ranges or copy regions, last update
+        uint64_t totalUploadedBytes = 0;
+    };
+
+    void init(VkPhysicalDevice physicalDevice, VkDevice device, GpuAllocator& gpuAllocator, DeletionQueue& deletionQueue,
+              const MemoryPlan& plan, VkBufferUsageFlags usage, uint32_t framesInFlight, VkDeviceSize pageSize = 1024);
+    void cleanup();
+
+    // Contents up to the new size are kept. The buffers only ever grow, by half their size at least.
+    void resize(VkDeviceSize size);
+    VkDeviceSize size() const { return contents.size(); }
+
+    // Grows the buffer when the write ends past it.
+    void write(VkDeviceSize offset, std::span<const uint8_t> data);
+
+    template<typename T>
+    void write(VkDeviceSize offset, std::span<const T> data) {
+        write(offset, std::span<const uint8_t>(reinterpret_cast<const uint8_t*>(data.data()), data.size_bytes()));
+    }
+
+    // Brings the buffer of this frame slot up to date. Call once per frame after waiting for the
+    // frame's fence, outside a render pass, and before reading getBuffer().
+    void update(uint32_t frameIndex, VkCommandBuffer commandBuffer, UploadRing& uploadRing);
+
+    VkBuffer getBuffer() const { return copies[activeCopy].buffer; }
+    const Stats& getStats() const { return stats; }
+
+
+ // Private ----------------------------------------------------------------------------------------
+private:
+    struct Copy {
+        VkBuffer buffer = VK_NULL_HANDLE;
+        GpuAllocation allocation;
+        std::vector<uint64_t> dirty;    // one bit per page
+    };
+
+    struct Run {
+        VkDeviceSize offset;
+        VkDeviceSize size;
+    };
+
+    VkDevice device = VK_NULL_HANDLE;
+    GpuAllocator* gpuAllocator = nullptr;
+    DeletionQueue* deletionQueue = nullptr;
+    MemoryPlan plan;
+    VkBufferUsageFlags usage = 0;
+    VkDeviceSize pageSize = 0;
+    VkDeviceSize capacity = 0;          // of the buffers, a whole number of pages
+
+    std::vector<uint8_t> contents;
+    std::vector<Copy> copies;
+    uint32_t activeCopy = 0;
+    bool written = false;               // the staged buffer has been copied to before
+
+    Stats stats;
+
+    void markDirty(VkDeviceSize page);
+    std::vector<Run> takeDirtyRuns(Copy& copy);
+    void createCopies(VkDeviceSize size);
+};
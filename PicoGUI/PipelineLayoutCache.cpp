@@ -0,0 +1,214 @@
+#include "PipelineLayoutCache.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+
+// Hashing ----------------------------------------------------------------------------------------
+static void hashCombine(size_t& seed, uint64_t value)
+{
+    seed ^= std::hash<uint64_t>{}(value) + 0x9e3779b97f4a7c15ull + (seed << 6) + (seed >> 2);
+}
+
+static bool sameBinding(const VkDescriptorSetLayoutBinding& a, const VkDescriptorSetLayoutBinding& b)
+{
+    return a.binding == b.binding && a.descriptorType == b.descriptorType && a.descriptorCount == b.descriptorCount && a.stageFlags == b.stageFlags;
+}
+
+static bool samePushConstants(const std::vector<VkPushConstantRange>& a, const std::vector<VkPushConstantRange>& b)
+{
+    return std::equal(a.begin(), a.end(), b.begin(), b.end(), [](const VkPushConstantRange& x, const VkPushConstantRange& y) {
+        return x.stageFlags == y.stageFlags && x.offset == y.offset && x.size == y.size;
+    });
+}
+
+bool DescriptorSetLayoutDesc::operator==(const DescriptorSetLayoutDesc& other) const
+{
+    return flags == other.flags && bindingFlags == other.bindingFlags && std::equal(bindings.begin(), bindings.end(), other.bindings.begin(), other.bindings.end(), sameBinding);
+}
+
+bool PipelineLayoutCache::PipelineLayoutKey::operator==(const PipelineLayoutKey& other) const
+{
+    return setLayouts == other.setLayouts && samePushConstants(pushConstants, other.pushConstants);
+}
+
+size_t PipelineLayoutCache::DescHash::operator()(const DescriptorSetLayoutDesc& desc) const
+{
+    size_t seed = desc.flags;
+    for (const auto& binding : desc.bindings) {
+        hashCombine(seed, (uint64_t(binding.binding) << 32) | binding.descriptorType);
+        hashCombine(seed, (uint64_t(binding.descriptorCount) << 32) | binding.stageFlags);
+    }
+    for (auto flags : desc.bindingFlags) {
+        hashCombine(seed, flags);
+    }
+    return seed;
+}
+
+size_t PipelineLayoutCache::DescHash::operator()(const PipelineLayoutKey& key) const
+{
+    size_t seed = 0;
+    for (auto layout : key.setLayouts) {
+        hashCombine(seed, reinterpret_cast<uint64_t>(layout));
+    }
+    for (const auto& range : key.pushConstants) {
+        hashCombine(seed, (uint64_t(range.offset) << 32) | range.size);
+        hashCombine(seed, range.stageFlags);
+    }
+    return seed;
+}
+
+
+
+// From Reflection ----------------------------------------------------------------------------------------
+PipelineLayoutDesc PipelineLayoutDesc::fromReflection(std::initializer_list<const ShaderReflection*> stages)
+{
+    PipelineLayoutDesc desc;
+
+    VkPushConstantRange pushConstants{};
+    for (const ShaderReflection* stage : stages) {
+        for (const auto& reflected : stage->bindings) {
+            if (desc.sets.size() <= reflected.set) {
+                desc.sets.resize(reflected.set + 1);
+            }
+
+            if (VkDescriptorSetLayoutBinding* existing = desc.findBinding(reflected.set, reflected.binding)) {
+                if (existing->descriptorType != reflected.descriptorType) {
+                    throw std::runtime_error("shader stages disagree on a descriptor binding type!");
+                }
+                existing->stageFlags |= reflected.stageFlags;
+                existing->descriptorCount = std::max(existing->descriptorCount, reflected.descriptorCount);
+                continue;
+            }
+
+            VkDescriptorSetLayoutBinding binding{};
+            binding.binding = reflected.binding;
+            binding.descriptorType = reflected.descriptorType;
+            binding.descriptorCount = reflected.descriptorCount;
+            binding.stageFlags = reflected.stageFlags;
+            desc.sets[reflected.set].bindings.push_back(binding);
+        }
+
+        // One range shared by all stages keeps the layout compatible across pipelines.
+        if (stage->pushConstantSize > 0) {
+            pushConstants.stageFlags |= stage->stage;
+            pushConstants.size = std::max(pushConstants.size, stage->pushConstantSize);
+        }
+    }
+
+    for (auto& set : desc.sets) {
+        std::sort(set.bindings.begin(), set.bindings.end(), [](const VkDescriptorSetLayoutBinding& a, const VkDescriptorSetLayoutBinding& b) {
+            return a.binding < b.binding;
+        });
+    }
+
+    if (pushConstants.size > 0) {
+        desc.pushConstants.push_back(pushConstants);
+    }
+
+    return desc;
+}
+
+VkDescriptorSetLayoutBinding* PipelineLayoutDesc::findBinding(uint32_t set, uint32_t binding)
+{
+    if (set >= sets.size()) {
+        return nullptr;
+    }
+
+    for (auto& existing : sets[set].bindings) {
+        if (existing.binding == binding) {
+            return &existing;
+        }
+    }
+
+    return nullptr;
+}
+
+
+
+// Init / Cleanup ----------------------------------------------------------------------------------------
+void PipelineLayoutCache::init(VkDevice device, const VkAllocationCallbacks* allocator)
+{
+    this->device = device;
+    this->allocator = allocator;
+}
+
+void PipelineLayoutCache::cleanup()
+{
+    for (auto& [key, layout] : pipelineLayouts) {
+        vkDestroyPipelineLayout(device, layout, allocator);
+    }
+    for (auto& [desc, layout] : setLayouts) {
+        vkDestroyDescriptorSetLayout(device, layout, allocator);
+    }
+
+    pipelineLayouts.clear();
+    setLayouts.clear();
+}
+
+
+
+// Get Set Layout ----------------------------------------------------------------------------------------
+VkDescriptorSetLayout PipelineLayoutCache::getSetLayout(const DescriptorSetLayoutDesc& desc)
+{
+    auto it = setLayouts.find(desc);
+    if (it != setLayouts.end()) {
+        return it->second;
+    }
+
+    if (!desc.bindingFlags.empty() && desc.bindingFlags.size() != desc.bindings.size()) {
+        throw std::runtime_error("descriptor binding flags must match the binding count!");
+    }
+
+    VkDescriptorSetLayoutBindingFlagsCreateInfo bindingFlagsInfo{};
+    bindingFlagsInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+    bindingFlagsInfo.bindingCount = static_cast<uint32_t>(desc.bindingFlags.size());
+    bindingFlagsInfo.pBindingFlags = desc.bindingFlags.data();
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.pNext = desc.bindingFlags.empty() ? nullptr : &bindingFlagsInfo;
+    layoutInfo.flags = desc.flags;
+    layoutInfo.bindingCount = static_cast<uint32_t>(desc.bindings.size());
+    layoutInfo.pBindings = desc.bindings.data();
+
+    VkDescriptorSetLayout layout;
+    if (vkCreateDescriptorSetLayout(device, &layoutInfo, allocator, &layout) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create descriptor set layout!");
+    }
+
+    setLayouts.emplace(desc, layout);
+    return layout;
+}
+
+
+
+// Get Pipeline Layout ----------------------------------------------------------------------------------------
+VkPipelineLayout PipelineLayoutCache::getPipelineLayout(const PipelineLayoutDesc& desc)
+{
+    PipelineLayoutKey key;
+    key.pushConstants = desc.pushConstants;
+    for (const auto& set : desc.sets) {
+        key.setLayouts.push_back(getSetLayout(set));
+    }
+
+    auto it = pipelineLayouts.find(key);
+    if (it != pipelineLayouts.end()) {
+        return it->second;
+    }
+
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(key.setLayouts.size());
+    pipelineLayoutInfo.pSetLayouts = key.setLayouts.data();
+    pipelineLayoutInfo.pushConstantRangeCount = static_cast<uint32_t>(key.pushConstants.size());
+    pipelineLayoutInfo.pPushConstantRanges = key.pushConstants.data();
+
+    VkPipelineLayout layout;
+    if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, allocator, &layout) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create pipeline layout!");
+    }
+
+    pipelineLayouts.emplace(std::move(key), layout);
+    return layout;
+}
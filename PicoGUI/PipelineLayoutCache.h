@@ -0,0 +1,73 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <unordered_map>
+#include <vector>
+
+#include "ShaderReflection.h"
+
+
+//  Layout Descriptions ---------------------------------------------------------------------------
+struct DescriptorSetLayoutDesc {
+    std::vector<VkDescriptorSetLayoutBinding> bindings;     // sorted by binding, no immutable samplers
+    std::vector<VkDescriptorBindingFlags> bindingFlags;     // empty, or one entry per binding
+    VkDescriptorSetLayoutCreateFlags flags = 0;
+
+    bool operator==(const DescriptorSetLayoutDesc& other) const;
+};
+
+struct PipelineLayoutDesc {
+    std::vector<DescriptorSetLayoutDesc> sets;
+    std::vector<VkPushConstantRange> pushConstants;
+
+    // Merges the bindings and push constants of all stages of one pipeline.
+    static PipelineLayoutDesc fromReflection(std::initializer_list<const ShaderReflection*> stages);
+
+    // Lets callers adjust what reflection cannot know, e.g. dynamic buffers or runtime array sizes.
+    VkDescriptorSetLayoutBinding* findBinding(uint32_t set, uint32_t binding);
+};
+
+
+
+//  CLASS #########################################################################################
+// Deduplicates descriptor set layouts and pipeline layouts. Pipelines whose shaders declare the
+// same sets get the same VkDescriptorSetLayout handles, so their descriptor sets stay bound
+// across pipeline switches.
+class PipelineLayoutCache
+{
+
+ // Public ----------------------------------------------------------------------------------------
+public:
+    void init(VkDevice device, const VkAllocationCallbacks* allocator = nullptr);
+    void cleanup();
+
+    VkDescriptorSetLayout getSetLayout(const DescriptorSetLayoutDesc& desc);
+    VkPipelineLayout getPipelineLayout(const PipelineLayoutDesc& desc);
+
+    size_t setLayoutCount() const { return setLayouts.size(); }
+    size_t pipelineLayoutCount() const { return pipelineLayouts.size(); }
+
+
+ // Private ----------------------------------------------------------------------------------------
+private:
+    struct PipelineLayoutKey {
+        std::vector<VkDescriptorSetLayout> setLayouts;
+        std::vector<VkPushConstantRange> pushConstants;
+
+        bool operator==(const PipelineLayoutKey& other) const;
+    };
+
+    struct DescHash {
+        size_t operator()(const DescriptorSetLayoutDesc& desc) const;
+        size_t operator()(const PipelineLayoutKey& key) const;
+    };
+
+    VkDevice device = VK_NULL_HANDLE;
+    const VkAllocationCallbacks* allocator = nullptr;
+
+    std::unordered_map<DescriptorSetLayoutDesc, VkDescriptorSetLayout, DescHash> setLayouts;
+    std::unordered_map<PipelineLayoutKey, VkPipelineLayout, DescHash> pipelineLayouts;
+};
@@ -0,0 +1,212 @@
+#include "QuadBatch.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+
+namespace {
+
+// The clip descriptor has a fixed range, so every frame uploads this many rects' worth of space.
+constexpr uint32_t MAX_CLIP_RECTS = 1024;
+constexpr VkDeviceSize CLIP_BUFFER_SIZE = MAX_CLIP_RECTS * sizeof(glm::vec4);
+
+} // namespace
+
+
+uint32_t packColor(const glm::vec4& color)
+{
+    const glm::vec4 scaled = glm::clamp(color, 0.0f, 1.0f) * 255.0f + 0.5f;
+    return static_cast<uint32_t>(scaled.r) | static_cast<uint32_t>(scaled.g) << 8
+         | static_cast<uint32_t>(scaled.b) << 16 | static_cast<uint32_t>(scaled.a) << 24;
+}
+
+
+
+// Quad Batch ----------------------------------------------------------------------------------------
+QuadBatch::QuadBatch()
+{
+    clear();
+}
+
+void QuadBatch::clear()
+{
+    instances.clear();
+    clipRects.clear();
+    clipRects.push_back(glm::vec4(-1e9f, -1e9f, 1e9f, 1e9f));
+}
+
+uint32_t QuadBatch::addClip(const glm::vec4& clipRect)
+{
+    if (clipRects.size() == MAX_CLIP_RECTS) {
+        throw std::runtime_error("too many clip rects in quad batch!");
+    }
+
+    clipRects.push_back(clipRect);
+    return static_cast<uint32_t>(clipRects.size() - 1);
+}
+
+void QuadBatch::addRect(const glm::vec4& rect, const glm::vec4& color, uint32_t clipIndex)
+{
+    QuadInstance instance;
+    instance.rect = rect;
+    instance.uv = glm::vec4(0.0f, 0.0f, 1.0f, 1.0f);
+    instance.color = packColor(color);
+    instance.clipIndex = clipIndex;
+    instance.paint = static_cast<uint32_t>(QuadPaint::Solid);
+    instance.texture = 0;
+    instances.push_back(instance);
+}
+
+void QuadBatch::addImage(const glm::vec4& rect, const AtlasRegion& region, const glm::vec4& color, uint32_t clipIndex, QuadPaint paint)
+{
+    addImage(rect, region.layer, region.uv, color, clipIndex, paint);
+}
+
+void QuadBatch::addImage(const glm::vec4& rect, uint32_t texture, const glm::vec4& uv, const glm::vec4& color, uint32_t clipIndex, QuadPaint paint)
+{
+    QuadInstance instance;
+    instance.rect = rect;
+    instance.uv = uv;
+    instance.color = packColor(color);
+    instance.clipIndex = clipIndex;
+    instance.paint = static_cast<uint32_t>(paint);
+    instance.texture = texture;
+    instances.push_back(instance);
+}
+
+
+
+// Init / Cleanup ----------------------------------------------------------------------------------------
+void QuadRenderer::init(VkDevice device, const AssetLoader& assets, PipelineLayoutCache& layoutCache, DescriptorAllocator& descriptors,
+                        BindlessTextures* bindless, const VkAllocationCallbacks* allocator)
+{
+    this->device = device;
+    this->allocator = allocator;
+    this->layoutCache = &layoutCache;
+    this->descriptors = &descriptors;
+    this->bindless = bindless;
+
+    vertexCode = assets.load("shaders/quad_vert.spv");
+    fragmentCode = assets.load(bindless != nullptr ? "shaders/quad_frag.bindless.spv" : "shaders/quad_frag.spv");
+
+    ShaderReflection vertexReflection = reflectShader(vertexCode.words());
+    ShaderReflection fragmentReflection = reflectShader(fragmentCode.words());
+
+    auto createModule = [&](std::span<const uint32_t> code) {
+        VkShaderModuleCreateInfo createInfo{};
+        createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+        createInfo.codeSize = code.size_bytes();
+        createInfo.pCode = code.data();
+
+        VkShaderModule shaderModule;
+        if (vkCreateShaderModule(device, &createInfo, allocator, &shaderModule) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create shader module!");
+        }
+        return shaderModule;
+    };
+
+    vertexShader = createModule(vertexCode.words());
+    fragmentShader = createModule(fragmentCode.words());
+
+    // The clip rects live in the upload ring; a dynamic offset selects this frame's copy.
+    layoutDesc = PipelineLayoutDesc::fromReflection({ &vertexReflection, &fragmentReflection });
+    VkDescriptorSetLayoutBinding* clipBinding = layoutDesc.findBinding(0, 0);
+    if (clipBinding == nullptr) {
+        throw std::runtime_error("quad shader has no clip rect binding!");
+    }
+    clipBinding->descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC;
+
+    // Reflection sees an unsized array; the bindless set knows its real size and flags.
+    if (bindless != nullptr) {
+        if (layoutDesc.sets.size() != 2) {
+            throw std::runtime_error("bindless quad shader has no texture set!");
+        }
+        layoutDesc.sets[1] = bindless->getLayoutDesc();
+    }
+
+    pipelineLayout = layoutCache.getPipelineLayout(layoutDesc);
+    setLayout = layoutCache.getSetLayout(layoutDesc.sets[0]);
+
+    pipelineDesc.vertexShader = vertexShader;
+    pipelineDesc.fragmentShader = fragmentShader;
+    pipelineDesc.vertexEntryPoint = vertexReflection.entryPoint;
+    pipelineDesc.fragmentEntryPoint = fragmentReflection.entryPoint;
+    pipelineDesc.layout = pipelineLayout;
+    pipelineDesc.vertexInput = reflectVertexInput(vertexReflection, 0, VK_VERTEX_INPUT_RATE_INSTANCE, { { 2, VK_FORMAT_R8G8B8A8_UNORM } });
+    pipelineDesc.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_STRIP;
+    pipelineDesc.cullMode = VK_CULL_MODE_NONE;
+    pipelineDesc.frontFace = VK_FRONT_FACE_CLOCKWISE;
+    pipelineDesc.blendMode = BlendMode::PremultipliedAlpha;
+
+    if (pipelineDesc.vertexInput.bindings.empty() || pipelineDesc.vertexInput.bindings[0].stride != sizeof(QuadInstance)) {
+        throw std::runtime_error("quad shader inputs do not match QuadInstance!");
+    }
+}
+
+void QuadRenderer::cleanup()
+{
+    vkDestroyShaderModule(device, fragmentShader, allocator);
+    vkDestroyShaderModule(device, vertexShader, allocator);
+    fragmentShader = VK_NULL_HANDLE;
+    vertexShader = VK_NULL_HANDLE;
+}
+
+void QuadRenderer::setAtlas(VkImageView imageView, VkSampler sampler)
+{
+    atlasView = imageView;
+    atlasSampler = sampler;
+}
+
+
+
+// Draw ----------------------------------------------------------------------------------------
+void QuadRenderer::draw(VkCommandBuffer commandBuffer, const QuadBatch& batch, UploadRing& uploadRing, VkExtent2D extent)
+{
+    if (batch.empty()) {
+        return;
+    }
+
+    UploadRing::Allocation instances = uploadRing.push(batch.getInstances());
+    draw(commandBuffer, batch, instances.buffer, instances.offset, uploadRing, extent);
+}
+
+void QuadRenderer::draw(VkCommandBuffer commandBuffer, const QuadBatch& batch, VkBuffer instanceBuffer, VkDeviceSize instanceOffset,
+                        UploadRing& uploadRing, VkExtent2D extent)
+{
+    if (batch.empty()) {
+        return;
+    }
+
+    std::span<const glm::vec4> clipRects = batch.getClipRects();
+    UploadRing::Allocation clips = uploadRing.allocateStorage(CLIP_BUFFER_SIZE);
+    memcpy(clips.data, clipRects.data(), clipRects.size_bytes());
+
+    // With bindless textures this is the only place the texture set is bound each frame.
+    const VkDescriptorSet sets[] = { getClipSet(clips.buffer), bindless != nullptr ? bindless->getDescriptorSet() : VK_NULL_HANDLE };
+    const uint32_t dynamicOffset = static_cast<uint32_t>(clips.offset);
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, bindless != nullptr ? 2 : 1, sets, 1, &dynamicOffset);
+
+    const glm::vec2 viewportScale(2.0f / extent.width, 2.0f / extent.height);
+    vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(viewportScale), &viewportScale);
+
+    vkCmdBindVertexBuffers(commandBuffer, 0, 1, &instanceBuffer, &instanceOffset);
+    vkCmdDraw(commandBuffer, 4, static_cast<uint32_t>(batch.getInstances().size()), 0, 0);
+}
+
+VkDescriptorSet QuadRenderer::getClipSet(VkBuffer buffer)
+{
+    // The dynamic offset moves with every frame, so the set only changes with the ring buffer
+    // and comes out of the descriptor allocator's per-frame cache after the first draw.
+    std::vector<DescriptorWrite> writes = {
+        DescriptorWrite::bufferWrite(0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, buffer, 0, CLIP_BUFFER_SIZE),
+    };
+
+    if (bindless == nullptr) {
+        if (atlasView == VK_NULL_HANDLE) {
+            throw std::runtime_error("quad renderer has no atlas!");
+        }
+        writes.push_back(DescriptorWrite::imageWrite(1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, atlasView, atlasSampler));
+    }
+
+    return descriptors->get(setLayout, writes);
+}
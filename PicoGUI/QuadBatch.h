@@ -0,0 +1,128 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "AssetPack.h"
+#include "BindlessTextures.h"
+#include "DescriptorAllocator.h"
+#include "GraphicsPipelines.h"
+#include "PipelineLayoutCache.h"
+#include "TextureAtlas.h"
+#include "UploadRing.h"
+
+
+//  Quad Instance ---------------------------------------------------------------------------------
+// Selects how quad.frag fills a quad. Textured paints sample QuadInstance::texture.
+enum class QuadPaint : uint32_t {
+    Solid = 0,
+    Image = 1,
+    Mask = 2,
+    Msdf = 3,       // glyphs from TextRenderer
+};
+
+// Matches the vertex inputs of quad.vert; the color is fed from VK_FORMAT_R8G8B8A8_UNORM.
+struct QuadInstance {
+    glm::vec4 rect;             // x, y, width, height in pixels
+    glm::vec4 uv;               // u0, v0, u1, v1
+    uint32_t color;             // RGBA8, straight alpha
+    uint32_t clipIndex;
+    uint32_t paint;             // QuadPaint
+    uint32_t texture;           // atlas layer, or bindless texture index
+};
+
+uint32_t packColor(const glm::vec4& color);
+
+
+
+//  CLASS #########################################################################################
+// One frame's worth of UI quads and the clip rects they refer to, in paint order.
+class QuadBatch
+{
+
+ // Public ----------------------------------------------------------------------------------------
+public:
+    QuadBatch();
+
+    void clear();
+
+    // Clip 0 is the whole viewport. Rects are x0, y0, x1, y1 in pixels.
+    uint32_t addClip(const glm::vec4& clipRect);
+
+    void add(const QuadInstance& instance) { instances.push_back(instance); }
+    void addRect(const glm::vec4& rect, const glm::vec4& color, uint32_t clipIndex = 0);
+    void addImage(const glm::vec4& rect, const AtlasRegion& region, const glm::vec4& color, uint32_t clipIndex = 0,
+                  QuadPaint paint = QuadPaint::Image);
+    void addImage(const glm::vec4& rect, uint32_t texture, const glm::vec4& uv, const glm::vec4& color, uint32_t clipIndex = 0,
+                  QuadPaint paint = QuadPaint::Image);
+
+    std::span<const QuadInstance> getInstances() const { return instances; }
+    std::span<const glm::vec4> getClipRects() const { return clipRects; }
+    bool empty() const { return instances.empty(); }
+
+
+ // Private ----------------------------------------------------------------------------------------
+private:
+    std::vector<QuadInstance> instances;
+    std::vector<glm::vec4> clipRects;
+};
+
+
+
+//  CLASS #########################################################################################
+// Draws a QuadBatch with one instanced draw of a four-vertex triangle strip. Instances and clip
+// rects go through the upload ring every frame; the clip rects are bound as a dynamic storage
+// buffer, so one descriptor set per ring buffer and frame serves every draw with new offsets.
+// Textured quads sample the texture atlas bound next to them, or with bindless textures any
+// texture in the bindless array; atlas pages then take the first slots, so layers and indices match.
+//
+// Binding the pipeline is left to the caller, which owns the pipeline cache.
+class QuadRenderer
+{
+
+ // Public ----------------------------------------------------------------------------------------
+public:
+    void init(VkDevice device, const AssetLoader& assets, PipelineLayoutCache& layoutCache, DescriptorAllocator& descriptors,
+              BindlessTextures* bindless = nullptr, const VkAllocationCallbacks* allocator = nullptr);
+    void cleanup();
+
+    const GraphicsPipelineDesc& getPipelineDesc() const { return pipelineDesc; }
+
+    // Call once, before the first draw; descriptor sets are written with it. Unused with bindless textures.
+    void setAtlas(VkImageView imageView, VkSampler sampler);
+
+    // Call after binding getPipelineDesc(); binds descriptors and draws.
+    void draw(VkCommandBuffer commandBuffer, const QuadBatch& batch, UploadRing& uploadRing, VkExtent2D extent);
+
+    // Draws with the batch's instances already in instanceBuffer, e.g. a PersistentBuffer.
+    void draw(VkCommandBuffer commandBuffer, const QuadBatch& batch, VkBuffer instanceBuffer, VkDeviceSize instanceOffset,
+              UploadRing& uploadRing, VkExtent2D extent);
+
+
+ // Private ----------------------------------------------------------------------------------------
+private:
+    VkDevice device = VK_NULL_HANDLE;
+    const VkAllocationCallbacks* allocator = nullptr;
+    PipelineLayoutCache* layoutCache = nullptr;
+    DescriptorAllocator* descriptors = nullptr;
+    BindlessTextures* bindless = nullptr;
+
+    Asset vertexCode;
+    Asset fragmentCode;
+    VkShaderModule vertexShader = VK_NULL_HANDLE;
+    VkShaderModule fragmentShader = VK_NULL_HANDLE;
+
+    PipelineLayoutDesc layoutDesc;
+    VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
+    VkDescriptorSetLayout setLayout = VK_NULL_HANDLE;
+    GraphicsPipelineDesc pipelineDesc;
+
+    VkImageView atlasView = VK_NULL_HANDLE;
+    VkSampler atlasSampler = VK_NULL_HANDLE;
+
+    VkDescriptorSet getClipSet(VkBuffer buffer);
+};
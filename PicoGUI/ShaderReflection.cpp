@@ -0,0 +1,531 @@
+#include "ShaderReflection.h"
+
+#include <spirv-headers/spirv.h>
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <unordered_map>
+
+
+// Module Tables ----------------------------------------------------------------------------------------
+namespace {
+
+struct SpvType {
+    SpvOp op = SpvOpNop;
+    uint32_t width = 0;             // scalars: bit width; vectors/matrices/arrays: element type id
+    uint32_t count = 0;             // vectors: components; matrices: columns; arrays: length constant id
+    uint32_t signedness = 0;
+    uint32_t dim = 0;               // images
+    uint32_t sampled = 0;           // images
+    uint32_t storageClass = 0;      // pointers
+    std::vector<uint32_t> members;  // structs
+};
+
+struct SpvDecorations {
+    uint32_t location = UINT32_MAX;
+    uint32_t binding = UINT32_MAX;
+    uint32_t set = 0;
+    uint32_t arrayStride = 0;
+    bool builtIn = false;
+    bool block = false;
+    bool bufferBlock = false;
+};
+
+struct SpvMemberDecorations {
+    uint32_t offset = 0;
+    uint32_t matrixStride = 0;
+    bool builtIn = false;
+};
+
+struct SpvVariable {
+    uint32_t id;
+    uint32_t typeId;
+    uint32_t storageClass;
+};
+
+struct SpvModule {
+    std::vector<SpvType> types;
+    std::vector<SpvDecorations> decorations;
+    std::unordered_map<uint64_t, SpvMemberDecorations> memberDecorations;
+    std::unordered_map<uint32_t, uint32_t> constants;
+    std::vector<SpvVariable> variables;
+
+    const SpvType& type(uint32_t id) const {
+        if (id >= types.size()) {
+            throw std::runtime_error("spir-v id out of range!");
+        }
+        return types[id];
+    }
+
+    const SpvMemberDecorations* member(uint32_t structId, uint32_t index) const {
+        auto it = memberDecorations.find((uint64_t(structId) << 32) | index);
+        return it == memberDecorations.end() ? nullptr : &it->second;
+    }
+
+    uint32_t arrayLength(const SpvType& array) const {
+        auto it = constants.find(array.count);
+        return it == constants.end() ? 1 : it->second;
+    }
+};
+
+
+
+// Type Size ----------------------------------------------------------------------------------------
+// Size of a type in an explicitly laid out block (push constants).
+uint32_t typeSize(const SpvModule& module, uint32_t typeId, uint32_t matrixStride = 0)
+{
+    const SpvType& type = module.type(typeId);
+
+    switch (type.op) {
+    case SpvOpTypeBool:
+        return 4;
+    case SpvOpTypeInt:
+    case SpvOpTypeFloat:
+        return type.width / 8;
+    case SpvOpTypeVector:
+        return typeSize(module, type.width) * type.count;
+    case SpvOpTypeMatrix:
+        return (matrixStride != 0 ? matrixStride : typeSize(module, type.width)) * type.count;
+    case SpvOpTypeArray: {
+        const uint32_t stride = module.decorations[typeId].arrayStride;
+        return (stride != 0 ? stride : typeSize(module, type.width)) * module.arrayLength(type);
+    }
+    case SpvOpTypeStruct: {
+        uint32_t size = 0;
+        for (uint32_t i = 0; i < type.members.size(); i++) {
+            const SpvMemberDecorations* decoration = module.member(typeId, i);
+            const uint32_t offset = decoration ? decoration->offset : size;
+            const uint32_t stride = decoration ? decoration->matrixStride : 0;
+            size = std::max(size, offset + typeSize(module, type.members[i], stride));
+        }
+        return size;
+    }
+    default:
+        return 0;
+    }
+}
+
+
+
+// Input Format ----------------------------------------------------------------------------------------
+VkFormat inputFormat(const SpvModule& module, const SpvType& type)
+{
+    const SpvType& scalar = type.op == SpvOpTypeVector ? module.type(type.width) : type;
+    const uint32_t components = type.op == SpvOpTypeVector ? type.count : 1;
+
+    if (scalar.width != 32) {
+        throw std::runtime_error("only 32-bit vertex inputs can be reflected!");
+    }
+
+    static const VkFormat floatFormats[] = { VK_FORMAT_R32_SFLOAT, VK_FORMAT_R32G32_SFLOAT, VK_FORMAT_R32G32B32_SFLOAT, VK_FORMAT_R32G32B32A32_SFLOAT };
+    static const VkFormat intFormats[] = { VK_FORMAT_R32_SINT, VK_FORMAT_R32G32_SINT, VK_FORMAT_R32G32B32_SINT, VK_FORMAT_R32G32B32A32_SINT };
+    static const VkFormat uintFormats[] = { VK_FORMAT_R32_UINT, VK_FORMAT_R32G32_UINT, VK_FORMAT_R32G32B32_UINT, VK_FORMAT_R32G32B32A32_UINT };
+
+    if (scalar.op == SpvOpTypeFloat) {
+        return floatFormats[components - 1];
+    }
+    if (scalar.op == SpvOpTypeInt) {
+        return scalar.signedness ? intFormats[components - 1] : uintFormats[components - 1];
+    }
+
+    throw std::runtime_error("unsupported vertex input type!");
+}
+
+
+
+// Descriptor Type ----------------------------------------------------------------------------------------
+bool descriptorType(const SpvModule& module, uint32_t storageClass, uint32_t typeId, VkDescriptorType& result)
+{
+    const SpvType& type = module.type(typeId);
+
+    switch (type.op) {
+    case SpvOpTypeSampler:
+        result = VK_DESCRIPTOR_TYPE_SAMPLER;
+        return true;
+    case SpvOpTypeSampledImage:
+        result = module.type(type.width).dim == SpvDimBuffer ? VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER : VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        return true;
+    case SpvOpTypeImage:
+        if (type.dim == SpvDimSubpassData) {
+            result = VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
+        }
+        else if (type.dim == SpvDimBuffer) {
+            result = type.sampled == 2 ? VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER : VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER;
+        }
+        else {
+            result = type.sampled == 2 ? VK_DESCRIPTOR_TYPE_STORAGE_IMAGE : VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+        }
+        return true;
+    case SpvOpTypeAccelerationStructureKHR:
+        result = VK_DESCRIPTOR_TYPE_ACCELERATION_STRUCTURE_KHR;
+        return true;
+    case SpvOpTypeStruct:
+        if (storageClass == SpvStorageClassStorageBuffer || module.decorations[typeId].bufferBlock) {
+            result = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+            return true;
+        }
+        if (storageClass == SpvStorageClassUniform && module.decorations[typeId].block) {
+            result = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+            return true;
+        }
+        return false;
+    default:
+        return false;
+    }
+}
+
+
+
+// Stage ----------------------------------------------------------------------------------------
+VkShaderStageFlagBits shaderStage(uint32_t executionModel)
+{
+    switch (executionModel) {
+    case SpvExecutionModelVertex: return VK_SHADER_STAGE_VERTEX_BIT;
+    case SpvExecutionModelTessellationControl: return VK_SHADER_STAGE_TESSELLATION_CONTROL_BIT;
+    case SpvExecutionModelTessellationEvaluation: return VK_SHADER_STAGE_TESSELLATION_EVALUATION_BIT;
+    case SpvExecutionModelGeometry: return VK_SHADER_STAGE_GEOMETRY_BIT;
+    case SpvExecutionModelFragment: return VK_SHADER_STAGE_FRAGMENT_BIT;
+    case SpvExecutionModelGLCompute: return VK_SHADER_STAGE_COMPUTE_BIT;
+    default:
+        throw std::runtime_error("unsupported shader execution model!");
+    }
+}
+
+} // namespace
+
+
+
+// Reflect Shader ----------------------------------------------------------------------------------------
+ShaderReflection reflectShader(std::span<const uint32_t> code)
+{
+    if (code.size() < 5 || code[0] != SpvMagicNumber) {
+        throw std::runtime_error("not a spir-v module!");
+    }
+
+    const uint32_t bound = code[3];
+
+    SpvModule module;
+    module.types.resize(bound);
+    module.decorations.resize(bound);
+
+    ShaderReflection reflection;
+    bool foundEntryPoint = false;
+
+    for (size_t i = 5; i < code.size();) {
+        const uint32_t wordCount = code[i] >> SpvWordCountShift;
+        const SpvOp op = static_cast<SpvOp>(code[i] & SpvOpCodeMask);
+
+        if (wordCount == 0 || i + wordCount > code.size()) {
+            throw std::runtime_error("malformed spir-v instruction!");
+        }
+
+        const uint32_t* operands = &code[i + 1];
+        auto checkId = [&](uint32_t id) {
+            if (id >= bound) {
+                throw std::runtime_error("spir-v id out of range!");
+            }
+            return id;
+        };
+        // Word counts include the opcode word, so operands[n] needs at least n + 2 words.
+        auto requireWords = [&](uint32_t minimum) {
+            if (wordCount < minimum) {
+                throw std::runtime_error("malformed spir-v instruction!");
+            }
+        };
+
+        switch (op) {
+        case SpvOpEntryPoint:
+            // Reflect the first entry point; PicoGUI shaders have exactly one.
+            // The name is a nul-terminated string that must end inside the instruction.
+            if (!foundEntryPoint) {
+                if (wordCount <= 3) {
+                    throw std::runtime_error("malformed spir-v entry point!");
+                }
+                const char* name = reinterpret_cast<const char*>(&operands[2]);
+                const size_t maxLength = (wordCount - 3) * sizeof(uint32_t);
+                const size_t length = strnlen(name, maxLength);
+                if (length == maxLength) {
+                    throw std::runtime_error("malformed spir-v entry point!");
+                }
+                reflection.stage = shaderStage(operands[0]);
+                reflection.entryPoint.assign(name, length);
+                foundEntryPoint = true;
+            }
+            break;
+
+        case SpvOpDecorate: {
+            requireWords(3);
+            SpvDecorations& decoration = module.decorations[checkId(operands[0])];
+            switch (operands[1]) {
+            case SpvDecorationLocation: requireWords(4); decoration.location = operands[2]; break;
+            case SpvDecorationBinding: requireWords(4); decoration.binding = operands[2]; break;
+            case SpvDecorationDescriptorSet: requireWords(4); decoration.set = operands[2]; break;
+            case SpvDecorationArrayStride: requireWords(4); decoration.arrayStride = operands[2]; break;
+            case SpvDecorationBuiltIn: decoration.builtIn = true; break;
+            case SpvDecorationBlock: decoration.block = true; break;
+            case SpvDecorationBufferBlock: decoration.bufferBlock = true; break;
+            default: break;
+            }
+            break;
+        }
+
+        case SpvOpMemberDecorate: {
+            requireWords(4);
+            SpvMemberDecorations& decoration = module.memberDecorations[(uint64_t(checkId(operands[0])) << 32) | operands[1]];
+            switch (operands[2]) {
+            case SpvDecorationOffset: requireWords(5); decoration.offset = operands[3]; break;
+            case SpvDecorationMatrixStride: requireWords(5); decoration.matrixStride = operands[3]; break;
+            case SpvDecorationBuiltIn: decoration.builtIn = true; break;
+            default: break;
+            }
+            break;
+        }
+
+        case SpvOpTypeBool:
+        case SpvOpTypeSampler:
+        case SpvOpTypeAccelerationStructureKHR:
+            requireWords(2);
+            module.types[checkId(operands[0])].op = op;
+            break;
+
+        case SpvOpTypeInt:
+        case SpvOpTypeFloat: {
+            requireWords(op == SpvOpTypeInt ? 4 : 3);
+            SpvType& type = module.types[checkId(operands[0])];
+            type.op = op;
+            type.width = operands[1];
+            type.signedness = op == SpvOpTypeInt ? operands[2] : 1;
+            break;
+        }
+
+        case SpvOpTypeVector:
+        case SpvOpTypeMatrix:
+        case SpvOpTypeArray: {
+            requireWords(4);
+            SpvType& type = module.types[checkId(operands[0])];
+            type.op = op;
+            type.width = checkId(operands[1]);
+            type.count = operands[2];
+            break;
+        }
+
+        case SpvOpTypeRuntimeArray:
+        case SpvOpTypeSampledImage: {
+            requireWords(3);
+            SpvType& type = module.types[checkId(operands[0])];
+            type.op = op;
+            type.width = checkId(operands[1]);
+            break;
+        }
+
+        case SpvOpTypeImage: {
+            requireWords(9);
+            SpvType& type = module.types[checkId(operands[0])];
+            type.op = op;
+            type.dim = operands[2];
+            type.sampled = operands[6];
+            break;
+        }
+
+        case SpvOpTypeStruct: {
+            requireWords(2);
+            SpvType& type = module.types[checkId(operands[0])];
+            type.op = op;
+            type.members.assign(operands + 1, operands + wordCount - 1);
+            for (uint32_t member : type.members) {
+                checkId(member);
+            }
+            break;
+        }
+
+        case SpvOpTypePointer: {
+            requireWords(4);
+            SpvType& type = module.types[checkId(operands[0])];
+            type.op = op;
+            type.storageClass = operands[1];
+            type.width = checkId(operands[2]);
+            break;
+        }
+
+        case SpvOpConstant:
+        case SpvOpSpecConstant:
+            // Only 32-bit integer constants matter here (array lengths).
+            requireWords(4);
+            module.constants[checkId(operands[1])] = operands[2];
+            break;
+
+        case SpvOpVariable:
+            requireWords(4);
+            module.variables.push_back({ checkId(operands[1]), checkId(operands[0]), operands[2] });
+            break;
+
+        case SpvOpFunction:
+            // Types, decorations and global variables all precede the first function.
+            i = code.size();
+            continue;
+
+        default:
+            break;
+        }
+
+        i += wordCount;
+    }
+
+    if (!foundEntryPoint) {
+        throw std::runtime_error("spir-v module has no entry point!");
+    }
+
+    for (const auto& variable : module.variables) {
+        const SpvType& pointer = module.type(variable.typeId);
+        const SpvDecorations& decoration = module.decorations[variable.id];
+        uint32_t typeId = pointer.width;
+
+        switch (variable.storageClass) {
+        case SpvStorageClassInput: {
+            if (reflection.stage != VK_SHADER_STAGE_VERTEX_BIT || decoration.builtIn || decoration.location == UINT32_MAX) {
+                break;
+            }
+
+            const SpvType& type = module.type(typeId);
+            if (type.op == SpvOpTypeMatrix) {
+                // A matrix input takes one location per column.
+                const VkFormat columnFormat = inputFormat(module, module.type(type.width));
+                for (uint32_t column = 0; column < type.count; column++) {
+                    reflection.inputs.push_back({ decoration.location + column, columnFormat });
+                }
+            }
+            else {
+                reflection.inputs.push_back({ decoration.location, inputFormat(module, type) });
+            }
+            break;
+        }
+
+        case SpvStorageClassPushConstant:
+            reflection.pushConstantSize = std::max(reflection.pushConstantSize, typeSize(module, typeId));
+            break;
+
+        case SpvStorageClassUniformConstant:
+        case SpvStorageClassUniform:
+        case SpvStorageClassStorageBuffer: {
+            uint32_t count = 1;
+            const SpvType* type = &module.type(typeId);
+            if (type->op == SpvOpTypeArray) {
+                count = module.arrayLength(*type);
+                typeId = type->width;
+            }
+            else if (type->op == SpvOpTypeRuntimeArray) {
+                count = 0;
+                typeId = type->width;
+            }
+
+            VkDescriptorType descriptor;
+            if (decoration.binding == UINT32_MAX || !descriptorType(module, variable.storageClass, typeId, descriptor)) {
+                break;
+            }
+
+            reflection.bindings.push_back({ decoration.set, decoration.binding, descriptor, count, static_cast<VkShaderStageFlags>(reflection.stage) });
+            break;
+        }
+
+        default:
+            break;
+        }
+    }
+
+    std::sort(reflection.inputs.begin(), reflection.inputs.end(), [](const ReflectedInput& a, const ReflectedInput& b) {
+        return a.location < b.location;
+    });
+    std::sort(reflection.bindings.begin(), reflection.bindings.end(), [](const ReflectedBinding& a, const ReflectedBinding& b) {
+        return a.set != b.set ? a.set < b.set : a.binding < b.binding;
+    });
+
+    return reflection;
+}
+
+
+
+// Format Size ----------------------------------------------------------------------------------------
+uint32_t formatSize(VkFormat format)
+{
+    switch (format) {
+    case VK_FORMAT_R8_UNORM:
+    case VK_FORMAT_R8_UINT:
+        return 1;
+    case VK_FORMAT_R8G8_UNORM:
+    case VK_FORMAT_R16_UINT:
+    case VK_FORMAT_R16_SFLOAT:
+        return 2;
+    case VK_FORMAT_R8G8B8A8_UNORM:
+    case VK_FORMAT_R8G8B8A8_SRGB:
+    case VK_FORMAT_B8G8R8A8_UNORM:
+    case VK_FORMAT_B8G8R8A8_SRGB:
+    case VK_FORMAT_R16G16_UINT:
+    case VK_FORMAT_R16G16_UNORM:
+    case VK_FORMAT_R16G16_SFLOAT:
+    case VK_FORMAT_R32_SFLOAT:
+    case VK_FORMAT_R32_SINT:
+    case VK_FORMAT_R32_UINT:
+        return 4;
+    case VK_FORMAT_R16G16B16A16_UNORM:
+    case VK_FORMAT_R16G16B16A16_SFLOAT:
+    case VK_FORMAT_R32G32_SFLOAT:
+    case VK_FORMAT_R32G32_SINT:
+    case VK_FORMAT_R32G32_UINT:
+        return 8;
+    case VK_FORMAT_R32G32B32_SFLOAT:
+    case VK_FORMAT_R32G32B32_SINT:
+    case VK_FORMAT_R32G32B32_UINT:
+        return 12;
+    case VK_FORMAT_R32G32B32A32_SFLOAT:
+    case VK_FORMAT_R32G32B32A32_SINT:
+    case VK_FORMAT_R32G32B32A32_UINT:
+        return 16;
+    default:
+        throw std::runtime_error("unsupported vertex attribute format!");
+    }
+}
+
+
+
+// Reflect Vertex Input ----------------------------------------------------------------------------------------
+VertexInputDesc reflectVertexInput(const ShaderReflection& vertexShader, uint32_t binding, VkVertexInputRate inputRate, const std::map<uint32_t, VkFormat>& formatOverrides)
+{
+    VertexInputDesc desc;
+
+    uint32_t offset = 0;
+    for (const auto& input : vertexShader.inputs) {
+        auto it = formatOverrides.find(input.location);
+        const VkFormat format = it != formatOverrides.end() ? it->second : input.format;
+
+        VkVertexInputAttributeDescription attribute{};
+        attribute.location = input.location;
+        attribute.binding = binding;
+        attribute.format = format;
+        attribute.offset = offset;
+        desc.attributes.push_back(attribute);
+
+        offset += formatSize(format);
+    }
+
+    if (!desc.attributes.empty()) {
+        VkVertexInputBindingDescription bindingDescription{};
+        bindingDescription.binding = binding;
+        bindingDescription.stride = offset;
+        bindingDescription.inputRate = inputRate;
+        desc.bindings.push_back(bindingDescription);
+    }
+
+    return desc;
+}
+
+VkPipelineVertexInputStateCreateInfo VertexInputDesc::createInfo() const
+{
+    VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
+    vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+    vertexInputInfo.vertexBindingDescriptionCount = static_cast<uint32_t>(bindings.size());
+    vertexInputInfo.pVertexBindingDescriptions = bindings.data();
+    vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributes.size());
+    vertexInputInfo.pVertexAttributeDescriptions = attributes.data();
+    return vertexInputInfo;
+}
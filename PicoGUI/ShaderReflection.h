@@ -0,0 +1,51 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <cstdint>
+#include <map>
+#include <span>
+#include <string>
+#include <vector>
+
+
+//  Reflected Data --------------------------------------------------------------------------------
+struct ReflectedBinding {
+    uint32_t set;
+    uint32_t binding;
+    VkDescriptorType descriptorType;
+    uint32_t descriptorCount;   // 0 for runtime arrays; the caller picks the size
+    VkShaderStageFlags stageFlags;
+};
+
+struct ReflectedInput {
+    uint32_t location;
+    VkFormat format;
+};
+
+struct ShaderReflection {
+    VkShaderStageFlagBits stage = VK_SHADER_STAGE_VERTEX_BIT;
+    std::string entryPoint = "main";
+    std::vector<ReflectedInput> inputs;         // stage inputs sorted by location, built-ins excluded
+    std::vector<ReflectedBinding> bindings;     // sorted by (set, binding)
+    uint32_t pushConstantSize = 0;
+};
+
+// Parses a SPIR-V module. Throws std::runtime_error on malformed input.
+ShaderReflection reflectShader(std::span<const uint32_t> code);
+
+uint32_t formatSize(VkFormat format);
+
+
+
+//  Vertex Input ----------------------------------------------------------------------------------
+struct VertexInputDesc {
+    std::vector<VkVertexInputBindingDescription> bindings;
+    std::vector<VkVertexInputAttributeDescription> attributes;
+
+    VkPipelineVertexInputStateCreateInfo createInfo() const;
+};
+
+// All vertex shader inputs packed tightly, in location order, into one binding.
+// formatOverrides lets the buffer layout differ from the shader type, e.g. a vec4
+// color fed from VK_FORMAT_R8G8B8A8_UNORM.
+VertexInputDesc reflectVertexInput(const ShaderReflection& vertexShader, uint32_t binding, VkVertexInputRate inputRate, const std::map<uint32_t, VkFormat>& formatOverrides = {});
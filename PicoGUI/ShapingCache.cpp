@@ -0,0 +1,251 @@
+#include "ShapingCache.h"
+
+#include <algorithm>
+#include <bit>
+
+#include "Hash.h"
+
+
+namespace {
+
+// Invalid sequences decode to U+FFFD, one byte at a time.
+uint32_t decodeUtf8(std::string_view text, size_t& i)
+{
+    const uint8_t lead = static_cast<uint8_t>(text[i++]);
+    if (lead < 0x80) {
+        return lead;
+    }
+
+    uint32_t length;
+    uint32_t codepoint;
+    if ((lead & 0xE0) == 0xC0) {
+        length = 1;
+        codepoint = lead & 0x1F;
+    }
+    else if ((lead & 0xF0) == 0xE0) {
+        length = 2;
+        codepoint = lead & 0x0F;
+    }
+    else if ((lead & 0xF8) == 0xF0) {
+        length = 3;
+        codepoint = lead & 0x07;
+    }
+    else {
+        return 0xFFFD;
+    }
+
+    if (i + length > text.size()) {
+        return 0xFFFD;
+    }
+    for (uint32_t k = 0; k < length; k++) {
+        const uint8_t next = static_cast<uint8_t>(text[i + k]);
+        if ((next & 0xC0) != 0x80) {
+            return 0xFFFD;
+        }
+        codepoint = codepoint << 6 | (next & 0x3F);
+    }
+    i += length;
+    return codepoint;
+}
+
+} // namespace
+
+
+
+// Shape ----------------------------------------------------------------------------------------
+ShapedRun shapeText(const Font& font, uint32_t features, std::string_view text)
+{
+    ShapedRun run;
+    run.glyphs.reserve(text.size());
+
+    uint32_t previous = UINT32_MAX;
+    for (size_t i = 0; i < text.size();) {
+        const uint32_t cluster = static_cast<uint32_t>(i);
+        const uint32_t codepoint = decodeUtf8(text, i);
+        if (codepoint == '\n') {
+            run.glyphs.push_back({ 0, 0.0f, cluster, SHAPED_NEWLINE });
+            previous = UINT32_MAX;
+            continue;
+        }
+
+        const uint32_t glyph = font.findGlyph(codepoint);
+        if (previous != UINT32_MAX && (features & SHAPE_KERNING)) {
+            run.glyphs.back().advance += font.getKerning(previous, glyph);
+        }
+        const uint32_t flags = codepoint == ' ' || codepoint == '\t' ? SHAPED_SPACE : 0;
+        run.glyphs.push_back({ glyph, font.getAdvance(glyph), cluster, flags });
+        previous = glyph;
+    }
+    return run;
+}
+
+
+
+// Init ----------------------------------------------------------------------------------------
+ShapingCache::~ShapingCache()
+{
+    cleanup();
+}
+
+void ShapingCache::init(uint32_t maxEntries)
+{
+    cleanup();
+
+    // About one entry per bucket when full.
+    const uint64_t bucketCount = std::bit_ceil(std::max<uint64_t>(maxEntries, 16));
+    this->maxEntries = maxEntries;
+    buckets = std::make_unique<std::atomic<Entry*>[]>(bucketCount);
+    bucketMask = bucketCount - 1;
+    for (uint64_t i = 0; i < bucketCount; i++) {
+        buckets[i].store(nullptr, std::memory_order_relaxed);
+    }
+}
+
+void ShapingCache::cleanup()
+{
+    for (Entry* entry : entries) {
+        delete entry;
+    }
+    for (Entry* entry : retired) {
+        delete entry;
+    }
+    entries.clear();
+    retired.clear();
+    buckets.reset();
+    bucketMask = 0;
+}
+
+
+
+// Frame ----------------------------------------------------------------------------------------
+void ShapingCache::beginFrame()
+{
+    std::lock_guard<std::mutex> lock(writeMutex);
+    for (Entry* entry : retired) {
+        delete entry;
+    }
+    retired.clear();
+    frame.fetch_add(1, std::memory_order_relaxed);
+}
+
+
+
+// Lookup ----------------------------------------------------------------------------------------
+const ShapedRun* ShapingCache::find(const Font& font, uint32_t features, std::string_view text)
+{
+    Entry* entry = lookup(hashKey(font, features, text), font, features, text);
+    if (entry == nullptr) {
+        return nullptr;
+    }
+    entry->lastUsed.store(frame.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    hits.fetch_add(1, std::memory_order_relaxed);
+    return &entry->run;
+}
+
+const ShapedRun* ShapingCache::shape(const Font& font, uint32_t features, std::string_view text)
+{
+    const uint64_t hash = hashKey(font, features, text);
+    if (Entry* entry = lookup(hash, font, features, text)) {
+        entry->lastUsed.store(frame.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        hits.fetch_add(1, std::memory_order_relaxed);
+        return &entry->run;
+    }
+
+    // Shaped outside the lock; if another thread gets there first, its run is kept instead.
+    Entry* shaped = new Entry;
+    shaped->hash = hash;
+    shaped->font = &font;
+    shaped->features = features;
+    shaped->text = text;
+    shaped->run = shapeText(font, features, text);
+    shaped->lastUsed.store(frame.load(std::memory_order_relaxed), std::memory_order_relaxed);
+
+    std::lock_guard<std::mutex> lock(writeMutex);
+    if (Entry* entry = lookup(hash, font, features, text)) {
+        delete shaped;
+        entry->lastUsed.store(frame.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        hits.fetch_add(1, std::memory_order_relaxed);
+        return &entry->run;
+    }
+
+    // The release store publishes the entry, fully built, to readers of the bucket.
+    std::atomic<Entry*>& bucket = buckets[hash & bucketMask];
+    shaped->next.store(bucket.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    bucket.store(shaped, std::memory_order_release);
+    entries.push_back(shaped);
+    misses.fetch_add(1, std::memory_order_relaxed);
+
+    if (entries.size() > maxEntries) {
+        evict();
+    }
+    return &shaped->run;
+}
+
+ShapingCache::Stats ShapingCache::getStats() const
+{
+    std::lock_guard<std::mutex> lock(writeMutex);
+    Stats stats;
+    stats.entries = static_cast<uint32_t>(entries.size());
+    stats.hits = hits.load(std::memory_order_relaxed);
+    stats.misses = misses.load(std::memory_order_relaxed);
+    stats.evictions = evictions;
+    return stats;
+}
+
+uint64_t ShapingCache::hashKey(const Font& font, uint32_t features, std::string_view text)
+{
+    const Font* fontPointer = &font;
+    uint64_t hash = hashBytes(HASH_SEED, &fontPointer, sizeof(fontPointer));
+    hash = hashBytes(hash, &features, sizeof(features));
+    return hashBytes(hash, text.data(), text.size());
+}
+
+ShapingCache::Entry* ShapingCache::lookup(uint64_t hash, const Font& font, uint32_t features, std::string_view text) const
+{
+    if (!buckets) {
+        return nullptr;
+    }
+    for (Entry* entry = buckets[hash & bucketMask].load(std::memory_order_acquire); entry != nullptr;
+         entry = entry->next.load(std::memory_order_acquire)) {
+        if (entry->hash == hash && entry->font == &font && entry->features == features && entry->text == text) {
+            return entry;
+        }
+    }
+    return nullptr;
+}
+
+
+
+// Eviction ----------------------------------------------------------------------------------------
+// Evicts an eighth of the entries at once, the least recently used, so the scan is paid rarely.
+// Called with the write lock held.
+void ShapingCache::evict()
+{
+    const uint64_t currentFrame = frame.load(std::memory_order_relaxed);
+    const size_t count = std::max<size_t>(entries.size() - maxEntries * 7 / 8, 1);
+    std::nth_element(entries.begin(), entries.begin() + (count - 1), entries.end(), [](const Entry* a, const Entry* b) {
+        return a->lastUsed.load(std::memory_order_relaxed) < b->lastUsed.load(std::memory_order_relaxed);
+    });
+
+    size_t evicted = 0;
+    for (size_t i = 0; i < count; i++) {
+        Entry* victim = entries[i];
+        if (victim->lastUsed.load(std::memory_order_relaxed) == currentFrame) {
+            continue;               // its run may be in use
+        }
+
+        // Readers on the victim keep walking from it; its own next pointer stays as it was.
+        std::atomic<Entry*>* link = &buckets[victim->hash & bucketMask];
+        while (link->load(std::memory_order_relaxed) != victim) {
+            link = &link->load(std::memory_order_relaxed)->next;
+        }
+        link->store(victim->next.load(std::memory_order_relaxed), std::memory_order_release);
+
+        retired.push_back(victim);
+        entries[i] = nullptr;
+        evicted++;
+    }
+
+    entries.erase(std::remove(entries.begin(), entries.end(), nullptr), entries.end());
+    evictions += evicted;
+}
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "Font.h"
+
+
+//  Shaped Text -----------------------------------------------------------------------------------
+// Shaping features, combined as bits in ShapingCache::shape().
+constexpr uint32_t SHAPE_KERNING = 1 << 0;
+
+// Shaped glyph flags.
+constexpr uint32_t SHAPED_SPACE = 1 << 0;       // a line may break after it, and it does not draw
+constexpr uint32_t SHAPED_NEWLINE = 1 << 1;     // the line ends here; the advance is 0
+
+struct ShapedGlyph {
+    uint32_t glyph;
+    float advance;              // in ems, with the kerning towards the next glyph
+    uint32_t cluster;           // byte offset in the text of the character it came from
+    uint32_t flags;             // SHAPED_*
+};
+
+// Glyphs in logical order. Runs are in ems, so one serves every size.
+struct ShapedRun {
+    std::vector<ShapedGlyph> glyphs;
+};
+
+
+
+//  CLASS #########################################################################################
+// Shaped runs of the strings drawn lately, keyed by font, features and text, so laying out the
+// same text again, to measure it for another width or to paint it, never shapes it twice.
+//
+// Lookups take no lock: each bucket is a list that readers walk with acquire loads while writers,
+// serialized by a mutex, only ever link new entries in at the head or unlink old ones. A hit
+// stamps the entry with the current frame, and when the cache is full the entries stamped
+// longest ago are evicted, never one used this frame. Evicted entries may still be walked by a
+// reader, so they are freed by the next beginFrame(); runs are valid until then.
+class ShapingCache
+{
+
+ // Public ----------------------------------------------------------------------------------------
+public:
+    struct Stats {
+        uint32_t entries = 0;
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        uint64_t evictions = 0;
+    };
+
+    ShapingCache() = default;
+    ~ShapingCache();
+
+    ShapingCache(const ShapingCache&) = delete;
+    ShapingCache& operator=(const ShapingCache&) = delete;
+
+    void init(uint32_t maxEntries = 4096);
+    void cleanup();
+
+    // Call once per frame, while no other thread reads the cache.
+    void beginFrame();
+
+    // Null if the text has not been shaped with the font and features lately.
+    const ShapedRun* find(const Font& font, uint32_t features, std::string_view text);
+    // Finds the run, or shapes the text (UTF-8) and keeps it.
+    const ShapedRun* shape(const Font& font, uint32_t features, std::string_view text);
+
+    Stats getStats() const;
+
+
+ // Private ----------------------------------------------------------------------------------------
+private:
+    struct Entry {
+        std::atomic<Entry*> next = nullptr;
+        uint64_t hash = 0;
+        const Font* font = nullptr;
+        uint32_t features = 0;
+        std::string text;
+        ShapedRun run;
+        std::atomic<uint64_t> lastUsed = 0;
+    };
+
+    uint32_t maxEntries = 0;
+    std::unique_ptr<std::atomic<Entry*>[]> buckets;
+    uint64_t bucketMask = 0;
+    std::atomic<uint64_t> frame = 1;
+
+    mutable std::mutex writeMutex;
+    std::vector<Entry*> entries;            // every linked entry, for eviction
+    std::vector<Entry*> retired;            // unlinked, freed by beginFrame()
+
+    std::atomic<uint64_t> hits = 0;
+    std::atomic<uint64_t> misses = 0;
+    uint64_t evictions = 0;
+
+    static uint64_t hashKey(const Font& font, uint32_t features, std::string_view text);
+    Entry* lookup(uint64_t hash, const Font& font, uint32_t features, std::string_view text) const;
+    void evict();
+};
+
+// Maps characters to glyphs and applies the features; the text is UTF-8.
+ShapedRun shapeText(const Font& font, uint32_t features, std::string_view text);
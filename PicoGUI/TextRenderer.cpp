@@ -0,0 +1,323 @@
+#include "TextRenderer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <optional>
+#include <stdexcept>
+
+#include "Msdf.h"
+
+
+namespace {
+
+// Fields are generated at one size for all; the distance range keeps them sharp well above it.
+const float GLYPH_TEXELS_PER_EM = 32.0f;
+const float GLYPH_PADDING = MSDF_RANGE;      // texels around the outline
+
+const uint64_t GLYPH_KEY_TAG = 0x47ull << 56;
+
+uint64_t glyphKey(uint32_t font, uint32_t glyph)
+{
+    return GLYPH_KEY_TAG | uint64_t(font) << 32 | glyph;
+}
+
+} // namespace
+
+
+
+// Init ----------------------------------------------------------------------------------------
+void TextRenderer::init(TextureAtlas& atlas, uint32_t workerCount)
+{
+    this->atlas = &atlas;
+    shaping.init();
+    atlasRepacks = atlas.getStats().repacks;
+
+    if (workerCount == 0) {
+        workerCount = std::clamp(std::thread::hardware_concurrency() / 2, 1u, 4u);
+    }
+    stopping = false;
+    for (uint32_t i = 0; i < workerCount; i++) {
+        workers.emplace_back(&TextRenderer::workerLoop, this);
+    }
+}
+
+void TextRenderer::cleanup()
+{
+    {
+        std::lock_guard<std::mutex> lock(workerMutex);
+        stopping = true;
+        jobs.clear();
+    }
+    workerSignal.notify_all();
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+    workers.clear();
+
+    results.clear();
+    unplaced.clear();
+    glyphs.clear();
+    painted.clear();
+    shaping.cleanup();
+    fonts.clear();
+}
+
+uint32_t TextRenderer::addFont(Font font)
+{
+    fonts.push_back(std::make_unique<Font>(std::move(font)));
+    return static_cast<uint32_t>(fonts.size() - 1);
+}
+
+
+
+// Frame ----------------------------------------------------------------------------------------
+void TextRenderer::beginFrame()
+{
+    shaping.beginFrame();
+    bool changed = false;
+
+    // Glyphs on the screen are touched first, so placing new ones cannot evict them. Those the
+    // atlas let go of anyway are generated again.
+    for (uint64_t key : painted) {
+        Glyph& glyph = glyphs[key];
+        if (glyph.state == GlyphState::Ready && !atlas->find(key)) {
+            request(key, static_cast<uint32_t>(key >> 32) & 0xFFFFFF, static_cast<uint32_t>(key));
+            changed = true;
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(workerMutex);
+        for (GlyphResult& result : results) {
+            unplaced.push_back(std::move(result));
+        }
+        results.clear();
+    }
+
+    // Atlas space left by evictions is reclaimed over the next frames; until then glyphs wait here.
+    auto placedEnd = std::remove_if(unplaced.begin(), unplaced.end(), [&](const GlyphResult& result) {
+        Glyph& glyph = glyphs[result.key];
+        if (result.pixels.empty()) {
+            glyph.state = GlyphState::Empty;
+            return true;
+        }
+        if (!atlas->insert(result.key, result.width, result.height, result.pixels)) {
+            return false;
+        }
+        glyph.state = GlyphState::Ready;
+        glyph.plane = result.plane;
+        stats.generated++;
+        changed = true;
+        return true;
+    });
+    unplaced.erase(placedEnd, unplaced.end());
+
+    // Repacking moves entries, so painted uvs may be stale.
+    if (atlas->getStats().repacks != atlasRepacks) {
+        atlasRepacks = atlas->getStats().repacks;
+        changed = true;
+    }
+
+    if (changed) {
+        generation++;
+        painted.clear();
+    }
+
+    stats.glyphs = 0;
+    stats.queued = 0;
+    for (const auto& [key, glyph] : glyphs) {
+        stats.glyphs += glyph.state == GlyphState::Ready;
+        stats.queued += glyph.state == GlyphState::Queued;
+    }
+}
+
+
+
+// Text ----------------------------------------------------------------------------------------
+glm::vec2 TextRenderer::measure(const TextStyle& style, std::string_view text, float maxWidth)
+{
+    return layout(style, text, maxWidth);
+}
+
+void TextRenderer::paint(const TextStyle& style, std::string_view text, float maxWidth, std::vector<QuadInstance>& quads)
+{
+    layout(style, text, maxWidth);
+
+    const uint32_t color = packColor(style.color);
+    for (const PlacedGlyph& placedGlyph : placed) {
+        const uint64_t key = glyphKey(style.font, placedGlyph.glyph);
+        auto [it, created] = glyphs.try_emplace(key);
+        if (created) {
+            request(key, style.font, placedGlyph.glyph);
+        }
+
+        Glyph& glyph = it->second;
+        if (glyph.state != GlyphState::Ready) {
+            continue;
+        }
+        const std::optional<AtlasRegion> region = atlas->find(key);
+        if (!region) {
+            request(key, style.font, placedGlyph.glyph);
+            continue;
+        }
+        if (glyph.paintedGeneration != generation) {
+            glyph.paintedGeneration = generation;
+            painted.push_back(key);
+        }
+
+        // The plane is y up from the baseline; quads are y down.
+        const glm::vec4& plane = glyph.plane;
+        QuadInstance quad;
+        quad.rect = glm::vec4(placedGlyph.pen.x + plane.x * style.size, placedGlyph.pen.y - plane.w * style.size,
+                              (plane.z - plane.x) * style.size, (plane.w - plane.y) * style.size);
+        quad.uv = region->uv;
+        quad.color = color;
+        quad.clipIndex = 0;
+        quad.paint = static_cast<uint32_t>(QuadPaint::Msdf);
+        quad.texture = region->layer;
+        quads.push_back(quad);
+    }
+}
+
+void TextRenderer::setWidgetText(WidgetTree& tree, WidgetId id, const TextStyle& style, std::string text)
+{
+    tree.setMeasure(id, [this, style, text](glm::vec2 available) {
+        return measure(style, text, available.x);
+    });
+    tree.setPaint(id, [this, style, text = std::move(text)](glm::vec2 size, std::vector<QuadInstance>& quads) {
+        paint(style, text, size.x, quads);
+    });
+}
+
+// Places the glyphs of the text in placed and returns the size it takes, rounded up to whole
+// pixels. A line breaks before the word that would overflow it, unless the word starts the line.
+glm::vec2 TextRenderer::layout(const TextStyle& style, std::string_view text, float maxWidth)
+{
+    placed.clear();
+
+    const Font& font = *fonts[style.font];
+    const ShapedRun& run = *shaping.shape(font, style.features, text);
+
+    const FontMetrics& metrics = font.getMetrics();
+    const float lineHeight = style.lineHeight * style.size;
+    const float baseline = ((style.lineHeight - (metrics.ascender - metrics.descender)) * 0.5f + metrics.ascender) * style.size;
+
+    float width = 0.0f;
+    float y = baseline;
+    uint32_t lines = 1;
+
+    float x = 0.0f;
+    float inkEnd = 0.0f;            // after the last glyph that is not a space
+    float breakWidth = 0.0f;        // of the line, if it breaks at the last space
+    size_t lineBegin = 0;
+    size_t wordBegin = 0;
+    float wordX = 0.0f;
+
+    for (const ShapedGlyph& shaped : run.glyphs) {
+        if (shaped.flags & SHAPED_NEWLINE) {
+            width = std::max(width, inkEnd);
+            y += lineHeight;
+            lines++;
+            x = inkEnd = breakWidth = wordX = 0.0f;
+            lineBegin = wordBegin = placed.size();
+            continue;
+        }
+
+        const float advance = shaped.advance * style.size;
+        if (shaped.flags & SHAPED_SPACE) {
+            breakWidth = inkEnd;
+            x += advance;
+            wordBegin = placed.size();
+            wordX = x;
+            continue;
+        }
+
+        if (x + advance > maxWidth && wordBegin > lineBegin) {
+            width = std::max(width, breakWidth);
+            y += lineHeight;
+            lines++;
+            for (size_t k = wordBegin; k < placed.size(); k++) {
+                placed[k].pen += glm::vec2(-wordX, lineHeight);
+            }
+            x -= wordX;
+            inkEnd -= wordX;
+            breakWidth = wordX = 0.0f;
+            lineBegin = wordBegin;
+        }
+
+        placed.push_back({ shaped.glyph, glm::vec2(x, y) });
+        x += advance;
+        inkEnd = x;
+    }
+    width = std::max(width, inkEnd);
+
+    return glm::ceil(glm::vec2(width, lines * lineHeight));
+}
+
+
+
+// Glyphs ----------------------------------------------------------------------------------------
+void TextRenderer::request(uint64_t key, uint32_t font, uint32_t glyph)
+{
+    glyphs[key].state = GlyphState::Queued;
+    {
+        std::lock_guard<std::mutex> lock(workerMutex);
+        jobs.push_back({ key, fonts[font].get(), glyph });
+    }
+    workerSignal.notify_one();
+}
+
+void TextRenderer::workerLoop()
+{
+    for (;;) {
+        GlyphJob job;
+        {
+            std::unique_lock<std::mutex> lock(workerMutex);
+            workerSignal.wait(lock, [this] { return stopping || !jobs.empty(); });
+
+            if (stopping) {
+                return;
+            }
+
+            job = jobs.front();
+            jobs.pop_front();
+        }
+
+        // Fonts are only freed in cleanup(), after the workers have been joined.
+        GlyphResult result;
+        result.key = job.key;
+        try {
+            const std::vector<GlyphContour> outline = job.font->getOutline(job.glyph);
+            glm::vec2 low(std::numeric_limits<float>::max());
+            glm::vec2 high(-std::numeric_limits<float>::max());
+            for (const GlyphContour& contour : outline) {
+                for (const GlyphEdge& edge : contour) {
+                    low = glm::min(low, glm::min(edge.p0, edge.p1));
+                    high = glm::max(high, glm::max(edge.p0, edge.p1));
+                    if (edge.curved) {
+                        low = glm::min(low, edge.p2);
+                        high = glm::max(high, edge.p2);
+                    }
+                }
+            }
+
+            if (low.x <= high.x && low.y <= high.y) {
+                // Whole texels from the origin, so the plane maps texel edges to em positions exactly.
+                const glm::vec2 first = glm::floor(low * GLYPH_TEXELS_PER_EM) - GLYPH_PADDING;
+                const glm::vec2 last = glm::ceil(high * GLYPH_TEXELS_PER_EM) + GLYPH_PADDING;
+                result.width = static_cast<uint32_t>(last.x - first.x);
+                result.height = static_cast<uint32_t>(last.y - first.y);
+                result.plane = glm::vec4(first, last) / GLYPH_TEXELS_PER_EM;
+                result.pixels = generateMsdf(outline, result.width, result.height, GLYPH_TEXELS_PER_EM, first / GLYPH_TEXELS_PER_EM);
+            }
+        }
+        catch (const std::exception&) {
+            // A glyph the font cannot describe is left out.
+            result.pixels.clear();
+        }
+
+        std::lock_guard<std::mutex> lock(workerMutex);
+        results.push_back(std::move(result));
+    }
+}
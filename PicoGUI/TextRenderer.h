@@ -0,0 +1,134 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "Font.h"
+#include "QuadBatch.h"
+#include "ShapingCache.h"
+#include "TextureAtlas.h"
+#include "WidgetTree.h"
+
+
+//  Text Style ------------------------------------------------------------------------------------
+struct TextStyle {
+    uint32_t font = 0;                      // from TextRenderer::addFont()
+    float size = 16.0f;                     // pixels per em
+    float lineHeight = 1.25f;               // in ems
+    glm::vec4 color = glm::vec4(1.0f);
+    uint32_t features = SHAPE_KERNING;
+};
+
+
+
+//  CLASS #########################################################################################
+// Lays out and draws text as quads sampling multi-channel distance fields of the glyphs, so one
+// rendition of a glyph serves every size and scale, and text batches with the rest of the UI.
+//
+// Fields are generated on worker threads the first time a glyph is painted and placed in the
+// texture atlas by beginFrame(); until then the glyph is left out. Whenever glyphs land, or the
+// atlas moves or evicts glyphs that were painted, the generation changes, and text painted before
+// should be painted again. Glyphs painted since the last change are kept resident in the atlas.
+//
+// Text is shaped once, through the shaping cache, and measuring or painting it again at any width
+// or size only breaks the shaped run into lines.
+class TextRenderer
+{
+
+ // Public ----------------------------------------------------------------------------------------
+public:
+    struct Stats {
+        uint32_t glyphs = 0;            // ready in the atlas
+        uint32_t queued = 0;            // waiting for a field or for atlas space
+        uint64_t generated = 0;
+    };
+
+    // workerCount 0 picks one from the number of cores.
+    void init(TextureAtlas& atlas, uint32_t workerCount = 0);
+    void cleanup();
+
+    // Returns the index to use in TextStyle::font.
+    uint32_t addFont(Font font);
+    const Font& getFont(uint32_t font) const { return *fonts[font]; }
+
+    // Call once per frame, after the atlas' beginFrame().
+    void beginFrame();
+    uint64_t getGeneration() const { return generation; }
+
+    // Text is UTF-8; lines break at '\n' and wrap between words to fit maxWidth.
+    glm::vec2 measure(const TextStyle& style, std::string_view text, float maxWidth = WIDGET_UNBOUNDED);
+    // Appends a quad per visible glyph, relative to the top-left corner of the text.
+    void paint(const TextStyle& style, std::string_view text, float maxWidth, std::vector<QuadInstance>& quads);
+
+    // Makes a widget measure and paint the text, wrapped to its width.
+    void setWidgetText(WidgetTree& tree, WidgetId id, const TextStyle& style, std::string text);
+
+    const Stats& getStats() const { return stats; }
+    ShapingCache::Stats getShapingStats() const { return shaping.getStats(); }
+
+
+ // Private ----------------------------------------------------------------------------------------
+private:
+    enum class GlyphState {
+        Queued,
+        Ready,
+        Empty,                          // nothing to draw, e.g. a space
+    };
+
+    struct Glyph {
+        GlyphState state = GlyphState::Queued;
+        glm::vec4 plane = glm::vec4(0.0f);      // x0, y0, x1, y1 of the field in ems, y up
+        uint64_t paintedGeneration = UINT64_MAX;
+    };
+
+    struct GlyphJob {
+        uint64_t key;
+        const Font* font;
+        uint32_t glyph;
+    };
+
+    struct GlyphResult {
+        uint64_t key = 0;
+        glm::vec4 plane = glm::vec4(0.0f);
+        uint32_t width = 0;
+        uint32_t height = 0;
+        std::vector<uint8_t> pixels;    // empty for glyphs without an outline
+    };
+
+    struct PlacedGlyph {
+        uint32_t glyph;
+        glm::vec2 pen;                  // on the baseline, in pixels from the top-left corner
+    };
+
+    TextureAtlas* atlas = nullptr;
+    std::vector<std::unique_ptr<Font>> fonts;     // jobs and the shaping cache point into them
+    ShapingCache shaping;
+    std::unordered_map<uint64_t, Glyph> glyphs;
+    std::vector<uint64_t> painted;                // glyphs painted in this generation
+    std::vector<GlyphResult> unplaced;            // generated, waiting for atlas space
+    std::vector<PlacedGlyph> placed;              // scratch for layout()
+    uint64_t generation = 0;
+    uint64_t atlasRepacks = 0;
+    Stats stats;
+
+    std::vector<std::thread> workers;
+    std::mutex workerMutex;
+    std::condition_variable workerSignal;
+    std::deque<GlyphJob> jobs;
+    std::vector<GlyphResult> results;
+    bool stopping = false;
+
+    glm::vec2 layout(const TextStyle& style, std::string_view text, float maxWidth);
+    void request(uint64_t key, uint32_t font, uint32_t glyph);
+    void workerLoop();
+};
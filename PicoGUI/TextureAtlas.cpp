@@ -0,0 +1,464 @@
+#include "TextureAtlas.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+
+namespace {
+
+// Transparent gap to the right of and below every entry, so linear filtering never reads a neighbour.
+constexpr uint32_t PADDING = 1;
+
+} // namespace
+
+
+
+// Init / Cleanup ----------------------------------------------------------------------------------------
+void TextureAtlas::init(VkDevice device, GpuAllocator& gpuAllocator, uint32_t pageSize, uint32_t pageCount,
+                        const VkAllocationCallbacks* allocator)
+{
+    this->device = device;
+    this->allocator = allocator;
+    this->gpuAllocator = &gpuAllocator;
+    this->pageSize = pageSize;
+
+    VkImageCreateInfo imageInfo{};
+    imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    imageInfo.imageType = VK_IMAGE_TYPE_2D;
+    imageInfo.format = VK_FORMAT_R8G8B8A8_UNORM;
+    imageInfo.extent = { pageSize, pageSize, 1 };
+    imageInfo.mipLevels = 1;
+    imageInfo.arrayLayers = pageCount;
+    imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+    imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+    imageInfo.usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+    imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+    GpuAllocationInfo memoryInfo;
+    memoryInfo.requiredFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+    image = gpuAllocator.createImage(imageInfo, memoryInfo, imageAllocation);
+
+    VkImageViewCreateInfo viewInfo{};
+    viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    viewInfo.image = image;
+    viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D_ARRAY;
+    viewInfo.format = imageInfo.format;
+    viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    viewInfo.subresourceRange.levelCount = 1;
+    viewInfo.subresourceRange.layerCount = pageCount;
+
+    if (vkCreateImageView(device, &viewInfo, allocator, &imageView) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create texture atlas image view!");
+    }
+
+    // Bindless texture arrays hold 2D images, so each page also gets a view of its own.
+    viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+    viewInfo.subresourceRange.layerCount = 1;
+    layerViews.resize(pageCount);
+    for (uint32_t layer = 0; layer < pageCount; layer++) {
+        viewInfo.subresourceRange.baseArrayLayer = layer;
+        if (vkCreateImageView(device, &viewInfo, allocator, &layerViews[layer]) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create texture atlas image view!");
+        }
+    }
+
+    VkSamplerCreateInfo samplerInfo{};
+    samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+    samplerInfo.magFilter = VK_FILTER_LINEAR;
+    samplerInfo.minFilter = VK_FILTER_LINEAR;
+    samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+    samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+
+    if (vkCreateSampler(device, &samplerInfo, allocator, &sampler) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create texture atlas sampler!");
+    }
+
+    pages.resize(pageCount);
+    for (Page& page : pages) {
+        page.skyline.push_back({ 0, 0, pageSize });
+    }
+}
+
+void TextureAtlas::cleanup()
+{
+    vkDestroySampler(device, sampler, allocator);
+    for (VkImageView layerView : layerViews) {
+        vkDestroyImageView(device, layerView, allocator);
+    }
+    vkDestroyImageView(device, imageView, allocator);
+    if (image != VK_NULL_HANDLE) {
+        gpuAllocator->destroyImage(image, imageAllocation);
+    }
+
+    sampler = VK_NULL_HANDLE;
+    imageView = VK_NULL_HANDLE;
+    layerViews.clear();
+    image = VK_NULL_HANDLE;
+    pages.clear();
+    entries.clear();
+    pendingUploads.clear();
+}
+
+
+
+// Begin Frame ----------------------------------------------------------------------------------------
+void TextureAtlas::beginFrame(uint64_t frameNumber)
+{
+    this->frameNumber = frameNumber;
+
+    // Repack the page with the most evicted space, if a failed insert asked for it or a good part
+    // of the page is wasted. Moved entries are uploaded before anything samples them this frame.
+    uint32_t bestLayer = UINT32_MAX;
+    for (uint32_t layer = 0; layer < pages.size(); layer++) {
+        if (pages[layer].deadTexels > 0 && (bestLayer == UINT32_MAX || pages[layer].deadTexels > pages[bestLayer].deadTexels)) {
+            bestLayer = layer;
+        }
+    }
+
+    const uint64_t wasteThreshold = uint64_t(pageSize) * pageSize / 4;
+    if (bestLayer != UINT32_MAX && (repackRequested || pages[bestLayer].deadTexels >= wasteThreshold)) {
+        repack(bestLayer);
+    }
+    repackRequested = false;
+}
+
+
+
+// Find / Insert ----------------------------------------------------------------------------------------
+std::optional<AtlasRegion> TextureAtlas::find(uint64_t key)
+{
+    auto it = entries.find(key);
+    if (it == entries.end()) {
+        return std::nullopt;
+    }
+
+    it->second.lastUsed = frameNumber;
+    return region(it->second);
+}
+
+std::optional<AtlasRegion> TextureAtlas::insert(uint64_t key, uint32_t width, uint32_t height, std::span<const uint8_t> rgba)
+{
+    if (rgba.size() != size_t(width) * height * 4) {
+        throw std::runtime_error("atlas image size does not match its extent!");
+    }
+    if (width == 0 || height == 0 || width + PADDING > pageSize || height + PADDING > pageSize) {
+        throw std::runtime_error("image does not fit in a texture atlas page!");
+    }
+
+    if (entries.contains(key)) {
+        evict(key);
+    }
+
+    for (uint32_t layer = 0; layer < pages.size(); layer++) {
+        uint32_t x, y;
+        if (!pack(pages[layer], width + PADDING, height + PADDING, x, y)) {
+            continue;
+        }
+
+        Entry entry;
+        entry.layer = layer;
+        entry.x = x;
+        entry.y = y;
+        entry.width = width;
+        entry.height = height;
+        entry.lastUsed = frameNumber;
+        entry.uploadQueued = true;
+        entry.pixels.assign(rgba.begin(), rgba.end());
+
+        pages[layer].liveTexels += uint64_t(width + PADDING) * (height + PADDING);
+        pendingUploads.push_back(key);
+
+        AtlasRegion result = region(entry);
+        entries.emplace(key, std::move(entry));
+        stats.entries = static_cast<uint32_t>(entries.size());
+        stats.usedTexels += uint64_t(width) * height;
+        return result;
+    }
+
+    // Make room for next frame; entries drawn this frame keep their place until then.
+    evictFor(uint64_t(width + PADDING) * (height + PADDING));
+    repackRequested = true;
+    return std::nullopt;
+}
+
+AtlasRegion TextureAtlas::region(const Entry& entry) const
+{
+    const float scale = 1.0f / pageSize;
+
+    AtlasRegion result;
+    result.layer = entry.layer;
+    result.uv = glm::vec4(entry.x, entry.y, entry.x + entry.width, entry.y + entry.height) * scale;
+    result.size = glm::uvec2(entry.width, entry.height);
+    return result;
+}
+
+
+
+// Skyline Packing ----------------------------------------------------------------------------------------
+// Bottom-left: the lowest position the rect fits at, ties going to the narrowest skyline segment.
+bool TextureAtlas::pack(Page& page, uint32_t width, uint32_t height, uint32_t& x, uint32_t& y)
+{
+    std::vector<SkylineNode>& skyline = page.skyline;
+
+    size_t bestIndex = SIZE_MAX;
+    uint32_t bestY = UINT32_MAX;
+    uint32_t bestWidth = UINT32_MAX;
+
+    for (size_t i = 0; i < skyline.size(); i++) {
+        if (skyline[i].x + width > pageSize) {
+            break;
+        }
+
+        // The rect rests on the highest segment it spans.
+        uint32_t top = 0;
+        uint32_t remaining = width;
+        for (size_t j = i; remaining > 0; j++) {
+            top = std::max(top, skyline[j].y);
+            remaining -= std::min(remaining, skyline[j].width);
+        }
+
+        if (top + height <= pageSize && (top < bestY || (top == bestY && skyline[i].width < bestWidth))) {
+            bestIndex = i;
+            bestY = top;
+            bestWidth = skyline[i].width;
+        }
+    }
+
+    if (bestIndex == SIZE_MAX) {
+        return false;
+    }
+
+    x = skyline[bestIndex].x;
+    y = bestY;
+    skyline.insert(skyline.begin() + bestIndex, { x, y + height, width });
+
+    // Trim the segments the new one covers.
+    for (size_t i = bestIndex + 1; i < skyline.size();) {
+        const uint32_t previousEnd = skyline[i - 1].x + skyline[i - 1].width;
+        if (skyline[i].x >= previousEnd) {
+            break;
+        }
+
+        const uint32_t overlap = previousEnd - skyline[i].x;
+        if (skyline[i].width <= overlap) {
+            skyline.erase(skyline.begin() + i);
+            continue;
+        }
+
+        skyline[i].x += overlap;
+        skyline[i].width -= overlap;
+        break;
+    }
+
+    // Merge neighbours at the same height.
+    for (size_t i = 0; i + 1 < skyline.size();) {
+        if (skyline[i].y == skyline[i + 1].y) {
+            skyline[i].width += skyline[i + 1].width;
+            skyline.erase(skyline.begin() + i + 1);
+        }
+        else {
+            i++;
+        }
+    }
+
+    return true;
+}
+
+
+
+// Eviction ----------------------------------------------------------------------------------------
+void TextureAtlas::evict(uint64_t key)
+{
+    auto it = entries.find(key);
+    const Entry& entry = it->second;
+    const uint64_t texels = uint64_t(entry.width + PADDING) * (entry.height + PADDING);
+
+    pages[entry.layer].liveTexels -= texels;
+    pages[entry.layer].deadTexels += texels;
+    stats.usedTexels -= uint64_t(entry.width) * entry.height;
+    stats.evictions++;
+
+    entries.erase(it);
+    stats.entries = static_cast<uint32_t>(entries.size());
+}
+
+// Evicts least recently used entries until one page has at least texels of reclaimable space.
+// Entries used this frame are never evicted: quads referring to them may already be recorded.
+bool TextureAtlas::evictFor(uint64_t texels)
+{
+    for (const Page& page : pages) {
+        if (page.deadTexels >= texels) {
+            return true;
+        }
+    }
+
+    std::vector<std::pair<uint64_t, uint64_t>> candidates;      // last used, key
+    for (const auto& [key, entry] : entries) {
+        if (entry.lastUsed < frameNumber) {
+            candidates.emplace_back(entry.lastUsed, key);
+        }
+    }
+    std::sort(candidates.begin(), candidates.end());
+
+    for (const auto& [lastUsed, key] : candidates) {
+        const uint32_t layer = entries.at(key).layer;
+        evict(key);
+
+        if (pages[layer].deadTexels >= texels) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+// Rebuilds a page's skyline from its live entries, tallest first, and queues them all for upload
+// into the cleared layer.
+void TextureAtlas::repack(uint32_t layer)
+{
+    std::vector<uint64_t> keys;
+    for (const auto& [key, entry] : entries) {
+        if (entry.layer == layer) {
+            keys.push_back(key);
+        }
+    }
+
+    std::sort(keys.begin(), keys.end(), [&](uint64_t a, uint64_t b) {
+        const Entry& ea = entries.at(a);
+        const Entry& eb = entries.at(b);
+        return ea.height != eb.height ? ea.height > eb.height : ea.width > eb.width;
+    });
+
+    Page& page = pages[layer];
+    page.skyline.assign(1, { 0, 0, pageSize });
+    page.liveTexels = 0;
+    page.deadTexels = 0;
+    page.needsClear = true;
+
+    for (uint64_t key : keys) {
+        Entry& entry = entries.at(key);
+        page.liveTexels += uint64_t(entry.width + PADDING) * (entry.height + PADDING);
+
+        if (!pack(page, entry.width + PADDING, entry.height + PADDING, entry.x, entry.y)) {
+            evict(key);
+            continue;
+        }
+
+        if (!entry.uploadQueued) {
+            entry.uploadQueued = true;
+            pendingUploads.push_back(key);
+        }
+    }
+
+    // Anything evicted above can only be reclaimed by the next repack.
+    page.deadTexels = 0;
+    stats.repacks++;
+}
+
+
+
+// Record Uploads ----------------------------------------------------------------------------------------
+void TextureAtlas::recordUploads(VkCommandBuffer commandBuffer, UploadRing& uploadRing)
+{
+    const bool anyClear = std::any_of(pages.begin(), pages.end(), [](const Page& page) { return page.needsClear; });
+    if (pendingUploads.empty() && !anyClear) {
+        return;
+    }
+
+    // Stage every pending entry in one ring allocation and copy them with a single command.
+    VkDeviceSize totalBytes = 0;
+    for (uint64_t key : pendingUploads) {
+        auto it = entries.find(key);
+        if (it != entries.end()) {
+            totalBytes += it->second.pixels.size();
+        }
+    }
+
+    std::vector<VkBufferImageCopy> regions;
+    UploadRing::Allocation staging;
+    if (totalBytes > 0) {
+        staging = uploadRing.allocate(totalBytes, 16);
+    }
+
+    VkDeviceSize offset = 0;
+    for (uint64_t key : pendingUploads) {
+        auto it = entries.find(key);
+        if (it == entries.end()) {
+            continue;                   // evicted before it was uploaded
+        }
+
+        Entry& entry = it->second;
+        memcpy(static_cast<char*>(staging.data) + offset, entry.pixels.data(), entry.pixels.size());
+        entry.uploadQueued = false;
+
+        VkBufferImageCopy region{};
+        region.bufferOffset = staging.offset + offset;
+        region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        region.imageSubresource.baseArrayLayer = entry.layer;
+        region.imageSubresource.layerCount = 1;
+        region.imageOffset = { static_cast<int32_t>(entry.x), static_cast<int32_t>(entry.y), 0 };
+        region.imageExtent = { entry.width, entry.height, 1 };
+        regions.push_back(region);
+
+        offset += entry.pixels.size();
+        stats.bytesUploaded += entry.pixels.size();
+    }
+    pendingUploads.clear();
+
+    VkImageMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.srcAccessMask = 0;
+    barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.oldLayout = imageInitialized ? VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_UNDEFINED;
+    barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image = image;
+    barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    barrier.subresourceRange.levelCount = 1;
+    barrier.subresourceRange.layerCount = static_cast<uint32_t>(pages.size());
+
+    // Earlier frames may still be sampling regions that are about to be overwritten.
+    const VkPipelineStageFlags srcStage = imageInitialized ? VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT : VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+    vkCmdPipelineBarrier(commandBuffer, srcStage, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+    if (anyClear) {
+        const VkClearColorValue transparent{};
+        for (uint32_t layer = 0; layer < pages.size(); layer++) {
+            if (!pages[layer].needsClear) {
+                continue;
+            }
+
+            VkImageSubresourceRange range{};
+            range.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+            range.baseArrayLayer = layer;
+            range.levelCount = 1;
+            range.layerCount = 1;
+            vkCmdClearColorImage(commandBuffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, &transparent, 1, &range);
+            pages[layer].needsClear = false;
+        }
+
+        if (!regions.empty()) {
+            VkImageMemoryBarrier clearBarrier = barrier;
+            clearBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            clearBarrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+            vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &clearBarrier);
+        }
+    }
+
+    if (!regions.empty()) {
+        vkCmdCopyBufferToImage(commandBuffer, staging.buffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, static_cast<uint32_t>(regions.size()), regions.data());
+    }
+
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+    imageInitialized = true;
+}
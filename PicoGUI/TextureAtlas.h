@@ -0,0 +1,120 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "GpuAllocator.h"
+#include "UploadRing.h"
+
+
+//  Atlas Region ----------------------------------------------------------------------------------
+struct AtlasRegion {
+    uint32_t layer = 0;
+    glm::vec4 uv{};             // u0, v0, u1, v1
+    glm::uvec2 size{};          // in texels
+};
+
+
+
+//  CLASS #########################################################################################
+// Packs icons, glyphs and other small RGBA8 images into the layers of one 2D array image, so any
+// number of them share one descriptor and batch into the same instanced draw. Each layer is a
+// page packed with a bottom-left skyline.
+//
+// New entries are copied into the image by recordUploads(), as one vkCmdCopyBufferToImage with a
+// region per entry, staged through the upload ring. Entries remember when they were last used;
+// when the atlas is full the least recently used ones are evicted. Evicted space is reclaimed by
+// repacking a page in beginFrame(), which moves entries, so regions must be looked up every frame.
+class TextureAtlas
+{
+
+ // Public ----------------------------------------------------------------------------------------
+public:
+    struct Stats {
+        uint32_t entries = 0;
+        uint64_t usedTexels = 0;
+        uint64_t evictions = 0;
+        uint64_t repacks = 0;
+        uint64_t bytesUploaded = 0;
+    };
+
+    void init(VkDevice device, GpuAllocator& gpuAllocator, uint32_t pageSize = 1024, uint32_t pageCount = 4,
+              const VkAllocationCallbacks* allocator = nullptr);
+    void cleanup();
+
+    // Call once per frame before any find() or insert(); repacks at most one page.
+    void beginFrame(uint64_t frameNumber);
+
+    // Both mark the entry as used this frame, which protects it from eviction until the next.
+    std::optional<AtlasRegion> find(uint64_t key);
+    // Returns nothing if the image cannot be placed this frame; evicted space is reclaimed by the
+    // next beginFrame(), so retrying next frame usually succeeds. rgba is copied.
+    std::optional<AtlasRegion> insert(uint64_t key, uint32_t width, uint32_t height, std::span<const uint8_t> rgba);
+
+    // Record before the render pass that samples the atlas.
+    void recordUploads(VkCommandBuffer commandBuffer, UploadRing& uploadRing);
+
+    VkImageView getImageView() const { return imageView; }
+    VkImageView getLayerView(uint32_t layer) const { return layerViews[layer]; }     // 2D view of one page
+    uint32_t getPageCount() const { return static_cast<uint32_t>(pages.size()); }
+    VkSampler getSampler() const { return sampler; }
+    const Stats& getStats() const { return stats; }
+
+
+ // Private ----------------------------------------------------------------------------------------
+private:
+    struct SkylineNode {
+        uint32_t x;
+        uint32_t y;
+        uint32_t width;
+    };
+
+    struct Page {
+        std::vector<SkylineNode> skyline;
+        uint64_t liveTexels = 0;
+        uint64_t deadTexels = 0;        // evicted but not yet reclaimed
+        bool needsClear = true;
+    };
+
+    struct Entry {
+        uint32_t layer;
+        uint32_t x;
+        uint32_t y;
+        uint32_t width;
+        uint32_t height;
+        uint64_t lastUsed;
+        bool uploadQueued;
+        std::vector<uint8_t> pixels;    // kept for repacking
+    };
+
+    VkDevice device = VK_NULL_HANDLE;
+    const VkAllocationCallbacks* allocator = nullptr;
+    GpuAllocator* gpuAllocator = nullptr;
+    uint32_t pageSize = 0;
+    uint64_t frameNumber = 0;
+
+    VkImage image = VK_NULL_HANDLE;
+    GpuAllocation imageAllocation;
+    VkImageView imageView = VK_NULL_HANDLE;
+    std::vector<VkImageView> layerViews;
+    VkSampler sampler = VK_NULL_HANDLE;
+    bool imageInitialized = false;
+    bool repackRequested = false;
+
+    std::vector<Page> pages;
+    std::unordered_map<uint64_t, Entry> entries;
+    std::vector<uint64_t> pendingUploads;
+    Stats stats;
+
+    AtlasRegion region(const Entry& entry) const;
+    bool pack(Page& page, uint32_t width, uint32_t height, uint32_t& x, uint32_t& y);
+    void evict(uint64_t key);
+    bool evictFor(uint64_t texels);
+    void repack(uint32_t layer);
+};
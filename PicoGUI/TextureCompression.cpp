@@ -0,0 +1,436 @@
+#include "TextureCompression.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+
+namespace {
+
+constexpr uint32_t DDS_MAGIC = 0x20534444;  // "DDS "
+constexpr uint32_t DDPF_FOURCC = 0x4;
+constexpr uint32_t DDPF_RGB = 0x40;
+
+constexpr uint32_t fourCC(char a, char b, char c, char d)
+{
+    return uint32_t(uint8_t(a)) | uint32_t(uint8_t(b)) << 8 | uint32_t(uint8_t(c)) << 16 | uint32_t(uint8_t(d)) << 24;
+}
+
+struct DdsPixelFormat {
+    uint32_t size;
+    uint32_t flags;
+    uint32_t fourCC;
+    uint32_t rgbBitCount;
+    uint32_t masks[4];
+};
+
+struct DdsHeader {
+    uint32_t size;
+    uint32_t flags;
+    uint32_t height;
+    uint32_t width;
+    uint32_t pitchOrLinearSize;
+    uint32_t depth;
+    uint32_t mipMapCount;
+    uint32_t reserved1[11];
+    DdsPixelFormat pixelFormat;
+    uint32_t caps[4];
+    uint32_t reserved2;
+};
+
+struct DdsHeaderDx10 {
+    uint32_t dxgiFormat;
+    uint32_t resourceDimension;
+    uint32_t miscFlag;
+    uint32_t arraySize;
+    uint32_t miscFlags2;
+};
+
+static_assert(sizeof(DdsHeader) == 124, "DdsHeader must match the DDS file layout");
+static_assert(sizeof(DdsHeaderDx10) == 20, "DdsHeaderDx10 must match the DDS file layout");
+
+struct DxgiFormat {
+    uint32_t dxgi;
+    TextureFormat format;
+    bool srgb;
+};
+
+constexpr DxgiFormat DXGI_FORMATS[] = {
+    { 28, TextureFormat::RGBA8, false }, { 29, TextureFormat::RGBA8, true },
+    { 71, TextureFormat::BC1, false }, { 72, TextureFormat::BC1, true },
+    { 77, TextureFormat::BC3, false }, { 78, TextureFormat::BC3, true },
+    { 80, TextureFormat::BC4, false },
+    { 98, TextureFormat::BC7, false }, { 99, TextureFormat::BC7, true },
+};
+
+constexpr uint8_t BC7_WEIGHTS2[] = { 0, 21, 43, 64 };
+constexpr uint8_t BC7_WEIGHTS3[] = { 0, 9, 18, 27, 37, 46, 55, 64 };
+constexpr uint8_t BC7_WEIGHTS4[] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+template <typename T>
+T readStruct(std::span<const std::byte> file, size_t offset)
+{
+    if (offset + sizeof(T) > file.size()) {
+        throw std::runtime_error("failed to parse DDS texture: file is truncated!");
+    }
+    T value;
+    std::memcpy(&value, file.data() + offset, sizeof(T));
+    return value;
+}
+
+uint16_t read16(const uint8_t* p)
+{
+    return uint16_t(p[0] | p[1] << 8);
+}
+
+void unpack565(uint16_t value, uint8_t* rgb)
+{
+    const uint32_t r = (value >> 11) & 31, g = (value >> 5) & 63, b = value & 31;
+    rgb[0] = uint8_t(r << 3 | r >> 2);
+    rgb[1] = uint8_t(g << 2 | g >> 4);
+    rgb[2] = uint8_t(b << 3 | b >> 2);
+}
+
+
+
+// Block Decoders ----------------------------------------------------------------------------------------
+// Each writes 16 RGBA texels in row order.
+void decodeBc1(const uint8_t* block, uint8_t* texels, bool alwaysFourColors)
+{
+    const uint16_t c0 = read16(block), c1 = read16(block + 2);
+    uint8_t palette[4][4];
+    unpack565(c0, palette[0]);
+    unpack565(c1, palette[1]);
+    palette[0][3] = palette[1][3] = 255;
+
+    for (int c = 0; c < 3; c++) {
+        if (c0 > c1 || alwaysFourColors) {
+            palette[2][c] = uint8_t((2 * palette[0][c] + palette[1][c]) / 3);
+            palette[3][c] = uint8_t((palette[0][c] + 2 * palette[1][c]) / 3);
+        }
+        else {
+            palette[2][c] = uint8_t((palette[0][c] + palette[1][c]) / 2);
+            palette[3][c] = 0;
+        }
+    }
+    palette[2][3] = 255;
+    palette[3][3] = (c0 > c1 || alwaysFourColors) ? 255 : 0;
+
+    uint32_t indices;
+    std::memcpy(&indices, block + 4, 4);
+    for (int i = 0; i < 16; i++) {
+        std::memcpy(texels + i * 4, palette[(indices >> (2 * i)) & 3], 4);
+    }
+}
+
+// Writes the channel at texels[i * 4 + channel].
+void decodeBc4(const uint8_t* block, uint8_t* texels, int channel)
+{
+    const uint32_t a0 = block[0], a1 = block[1];
+    uint8_t palette[8] = { uint8_t(a0), uint8_t(a1) };
+    if (a0 > a1) {
+        for (uint32_t i = 1; i < 7; i++) {
+            palette[i + 1] = uint8_t(((7 - i) * a0 + i * a1) / 7);
+        }
+    }
+    else {
+        for (uint32_t i = 1; i < 5; i++) {
+            palette[i + 1] = uint8_t(((5 - i) * a0 + i * a1) / 5);
+        }
+        palette[6] = 0;
+        palette[7] = 255;
+    }
+
+    uint64_t indices = 0;
+    std::memcpy(&indices, block + 2, 6);
+    for (int i = 0; i < 16; i++) {
+        texels[i * 4 + channel] = palette[(indices >> (3 * i)) & 7];
+    }
+}
+
+class BitReader
+{
+public:
+    explicit BitReader(const uint8_t* block) { std::memcpy(bits, block, 16); }
+
+    uint32_t read(uint32_t count)
+    {
+        uint32_t value = 0;
+        for (uint32_t i = 0; i < count; i++, position++) {
+            value |= uint32_t((bits[position >> 3] >> (position & 7)) & 1) << i;
+        }
+        return value;
+    }
+
+private:
+    uint8_t bits[16];
+    uint32_t position = 0;
+};
+
+uint8_t interpolate(uint32_t e0, uint32_t e1, uint32_t weight)
+{
+    return uint8_t(((64 - weight) * e0 + weight * e1 + 32) >> 6);
+}
+
+// Reads 16 indices of the given width; the first, the anchor, has one bit less.
+void readIndices(BitReader& reader, uint32_t bits, uint32_t* indices)
+{
+    for (int i = 0; i < 16; i++) {
+        indices[i] = reader.read(i == 0 ? bits - 1 : bits);
+    }
+}
+
+void decodeBc7(const uint8_t* block, uint8_t* texels)
+{
+    uint32_t mode = 0;
+    while (mode < 8 && !((block[0] >> mode) & 1)) {
+        mode++;
+    }
+
+    if (mode < 4 || mode > 6) {
+        for (int i = 0; i < 16; i++) {
+            texels[i * 4 + 0] = 255;
+            texels[i * 4 + 1] = 0;
+            texels[i * 4 + 2] = 255;
+            texels[i * 4 + 3] = 255;
+        }
+        return;
+    }
+
+    BitReader reader(block);
+    reader.read(mode + 1);
+
+    uint32_t endpoints[2][4];
+    uint32_t rotation = 0;
+    uint32_t indexSelection = 0;
+
+    if (mode == 6) {
+        for (int c = 0; c < 4; c++) {
+            endpoints[0][c] = reader.read(7);
+            endpoints[1][c] = reader.read(7);
+        }
+        for (int e = 0; e < 2; e++) {
+            const uint32_t pbit = reader.read(1);
+            for (int c = 0; c < 4; c++) {
+                endpoints[e][c] = endpoints[e][c] << 1 | pbit;
+            }
+        }
+
+        uint32_t indices[16];
+        readIndices(reader, 4, indices);
+        for (int i = 0; i < 16; i++) {
+            for (int c = 0; c < 4; c++) {
+                texels[i * 4 + c] = interpolate(endpoints[0][c], endpoints[1][c], BC7_WEIGHTS4[indices[i]]);
+            }
+        }
+        return;
+    }
+
+    // Modes 4 and 5: color and alpha have separate endpoints and index sets.
+    rotation = reader.read(2);
+    if (mode == 4) {
+        indexSelection = reader.read(1);
+    }
+
+    const uint32_t colorBits = mode == 4 ? 5 : 7;
+    const uint32_t alphaBits = mode == 4 ? 6 : 8;
+    for (int c = 0; c < 3; c++) {
+        for (int e = 0; e < 2; e++) {
+            const uint32_t value = reader.read(colorBits);
+            endpoints[e][c] = value << (8 - colorBits) | value >> (2 * colorBits - 8);
+        }
+    }
+    for (int e = 0; e < 2; e++) {
+        const uint32_t value = reader.read(alphaBits);
+        endpoints[e][3] = alphaBits == 8 ? value : (value << 2 | value >> 4);
+    }
+
+    uint32_t primary[16];
+    uint32_t secondary[16];
+    readIndices(reader, 2, primary);
+    readIndices(reader, mode == 4 ? 3 : 2, secondary);
+
+    const uint8_t* primaryWeights = BC7_WEIGHTS2;
+    const uint8_t* secondaryWeights = mode == 4 ? BC7_WEIGHTS3 : BC7_WEIGHTS2;
+
+    for (int i = 0; i < 16; i++) {
+        uint32_t colorWeight = primaryWeights[primary[i]];
+        uint32_t alphaWeight = secondaryWeights[secondary[i]];
+        if (indexSelection) {
+            colorWeight = secondaryWeights[secondary[i]];
+            alphaWeight = primaryWeights[primary[i]];
+        }
+
+        uint8_t* texel = texels + i * 4;
+        for (int c = 0; c < 3; c++) {
+            texel[c] = interpolate(endpoints[0][c], endpoints[1][c], colorWeight);
+        }
+        texel[3] = interpolate(endpoints[0][3], endpoints[1][3], alphaWeight);
+
+        if (rotation != 0) {
+            std::swap(texel[3], texel[rotation - 1]);
+        }
+    }
+}
+
+} // namespace
+
+
+
+// Texture Formats ----------------------------------------------------------------------------------------
+TextureFormatInfo getTextureFormatInfo(TextureFormat format)
+{
+    switch (format) {
+    case TextureFormat::BC1: return { 4, 4, 8 };
+    case TextureFormat::BC3: return { 4, 4, 16 };
+    case TextureFormat::BC4: return { 4, 4, 8 };
+    case TextureFormat::BC7: return { 4, 4, 16 };
+    case TextureFormat::RGBA8:
+    default:
+        return { 1, 1, 4 };
+    }
+}
+
+VkFormat getVkFormat(TextureFormat format, bool srgb)
+{
+    switch (format) {
+    case TextureFormat::BC1: return srgb ? VK_FORMAT_BC1_RGBA_SRGB_BLOCK : VK_FORMAT_BC1_RGBA_UNORM_BLOCK;
+    case TextureFormat::BC3: return srgb ? VK_FORMAT_BC3_SRGB_BLOCK : VK_FORMAT_BC3_UNORM_BLOCK;
+    case TextureFormat::BC4: return VK_FORMAT_BC4_UNORM_BLOCK;
+    case TextureFormat::BC7: return srgb ? VK_FORMAT_BC7_SRGB_BLOCK : VK_FORMAT_BC7_UNORM_BLOCK;
+    case TextureFormat::RGBA8:
+    default:
+        return srgb ? VK_FORMAT_R8G8B8A8_SRGB : VK_FORMAT_R8G8B8A8_UNORM;
+    }
+}
+
+size_t getTextureLevelSize(TextureFormat format, uint32_t width, uint32_t height)
+{
+    const TextureFormatInfo info = getTextureFormatInfo(format);
+    const size_t blocksWide = (width + info.blockWidth - 1) / info.blockWidth;
+    const size_t blocksHigh = (height + info.blockHeight - 1) / info.blockHeight;
+    return blocksWide * blocksHigh * info.bytesPerBlock;
+}
+
+
+
+// Parse DDS ----------------------------------------------------------------------------------------
+TextureData parseDds(std::span<const std::byte> file)
+{
+    if (readStruct<uint32_t>(file, 0) != DDS_MAGIC) {
+        throw std::runtime_error("failed to parse DDS texture: bad magic!");
+    }
+
+    const DdsHeader header = readStruct<DdsHeader>(file, 4);
+    size_t offset = 4 + sizeof(DdsHeader);
+
+    TextureData texture;
+    texture.width = header.width;
+    texture.height = header.height;
+
+    const DdsPixelFormat& pixelFormat = header.pixelFormat;
+    bool known = true;
+
+    if ((pixelFormat.flags & DDPF_FOURCC) && pixelFormat.fourCC == fourCC('D', 'X', '1', '0')) {
+        const DdsHeaderDx10 dx10 = readStruct<DdsHeaderDx10>(file, offset);
+        offset += sizeof(DdsHeaderDx10);
+
+        if (dx10.arraySize > 1 || dx10.resourceDimension != 3) {
+            throw std::runtime_error("failed to parse DDS texture: only single 2D textures are supported!");
+        }
+
+        auto it = std::find_if(std::begin(DXGI_FORMATS), std::end(DXGI_FORMATS), [&](const DxgiFormat& format) { return format.dxgi == dx10.dxgiFormat; });
+        known = it != std::end(DXGI_FORMATS);
+        if (known) {
+            texture.format = it->format;
+            texture.srgb = it->srgb;
+        }
+    }
+    else if (pixelFormat.flags & DDPF_FOURCC) {
+        switch (pixelFormat.fourCC) {
+        case fourCC('D', 'X', 'T', '1'): texture.format = TextureFormat::BC1; break;
+        case fourCC('D', 'X', 'T', '5'): texture.format = TextureFormat::BC3; break;
+        case fourCC('A', 'T', 'I', '1'):
+        case fourCC('B', 'C', '4', 'U'): texture.format = TextureFormat::BC4; break;
+        default: known = false; break;
+        }
+    }
+    else {
+        known = (pixelFormat.flags & DDPF_RGB) && pixelFormat.rgbBitCount == 32
+            && pixelFormat.masks[0] == 0x000000ff && pixelFormat.masks[1] == 0x0000ff00 && pixelFormat.masks[2] == 0x00ff0000;
+    }
+
+    if (!known) {
+        throw std::runtime_error("failed to parse DDS texture: unsupported format!");
+    }
+    if (texture.width == 0 || texture.height == 0) {
+        throw std::runtime_error("failed to parse DDS texture: empty image!");
+    }
+
+    const uint32_t levelCount = std::max(1u, header.mipMapCount);
+    uint32_t width = texture.width;
+    uint32_t height = texture.height;
+    for (uint32_t level = 0; level < levelCount; level++) {
+        const size_t size = getTextureLevelSize(texture.format, width, height);
+        if (offset + size > file.size()) {
+            throw std::runtime_error("failed to parse DDS texture: file is truncated!");
+        }
+
+        texture.levels.push_back({ reinterpret_cast<const uint8_t*>(file.data()) + offset, size });
+        offset += size;
+        width = std::max(1u, width / 2);
+        height = std::max(1u, height / 2);
+    }
+
+    return texture;
+}
+
+
+
+// Decode ----------------------------------------------------------------------------------------
+void decodeTextureLevel(TextureFormat format, std::span<const uint8_t> blocks, uint32_t width, uint32_t height, uint8_t* rgba)
+{
+    if (format == TextureFormat::RGBA8) {
+        std::memcpy(rgba, blocks.data(), size_t(width) * height * 4);
+        return;
+    }
+
+    const TextureFormatInfo info = getTextureFormatInfo(format);
+    const uint32_t blocksWide = (width + 3) / 4;
+    const uint32_t blocksHigh = (height + 3) / 4;
+
+    uint8_t texels[16 * 4];
+    for (uint32_t by = 0; by < blocksHigh; by++) {
+        for (uint32_t bx = 0; bx < blocksWide; bx++) {
+            const uint8_t* block = blocks.data() + (size_t(by) * blocksWide + bx) * info.bytesPerBlock;
+
+            switch (format) {
+            case TextureFormat::BC1:
+                decodeBc1(block, texels, false);
+                break;
+            case TextureFormat::BC3:
+                decodeBc1(block + 8, texels, true);
+                decodeBc4(block, texels, 3);
+                break;
+            case TextureFormat::BC4:
+                decodeBc4(block, texels, 0);
+                for (int i = 0; i < 16; i++) {
+                    texels[i * 4 + 1] = texels[i * 4 + 2] = texels[i * 4];
+                    texels[i * 4 + 3] = 255;
+                }
+                break;
+            case TextureFormat::BC7:
+            default:
+                decodeBc7(block, texels);
+                break;
+            }
+
+            // Edge blocks hang over the image; only copy the texels inside it.
+            const uint32_t rows = std::min(4u, height - by * 4);
+            const uint32_t columns = std::min(4u, width - bx * 4);
+            for (uint32_t y = 0; y < rows; y++) {
+                std::memcpy(rgba + ((size_t(by) * 4 + y) * width + bx * 4) * 4, texels + y * 16, columns * 4);
+            }
+        }
+    }
+}
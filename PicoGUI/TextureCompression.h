@@ -0,0 +1,53 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+
+//  Texture Formats -------------------------------------------------------------------------------
+enum class TextureFormat : uint32_t {
+    RGBA8,
+    BC1,        // RGB with 1-bit alpha, 8 bytes per 4x4 block
+    BC3,        // RGBA, BC4 alpha + BC1 color, 16 bytes per block
+    BC4,        // one channel, 8 bytes per block
+    BC7,        // RGBA, 16 bytes per block
+};
+
+struct TextureFormatInfo {
+    uint32_t blockWidth;
+    uint32_t blockHeight;
+    uint32_t bytesPerBlock;
+};
+
+TextureFormatInfo getTextureFormatInfo(TextureFormat format);
+VkFormat getVkFormat(TextureFormat format, bool srgb);
+
+// Bytes of one mip level of a width x height texture.
+size_t getTextureLevelSize(TextureFormat format, uint32_t width, uint32_t height);
+
+
+
+//  DDS Files -------------------------------------------------------------------------------------
+// A texture in memory; levels point into the parsed file, largest first.
+struct TextureData {
+    TextureFormat format = TextureFormat::RGBA8;
+    bool srgb = false;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    std::vector<std::span<const uint8_t>> levels;
+};
+
+// Reads 2D DDS files as written by tools/encode_textures.py, plus the legacy DXT1, DXT5, ATI1 and
+// 32-bit RGBA headers. Throws on anything else.
+TextureData parseDds(std::span<const std::byte> file);
+
+
+
+//  Block Decoders --------------------------------------------------------------------------------
+// Decodes one mip level to tightly packed RGBA8, for devices that cannot sample the compressed
+// format. BC4 decodes to gray with opaque alpha. BC7 blocks in the single-subset modes 4, 5 and 6
+// are decoded; blocks in the partitioned modes come out magenta.
+void decodeTextureLevel(TextureFormat format, std::span<const uint8_t> blocks, uint32_t width, uint32_t height, uint8_t* rgba);
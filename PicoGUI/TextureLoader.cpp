@@ -0,0 +1,231 @@
+#include "TextureLoader.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+
+// Init / Cleanup ----------------------------------------------------------------------------------------
+void TextureLoader::init(VkPhysicalDevice physicalDevice, VkDevice device, const AssetLoader& assets, GpuAllocator& gpuAllocator,
+                         TransferQueue& transfers, DeletionQueue& deletionQueue, bool textureCompressionBC, const VkAllocationCallbacks* allocator)
+{
+    this->physicalDevice = physicalDevice;
+    this->device = device;
+    this->allocator = allocator;
+    this->assets = &assets;
+    this->gpuAllocator = &gpuAllocator;
+    this->transfers = &transfers;
+    this->deletionQueue = &deletionQueue;
+    this->textureCompressionBC = textureCompressionBC;
+}
+
+void TextureLoader::cleanup()
+{
+    // The device is idle by now, and the deletion queue already drained.
+    for (ParkedTexture& parkedTexture : parked) {
+        vkDestroyImageView(device, parkedTexture.texture.imageView, allocator);
+        gpuAllocator->destroyImage(parkedTexture.texture.image, parkedTexture.texture.allocation);
+    }
+    for (auto& [name, cached] : cache) {
+        vkDestroyImageView(device, cached.texture.imageView, allocator);
+        gpuAllocator->destroyImage(cached.texture.image, cached.texture.allocation);
+    }
+    parked.clear();
+    cache.clear();
+    pending.clear();
+}
+
+bool TextureLoader::isSupported(TextureFormat format, bool srgb) const
+{
+    if (format != TextureFormat::RGBA8 && !textureCompressionBC) {
+        return false;
+    }
+
+    VkFormatProperties properties;
+    vkGetPhysicalDeviceFormatProperties(physicalDevice, getVkFormat(format, srgb), &properties);
+
+    const VkFormatFeatureFlags required = VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT | VK_FORMAT_FEATURE_TRANSFER_DST_BIT;
+    return (properties.optimalTilingFeatures & required) == required;
+}
+
+
+
+// Load ----------------------------------------------------------------------------------------
+Texture TextureLoader::load(Asset asset)
+{
+    const TextureData data = parseDds(asset.bytes());
+
+    Texture texture;
+    texture.extent = { data.width, data.height };
+    texture.levels = static_cast<uint32_t>(data.levels.size());
+    texture.format = isSupported(data.format, data.srgb) ? data.format : TextureFormat::RGBA8;
+
+    PendingUpload upload{ 0, std::move(asset), {} };
+
+    // The fallback decodes every level into one buffer, kept alive until the upload completes.
+    std::vector<std::span<const uint8_t>> levels = data.levels;
+    if (texture.format != data.format) {
+        size_t total = 0;
+        for (uint32_t level = 0; level < texture.levels; level++) {
+            total += getTextureLevelSize(TextureFormat::RGBA8, std::max(1u, data.width >> level), std::max(1u, data.height >> level));
+        }
+        upload.decoded.resize(total);
+
+        size_t offset = 0;
+        for (uint32_t level = 0; level < texture.levels; level++) {
+            const uint32_t width = std::max(1u, data.width >> level);
+            const uint32_t height = std::max(1u, data.height >> level);
+            const size_t size = getTextureLevelSize(TextureFormat::RGBA8, width, height);
+
+            decodeTextureLevel(data.format, data.levels[level], width, height, upload.decoded.data() + offset);
+            levels[level] = { upload.decoded.data() + offset, size };
+            offset += size;
+        }
+        stats.decoded++;
+    }
+    else if (texture.format != TextureFormat::RGBA8) {
+        stats.compressed++;
+    }
+
+    VkImageCreateInfo imageInfo{};
+    imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    imageInfo.imageType = VK_IMAGE_TYPE_2D;
+    imageInfo.format = getVkFormat(texture.format, data.srgb);
+    imageInfo.extent = { data.width, data.height, 1 };
+    imageInfo.mipLevels = texture.levels;
+    imageInfo.arrayLayers = 1;
+    imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+    imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+    imageInfo.usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+    imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+    GpuAllocationInfo memoryInfo;
+    memoryInfo.requiredFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+
+    texture.image = gpuAllocator->createImage(imageInfo, memoryInfo, texture.allocation);
+
+    VkImageViewCreateInfo viewInfo{};
+    viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    viewInfo.image = texture.image;
+    viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+    viewInfo.format = imageInfo.format;
+    viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    viewInfo.subresourceRange.levelCount = texture.levels;
+    viewInfo.subresourceRange.layerCount = 1;
+
+    if (vkCreateImageView(device, &viewInfo, allocator, &texture.imageView) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create texture image view!");
+    }
+
+    const TextureFormatInfo formatInfo = getTextureFormatInfo(texture.format);
+    for (uint32_t level = 0; level < texture.levels; level++) {
+        ImageUpload imageUpload;
+        imageUpload.image = texture.image;
+        imageUpload.extent = { std::max(1u, data.width >> level), std::max(1u, data.height >> level) };
+        imageUpload.mipLevel = level;
+        imageUpload.blockWidth = formatInfo.blockWidth;
+        imageUpload.blockHeight = formatInfo.blockHeight;
+        imageUpload.bytesPerBlock = formatInfo.bytesPerBlock;
+        imageUpload.data = levels[level];
+
+        texture.ticket = transfers->upload(imageUpload);
+        stats.uploadBytes += levels[level].size();
+    }
+
+    upload.ticket = texture.ticket;
+    pending.push_back(std::move(upload));
+    return texture;
+}
+
+void TextureLoader::destroy(Texture& texture)
+{
+    if (!isReady(texture)) {
+        // The transfer queue may still copy into the image, from the sources in pending.
+        auto it = std::find_if(pending.begin(), pending.end(), [&](const PendingUpload& upload) { return upload.ticket == texture.ticket; });
+        ParkedTexture parkedTexture{ texture, {} };
+        if (it != pending.end()) {
+            parkedTexture.upload = std::move(*it);
+            pending.erase(it);
+        }
+        parked.push_back(std::move(parkedTexture));
+        texture = Texture{};
+        return;
+    }
+
+    deletionQueue->destroyImageView(texture.imageView, allocator);
+    deletionQueue->destroyImage(texture.image, texture.allocation);
+    texture = Texture{};
+}
+
+
+
+// Cache ----------------------------------------------------------------------------------------
+const Texture* TextureLoader::acquire(const std::string& name)
+{
+    auto it = cache.find(name);
+    if (it == cache.end()) {
+        it = cache.emplace(name, CachedTexture{ load(assets->load(name)) }).first;
+        stats.cached = static_cast<uint32_t>(cache.size());
+    }
+
+    it->second.lastUsed = deletionQueue->getFrameNumber();
+    return isReady(it->second.texture) ? &it->second.texture : nullptr;
+}
+
+// Evicted images go through the deletion queue, so their memory returns to GpuAllocator once the
+// frames that last sampled them are done, and to the driver when its empty blocks are trimmed.
+VkDeviceSize TextureLoader::trim(uint32_t heapIndex, VkDeviceSize bytes)
+{
+    const VkPhysicalDeviceMemoryProperties& memoryProperties = gpuAllocator->getMemoryProperties();
+    const uint64_t frameNumber = deletionQueue->getFrameNumber();
+
+    // Textures acquired last frame are likely on screen; evicting them would only load them again.
+    std::vector<decltype(cache)::iterator> candidates;
+    for (auto it = cache.begin(); it != cache.end(); ++it) {
+        const CachedTexture& cached = it->second;
+        if (cached.lastUsed + 1 < frameNumber && isReady(cached.texture)
+            && memoryProperties.memoryTypes[cached.texture.allocation.memoryType].heapIndex == heapIndex) {
+            candidates.push_back(it);
+        }
+    }
+    std::sort(candidates.begin(), candidates.end(), [](const auto& a, const auto& b) {
+        return a->second.lastUsed < b->second.lastUsed;
+    });
+
+    VkDeviceSize released = 0;
+    for (auto it : candidates) {
+        if (released >= bytes) {
+            break;
+        }
+
+        CachedTexture& cached = it->second;
+        released += cached.texture.allocation.size;
+        deletionQueue->destroyImageView(cached.texture.imageView, allocator, cached.lastUsed);
+        deletionQueue->destroyImage(cached.texture.image, cached.texture.allocation, cached.lastUsed);
+        cache.erase(it);
+        stats.evictions++;
+    }
+
+    stats.cached = static_cast<uint32_t>(cache.size());
+    return released;
+}
+
+
+
+// Begin Frame ----------------------------------------------------------------------------------------
+void TextureLoader::beginFrame()
+{
+    while (!pending.empty() && transfers->isComplete(pending.front().ticket)) {
+        pending.pop_front();
+    }
+
+    auto parkedEnd = std::remove_if(parked.begin(), parked.end(), [&](ParkedTexture& parkedTexture) {
+        if (!isReady(parkedTexture.texture)) {
+            return false;
+        }
+        deletionQueue->destroyImageView(parkedTexture.texture.imageView, allocator);
+        deletionQueue->destroyImage(parkedTexture.texture.image, parkedTexture.texture.allocation);
+        return true;
+    });
+    parked.erase(parkedEnd, parked.end());
+}
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "AssetPack.h"
+#include "DeletionQueue.h"
+#include "GpuAllocator.h"
+#include "TextureCompression.h"
+#include "TransferQueue.h"
+
+
+//  Texture ---------------------------------------------------------------------------------------
+struct Texture {
+    VkImage image = VK_NULL_HANDLE;
+    VkImageView imageView = VK_NULL_HANDLE;
+    GpuAllocation allocation;
+    VkExtent2D extent{};
+    uint32_t levels = 0;
+    TextureFormat format = TextureFormat::RGBA8;    // as stored on the GPU
+    uint64_t ticket = 0;                            // transfer ticket of the last level
+};
+
+
+
+//  CLASS #########################################################################################
+// Creates sampled images from DDS assets. Block-compressed levels are copied into the image as
+// they are, through the TransferQueue, so a BC7 or BC3 texture costs a quarter of its RGBA8 size
+// in memory and upload bandwidth, and BC1 and BC4 an eighth.
+//
+// Formats the device cannot sample with linear filtering are decoded to RGBA8 on the CPU first.
+// The asset, and any decoded copy, is kept until its upload completes. A texture destroyed before
+// then is parked with them, and destroyed once the transfer queue is done with it.
+//
+// Textures can also be shared by asset name through acquire(), which keeps them in a cache that
+// MemoryBudget can trim: under memory pressure the textures acquired longest ago are evicted, and
+// loaded again when they are next acquired.
+class TextureLoader
+{
+
+ // Public ----------------------------------------------------------------------------------------
+public:
+    struct Stats {
+        uint32_t compressed = 0;        // textures uploaded in their block-compressed format
+        uint32_t decoded = 0;           // textures decoded to RGBA8 first
+        uint64_t uploadBytes = 0;
+        uint32_t cached = 0;            // textures in the acquire() cache
+        uint64_t evictions = 0;
+    };
+
+    void init(VkPhysicalDevice physicalDevice, VkDevice device, const AssetLoader& assets, GpuAllocator& gpuAllocator,
+              TransferQueue& transfers, DeletionQueue& deletionQueue, bool textureCompressionBC, const VkAllocationCallbacks* allocator = nullptr);
+    void cleanup();
+
+    bool isSupported(TextureFormat format, bool srgb) const;
+
+    Texture load(Asset asset);
+    void destroy(Texture& texture);
+
+    bool isReady(const Texture& texture) const { return transfers->isComplete(texture.ticket); }
+
+    // The cached texture of the asset, loaded on first use; null until it is uploaded. The pointer
+    // is valid until the next trim().
+    const Texture* acquire(const std::string& name);
+    // Evicts cached textures on the heap that were not acquired last frame, least recently acquired
+    // first, until at least bytes are released. Returns what was released.
+    VkDeviceSize trim(uint32_t heapIndex, VkDeviceSize bytes);
+
+    // Call once per frame after TransferQueue::beginFrame(); drops the sources of finished uploads
+    // and destroys the textures parked until then.
+    void beginFrame();
+
+    const Stats& getStats() const { return stats; }
+
+
+ // Private ----------------------------------------------------------------------------------------
+private:
+    struct PendingUpload {
+        uint64_t ticket;
+        Asset asset;
+        std::vector<uint8_t> decoded;
+    };
+
+    struct ParkedTexture {
+        Texture texture;
+        PendingUpload upload;
+    };
+
+    struct CachedTexture {
+        Texture texture;
+        uint64_t lastUsed = 0;          // frame number of the last acquire()
+    };
+
+    VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
+    VkDevice device = VK_NULL_HANDLE;
+    const VkAllocationCallbacks* allocator = nullptr;
+    const AssetLoader* assets = nullptr;
+    GpuAllocator* gpuAllocator = nullptr;
+    TransferQueue* transfers = nullptr;
+    DeletionQueue* deletionQueue = nullptr;
+    bool textureCompressionBC = false;
+
+    std::deque<PendingUpload> pending;  // in ticket order
+    std::vector<ParkedTexture> parked;  // destroyed while uploading
+    std::unordered_map<std::string, CachedTexture> cache;
+    Stats stats;
+};
@@ -0,0 +1,464 @@
+#include "TransferQueue.h"
+
+#include <algorithm>
+#include <cstring>
+#include <numeric>
+#include <stdexcept>
+
+
+namespace {
+
+VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment)
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+VkImageSubresourceRange subresourceRange(const ImageUpload& upload)
+{
+    VkImageSubresourceRange range{};
+    range.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    range.baseMipLevel = upload.mipLevel;
+    range.levelCount = 1;
+    range.baseArrayLayer = upload.arrayLayer;
+    range.layerCount = 1;
+    return range;
+}
+
+} // namespace
+
+
+
+// Init / Cleanup ----------------------------------------------------------------------------------------
+void TransferQueue::init(VkDevice device, GpuAllocator& gpuAllocator, uint32_t transferFamily, VkQueue transferQueue, uint32_t graphicsFamily,
+                         uint32_t framesInFlight, const GpuAllocationInfo& stagingMemory, VkDeviceSize stagingSize, VkDeviceSize bytesPerFrame,
+                         const VkAllocationCallbacks* allocator)
+{
+    this->device = device;
+    this->allocator = allocator;
+    this->gpuAllocator = &gpuAllocator;
+    this->transferFamily = transferFamily;
+    this->graphicsFamily = graphicsFamily;
+    this->queue = transferQueue;
+    this->framesInFlight = framesInFlight;
+    this->stagingSize = stagingSize;
+    this->bytesPerFrame = bytesPerFrame;
+    stats.dedicatedQueue = ownershipTransfer();
+
+    VkCommandPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT | VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+    poolInfo.queueFamilyIndex = transferFamily;
+
+    if (vkCreateCommandPool(device, &poolInfo, allocator, &commandPool) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create transfer command pool!");
+    }
+
+    // A batch can be waited on by a frame in flight while the next frames submit their own.
+    batches.resize(framesInFlight + 2);
+
+    VkSemaphoreCreateInfo semaphoreInfo{};
+    semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+
+    VkFenceCreateInfo fenceInfo{};
+    fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+
+    for (Batch& batch : batches) {
+        VkCommandBufferAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocInfo.commandPool = commandPool;
+        allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        allocInfo.commandBufferCount = 1;
+
+        if (vkAllocateCommandBuffers(device, &allocInfo, &batch.commandBuffer) != VK_SUCCESS ||
+            vkCreateSemaphore(device, &semaphoreInfo, allocator, &batch.semaphore) != VK_SUCCESS ||
+            vkCreateFence(device, &fenceInfo, allocator, &batch.fence) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create transfer batch!");
+        }
+    }
+
+    // Staging writes are never flushed. Host-coherent, host-visible memory is guaranteed to exist.
+    if ((stagingMemory.requiredFlags & (VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT))
+        != (VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT)) {
+        throw std::runtime_error("staging memory must be host-visible and host-coherent!");
+    }
+
+    VkBufferCreateInfo bufferInfo{};
+    bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferInfo.size = stagingSize;
+    bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+    bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    stagingBuffer = gpuAllocator.createBuffer(bufferInfo, stagingMemory, stagingAllocation);
+}
+
+void TransferQueue::cleanup()
+{
+    for (Batch& batch : batches) {
+        vkDestroyFence(device, batch.fence, allocator);
+        vkDestroySemaphore(device, batch.semaphore, allocator);
+    }
+    batches.clear();
+    inFlightBatches.clear();
+
+    vkDestroyCommandPool(device, commandPool, allocator);
+
+    if (stagingBuffer != VK_NULL_HANDLE) {
+        gpuAllocator->destroyBuffer(stagingBuffer, stagingAllocation);
+        stagingBuffer = VK_NULL_HANDLE;
+    }
+
+    jobs.clear();
+    pendingAcquires.clear();
+}
+
+
+
+// Upload ----------------------------------------------------------------------------------------
+uint64_t TransferQueue::upload(const BufferUpload& upload)
+{
+    if (upload.data.empty()) {
+        throw std::runtime_error("buffer upload is empty!");
+    }
+
+    Job job{};
+    job.ticket = nextTicket++;
+    job.isImage = false;
+    job.buffer = upload;
+    jobs.push_back(job);
+    return job.ticket;
+}
+
+uint64_t TransferQueue::upload(const ImageUpload& upload)
+{
+    const uint64_t blocksWide = (upload.extent.width + upload.blockWidth - 1) / upload.blockWidth;
+    const uint64_t blocksHigh = (upload.extent.height + upload.blockHeight - 1) / upload.blockHeight;
+    if (blocksWide * blocksHigh == 0 || upload.data.size() < blocksWide * blocksHigh * upload.bytesPerBlock) {
+        throw std::runtime_error("image upload data does not match its extent!");
+    }
+
+    Job job{};
+    job.ticket = nextTicket++;
+    job.isImage = true;
+    job.image = upload;
+    jobs.push_back(job);
+    return job.ticket;
+}
+
+
+
+// Begin Frame ----------------------------------------------------------------------------------------
+void TransferQueue::beginFrame(uint64_t frameNumber)
+{
+    this->frameNumber = frameNumber;
+    retireBatches();
+}
+
+void TransferQueue::retireBatches()
+{
+    // Batches complete in submission order; never block on one.
+    while (!inFlightBatches.empty()) {
+        Batch& batch = batches[inFlightBatches.front()];
+        if (vkGetFenceStatus(device, batch.fence) != VK_SUCCESS) {
+            break;
+        }
+
+        // The frame that waited on the semaphore has to be finished before it can be signaled again.
+        if (batch.signaled && batch.frameNumber + framesInFlight > frameNumber) {
+            break;
+        }
+
+        stagingUsed -= batch.stagingBytes;
+        batch.inFlight = false;
+        inFlightBatches.pop_front();
+    }
+
+    if (stagingUsed == 0) {
+        stagingHead = 0;
+    }
+}
+
+
+
+// Submit ----------------------------------------------------------------------------------------
+TransferQueue::Submission TransferQueue::submit()
+{
+    Submission submission;
+    if (jobs.empty()) {
+        return submission;
+    }
+
+    auto freeBatch = std::find_if(batches.begin(), batches.end(), [](const Batch& batch) { return !batch.inFlight; });
+    if (freeBatch == batches.end()) {
+        stats.framesDeferred++;
+        return submission;
+    }
+    Batch& batch = *freeBatch;
+
+    vkResetCommandBuffer(batch.commandBuffer, 0);
+
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+    if (vkBeginCommandBuffer(batch.commandBuffer, &beginInfo) != VK_SUCCESS) {
+        throw std::runtime_error("failed to begin recording transfer command buffer!");
+    }
+
+    VkDeviceSize budget = bytesPerFrame;
+    VkDeviceSize batchBytes = 0;
+    size_t releasedBefore = pendingAcquires.size();
+
+    while (!jobs.empty() && budget > 0) {
+        Job& job = jobs.front();
+        if (!recordJob(job, batch.commandBuffer, budget, batchBytes)) {
+            break;
+        }
+
+        recordRelease(job, batch.commandBuffer);
+        pendingAcquires.push_back({ job.ticket, job.isImage, job.buffer, job.image });
+        submission.waitStageMask |= job.isImage ? job.image.dstStageMask : job.buffer.dstStageMask;
+        jobs.pop_front();
+    }
+
+    if (vkEndCommandBuffer(batch.commandBuffer) != VK_SUCCESS) {
+        throw std::runtime_error("failed to record transfer command buffer!");
+    }
+
+    if (batchBytes == 0) {
+        stats.framesDeferred++;
+        return submission;
+    }
+
+    // Only batches that finish a resource signal the render frame; partial slices just keep going.
+    const bool signal = pendingAcquires.size() > releasedBefore;
+
+    VkSubmitInfo submitInfo{};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &batch.commandBuffer;
+    submitInfo.signalSemaphoreCount = signal ? 1 : 0;
+    submitInfo.pSignalSemaphores = &batch.semaphore;
+
+    vkResetFences(device, 1, &batch.fence);
+    if (vkQueueSubmit(queue, 1, &submitInfo, batch.fence) != VK_SUCCESS) {
+        throw std::runtime_error("failed to submit transfer command buffer!");
+    }
+
+    batch.stagingBytes = batchBytes;
+    batch.frameNumber = frameNumber;
+    batch.signaled = signal;
+    batch.inFlight = true;
+    inFlightBatches.push_back(static_cast<uint32_t>(&batch - batches.data()));
+
+    stats.bytesUploaded += bytesPerFrame - budget;
+    stats.batchesSubmitted++;
+
+    if (signal) {
+        submission.semaphore = batch.semaphore;
+    }
+    return submission;
+}
+
+
+
+// Record Job ----------------------------------------------------------------------------------------
+// Copies as much of job as the budget and staging space allow. Returns true once the whole job
+// has been recorded.
+bool TransferQueue::recordJob(Job& job, VkCommandBuffer commandBuffer, VkDeviceSize& budget, VkDeviceSize& batchBytes)
+{
+    // Keep single slices well below the ring size so the ring never deadlocks on one job.
+    auto maxSlice = [&]() { return std::min(budget, stagingSize / 4); };
+
+    if (!job.isImage) {
+        const BufferUpload& upload = job.buffer;
+
+        while (job.progress < upload.data.size()) {
+            const VkDeviceSize size = std::min<VkDeviceSize>(upload.data.size() - job.progress, std::max<VkDeviceSize>(maxSlice(), 1));
+
+            VkDeviceSize stagingOffset, consumed;
+            if (budget == 0 || !allocateStaging(size, 16, stagingOffset, consumed)) {
+                return false;
+            }
+            memcpy(static_cast<char*>(stagingAllocation.mapped) + stagingOffset, upload.data.data() + job.progress, size);
+
+            VkBufferCopy region{};
+            region.srcOffset = stagingOffset;
+            region.dstOffset = upload.offset + job.progress;
+            region.size = size;
+            vkCmdCopyBuffer(commandBuffer, stagingBuffer, upload.buffer, 1, &region);
+
+            job.progress += size;
+            budget -= std::min(budget, size);
+            batchBytes += consumed;
+        }
+        return true;
+    }
+
+    const ImageUpload& upload = job.image;
+    const uint32_t blocksWide = (upload.extent.width + upload.blockWidth - 1) / upload.blockWidth;
+    const uint32_t blocksHigh = (upload.extent.height + upload.blockHeight - 1) / upload.blockHeight;
+    const VkDeviceSize rowPitch = VkDeviceSize(blocksWide) * upload.bytesPerBlock;
+
+    // bufferOffset must be a multiple of both 4 and the texel block size.
+    const VkDeviceSize alignment = std::lcm<VkDeviceSize>(upload.bytesPerBlock, 4);
+
+    if (job.progress == 0) {
+        VkImageMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        barrier.srcAccessMask = 0;
+        barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.image = upload.image;
+        barrier.subresourceRange = subresourceRange(upload);
+
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                             0, 0, nullptr, 0, nullptr, 1, &barrier);
+    }
+
+    while (job.progress < blocksHigh) {
+        const uint32_t rows = static_cast<uint32_t>(std::min<VkDeviceSize>(blocksHigh - job.progress, std::max<VkDeviceSize>(maxSlice() / rowPitch, 1)));
+        const VkDeviceSize size = rows * rowPitch;
+
+        VkDeviceSize stagingOffset, consumed;
+        if (budget == 0 || !allocateStaging(size, alignment, stagingOffset, consumed)) {
+            return false;
+        }
+        memcpy(static_cast<char*>(stagingAllocation.mapped) + stagingOffset, upload.data.data() + job.progress * rowPitch, size);
+
+        const uint32_t firstRow = static_cast<uint32_t>(job.progress);
+
+        VkBufferImageCopy region{};
+        region.bufferOffset = stagingOffset;
+        region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        region.imageSubresource.mipLevel = upload.mipLevel;
+        region.imageSubresource.baseArrayLayer = upload.arrayLayer;
+        region.imageSubresource.layerCount = 1;
+        region.imageOffset = { 0, static_cast<int32_t>(firstRow * upload.blockHeight), 0 };
+        region.imageExtent = { upload.extent.width, std::min(rows * upload.blockHeight, upload.extent.height - firstRow * upload.blockHeight), 1 };
+        vkCmdCopyBufferToImage(commandBuffer, stagingBuffer, upload.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+
+        job.progress += rows;
+        budget -= std::min(budget, size);
+        batchBytes += consumed;
+    }
+    return true;
+}
+
+void TransferQueue::recordRelease(const Job& job, VkCommandBuffer commandBuffer)
+{
+    // Without a dedicated family this is the final barrier; with one it is the release half of
+    // the queue family ownership transfer, and recordAcquires() records the matching acquire.
+    const uint32_t srcFamily = ownershipTransfer() ? transferFamily : VK_QUEUE_FAMILY_IGNORED;
+    const uint32_t dstFamily = ownershipTransfer() ? graphicsFamily : VK_QUEUE_FAMILY_IGNORED;
+
+    if (job.isImage) {
+        VkImageMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = 0;
+        barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        barrier.newLayout = job.image.finalLayout;
+        barrier.srcQueueFamilyIndex = srcFamily;
+        barrier.dstQueueFamilyIndex = dstFamily;
+        barrier.image = job.image.image;
+        barrier.subresourceRange = subresourceRange(job.image);
+
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+                             0, 0, nullptr, 0, nullptr, 1, &barrier);
+    }
+    else if (ownershipTransfer()) {
+        VkBufferMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = 0;
+        barrier.srcQueueFamilyIndex = srcFamily;
+        barrier.dstQueueFamilyIndex = dstFamily;
+        barrier.buffer = job.buffer.buffer;
+        barrier.offset = job.buffer.offset;
+        barrier.size = job.buffer.data.size();
+
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+                             0, 0, nullptr, 1, &barrier, 0, nullptr);
+    }
+}
+
+
+
+// Record Acquires ----------------------------------------------------------------------------------------
+void TransferQueue::recordAcquires(VkCommandBuffer commandBuffer)
+{
+    if (pendingAcquires.empty()) {
+        return;
+    }
+
+    // Same family: the semaphore wait already made the copies visible at the wait stage.
+    if (ownershipTransfer()) {
+        std::vector<VkImageMemoryBarrier> imageBarriers;
+        std::vector<VkBufferMemoryBarrier> bufferBarriers;
+        VkPipelineStageFlags dstStageMask = 0;
+
+        for (const Acquire& acquire : pendingAcquires) {
+            if (acquire.isImage) {
+                VkImageMemoryBarrier barrier{};
+                barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+                barrier.srcAccessMask = 0;
+                barrier.dstAccessMask = acquire.image.dstAccessMask;
+                barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+                barrier.newLayout = acquire.image.finalLayout;
+                barrier.srcQueueFamilyIndex = transferFamily;
+                barrier.dstQueueFamilyIndex = graphicsFamily;
+                barrier.image = acquire.image.image;
+                barrier.subresourceRange = subresourceRange(acquire.image);
+                imageBarriers.push_back(barrier);
+                dstStageMask |= acquire.image.dstStageMask;
+            }
+            else {
+                VkBufferMemoryBarrier barrier{};
+                barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+                barrier.srcAccessMask = 0;
+                barrier.dstAccessMask = acquire.buffer.dstAccessMask;
+                barrier.srcQueueFamilyIndex = transferFamily;
+                barrier.dstQueueFamilyIndex = graphicsFamily;
+                barrier.buffer = acquire.buffer.buffer;
+                barrier.offset = acquire.buffer.offset;
+                barrier.size = acquire.buffer.data.size();
+                bufferBarriers.push_back(barrier);
+                dstStageMask |= acquire.buffer.dstStageMask;
+            }
+        }
+
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, dstStageMask, 0, 0, nullptr,
+                             static_cast<uint32_t>(bufferBarriers.size()), bufferBarriers.data(),
+                             static_cast<uint32_t>(imageBarriers.size()), imageBarriers.data());
+    }
+
+    completedTicket = pendingAcquires.back().ticket;
+    pendingAcquires.clear();
+}
+
+
+
+// Staging Ring ----------------------------------------------------------------------------------------
+bool TransferQueue::allocateStaging(VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize& offset, VkDeviceSize& consumed)
+{
+    VkDeviceSize aligned = alignUp(stagingHead, alignment);
+    consumed = aligned - stagingHead + size;
+
+    // Wrap around, writing off the tail of the ring.
+    if (aligned + size > stagingSize) {
+        aligned = 0;
+        consumed = stagingSize - stagingHead + size;
+    }
+
+    if (stagingUsed + consumed > stagingSize) {
+        return false;
+    }
+
+    offset = aligned;
+    stagingHead = aligned + size;
+    stagingUsed += consumed;
+    return true;
+}
@@ -0,0 +1,148 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <cstdint>
+#include <deque>
+#include <span>
+#include <vector>
+
+#include "GpuAllocator.h"
+
+
+//  Uploads ---------------------------------------------------------------------------------------
+struct BufferUpload {
+    VkBuffer buffer = VK_NULL_HANDLE;
+    VkDeviceSize offset = 0;
+    std::span<const uint8_t> data;                  // must stay valid until the upload is complete
+
+    VkPipelineStageFlags dstStageMask = VK_PIPELINE_STAGE_VERTEX_INPUT_BIT;
+    VkAccessFlags dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT;
+};
+
+// Writes one mip level of one array layer. Block sizes describe compressed formats; leave them at
+// 1 x 1 for uncompressed ones.
+struct ImageUpload {
+    VkImage image = VK_NULL_HANDLE;
+    VkExtent2D extent{};
+    uint32_t mipLevel = 0;
+    uint32_t arrayLayer = 0;
+    uint32_t blockWidth = 1;
+    uint32_t blockHeight = 1;
+    uint32_t bytesPerBlock = 4;
+    std::span<const uint8_t> data;                  // tightly packed rows; must stay valid until complete
+
+    VkImageLayout finalLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    VkPipelineStageFlags dstStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+    VkAccessFlags dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+};
+
+
+
+//  CLASS #########################################################################################
+// Streams initial contents of new buffers and images through a staging ring, on a dedicated
+// transfer queue when the device has one, so large uploads never stall rendering.
+//
+// Each frame submit() copies at most bytesPerFrame, slicing big resources by rows, and returns a
+// semaphore for the frame's graphics submission to wait on. Resources whose last slice went out
+// are released to the graphics family and acquired by recordAcquires() in that same frame, after
+// which isComplete() reports them usable. A full staging ring defers work to later frames instead
+// of waiting.
+//
+// Uploads must target resources the graphics queue is not using yet; images start out in
+// VK_IMAGE_LAYOUT_UNDEFINED.
+class TransferQueue
+{
+
+ // Public ----------------------------------------------------------------------------------------
+public:
+    struct Submission {
+        VkSemaphore semaphore = VK_NULL_HANDLE;     // VK_NULL_HANDLE if nothing was submitted
+        VkPipelineStageFlags waitStageMask = 0;
+    };
+
+    struct Stats {
+        uint64_t bytesUploaded = 0;
+        uint64_t batchesSubmitted = 0;
+        uint64_t framesDeferred = 0;                // frames where the staging ring or batch pool was full
+        bool dedicatedQueue = false;
+    };
+
+    void init(VkDevice device, GpuAllocator& gpuAllocator, uint32_t transferFamily, VkQueue transferQueue, uint32_t graphicsFamily,
+              uint32_t framesInFlight, const GpuAllocationInfo& stagingMemory, VkDeviceSize stagingSize = 64ull << 20,
+              VkDeviceSize bytesPerFrame = 16ull << 20, const VkAllocationCallbacks* allocator = nullptr);
+    void cleanup();
+
+    // Returns a ticket for isComplete().
+    uint64_t upload(const BufferUpload& upload);
+    uint64_t upload(const ImageUpload& upload);
+
+    bool isComplete(uint64_t ticket) const { return ticket <= completedTicket; }
+    bool idle() const { return jobs.empty() && pendingAcquires.empty(); }
+
+    // Call once per frame after waiting for the frame's fence, before submit().
+    void beginFrame(uint64_t frameNumber);
+    Submission submit();
+    void recordAcquires(VkCommandBuffer commandBuffer);
+
+    const Stats& getStats() const { return stats; }
+
+
+ // Private ----------------------------------------------------------------------------------------
+private:
+    struct Job {
+        uint64_t ticket;
+        bool isImage;
+        BufferUpload buffer;
+        ImageUpload image;
+        uint64_t progress;                          // bytes for buffers, block rows for images
+    };
+
+    struct Batch {
+        VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+        VkFence fence = VK_NULL_HANDLE;
+        VkSemaphore semaphore = VK_NULL_HANDLE;
+        VkDeviceSize stagingBytes = 0;
+        uint64_t frameNumber = 0;                   // frame whose graphics submission waits on semaphore
+        bool signaled = false;
+        bool inFlight = false;
+    };
+
+    struct Acquire {
+        uint64_t ticket;
+        bool isImage;
+        BufferUpload buffer;
+        ImageUpload image;
+    };
+
+    VkDevice device = VK_NULL_HANDLE;
+    const VkAllocationCallbacks* allocator = nullptr;
+    GpuAllocator* gpuAllocator = nullptr;
+    uint32_t transferFamily = 0;
+    uint32_t graphicsFamily = 0;
+    VkQueue queue = VK_NULL_HANDLE;
+    uint32_t framesInFlight = 1;
+    VkDeviceSize bytesPerFrame = 0;
+    uint64_t frameNumber = 0;
+
+    VkCommandPool commandPool = VK_NULL_HANDLE;
+    std::vector<Batch> batches;
+    std::deque<uint32_t> inFlightBatches;
+
+    VkBuffer stagingBuffer = VK_NULL_HANDLE;
+    GpuAllocation stagingAllocation;
+    VkDeviceSize stagingSize = 0;
+    VkDeviceSize stagingHead = 0;
+    VkDeviceSize stagingUsed = 0;
+
+    std::deque<Job> jobs;
+    std::vector<Acquire> pendingAcquires;
+    uint64_t nextTicket = 1;
+    uint64_t completedTicket = 0;
+    Stats stats;
+
+    bool ownershipTransfer() const { return transferFamily != graphicsFamily; }
+    bool allocateStaging(VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize& offset, VkDeviceSize& consumed);
+    void retireBatches();
+    bool recordJob(Job& job, VkCommandBuffer commandBuffer, VkDeviceSize& budget, VkDeviceSize& batchBytes);
+    void recordRelease(const Job& job, VkCommandBuffer commandBuffer);
+};
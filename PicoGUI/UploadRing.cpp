@@ -0,0 +1,194 @@
+#include "UploadRing.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+
+namespace {
+
+VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment)
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+} // namespace
+
+
+
+// Init / Cleanup ----------------------------------------------------------------------------------------
+void UploadRing::init(VkPhysicalDevice physicalDevice, VkDevice device, GpuAllocator& gpuAllocator, VkDeviceSize frameSize,
+                      uint32_t framesInFlight, const GpuAllocationInfo& memory, VkBufferUsageFlags usage)
+{
+    this->device = device;
+    this->gpuAllocator = &gpuAllocator;
+    this->usage = usage;
+    this->memory = memory;
+
+    // Mapped memory is required; whether it is coherent only changes what flush() does.
+    if (!(memory.requiredFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)) {
+        throw std::runtime_error("upload ring memory must be host-visible!");
+    }
+
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+    uniformAlignment = std::max<VkDeviceSize>(properties.limits.minUniformBufferOffsetAlignment, 16);
+    storageAlignment = std::max<VkDeviceSize>(properties.limits.minStorageBufferOffsetAlignment, 16);
+    nonCoherentAtomSize = properties.limits.nonCoherentAtomSize;
+
+    // Regions start on an atom boundary so flushing one never touches its neighbour.
+    this->frameSize = alignUp(frameSize, std::max({ uniformAlignment, storageAlignment, nonCoherentAtomSize }));
+
+    VkBufferCreateInfo bufferInfo{};
+    bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferInfo.size = this->frameSize * framesInFlight;
+    bufferInfo.usage = usage;
+    bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    ringBuffer = gpuAllocator.createBuffer(bufferInfo, memory, ringAllocation);
+    if (ringAllocation.mapped == nullptr) {
+        throw std::runtime_error("failed to map upload ring!");
+    }
+
+    frames.resize(framesInFlight);
+    for (uint32_t i = 0; i < framesInFlight; i++) {
+        Chunk region;
+        region.buffer = ringBuffer;
+        region.mapped = static_cast<char*>(ringAllocation.mapped) + i * this->frameSize;
+        region.memoryOffset = ringAllocation.offset + i * this->frameSize;
+        region.begin = i * this->frameSize;
+        region.end = region.begin + this->frameSize;
+        region.cursor = region.begin;
+        frames[i].push_back(region);
+    }
+}
+
+void UploadRing::cleanup()
+{
+    for (auto& chunks : frames) {
+        for (size_t i = 1; i < chunks.size(); i++) {
+            gpuAllocator->destroyBuffer(chunks[i].buffer, chunks[i].allocation);
+        }
+    }
+    frames.clear();
+
+    if (ringBuffer != VK_NULL_HANDLE) {
+        gpuAllocator->destroyBuffer(ringBuffer, ringAllocation);
+        ringBuffer = VK_NULL_HANDLE;
+    }
+}
+
+
+
+// Begin Frame ----------------------------------------------------------------------------------------
+void UploadRing::beginFrame(uint32_t frameIndex)
+{
+    this->frameIndex = frameIndex;
+    activeChunk = 0;
+    frameUsage = 0;
+
+    for (Chunk& chunk : frames[frameIndex]) {
+        chunk.cursor = chunk.begin;
+    }
+}
+
+
+
+// Allocate ----------------------------------------------------------------------------------------
+UploadRing::Allocation UploadRing::allocate(VkDeviceSize size, VkDeviceSize alignment)
+{
+    std::vector<Chunk>& chunks = frames[frameIndex];
+
+    while (true) {
+        if (activeChunk == chunks.size()) {
+            chunks.push_back(createOverflowChunk(size + alignment));
+        }
+
+        Chunk& chunk = chunks[activeChunk];
+        const VkDeviceSize offset = alignUp(chunk.cursor, alignment);
+        if (offset + size <= chunk.end) {
+            frameUsage += offset + size - chunk.cursor;
+            peakFrameUsage = std::max(peakFrameUsage, frameUsage);
+            chunk.cursor = offset + size;
+
+            Allocation allocation;
+            allocation.buffer = chunk.buffer;
+            allocation.offset = offset;
+            allocation.data = chunk.mapped + (offset - chunk.begin);
+            return allocation;
+        }
+
+        // Earlier chunks keep their tail unused; reordering allocations is not worth the bookkeeping.
+        activeChunk++;
+    }
+}
+
+UploadRing::Chunk UploadRing::createOverflowChunk(VkDeviceSize minSize)
+{
+    VkBufferCreateInfo bufferInfo{};
+    bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferInfo.size = std::max(frameSize, alignUp(minSize, nonCoherentAtomSize));
+    bufferInfo.usage = usage;
+    bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    Chunk chunk;
+    chunk.buffer = gpuAllocator->createBuffer(bufferInfo, memory, chunk.allocation);
+    chunk.mapped = static_cast<char*>(chunk.allocation.mapped);
+    chunk.memoryOffset = chunk.allocation.offset;
+    chunk.begin = 0;
+    chunk.end = bufferInfo.size;
+    chunk.cursor = 0;
+
+    overflowBufferCount++;
+    return chunk;
+}
+
+
+VkDeviceSize UploadRing::trim(uint32_t heapIndex)
+{
+    const VkPhysicalDeviceMemoryProperties& memoryProperties = gpuAllocator->getMemoryProperties();
+
+    // The first chunk is the slot's region of the ring buffer and always stays.
+    VkDeviceSize released = 0;
+    if (activeChunk != 0) {
+        return released;
+    }
+
+    std::vector<Chunk>& chunks = frames[frameIndex];
+    for (size_t i = chunks.size(); i-- > 1;) {
+        if (memoryProperties.memoryTypes[chunks[i].allocation.memoryType].heapIndex != heapIndex) {
+            continue;
+        }
+
+        released += chunks[i].allocation.size;
+        gpuAllocator->destroyBuffer(chunks[i].buffer, chunks[i].allocation);
+        chunks.erase(chunks.begin() + i);
+    }
+
+    return released;
+}
+
+
+
+// Flush ----------------------------------------------------------------------------------------
+void UploadRing::flush()
+{
+    std::vector<VkMappedMemoryRange> ranges;
+    for (size_t i = 0; i <= activeChunk && i < frames[frameIndex].size(); i++) {
+        const Chunk& chunk = frames[frameIndex][i];
+        const GpuAllocation& allocation = i == 0 ? ringAllocation : chunk.allocation;
+        if (chunk.cursor == chunk.begin || (allocation.propertyFlags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT)) {
+            continue;
+        }
+
+        VkMappedMemoryRange range{};
+        range.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+        range.memory = allocation.memory;
+        range.offset = chunk.memoryOffset;
+        range.size = alignUp(chunk.cursor - chunk.begin, nonCoherentAtomSize);
+        ranges.push_back(range);
+    }
+
+    if (!ranges.empty() && vkFlushMappedMemoryRanges(device, static_cast<uint32_t>(ranges.size()), ranges.data()) != VK_SUCCESS) {
+        throw std::runtime_error("failed to flush upload ring!");
+    }
+}
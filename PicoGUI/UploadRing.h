@@ -0,0 +1,97 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <vector>
+
+#include "GpuAllocator.h"
+
+
+//  CLASS #########################################################################################
+// Persistently mapped host-visible buffer for data that is rewritten every frame: instances,
+// uniforms, text vertices. The buffer is split into one region per frame in flight; a frame
+// bump-allocates from its own region and binds the result by offset. beginFrame() reclaims the
+// region as a whole once the frame that last used it has finished on the GPU.
+//
+// A frame that outgrows its region continues in overflow buffers of the same size, which stay
+// attached to that frame slot and are reused from then on.
+class UploadRing
+{
+
+ // Public ----------------------------------------------------------------------------------------
+public:
+    struct Allocation {
+        VkBuffer buffer = VK_NULL_HANDLE;
+        VkDeviceSize offset = 0;
+        void* data = nullptr;
+    };
+
+    static constexpr VkBufferUsageFlags DefaultUsage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT
+        | VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+
+    void init(VkPhysicalDevice physicalDevice, VkDevice device, GpuAllocator& gpuAllocator, VkDeviceSize frameSize,
+              uint32_t framesInFlight, const GpuAllocationInfo& memory, VkBufferUsageFlags usage = DefaultUsage);
+    void cleanup();
+
+    // Call after waiting for the fence of the frame that last used frameIndex.
+    void beginFrame(uint32_t frameIndex);
+
+    Allocation allocate(VkDeviceSize size, VkDeviceSize alignment = 16);
+    Allocation allocateUniform(VkDeviceSize size) { return allocate(size, uniformAlignment); }
+    Allocation allocateStorage(VkDeviceSize size) { return allocate(size, storageAlignment); }
+
+    template<typename T>
+    Allocation push(std::span<const T> data, VkDeviceSize alignment = alignof(T) < 16 ? 16 : alignof(T)) {
+        Allocation allocation = allocate(data.size_bytes(), alignment);
+        memcpy(allocation.data, data.data(), data.size_bytes());
+        return allocation;
+    }
+
+    // Makes this frame's writes visible to the device; a no-op on host-coherent memory.
+    void flush();
+
+    // Releases the overflow buffers of the current frame slot that live on a heap; returns the
+    // bytes released. Call after beginFrame() and before allocating.
+    VkDeviceSize trim(uint32_t heapIndex);
+
+    VkDeviceSize getFrameUsage() const { return frameUsage; }
+    VkDeviceSize getPeakFrameUsage() const { return peakFrameUsage; }
+    uint32_t getOverflowBufferCount() const { return overflowBufferCount; }
+
+
+ // Private ----------------------------------------------------------------------------------------
+private:
+    struct Chunk {
+        VkBuffer buffer = VK_NULL_HANDLE;
+        GpuAllocation allocation;   // empty for regions of the ring buffer, which share ringAllocation
+        char* mapped = nullptr;     // at begin
+        VkDeviceSize memoryOffset = 0;
+        VkDeviceSize begin = 0;
+        VkDeviceSize end = 0;
+        VkDeviceSize cursor = 0;
+    };
+
+    VkDevice device = VK_NULL_HANDLE;
+    GpuAllocator* gpuAllocator = nullptr;
+    VkBufferUsageFlags usage = 0;
+    GpuAllocationInfo memory;
+    VkDeviceSize frameSize = 0;
+    VkDeviceSize uniformAlignment = 16;
+    VkDeviceSize storageAlignment = 16;
+    VkDeviceSize nonCoherentAtomSize = 1;
+
+    VkBuffer ringBuffer = VK_NULL_HANDLE;
+    GpuAllocation ringAllocation;
+
+    std::vector<std::vector<Chunk>> frames;
+    uint32_t frameIndex = 0;
+    size_t activeChunk = 0;
+
+    VkDeviceSize frameUsage = 0;
+    VkDeviceSize peakFrameUsage = 0;
+    uint32_t overflowBufferCount = 0;
+
+    Chunk createOverflowChunk(VkDeviceSize minSize);
+};
@@ -0,0 +1,767 @@
+#include "WidgetTree.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+
+// Widget Style ----------------------------------------------------------------------------------------
+bool WidgetStyle::sameLayout(const WidgetStyle& other) const
+{
+    return direction == other.direction && wrap == other.wrap && justify == other.justify && alignItems == other.alignItems
+        && padding == other.padding && gap == other.gap
+        && width == other.width && height == other.height && minWidth == other.minWidth && minHeight == other.minHeight
+        && maxWidth == other.maxWidth && maxHeight == other.maxHeight
+        && grow == other.grow && shrink == other.shrink && basis == other.basis && alignSelf == other.alignSelf;
+}
+
+bool WidgetStyle::samePaint(const WidgetStyle& other) const
+{
+    return background == other.background && texture == other.texture && uv == other.uv
+        && tint == other.tint && paint == other.paint && clipChildren == other.clipChildren;
+}
+
+
+
+// Tree ----------------------------------------------------------------------------------------
+WidgetTree::WidgetTree()
+{
+    Node root;
+    root.alive = true;
+    root.style.width = 0.0f;
+    root.style.height = 0.0f;
+    nodes.push_back(root);
+    stats.widgets = 1;
+
+    markLayout(getRoot());
+}
+
+void WidgetTree::setViewport(glm::vec2 size)
+{
+    WidgetStyle style = getStyle(getRoot());
+    style.width = size.x;
+    style.height = size.y;
+    setStyle(getRoot(), style);
+}
+
+WidgetId WidgetTree::create(WidgetId parent, const WidgetStyle& style)
+{
+    if (parent >= nodes.size() || !nodes[parent].alive) {
+        throw std::runtime_error("widget parent does not exist!");
+    }
+
+    WidgetId id;
+    if (!freeNodes.empty()) {
+        id = freeNodes.back();
+        freeNodes.pop_back();
+    }
+    else {
+        id = static_cast<WidgetId>(nodes.size());
+        nodes.emplace_back();
+    }
+
+    Node& node = nodes[id];
+    node = Node{};
+    node.alive = true;
+    node.style = style;
+    link(id, parent, NO_WIDGET);
+    stats.widgets++;
+
+    // A boundary stops the walk at itself, so the parent is marked on its own.
+    markLayout(id);
+    markLayout(parent);
+    markPaint(id);
+    return id;
+}
+
+void WidgetTree::destroy(WidgetId id)
+{
+    if (id == getRoot()) {
+        throw std::runtime_error("cannot destroy the root widget!");
+    }
+
+    markLayout(nodes[id].parent);
+    unlink(id);
+    changed = true;
+
+    // Queued entries of freed nodes are skipped by the alive check.
+    std::vector<WidgetId> stack = { id };
+    while (!stack.empty()) {
+        const WidgetId current = stack.back();
+        stack.pop_back();
+        for (WidgetId child = nodes[current].firstChild; child != NO_WIDGET; child = nodes[child].nextSibling) {
+            stack.push_back(child);
+        }
+
+        addDamage(nodes[current].shown);
+        nodes[current] = Node{};
+        freeNodes.push_back(current);
+        stats.widgets--;
+    }
+}
+
+void WidgetTree::move(WidgetId id, WidgetId parent, WidgetId before)
+{
+    if (id == getRoot() || parent >= nodes.size() || !nodes[parent].alive) {
+        throw std::runtime_error("widget parent does not exist!");
+    }
+    for (WidgetId ancestor = parent; ancestor != NO_WIDGET; ancestor = nodes[ancestor].parent) {
+        if (ancestor == id) {
+            throw std::runtime_error("cannot move a widget into its own subtree!");
+        }
+    }
+
+    markLayout(nodes[id].parent);
+    unlink(id);
+    link(id, parent, before);
+
+    // Like a new widget, the node may get another size in its new place.
+    markLayout(id);
+    markLayout(parent);
+    changed = true;
+}
+
+void WidgetTree::link(WidgetId id, WidgetId parent, WidgetId before)
+{
+    Node& node = nodes[id];
+    Node& parentNode = nodes[parent];
+    node.parent = parent;
+    node.nextSibling = before;
+    node.previousSibling = before != NO_WIDGET ? nodes[before].previousSibling : parentNode.lastChild;
+
+    if (node.previousSibling != NO_WIDGET) {
+        nodes[node.previousSibling].nextSibling = id;
+    }
+    else {
+        parentNode.firstChild = id;
+    }
+    if (before != NO_WIDGET) {
+        nodes[before].previousSibling = id;
+    }
+    else {
+        parentNode.lastChild = id;
+    }
+}
+
+void WidgetTree::unlink(WidgetId id)
+{
+    Node& node = nodes[id];
+    Node& parentNode = nodes[node.parent];
+    if (node.previousSibling != NO_WIDGET) {
+        nodes[node.previousSibling].nextSibling = node.nextSibling;
+    }
+    else {
+        parentNode.firstChild = node.nextSibling;
+    }
+    if (node.nextSibling != NO_WIDGET) {
+        nodes[node.nextSibling].previousSibling = node.previousSibling;
+    }
+    else {
+        parentNode.lastChild = node.previousSibling;
+    }
+
+    node.parent = NO_WIDGET;
+    node.nextSibling = NO_WIDGET;
+    node.previousSibling = NO_WIDGET;
+}
+
+// Styles are applied in update(), which compares them with the old ones; until then they wait
+// here rather than in every node.
+void WidgetTree::setStyle(WidgetId id, const WidgetStyle& style)
+{
+    Node& node = nodes[id];
+    if (node.pendingStyle != UINT32_MAX) {
+        pendingStyles[node.pendingStyle].second = style;
+        return;
+    }
+
+    node.pendingStyle = static_cast<uint32_t>(pendingStyles.size());
+    node.dirty |= DIRTY_STYLE;
+    pendingStyles.emplace_back(id, style);
+}
+
+const WidgetStyle& WidgetTree::getStyle(WidgetId id) const
+{
+    const Node& node = nodes[id];
+    return node.pendingStyle != UINT32_MAX ? pendingStyles[node.pendingStyle].second : node.style;
+}
+
+void WidgetTree::setMeasure(WidgetId id, MeasureFunction measure)
+{
+    nodes[id].measureContent = std::move(measure);
+    markLayout(id);
+}
+
+void WidgetTree::setPaint(WidgetId id, PaintFunction paint)
+{
+    nodes[id].paintContent = std::move(paint);
+    markPaint(id);
+}
+
+void WidgetTree::repaint(WidgetId id)
+{
+    markPaint(id);
+}
+
+void WidgetTree::setScroll(WidgetId id, glm::vec2 scroll)
+{
+    if (nodes[id].scroll != scroll) {
+        nodes[id].scroll = scroll;
+        changed = true;
+    }
+}
+
+
+
+// Invalidation ----------------------------------------------------------------------------------------
+bool WidgetTree::isLayoutBoundary(WidgetId id) const
+{
+    const WidgetStyle& style = nodes[id].style;
+    return id == getRoot() || (style.width != WIDGET_AUTO && style.height != WIDGET_AUTO);
+}
+
+void WidgetTree::markLayout(WidgetId id)
+{
+    // Everything between a marked node and its boundary is marked already.
+    for (WidgetId current = id; current != NO_WIDGET; current = nodes[current].parent) {
+        Node& node = nodes[current];
+        if (node.dirty & DIRTY_LAYOUT) {
+            return;
+        }
+
+        node.dirty |= DIRTY_LAYOUT | DIRTY_MEASURE;
+        if (isLayoutBoundary(current)) {
+            layoutRoots.push_back(current);
+            return;
+        }
+    }
+}
+
+void WidgetTree::markPaint(WidgetId id)
+{
+    if (!(nodes[id].dirty & DIRTY_PAINT)) {
+        nodes[id].dirty |= DIRTY_PAINT;
+        paintQueue.push_back(id);
+    }
+    changed = true;
+}
+
+
+
+// Update ----------------------------------------------------------------------------------------
+bool WidgetTree::update(QuadBatch& batch)
+{
+    stats.styled = 0;
+    stats.measured = 0;
+    stats.measureHits = 0;
+    stats.laidOut = 0;
+    stats.painted = 0;
+
+    // Style first: it decides what else a change invalidates.
+    for (size_t i = 0; i < pendingStyles.size(); i++) {
+        const WidgetId id = pendingStyles[i].first;
+        Node& node = nodes[id];
+        if (!node.alive || node.pendingStyle != i) {
+            continue;               // destroyed, and maybe created again, since the style was set
+        }
+
+        node.dirty &= ~DIRTY_STYLE;
+        node.pendingStyle = UINT32_MAX;
+        stats.styled++;
+
+        const WidgetStyle old = node.style;
+        node.style = pendingStyles[i].second;
+
+        // Any of the layout properties can change how the parent sizes or places the node.
+        if (!old.sameLayout(node.style)) {
+            markLayout(id);
+            if (node.parent != NO_WIDGET) {
+                markLayout(node.parent);
+            }
+        }
+        if (!old.samePaint(node.style)) {
+            markPaint(id);
+        }
+    }
+    pendingStyles.clear();
+
+    // A boundary inside another one is usually laid out with it and then found clean. Other
+    // boundaries keep the size their parent gave them, which their children cannot change.
+    for (size_t i = 0; i < layoutRoots.size(); i++) {
+        const WidgetId id = layoutRoots[i];
+        Node& node = nodes[id];
+        if (!node.alive || !(node.dirty & DIRTY_LAYOUT)) {
+            continue;
+        }
+
+        if (id == getRoot()) {
+            const glm::vec2 size = measure(id, glm::vec2(WIDGET_UNBOUNDED));
+            if (glm::vec2(node.rect.z, node.rect.w) != size) {
+                node.rect = glm::vec4(0.0f, 0.0f, size);
+                markPaint(id);
+            }
+        }
+        layoutChildren(id);
+        node.dirty &= ~DIRTY_LAYOUT;
+    }
+    layoutRoots.clear();
+
+    for (WidgetId id : paintQueue) {
+        if (nodes[id].alive && (nodes[id].dirty & DIRTY_PAINT)) {
+            paint(id);
+        }
+    }
+    paintQueue.clear();
+
+    damage.clear();
+    if (!changed) {
+        return false;
+    }
+
+    batch.clear();
+    stats.gathered = 0;
+    gather(getRoot(), glm::vec2(0.0f), 0, glm::vec4(-1e9f, -1e9f, 1e9f, 1e9f), batch);
+    damage.swap(pendingDamage);
+    changed = false;
+    return true;
+}
+
+
+
+// Layout ----------------------------------------------------------------------------------------
+namespace {
+
+float clampSize(float value, float minValue, float maxValue)
+{
+    return std::max(minValue, std::min(value, maxValue));
+}
+
+} // namespace
+
+glm::vec2 WidgetTree::measure(WidgetId id, glm::vec2 available)
+{
+    Node& node = nodes[id];
+    if (node.dirty & DIRTY_MEASURE) {
+        node.measureCount = 0;
+        node.dirty &= ~DIRTY_MEASURE;
+    }
+
+    for (uint32_t i = 0; i < node.measureCount; i++) {
+        if (node.measureCache[i].available == available) {
+            stats.measureHits++;
+            return node.measureCache[i].size;
+        }
+    }
+
+    const glm::vec2 size = measureUncached(id, available);
+    stats.measured++;
+
+    // Flex layout asks for few distinct sizes, so replacing the oldest entry is enough.
+    Node& cached = nodes[id];
+    cached.measureCache[cached.measureNext] = { available, size };
+    cached.measureNext = (cached.measureNext + 1) % MEASURE_CACHE_SIZE;
+    cached.measureCount = std::min(cached.measureCount + 1, MEASURE_CACHE_SIZE);
+    return size;
+}
+
+glm::vec2 WidgetTree::measureUncached(WidgetId id, glm::vec2 available)
+{
+    const Node& node = nodes[id];
+    const WidgetStyle& style = node.style;
+    const glm::vec2 minSize(style.minWidth, style.minHeight);
+    const glm::vec2 maxSize(style.maxWidth, style.maxHeight);
+    const glm::vec2 fixed(style.width, style.height);
+
+    if (fixed.x != WIDGET_AUTO && fixed.y != WIDGET_AUTO) {
+        return glm::vec2(clampSize(fixed.x, minSize.x, maxSize.x), clampSize(fixed.y, minSize.y, maxSize.y));
+    }
+
+    // The content gets what is left of the node's own size, or of the available space, inside the padding.
+    const glm::vec2 padding(style.padding.x + style.padding.z, style.padding.y + style.padding.w);
+    glm::vec2 inner;
+    for (int axis = 0; axis < 2; axis++) {
+        const float outer = fixed[axis] != WIDGET_AUTO ? clampSize(fixed[axis], minSize[axis], maxSize[axis]) : std::min(available[axis], maxSize[axis]);
+        inner[axis] = std::max(outer - padding[axis], 0.0f);
+    }
+
+    const glm::vec2 content = node.measureContent ? node.measureContent(inner) : flex(id, inner, false);
+
+    glm::vec2 size;
+    for (int axis = 0; axis < 2; axis++) {
+        size[axis] = clampSize(fixed[axis] != WIDGET_AUTO ? fixed[axis] : content[axis] + padding[axis], minSize[axis], maxSize[axis]);
+    }
+    return size;
+}
+
+// Sizes the children of a node into inner, the space inside its padding, and returns the size of
+// their lines. With place set, the children are also positioned and laid out in turn.
+glm::vec2 WidgetTree::flex(WidgetId id, glm::vec2 inner, bool place)
+{
+    const WidgetStyle& style = nodes[id].style;
+    const bool row = style.direction == LayoutDirection::Row;
+    const int mainAxis = row ? 0 : 1;
+    const int crossAxis = row ? 1 : 0;
+    const float innerMain = inner[mainAxis];
+    const float innerCross = inner[crossAxis];
+
+    auto axes = [&](float main, float cross) {
+        glm::vec2 v;
+        v[mainAxis] = main;
+        v[crossAxis] = cross;
+        return v;
+    };
+
+    // Items live on a stack shared with the nested calls measure() makes, so they are addressed by index.
+    const size_t first = flexItems.size();
+    for (WidgetId child = nodes[id].firstChild; child != NO_WIDGET; child = nodes[child].nextSibling) {
+        const WidgetStyle& childStyle = nodes[child].style;
+        const float fixedMain = row ? childStyle.width : childStyle.height;
+
+        float basis = childStyle.basis;
+        if (basis == WIDGET_AUTO) {
+            basis = fixedMain != WIDGET_AUTO ? fixedMain : measure(child, axes(WIDGET_UNBOUNDED, innerCross))[mainAxis];
+        }
+
+        const float minMain = row ? childStyle.minWidth : childStyle.minHeight;
+        const float maxMain = row ? childStyle.maxWidth : childStyle.maxHeight;
+        flexItems.push_back({ child, clampSize(basis, minMain, maxMain), 0.0f, 0.0f, false });
+    }
+    const size_t last = flexItems.size();
+
+    glm::vec2 content(0.0f);
+    float crossCursor = row ? style.padding.y : style.padding.x;
+
+    size_t lineBegin = first;
+    while (lineBegin < last) {
+        // Break lines where the next item would overflow, but always take at least one.
+        size_t lineEnd = lineBegin + 1;
+        float used = flexItems[lineBegin].base;
+        if (style.wrap && std::isfinite(innerMain)) {
+            while (lineEnd < last && used + style.gap + flexItems[lineEnd].base <= innerMain) {
+                used += style.gap + flexItems[lineEnd].base;
+                lineEnd++;
+            }
+        }
+        else {
+            for (; lineEnd < last; lineEnd++) {
+                used += style.gap + flexItems[lineEnd].base;
+            }
+        }
+        const float gaps = style.gap * (lineEnd - lineBegin - 1);
+
+        // Grow into free space, or shrink, in proportion to shrink times base size. Items that hit
+        // their min or max are frozen there and the rest is shared out again.
+        const bool growing = std::isfinite(innerMain) && used < innerMain;
+        const bool shrinking = std::isfinite(innerMain) && used > innerMain;
+        for (size_t i = lineBegin; i < lineEnd; i++) {
+            FlexItem& item = flexItems[i];
+            const WidgetStyle& childStyle = nodes[item.id].style;
+            item.main = item.base;
+            item.frozen = !(growing && childStyle.grow > 0.0f) && !(shrinking && childStyle.shrink > 0.0f);
+        }
+
+        for (size_t pass = lineBegin; (growing || shrinking) && pass < lineEnd; pass++) {
+            float freeSpace = innerMain - gaps;
+            float factors = 0.0f;
+            for (size_t i = lineBegin; i < lineEnd; i++) {
+                const FlexItem& item = flexItems[i];
+                const WidgetStyle& childStyle = nodes[item.id].style;
+                freeSpace -= item.frozen ? item.main : item.base;
+                if (!item.frozen) {
+                    factors += growing ? childStyle.grow : childStyle.shrink * item.base;
+                }
+            }
+            if (factors <= 0.0f) {
+                break;
+            }
+
+            bool clamped = false;
+            for (size_t i = lineBegin; i < lineEnd; i++) {
+                FlexItem& item = flexItems[i];
+                if (item.frozen) {
+                    continue;
+                }
+
+                const WidgetStyle& childStyle = nodes[item.id].style;
+                const float factor = growing ? childStyle.grow : childStyle.shrink * item.base;
+                const float target = item.base + freeSpace * factor / factors;
+                item.main = clampSize(target, row ? childStyle.minWidth : childStyle.minHeight, row ? childStyle.maxWidth : childStyle.maxHeight);
+                if (item.main != target) {
+                    item.frozen = true;
+                    clamped = true;
+                }
+            }
+            if (!clamped) {
+                break;
+            }
+        }
+
+        // Cross sizes: fixed, or measured at the final main size. A single line fills the node's
+        // cross size where that is definite: fixed, or placed. Measuring an auto-sized node keeps
+        // the largest item, so the node does not take all the space it is offered.
+        float lineMain = gaps;
+        float lineCross = 0.0f;
+        for (size_t i = lineBegin; i < lineEnd; i++) {
+            const WidgetId child = flexItems[i].id;
+            const float main = flexItems[i].main;
+            const WidgetStyle& childStyle = nodes[child].style;
+            const float fixedCross = row ? childStyle.height : childStyle.width;
+            const float minCross = row ? childStyle.minHeight : childStyle.minWidth;
+            const float maxCross = row ? childStyle.maxHeight : childStyle.maxWidth;
+
+            // measure() may grow the item stack, so the item is only written afterwards.
+            const float cross = fixedCross != WIDGET_AUTO ? clampSize(fixedCross, minCross, maxCross) : measure(child, axes(main, innerCross))[crossAxis];
+            flexItems[i].cross = cross;
+            lineMain += main;
+            lineCross = std::max(lineCross, cross);
+        }
+        const bool definiteCross = place || (row ? style.height : style.width) != WIDGET_AUTO;
+        if (!style.wrap && definiteCross && std::isfinite(innerCross)) {
+            lineCross = innerCross;
+        }
+
+        content[mainAxis] = std::max(content[mainAxis], lineMain);
+        content[crossAxis] += (lineBegin != first ? style.gap : 0.0f) + lineCross;
+
+        if (place) {
+            const float remaining = std::isfinite(innerMain) ? innerMain - lineMain : 0.0f;
+            const size_t count = lineEnd - lineBegin;
+            float offset = 0.0f;
+            float spacing = 0.0f;
+            switch (style.justify) {
+            case FlexJustify::Start:
+                break;
+            case FlexJustify::Center:
+                offset = remaining * 0.5f;
+                break;
+            case FlexJustify::End:
+                offset = remaining;
+                break;
+            case FlexJustify::SpaceBetween:
+                spacing = count > 1 ? std::max(remaining, 0.0f) / (count - 1) : 0.0f;
+                break;
+            case FlexJustify::SpaceAround:
+                spacing = std::max(remaining, 0.0f) / count;
+                offset = spacing * 0.5f;
+                break;
+            }
+
+            float mainCursor = (row ? style.padding.x : style.padding.y) + offset;
+            for (size_t i = lineBegin; i < lineEnd; i++) {
+                FlexItem& item = flexItems[i];
+                const WidgetStyle& childStyle = nodes[item.id].style;
+                const FlexAlign align = childStyle.alignSelf != FlexAlign::Auto ? childStyle.alignSelf : style.alignItems;
+                const float fixedCross = row ? childStyle.height : childStyle.width;
+
+                float crossOffset = 0.0f;
+                if (align == FlexAlign::Stretch && fixedCross == WIDGET_AUTO) {
+                    item.cross = clampSize(lineCross, row ? childStyle.minHeight : childStyle.minWidth, row ? childStyle.maxHeight : childStyle.maxWidth);
+                }
+                else if (align == FlexAlign::Center) {
+                    crossOffset = (lineCross - item.cross) * 0.5f;
+                }
+                else if (align == FlexAlign::End) {
+                    crossOffset = lineCross - item.cross;
+                }
+
+                const glm::vec2 position = axes(mainCursor, crossCursor + crossOffset);
+                const glm::vec2 size = axes(item.main, item.cross);
+                mainCursor += item.main + style.gap + spacing;
+
+                Node& node = nodes[item.id];
+                const glm::vec4 rect(position, size);
+                const bool resized = node.rect.z != rect.z || node.rect.w != rect.w;
+                if (node.rect != rect) {
+                    node.rect = rect;
+                    changed = true;
+                }
+                if (resized) {
+                    markPaint(item.id);
+                }
+
+                // A child that only moved keeps its layout; its children are placed relative to it.
+                if ((node.dirty & DIRTY_LAYOUT) || resized) {
+                    const WidgetId child = item.id;
+                    layoutChildren(child);
+                    nodes[child].dirty &= ~DIRTY_LAYOUT;
+                }
+            }
+            crossCursor += lineCross + style.gap;
+        }
+
+        lineBegin = lineEnd;
+    }
+
+    flexItems.resize(first);
+    return content;
+}
+
+void WidgetTree::layoutChildren(WidgetId id)
+{
+    stats.laidOut++;
+
+    const Node& node = nodes[id];
+    if (node.firstChild == NO_WIDGET) {
+        return;
+    }
+
+    const glm::vec4& padding = node.style.padding;
+    const glm::vec2 inner(std::max(node.rect.z - padding.x - padding.z, 0.0f), std::max(node.rect.w - padding.y - padding.w, 0.0f));
+    flex(id, inner, true);
+}
+
+
+
+// Paint ----------------------------------------------------------------------------------------
+void WidgetTree::paint(WidgetId id)
+{
+    Node& node = nodes[id];
+    node.dirty &= ~DIRTY_PAINT;
+    node.dirty |= DIRTY_DAMAGE;
+    node.quads.clear();
+    stats.painted++;
+
+    const WidgetStyle& style = node.style;
+    const glm::vec4 rect(0.0f, 0.0f, node.rect.z, node.rect.w);
+
+    if (style.background.a > 0.0f) {
+        QuadInstance background;
+        background.rect = rect;
+        background.uv = glm::vec4(0.0f, 0.0f, 1.0f, 1.0f);
+        background.color = packColor(style.background);
+        background.clipIndex = 0;
+        background.paint = static_cast<uint32_t>(QuadPaint::Solid);
+        background.texture = 0;
+        node.quads.push_back(background);
+    }
+
+    if (style.texture != UINT32_MAX) {
+        QuadInstance image;
+        image.rect = rect;
+        image.uv = style.uv;
+        image.color = packColor(style.tint);
+        image.clipIndex = 0;
+        image.paint = static_cast<uint32_t>(style.paint);
+        image.texture = style.texture;
+        node.quads.push_back(image);
+    }
+
+    if (node.paintContent) {
+        node.paintContent(glm::vec2(node.rect.z, node.rect.w), node.quads);
+    }
+}
+
+void WidgetTree::gather(WidgetId id, glm::vec2 origin, uint32_t clipIndex, const glm::vec4& clipRect, QuadBatch& batch)
+{
+    Node& node = nodes[id];
+    const glm::vec2 position = origin + glm::vec2(node.rect.x, node.rect.y);
+    const glm::vec4 bounds(position, position + glm::vec2(node.rect.z, node.rect.w));
+    const bool visible = bounds.x < clipRect.z && bounds.z > clipRect.x && bounds.y < clipRect.w && bounds.w > clipRect.y;
+    const glm::vec4 clipped(glm::max(glm::vec2(clipRect), glm::vec2(bounds)), glm::min(glm::vec2(clipRect.z, clipRect.w), glm::vec2(bounds.z, bounds.w)));
+
+    if (visible) {
+        for (QuadInstance quad : node.quads) {
+            quad.rect.x += position.x;
+            quad.rect.y += position.y;
+            quad.clipIndex = clipIndex;
+            batch.add(quad);
+            stats.gathered++;
+        }
+    }
+
+    // Quads that moved, or changed in place, damage both where they were and where they are now.
+    const glm::vec4 shown = visible && !node.quads.empty() ? clipped : glm::vec4(0.0f);
+    if (shown != node.shown || (node.dirty & DIRTY_DAMAGE)) {
+        addDamage(node.shown);
+        addDamage(shown);
+        node.shown = shown;
+        node.dirty &= ~DIRTY_DAMAGE;
+    }
+
+    // Children may overflow a node that does not clip them, so only clipping nodes cull their subtree.
+    glm::vec4 childClip = clipRect;
+    if (node.style.clipChildren) {
+        if (!visible) {
+            if (!node.culled) {
+                for (WidgetId child = node.firstChild; child != NO_WIDGET; child = nodes[child].nextSibling) {
+                    hide(child);
+                }
+                node.culled = true;
+            }
+            return;
+        }
+        childClip = clipped;
+        clipIndex = batch.addClip(childClip);
+    }
+    node.culled = false;
+
+    const glm::vec2 childOrigin = position - node.scroll;
+    for (WidgetId child = node.firstChild; child != NO_WIDGET; child = nodes[child].nextSibling) {
+        gather(child, childOrigin, clipIndex, childClip, batch);
+    }
+}
+
+// Takes a subtree that gather() no longer reaches off the screen.
+void WidgetTree::hide(WidgetId id)
+{
+    Node& node = nodes[id];
+    addDamage(node.shown);
+    node.shown = glm::vec4(0.0f);
+    for (WidgetId child = node.firstChild; child != NO_WIDGET; child = nodes[child].nextSibling) {
+        hide(child);
+    }
+}
+
+void WidgetTree::addDamage(const glm::vec4& rect)
+{
+    const glm::vec4& root = nodes[getRoot()].rect;
+    const glm::vec4 area(glm::max(glm::vec2(rect), glm::vec2(0.0f)), glm::min(glm::vec2(rect.z, rect.w), glm::vec2(root.z, root.w)));
+    if (area.x >= area.z || area.y >= area.w) {
+        return;
+    }
+
+    // Overlapping damage merges, so a widget that moves a little adds one rect rather than two.
+    for (glm::vec4& other : pendingDamage) {
+        if (area.x <= other.z && area.z >= other.x && area.y <= other.w && area.w >= other.y) {
+            other = glm::vec4(glm::min(glm::vec2(other), glm::vec2(area)), glm::max(glm::vec2(other.z, other.w), glm::vec2(area.z, area.w)));
+            return;
+        }
+    }
+
+    pendingDamage.push_back(area);
+    if (pendingDamage.size() > MAX_DAMAGE_RECTS) {
+        glm::vec4 bounds = pendingDamage[0];
+        for (const glm::vec4& other : pendingDamage) {
+            bounds = glm::vec4(glm::min(glm::vec2(bounds), glm::vec2(other)), glm::max(glm::vec2(bounds.z, bounds.w), glm::vec2(other.z, other.w)));
+        }
+        pendingDamage.assign(1, bounds);
+    }
+}
+
+
+
+// Hit Testing ----------------------------------------------------------------------------------------
+WidgetId WidgetTree::hitTest(glm::vec2 point) const
+{
+    return hitTest(getRoot(), glm::vec2(0.0f), point);
+}
+
+// Later children are drawn over earlier ones, so they are tried first.
+WidgetId WidgetTree::hitTest(WidgetId id, glm::vec2 origin, glm::vec2 point) const
+{
+    const Node& node = nodes[id];
+    const glm::vec2 position = origin + glm::vec2(node.rect.x, node.rect.y);
+    const bool inside = point.x >= position.x && point.y >= position.y && point.x < position.x + node.rect.z && point.y < position.y + node.rect.w;
+    if (node.style.clipChildren && !inside) {
+        return NO_WIDGET;
+    }
+
+    const glm::vec2 childOrigin = position - node.scroll;
+    for (WidgetId child = node.lastChild; child != NO_WIDGET; child = nodes[child].previousSibling) {
+        const WidgetId hit = hitTest(child, childOrigin, point);
+        if (hit != NO_WIDGET) {
+            return hit;
+        }
+    }
+    return inside ? id : NO_WIDGET;
+}
@@ -0,0 +1,255 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <span>
+#include <utility>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "QuadBatch.h"
+
+
+//  Widget Style ----------------------------------------------------------------------------------
+using WidgetId = uint32_t;
+constexpr WidgetId NO_WIDGET = UINT32_MAX;
+
+// Sizes set to WIDGET_AUTO are measured from the children.
+constexpr float WIDGET_AUTO = -1.0f;
+constexpr float WIDGET_UNBOUNDED = std::numeric_limits<float>::infinity();
+
+enum class LayoutDirection : uint32_t {
+    Column,
+    Row,
+};
+
+enum class FlexJustify : uint32_t {
+    Start,
+    Center,
+    End,
+    SpaceBetween,
+    SpaceAround,
+};
+
+enum class FlexAlign : uint32_t {
+    Auto,           // alignSelf only: use the parent's alignItems
+    Start,
+    Center,
+    End,
+    Stretch,        // fills the line, unless the cross size is fixed
+};
+
+// Flexbox as in CSS, with a few simplifications: minimum sizes default to 0 rather than to the
+// content size, baseline alignment is left out, and wrapped lines always pack at the start.
+struct WidgetStyle {
+    // Layout of the children
+    LayoutDirection direction = LayoutDirection::Column;
+    bool wrap = false;
+    FlexJustify justify = FlexJustify::Start;
+    FlexAlign alignItems = FlexAlign::Stretch;
+    glm::vec4 padding = glm::vec4(0.0f);    // left, top, right, bottom
+    float gap = 0.0f;                       // between children and between lines
+
+    // Size and place in the parent
+    float width = WIDGET_AUTO;
+    float height = WIDGET_AUTO;
+    float minWidth = 0.0f;
+    float minHeight = 0.0f;
+    float maxWidth = WIDGET_UNBOUNDED;
+    float maxHeight = WIDGET_UNBOUNDED;
+    float grow = 0.0f;
+    float shrink = 1.0f;
+    float basis = WIDGET_AUTO;              // main size before growing and shrinking; AUTO uses width or height
+    FlexAlign alignSelf = FlexAlign::Auto;
+
+    // Paint
+    glm::vec4 background = glm::vec4(0.0f);
+    uint32_t texture = UINT32_MAX;          // atlas layer or bindless index, drawn over the background
+    glm::vec4 uv = glm::vec4(0.0f, 0.0f, 1.0f, 1.0f);
+    glm::vec4 tint = glm::vec4(1.0f);
+    QuadPaint paint = QuadPaint::Image;
+    bool clipChildren = false;
+
+    bool sameLayout(const WidgetStyle& other) const;
+    bool samePaint(const WidgetStyle& other) const;
+};
+
+
+
+//  CLASS #########################################################################################
+// Retained tree of widgets that turns into a QuadBatch. Changes only mark nodes dirty; update()
+// then does the least work that brings the batch up to date:
+//
+//  - Style: a changed style is compared with the old one and marks the node for layout, paint,
+//    or nothing.
+//  - Layout: a node whose size may change marks its ancestors up to the nearest layout boundary,
+//    a node of fixed width and height whose own size cannot change. Only those boundaries are
+//    laid out again, and inside them only children that are dirty or get a new size. Each node
+//    remembers the sizes it measured for its last few available sizes, so the repeated measure
+//    passes of flex layout, and every pass over a clean node, cost a lookup.
+//  - Paint: each node keeps its quads relative to its own origin, so a node that only moves, or
+//    a scrolled container, repaints nothing.
+//
+// Gathering the quads into the batch walks the visible tree and skips nodes outside their clip,
+// and is skipped entirely in frames where nothing changed. It also compares where each node shows
+// with where it showed in the last batch; the difference is the damage, the parts of the screen
+// that the new batch draws differently.
+class WidgetTree
+{
+
+ // Public ----------------------------------------------------------------------------------------
+public:
+    // Size of a leaf's content, such as text, given the space available to it; either axis may be
+    // WIDGET_UNBOUNDED.
+    using MeasureFunction = std::function<glm::vec2(glm::vec2 available)>;
+
+    // Appends quads for a widget's content, such as text, relative to its top-left corner; drawn
+    // over the background and texture. Their clip index is replaced by the widget's clip.
+    using PaintFunction = std::function<void(glm::vec2 size, std::vector<QuadInstance>& quads)>;
+
+    struct Stats {
+        uint32_t widgets = 0;
+        uint32_t styled = 0;        // last update
+        uint32_t measured = 0;      // last update, measure cache misses
+        uint32_t measureHits = 0;   // last update
+        uint32_t laidOut = 0;       // last update
+        uint32_t painted = 0;       // last update
+        uint32_t gathered = 0;      // quads, in the last update that changed the batch
+    };
+
+    WidgetTree();
+
+    WidgetId getRoot() const { return 0; }
+
+    // The root covers the viewport.
+    void setViewport(glm::vec2 size);
+
+    WidgetId create(WidgetId parent, const WidgetStyle& style);
+    void destroy(WidgetId id);      // with its subtree
+
+    // Moves a widget, with its subtree, to just before another child of parent, or to the end.
+    void move(WidgetId id, WidgetId parent, WidgetId before = NO_WIDGET);
+
+    WidgetId getParent(WidgetId id) const { return nodes[id].parent; }
+    WidgetId getFirstChild(WidgetId id) const { return nodes[id].firstChild; }
+    WidgetId getNextSibling(WidgetId id) const { return nodes[id].nextSibling; }
+
+    // The last style set, including one update() has not applied yet.
+    void setStyle(WidgetId id, const WidgetStyle& style);
+    const WidgetStyle& getStyle(WidgetId id) const;
+
+    // Makes a leaf measure its content with the function; call again when the content changes.
+    void setMeasure(WidgetId id, MeasureFunction measure);
+
+    // Makes a widget paint its content with the function; call again, or repaint(), when the
+    // content changes.
+    void setPaint(WidgetId id, PaintFunction paint);
+    void repaint(WidgetId id);
+
+    // Moves the children of a node without laying them out again.
+    void setScroll(WidgetId id, glm::vec2 scroll);
+
+    // Returns false, leaving the batch as it is, if nothing changed since the last call.
+    bool update(QuadBatch& batch);
+
+    // x, y relative to the parent's top-left corner, width, height; valid after update().
+    glm::vec4 getRect(WidgetId id) const { return nodes[id].rect; }
+
+    // The last, deepest widget whose rect holds a point, as of the last update(); NO_WIDGET outside the root.
+    WidgetId hitTest(glm::vec2 point) const;
+
+    // Screen rects, x0, y0, x1, y1 in pixels, that the last update() changed; empty if it
+    // returned false.
+    std::span<const glm::vec4> getDamage() const { return damage; }
+
+    const Stats& getStats() const { return stats; }
+
+
+ // Private ----------------------------------------------------------------------------------------
+private:
+    enum DirtyFlags : uint32_t {
+        DIRTY_STYLE = 1 << 0,
+        DIRTY_LAYOUT = 1 << 1,
+        DIRTY_PAINT = 1 << 2,
+        DIRTY_MEASURE = 1 << 3,     // set with DIRTY_LAYOUT, cleared once the size is measured
+        DIRTY_DAMAGE = 1 << 4,      // quads changed since the last batch
+    };
+
+    static constexpr uint32_t MEASURE_CACHE_SIZE = 4;
+
+    // Beyond this many rects, the damage becomes their bounding box.
+    static constexpr size_t MAX_DAMAGE_RECTS = 16;
+
+    struct MeasureEntry {
+        glm::vec2 available;
+        glm::vec2 size;
+    };
+
+    struct FlexItem {
+        WidgetId id;
+        float base;                 // flex base size, clamped
+        float main;
+        float cross;
+        bool frozen;
+    };
+
+    struct Node {
+        WidgetStyle style;
+        uint32_t pendingStyle = UINT32_MAX;     // index into pendingStyles
+        WidgetId parent = NO_WIDGET;
+        WidgetId firstChild = NO_WIDGET;
+        WidgetId lastChild = NO_WIDGET;
+        WidgetId nextSibling = NO_WIDGET;
+        WidgetId previousSibling = NO_WIDGET;
+        uint32_t dirty = 0;
+        bool alive = false;
+
+        MeasureFunction measureContent;
+        std::array<MeasureEntry, MEASURE_CACHE_SIZE> measureCache;
+        uint32_t measureCount = 0;
+        uint32_t measureNext = 0;
+
+        PaintFunction paintContent;
+
+        glm::vec4 rect = glm::vec4(0.0f);
+        glm::vec2 scroll = glm::vec2(0.0f);
+        std::vector<QuadInstance> quads;    // relative to the node's origin
+
+        glm::vec4 shown = glm::vec4(0.0f);  // screen rect of the quads in the last batch, x0, y0, x1, y1
+        bool culled = false;                // the subtree was left out of the last batch
+    };
+
+    std::vector<Node> nodes;
+    std::vector<WidgetId> freeNodes;
+
+    std::vector<std::pair<WidgetId, WidgetStyle>> pendingStyles;
+    std::vector<WidgetId> layoutRoots;
+    std::vector<WidgetId> paintQueue;
+    bool changed = true;                    // anything the batch shows
+    std::vector<FlexItem> flexItems;        // stack shared by nested flex() calls
+
+    std::vector<glm::vec4> damage;
+    std::vector<glm::vec4> pendingDamage;   // collected until the next update() that changes the batch
+
+    Stats stats;
+
+    void link(WidgetId id, WidgetId parent, WidgetId before);
+    void unlink(WidgetId id);
+
+    bool isLayoutBoundary(WidgetId id) const;
+    void markLayout(WidgetId id);
+    void markPaint(WidgetId id);
+
+    glm::vec2 measure(WidgetId id, glm::vec2 available);
+    glm::vec2 measureUncached(WidgetId id, glm::vec2 available);
+    glm::vec2 flex(WidgetId id, glm::vec2 inner, bool place);
+    void layoutChildren(WidgetId id);
+    void paint(WidgetId id);
+    void gather(WidgetId id, glm::vec2 origin, uint32_t clipIndex, const glm::vec4& clipRect, QuadBatch& batch);
+    void hide(WidgetId id);
+    void addDamage(const glm::vec4& rect);
+    WidgetId hitTest(WidgetId id, glm::vec2 origin, glm::vec2 point) const;
+};
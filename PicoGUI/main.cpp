@@ -2,16 +2,42 @@
 
 #include <GLFW\glfw3.h>   
 #include <iostream>
-#include <fstream>
 #include <stdexcept>
 #include <algorithm>
 #include <vector>
 #include <cstring>
 #include <cstdlib>
 #include <cstdint>
+#include <cmath>
 #include <limits>
 #include <optional>
 #include <set>
+#include <span>
+
+#include <glm/glm.hpp>
+
+#include "AssetPack.h"
+#include "BindlessTextures.h"
+#include "DeletionQueue.h"
+#include "DescriptorAllocator.h"
+#include "DeviceCapabilities.h"
+#include "GpuAllocator.h"
+#include "GraphicsPipelines.h"
+#include "HostAllocator.h"
+#include "ImmediateUI.h"
+#include "LayoutBenchmark.h"
+#include "MemoryBudget.h"
+#include "MemoryStrategy.h"
+#include "PersistentBuffer.h"
+#include "PipelineLayoutCache.h"
+#include "QuadBatch.h"
+#include "ShaderReflection.h"
+#include "TextRenderer.h"
+#include "TextureAtlas.h"
+#include "TextureLoader.h"
+#include "TransferQueue.h"
+#include "UploadRing.h"
+#include "WidgetTree.h"
 
 
 //  Variables -----------------------------------------------------------------------------------------------------
@@ -20,6 +46,10 @@ const uint32_t HEIGHT = 600;
 
 const int MAX_FRAMES_IN_FLIGHT = 2;
 
+const VkDeviceSize UPLOAD_RING_FRAME_SIZE = 4 << 20;
+
+const std::string BACKGROUND_TEXTURE = "textures/background.dds";
+
 const std::vector<const char*> validationLayers = {
     "VK_LAYER_KHRONOS_validation"
 };
@@ -37,6 +67,40 @@ const bool enableValidationLayers = true;
 #endif
 
 
+// Release builds read assets from res.pak, debug builds from the loose res/ directory ---------------------------------
+#ifdef NDEBUG
+const bool useAssetPack = true;
+#else
+const bool useAssetPack = false;
+#endif
+
+
+// Sample textures through one bindless descriptor array when the device supports descriptor indexing --------------------
+#ifdef PICOGUI_NO_BINDLESS
+const bool preferBindless = false;
+#else
+const bool preferBindless = true;
+#endif
+
+const uint32_t MAX_BINDLESS_TEXTURES = 4096;
+
+
+// Serve the driver's command-scope host allocations from a thread-local arena instead of the heap ----------------------
+#ifdef PICOGUI_NO_COMMAND_ARENA
+const bool useCommandArena = false;
+#else
+const bool useCommandArena = true;
+#endif
+
+
+// Time CPU writes into each kind of mappable memory at startup and place buffers by the results ------------------------
+#ifdef PICOGUI_NO_MEMORY_BENCHMARK
+const bool benchmarkMemory = false;
+#else
+const bool benchmarkMemory = true;
+#endif
+
+
 // Create Validation Layer / Debug Mode --------------------------------------------------------------------------------
 VkResult CreateDebugUtilsMessengerEXT(VkInstance instance, const VkDebugUtilsMessengerCreateInfoEXT* pCreateInfo, const VkAllocationCallbacks* pAllocator, VkDebugUtilsMessengerEXT* pDebugMessenger) 
 {
@@ -62,6 +126,7 @@ void DestroyDebugUtilsMessengerEXT(VkInstance instance, VkDebugUtilsMessengerEXT
 struct QueueFamilyIndices {
     std::optional<uint32_t> graphicsFamily;
     std::optional<uint32_t> presentFamily;
+    std::optional<uint32_t> transferFamily;     // a family without graphics, if the device has one
 
     bool isComplete() {
         return graphicsFamily.has_value() && presentFamily.has_value();
@@ -95,15 +160,24 @@ public:
 private:
     GLFWwindow* window;
 
+    AssetLoader assets{ "res.pak", "res", useAssetPack };
+
+    HostAllocator hostAllocator;
     VkInstance instance;
     VkDebugUtilsMessengerEXT debugMessenger;
     VkSurfaceKHR surface;
 
     VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
+    DeviceCapabilities deviceCapabilities;
     VkDevice device;
+    GpuAllocator gpuAllocator;
+    MemoryStrategy memoryStrategy;
+    MemoryBudget memoryBudget;
+    DeletionQueue deletionQueue;
 
     VkQueue graphicsQueue;
     VkQueue presentQueue;
+    VkQueue transferQueue;
 
     VkSwapchainKHR swapChain;
     std::vector<VkImage> swapChainImages;
@@ -113,15 +187,43 @@ private:
     std::vector<VkFramebuffer> swapChainFramebuffers;
 
     VkRenderPass renderPass;
-    VkPipelineLayout pipelineLayout;
-    VkPipeline graphicsPipeline;
+    PipelineLayoutCache layoutCache;
+    DescriptorAllocator descriptors;
+    GraphicsPipelineCache pipelines;
+    QuadRenderer quads;
+    QuadBatch quadBatch;
+    WidgetTree widgets;
+    WidgetId demoTitleBar = NO_WIDGET;
+    WidgetId demoGrid = NO_WIDGET;
+    std::vector<WidgetId> demoIcons;
+    std::vector<WidgetId> demoLabels;
+    uint64_t demoTextGeneration = 0;
+    ImmediateUI demoTools;
+    bool demoScrollPaused = false;
+    float demoScroll = 0.0f;
+    double demoTime = 0.0;
+    uint32_t demoAccent = 0;
+    TextureAtlas atlas;
+    TextRenderer text;
+    uint32_t uiFont = UINT32_MAX;
+    BindlessTextures bindless;
+    TextureLoader textures;
+    bool useBackground = false;
+    VkImageView backgroundView = VK_NULL_HANDLE;
+    uint32_t backgroundTexture = UINT32_MAX;
+    bool useBindless = false;
 
     VkCommandPool commandPool;
-    VkCommandBuffer commandBuffer;
+    std::vector<VkCommandBuffer> commandBuffers;
+    UploadRing uploadRing;
+    PersistentBuffer quadInstances;
+    TransferQueue transfers;
 
-    VkSemaphore imageAvailableSemaphore;
-    VkSemaphore renderFinishedSemaphore;
-    VkFence inFlightFence;
+    std::vector<VkSemaphore> imageAvailableSemaphores;
+    std::vector<VkSemaphore> renderFinishedSemaphores;
+    std::vector<VkFence> inFlightFences;
+    uint32_t currentFrame = 0;
+    uint64_t frameNumber = 0;
 
 
 
@@ -138,6 +240,7 @@ private:
 
     // Initialize Vulkan ----------------------------------------------------------------------------------------
     void initVulkan() {
+        hostAllocator.setCommandArena(useCommandArena);
         createInstance();
         setupDebugMessenger();
         createSurface();
@@ -149,7 +252,14 @@ private:
         createGraphicsPipeline();
         createFramebuffers();
         createCommandPool();
-        createCommandBuffer();
+        createCommandBuffers();
+        createUploadRing();
+        createTextureAtlas();
+        createTextRenderer();
+        createTransferQueue();
+        loadTextures();
+        buildDemoScene();
+        createMemoryBudget();
         createSyncObjects();
     }
 
@@ -171,36 +281,52 @@ private:
     // Cleanup ----------------------------------------------------------------------------------------
     void cleanup() 
     {
-        vkDestroySemaphore(device, renderFinishedSemaphore, nullptr);
-        vkDestroySemaphore(device, imageAvailableSemaphore, nullptr);
-        vkDestroyFence(device, inFlightFence, nullptr);
+        for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+            vkDestroySemaphore(device, renderFinishedSemaphores[i], hostAllocator.callbacks(HostAllocationTag::Sync));
+            vkDestroySemaphore(device, imageAvailableSemaphores[i], hostAllocator.callbacks(HostAllocationTag::Sync));
+            vkDestroyFence(device, inFlightFences[i], hostAllocator.callbacks(HostAllocationTag::Sync));
+        }
+
+        deletionQueue.cleanup();
+        textures.cleanup();
+        quadInstances.cleanup();
+        uploadRing.cleanup();
+        text.cleanup();
+        atlas.cleanup();
+        transfers.cleanup();
 
-        vkDestroyCommandPool(device, commandPool, nullptr);
+        vkDestroyCommandPool(device, commandPool, hostAllocator.callbacks(HostAllocationTag::Command));
 
         for (auto framebuffer : swapChainFramebuffers) 
         {
-            vkDestroyFramebuffer(device, framebuffer, nullptr);
+            vkDestroyFramebuffer(device, framebuffer, hostAllocator.callbacks(HostAllocationTag::Swapchain));
         }
 
-        vkDestroyPipeline(device, graphicsPipeline, nullptr);
-        vkDestroyPipelineLayout(device, pipelineLayout, nullptr);
-        vkDestroyRenderPass(device, renderPass, nullptr);
+        pipelines.cleanup();
+        quads.cleanup();
+        descriptors.cleanup();
+        if (useBindless) {
+            bindless.cleanup();
+        }
+        layoutCache.cleanup();
+        vkDestroyRenderPass(device, renderPass, hostAllocator.callbacks(HostAllocationTag::Pipeline));
 
         for (auto imageView : swapChainImageViews)
         {
-            vkDestroyImageView(device, imageView, nullptr);
+            vkDestroyImageView(device, imageView, hostAllocator.callbacks(HostAllocationTag::Swapchain));
         }
 
-        vkDestroySwapchainKHR(device, swapChain, nullptr);
-        vkDestroyDevice(device, nullptr);
+        vkDestroySwapchainKHR(device, swapChain, hostAllocator.callbacks(HostAllocationTag::Swapchain));
+        gpuAllocator.cleanup();
+        vkDestroyDevice(device, hostAllocator.callbacks(HostAllocationTag::Device));
 
         if (enableValidationLayers)
         {
-            DestroyDebugUtilsMessengerEXT(instance, debugMessenger, nullptr);
+            DestroyDebugUtilsMessengerEXT(instance, debugMessenger, hostAllocator.callbacks(HostAllocationTag::Instance));
         }
 
-        vkDestroySurfaceKHR(instance, surface, nullptr);
-        vkDestroyInstance(instance, nullptr);
+        vkDestroySurfaceKHR(instance, surface, hostAllocator.callbacks(HostAllocationTag::Instance));
+        vkDestroyInstance(instance, hostAllocator.callbacks(HostAllocationTag::Instance));
 
         glfwDestroyWindow(window);    
         glfwTerminate();
@@ -222,7 +348,7 @@ private:
         appInfo.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
         appInfo.pEngineName = "No Engine";
         appInfo.engineVersion = VK_MAKE_VERSION(1, 0, 0);
-        appInfo.apiVersion = VK_API_VERSION_1_0;
+        appInfo.apiVersion = VK_API_VERSION_1_1;
 
         VkInstanceCreateInfo createInfo{};
         createInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
@@ -247,7 +373,7 @@ private:
             createInfo.pNext = nullptr;
         }
 
-        if (vkCreateInstance(&createInfo, nullptr, &instance) != VK_SUCCESS) 
+        if (vkCreateInstance(&createInfo, hostAllocator.callbacks(HostAllocationTag::Instance), &instance) != VK_SUCCESS) 
         {
             throw std::runtime_error("failed to create instance!");
         }
@@ -273,7 +399,7 @@ private:
         VkDebugUtilsMessengerCreateInfoEXT createInfo;
         populateDebugMessengerCreateInfo(createInfo);
 
-        if (CreateDebugUtilsMessengerEXT(instance, &createInfo, nullptr, &debugMessenger) != VK_SUCCESS) {
+        if (CreateDebugUtilsMessengerEXT(instance, &createInfo, hostAllocator.callbacks(HostAllocationTag::Instance), &debugMessenger) != VK_SUCCESS) {
             throw std::runtime_error("failed to set up debug messenger!");
         }
     }
@@ -283,7 +409,7 @@ private:
 
     // Create Surface ----------------------------------------------------------------------------------------
     void createSurface() {
-        if (glfwCreateWindowSurface(instance, window, nullptr, &surface) != VK_SUCCESS) {
+        if (glfwCreateWindowSurface(instance, window, hostAllocator.callbacks(HostAllocationTag::Instance), &surface) != VK_SUCCESS) {
             throw std::runtime_error("failed to create window surface!");
         }
     }
@@ -312,6 +438,8 @@ private:
         if (physicalDevice == VK_NULL_HANDLE) {
             throw std::runtime_error("failed to find a suitable GPU!");
         }
+
+        deviceCapabilities = queryDeviceCapabilities(physicalDevice);
     }
 
 
@@ -323,6 +451,9 @@ private:
 
         std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
         std::set<uint32_t> uniqueQueueFamilies = { indices.graphicsFamily.value(), indices.presentFamily.value() };
+        if (indices.transferFamily.has_value()) {
+            uniqueQueueFamilies.insert(indices.transferFamily.value());
+        }
 
         float queuePriority = 1.0f;
         for (uint32_t queueFamily : uniqueQueueFamilies) {
@@ -334,18 +465,23 @@ private:
             queueCreateInfos.push_back(queueCreateInfo);
         }
 
-        VkPhysicalDeviceFeatures deviceFeatures{};
+        // Only the chosen paths' extensions are enabled.
+        useBindless = preferBindless && deviceCapabilities.descriptorIndexing;
+        deviceCapabilities.descriptorIndexing = useBindless;
+
+        DeviceEnableInfo enableInfo(deviceCapabilities, deviceExtensions);
 
         VkDeviceCreateInfo createInfo{};
         createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+        createInfo.pNext = &enableInfo.features2;
 
         createInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
         createInfo.pQueueCreateInfos = queueCreateInfos.data();
 
-        createInfo.pEnabledFeatures = &deviceFeatures;
+        createInfo.pEnabledFeatures = nullptr;
 
-        createInfo.enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size());
-        createInfo.ppEnabledExtensionNames = deviceExtensions.data();
+        createInfo.enabledExtensionCount = static_cast<uint32_t>(enableInfo.extensions.size());
+        createInfo.ppEnabledExtensionNames = enableInfo.extensions.data();
 
         if (enableValidationLayers) {
             createInfo.enabledLayerCount = static_cast<uint32_t>(validationLayers.size());
@@ -355,12 +491,18 @@ private:
             createInfo.enabledLayerCount = 0;
         }
 
-        if (vkCreateDevice(physicalDevice, &createInfo, nullptr, &device) != VK_SUCCESS) {
+        if (vkCreateDevice(physicalDevice, &createInfo, hostAllocator.callbacks(HostAllocationTag::Device), &device) != VK_SUCCESS) {
             throw std::runtime_error("failed to create logical device!");
         }
 
         vkGetDeviceQueue(device, indices.graphicsFamily.value(), 0, &graphicsQueue);
         vkGetDeviceQueue(device, indices.presentFamily.value(), 0, &presentQueue);
+        vkGetDeviceQueue(device, indices.transferFamily.value_or(indices.graphicsFamily.value()), 0, &transferQueue);
+
+        gpuAllocator.init(physicalDevice, device, MAX_FRAMES_IN_FLIGHT, 64ull << 20, hostAllocator.callbacks(HostAllocationTag::Resource));
+        memoryStrategy.init(physicalDevice, device, gpuAllocator, benchmarkMemory, hostAllocator.callbacks(HostAllocationTag::Resource));
+        deletionQueue.init(device, gpuAllocator, MAX_FRAMES_IN_FLIGHT);
+        layoutCache.init(device, hostAllocator.callbacks(HostAllocationTag::Pipeline));
     }
 
 
@@ -409,7 +551,7 @@ private:
 
         createInfo.oldSwapchain = VK_NULL_HANDLE;
 
-        if (vkCreateSwapchainKHR(device, &createInfo, nullptr, &swapChain) != VK_SUCCESS) {
+        if (vkCreateSwapchainKHR(device, &createInfo, hostAllocator.callbacks(HostAllocationTag::Swapchain), &swapChain) != VK_SUCCESS) {
             throw std::runtime_error("failed to create swap chain!");
         }
 
@@ -444,7 +586,7 @@ private:
             createInfo.subresourceRange.baseArrayLayer = 0;
             createInfo.subresourceRange.layerCount = 1;
 
-            if (vkCreateImageView(device, &createInfo, nullptr, &swapChainImageViews[i]) != VK_SUCCESS) {
+            if (vkCreateImageView(device, &createInfo, hostAllocator.callbacks(HostAllocationTag::Swapchain), &swapChainImageViews[i]) != VK_SUCCESS) {
                 throw std::runtime_error("failed to create image views!");
             }
         }
@@ -490,7 +632,7 @@ private:
         renderPassInfo.dependencyCount = 1;
         renderPassInfo.pDependencies = &dependency;
 
-        if (vkCreateRenderPass(device, &renderPassInfo, nullptr, &renderPass) != VK_SUCCESS) {
+        if (vkCreateRenderPass(device, &renderPassInfo, hostAllocator.callbacks(HostAllocationTag::Pipeline), &renderPass) != VK_SUCCESS) {
             throw std::runtime_error("failed to create render pass!");
         }
     }
@@ -499,111 +641,17 @@ private:
 
     // Create Graphics Pipeline ----------------------------------------------------------------------------------------
     void createGraphicsPipeline() {
-        auto vertShaderCode = readFile("res/shaders/vert.spv");
-        auto fragShaderCode = readFile("res/shaders/frag.spv");
-
-        VkShaderModule vertShaderModule = createShaderModule(vertShaderCode);
-        VkShaderModule fragShaderModule = createShaderModule(fragShaderCode);
-
-        VkPipelineShaderStageCreateInfo vertShaderStageInfo{};
-        vertShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-        vertShaderStageInfo.stage = VK_SHADER_STAGE_VERTEX_BIT;
-        vertShaderStageInfo.module = vertShaderModule;
-        vertShaderStageInfo.pName = "main";
-
-        VkPipelineShaderStageCreateInfo fragShaderStageInfo{};
-        fragShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-        fragShaderStageInfo.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
-        fragShaderStageInfo.module = fragShaderModule;
-        fragShaderStageInfo.pName = "main";
-
-        VkPipelineShaderStageCreateInfo shaderStages[] = { vertShaderStageInfo, fragShaderStageInfo };
-
-        VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
-        vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-        vertexInputInfo.vertexBindingDescriptionCount = 0;
-        vertexInputInfo.vertexAttributeDescriptionCount = 0;
-
-        VkPipelineInputAssemblyStateCreateInfo inputAssembly{};
-        inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
-        inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
-        inputAssembly.primitiveRestartEnable = VK_FALSE;
-
-        VkPipelineViewportStateCreateInfo viewportState{};
-        viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
-        viewportState.viewportCount = 1;
-        viewportState.scissorCount = 1;
-
-        VkPipelineRasterizationStateCreateInfo rasterizer{};
-        rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
-        rasterizer.depthClampEnable = VK_FALSE;
-        rasterizer.rasterizerDiscardEnable = VK_FALSE;
-        rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
-        rasterizer.lineWidth = 1.0f;
-        rasterizer.cullMode = VK_CULL_MODE_BACK_BIT;
-        rasterizer.frontFace = VK_FRONT_FACE_CLOCKWISE;
-        rasterizer.depthBiasEnable = VK_FALSE;
-
-        VkPipelineMultisampleStateCreateInfo multisampling{};
-        multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
-        multisampling.sampleShadingEnable = VK_FALSE;
-        multisampling.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
-
-        VkPipelineColorBlendAttachmentState colorBlendAttachment{};
-        colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
-        colorBlendAttachment.blendEnable = VK_FALSE;
-
-        VkPipelineColorBlendStateCreateInfo colorBlending{};
-        colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
-        colorBlending.logicOpEnable = VK_FALSE;
-        colorBlending.logicOp = VK_LOGIC_OP_COPY;
-        colorBlending.attachmentCount = 1;
-        colorBlending.pAttachments = &colorBlendAttachment;
-        colorBlending.blendConstants[0] = 0.0f;
-        colorBlending.blendConstants[1] = 0.0f;
-        colorBlending.blendConstants[2] = 0.0f;
-        colorBlending.blendConstants[3] = 0.0f;
-
-        std::vector<VkDynamicState> dynamicStates = {
-            VK_DYNAMIC_STATE_VIEWPORT,
-            VK_DYNAMIC_STATE_SCISSOR
-        };
-        VkPipelineDynamicStateCreateInfo dynamicState{};
-        dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
-        dynamicState.dynamicStateCount = static_cast<uint32_t>(dynamicStates.size());
-        dynamicState.pDynamicStates = dynamicStates.data();
-
-        VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
-        pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-        pipelineLayoutInfo.setLayoutCount = 0;
-        pipelineLayoutInfo.pushConstantRangeCount = 0;
-
-        if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS) {
-            throw std::runtime_error("failed to create pipeline layout!");
+        if (useBindless) {
+            bindless.init(device, layoutCache, deletionQueue, std::min(MAX_BINDLESS_TEXTURES, deviceCapabilities.maxBindlessTextures),
+                          hostAllocator.callbacks(HostAllocationTag::Resource));
         }
 
-        VkGraphicsPipelineCreateInfo pipelineInfo{};
-        pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
-        pipelineInfo.stageCount = 2;
-        pipelineInfo.pStages = shaderStages;
-        pipelineInfo.pVertexInputState = &vertexInputInfo;
-        pipelineInfo.pInputAssemblyState = &inputAssembly;
-        pipelineInfo.pViewportState = &viewportState;
-        pipelineInfo.pRasterizationState = &rasterizer;
-        pipelineInfo.pMultisampleState = &multisampling;
-        pipelineInfo.pColorBlendState = &colorBlending;
-        pipelineInfo.pDynamicState = &dynamicState;
-        pipelineInfo.layout = pipelineLayout;
-        pipelineInfo.renderPass = renderPass;
-        pipelineInfo.subpass = 0;
-        pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
-
-        if (vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &graphicsPipeline) != VK_SUCCESS) {
-            throw std::runtime_error("failed to create graphics pipeline!");
-        }
+        descriptors.init(device, layoutCache, MAX_FRAMES_IN_FLIGHT, hostAllocator.callbacks(HostAllocationTag::Resource));
+        quads.init(device, assets, layoutCache, descriptors, useBindless ? &bindless : nullptr, hostAllocator.callbacks(HostAllocationTag::Pipeline));
+        pipelines.init(device, deviceCapabilities, renderPass, deletionQueue, hostAllocator.callbacks(HostAllocationTag::Pipeline));
 
-        vkDestroyShaderModule(device, fragShaderModule, nullptr);
-        vkDestroyShaderModule(device, vertShaderModule, nullptr);
+        // Pipelines are linked on first use; building the quad pipeline now keeps the first frame hitch-free.
+        pipelines.get(quads.getPipelineDesc());
     }
 
 
@@ -628,7 +676,7 @@ private:
             framebufferInfo.height = swapChainExtent.height;
             framebufferInfo.layers = 1;
 
-            if (vkCreateFramebuffer(device, &framebufferInfo, nullptr, &swapChainFramebuffers[i]) != VK_SUCCESS) {
+            if (vkCreateFramebuffer(device, &framebufferInfo, hostAllocator.callbacks(HostAllocationTag::Swapchain), &swapChainFramebuffers[i]) != VK_SUCCESS) {
                 throw std::runtime_error("failed to create framebuffer!");
             }
         }
@@ -647,23 +695,352 @@ private:
         poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
         poolInfo.queueFamilyIndex = queueFamilyIndices.graphicsFamily.value();
 
-        if (vkCreateCommandPool(device, &poolInfo, nullptr, &commandPool) != VK_SUCCESS) {
+        if (vkCreateCommandPool(device, &poolInfo, hostAllocator.callbacks(HostAllocationTag::Command), &commandPool) != VK_SUCCESS) {
             throw std::runtime_error("failed to create command pool!");
         }
     }
 
-    void createCommandBuffer() {
+    void createCommandBuffers() {
+        commandBuffers.resize(MAX_FRAMES_IN_FLIGHT);
+
         VkCommandBufferAllocateInfo allocInfo{};
         allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
         allocInfo.commandPool = commandPool;
         allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-        allocInfo.commandBufferCount = 1;
+        allocInfo.commandBufferCount = (uint32_t)commandBuffers.size();
 
-        if (vkAllocateCommandBuffers(device, &allocInfo, &commandBuffer) != VK_SUCCESS) {
+        if (vkAllocateCommandBuffers(device, &allocInfo, commandBuffers.data()) != VK_SUCCESS) {
             throw std::runtime_error("failed to allocate command buffers!");
         }
     }
 
+
+
+
+    // Create Upload Ring ----------------------------------------------------------------------------------------
+    // Per-frame geometry, instances and uniforms are written here instead of into buffers of their own.
+    void createUploadRing() {
+        uploadRing.init(physicalDevice, device, gpuAllocator, UPLOAD_RING_FRAME_SIZE, MAX_FRAMES_IN_FLIGHT,
+                        memoryStrategy.getPlan(ResourceClass::FrameData).allocation);
+
+        // The demo scene is rebuilt every frame, but only the pages of it that change reach the GPU.
+        quadInstances.init(physicalDevice, device, gpuAllocator, deletionQueue, memoryStrategy.getPlan(ResourceClass::StaticGeometry),
+                           VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, MAX_FRAMES_IN_FLIGHT);
+    }
+
+
+
+
+    // Create Texture Atlas ----------------------------------------------------------------------------------------
+    // Icons, glyphs and small images share one array image, so they all draw in the same batch.
+    void createTextureAtlas() {
+        atlas.init(device, gpuAllocator, 1024, 4, hostAllocator.callbacks(HostAllocationTag::Resource));
+
+        if (!useBindless) {
+            quads.setAtlas(atlas.getImageView(), atlas.getSampler());
+            return;
+        }
+
+        // Pages go first, so an atlas layer doubles as its bindless texture index.
+        for (uint32_t layer = 0; layer < atlas.getPageCount(); layer++) {
+            if (bindless.add(atlas.getLayerView(layer)) != layer) {
+                throw std::runtime_error("atlas pages must take the first bindless slots!");
+            }
+        }
+    }
+
+
+
+
+    // Create Text Renderer ----------------------------------------------------------------------------------------
+    // Text is drawn in the UI font shipped with the assets, DejaVu Sans (res/fonts/LICENSE.txt).
+    void createTextRenderer() {
+        text.init(atlas);
+
+        Font font;
+        font.load(assets.load("fonts/ui.ttf").bytes());
+        uiFont = text.addFont(std::move(font));
+    }
+
+
+
+
+    // Create Transfer Queue ----------------------------------------------------------------------------------------
+    // Textures and other static resources stream in on their own queue, a slice per frame.
+    void createTransferQueue() {
+        QueueFamilyIndices queueFamilyIndices = findQueueFamilies(physicalDevice);
+        const uint32_t graphicsFamily = queueFamilyIndices.graphicsFamily.value();
+
+        transfers.init(device, gpuAllocator, queueFamilyIndices.transferFamily.value_or(graphicsFamily), transferQueue, graphicsFamily, MAX_FRAMES_IN_FLIGHT,
+                       memoryStrategy.getPlan(ResourceClass::Staging).allocation, 64ull << 20, 16ull << 20, hostAllocator.callbacks(HostAllocationTag::Command));
+    }
+
+
+
+
+    // Load Textures ----------------------------------------------------------------------------------------
+    // Block-compressed textures from the asset build; decoded to RGBA8 where the device cannot sample them.
+    void loadTextures() {
+        textures.init(physicalDevice, device, assets, gpuAllocator, transfers, deletionQueue, deviceCapabilities.textureCompressionBC,
+                      hostAllocator.callbacks(HostAllocationTag::Resource));
+
+        // Only bindless quads can sample a texture of their own; the atlas path has nowhere to put it.
+        useBackground = useBindless && assets.exists(BACKGROUND_TEXTURE);
+        if (useBackground) {
+            textures.acquire(BACKGROUND_TEXTURE);
+        }
+    }
+
+
+
+
+    // Create Memory Budget ----------------------------------------------------------------------------------------
+    // Caches give memory back when a heap nears its budget, before the driver starts paging or failing allocations.
+    void createMemoryBudget() {
+        memoryBudget.init(physicalDevice, gpuAllocator, deviceCapabilities.memoryBudget);
+
+        memoryBudget.registerCache("empty allocator blocks", CachePriority::Low, [this](uint32_t heapIndex, VkDeviceSize) {
+            return gpuAllocator.trim(heapIndex);
+        });
+        memoryBudget.registerCache("upload ring overflow", CachePriority::Normal, [this](uint32_t heapIndex, VkDeviceSize) {
+            return uploadRing.trim(heapIndex);
+        });
+        memoryBudget.registerCache("textures", CachePriority::Normal, [this](uint32_t heapIndex, VkDeviceSize bytes) {
+            return textures.trim(heapIndex, bytes);
+        });
+    }
+
+
+
+
+    // Build Demo Scene ----------------------------------------------------------------------------------------
+    // A title bar, a sidebar of buttons and a scrolling grid of cells, clipped to its panel.
+    void buildDemoScene() {
+        const float width = (float)swapChainExtent.width;
+        const float height = (float)swapChainExtent.height;
+        const glm::vec4 panelColor(0.16f, 0.17f, 0.20f, 1.0f);
+        const glm::vec4 buttonColor(0.26f, 0.45f, 0.80f, 1.0f);
+
+        widgets.setViewport({ width, height });
+
+        WidgetStyle rootStyle = widgets.getStyle(widgets.getRoot());
+        rootStyle.background = { 0.09f, 0.10f, 0.12f, 1.0f };
+        widgets.setStyle(widgets.getRoot(), rootStyle);
+
+        WidgetStyle titleBar;
+        titleBar.width = width;
+        titleBar.height = 40.0f;
+        titleBar.padding = { 16.0f, 0.0f, 16.0f, 0.0f };
+        titleBar.justify = FlexJustify::Center;
+        titleBar.background = panelColor;
+        demoTitleBar = widgets.create(widgets.getRoot(), titleBar);
+
+        WidgetStyle body;
+        body.direction = LayoutDirection::Row;
+        const WidgetId bodyId = widgets.create(widgets.getRoot(), body);
+
+        WidgetStyle sidebar;
+        sidebar.width = 200.0f;
+        sidebar.height = height - 40.0f;
+        sidebar.padding = { 12.0f, 16.0f, 12.0f, 16.0f };
+        sidebar.gap = 12.0f;
+        sidebar.background = panelColor;
+        const WidgetId sidebarId = widgets.create(bodyId, sidebar);
+
+        WidgetStyle button;
+        button.direction = LayoutDirection::Row;
+        button.width = 176.0f;
+        button.height = 32.0f;
+        button.padding = { 8.0f, 4.0f, 8.0f, 4.0f };
+        button.gap = 8.0f;
+        button.background = buttonColor;
+
+        WidgetStyle icon;
+        icon.width = 24.0f;
+        icon.height = 24.0f;
+
+        WidgetStyle label;
+        label.grow = 1.0f;
+        label.alignSelf = FlexAlign::Center;
+
+        const char* buttonLabels[] = { "Home", "Search", "Library", "Downloads", "Messages", "Calendar", "Settings", "Help" };
+        demoIcons.clear();
+        demoLabels.clear();
+        for (int i = 0; i < 8; i++) {
+            const WidgetId buttonId = widgets.create(sidebarId, button);
+            demoIcons.push_back(widgets.create(buttonId, icon));
+            demoLabels.push_back(widgets.create(buttonId, label));
+            text.setWidgetText(widgets, demoLabels.back(), { uiFont, 15.0f }, buttonLabels[i]);
+        }
+
+        demoLabels.push_back(widgets.create(demoTitleBar, WidgetStyle{}));
+        text.setWidgetText(widgets, demoLabels.back(), { uiFont, 18.0f }, "PicoGUI");
+
+        // The rest of the sidebar is declared every frame, in immediate mode.
+        WidgetStyle tools;
+        tools.gap = 8.0f;
+        demoTools.init(widgets, widgets.create(sidebarId, tools));
+
+        WidgetStyle contentArea;
+        contentArea.width = width - 200.0f;
+        contentArea.height = height - 40.0f;
+        contentArea.padding = { 12.0f, 12.0f, 12.0f, 12.0f };
+        const WidgetId contentId = widgets.create(bodyId, contentArea);
+
+        WidgetStyle grid;
+        grid.width = width - 224.0f;
+        grid.height = height - 64.0f;
+        grid.gap = 8.0f;
+        grid.clipChildren = true;
+        demoGrid = widgets.create(contentId, grid);
+
+        // Rows and cells overflow the grid and scroll through it, so neither may shrink to fit.
+        WidgetStyle row;
+        row.direction = LayoutDirection::Row;
+        row.gap = 8.0f;
+        row.shrink = 0.0f;
+
+        // One row more than fits, so the scrolled-in row is never empty.
+        const int rows = (int)std::ceil(grid.height / 56.0f) + 1;
+        const int columns = (int)std::ceil(grid.width / 56.0f);
+        for (int r = 0; r < rows; r++) {
+            const WidgetId rowId = widgets.create(demoGrid, row);
+            for (int c = 0; c < columns; c++) {
+                const float shade = 0.5f + 0.5f * std::sin((212.0f + c * 56.0f) * 0.02f + (52.0f + r * 56.0f) * 0.015f);
+
+                WidgetStyle cell;
+                cell.width = 48.0f;
+                cell.height = 48.0f;
+                cell.shrink = 0.0f;
+                cell.background = { 0.2f + 0.6f * shade, 0.35f, 0.9f - 0.6f * shade, 0.85f };
+                widgets.create(rowId, cell);
+            }
+        }
+    }
+
+    // Per-frame changes: the grid scrolls, and images appear once they are uploaded. Setting an
+    // unchanged style costs a compare and invalidates nothing.
+    void updateDemoScene() {
+        const double time = glfwGetTime();
+        if (!demoScrollPaused) {
+            demoScroll = std::fmod(demoScroll + (float)(time - demoTime) * 40.0f, 56.0f);
+        }
+        demoTime = time;
+        widgets.setScroll(demoGrid, { 0.0f, demoScroll });
+
+        updateDemoTools();
+
+        // Glyphs appear as their fields are generated, and move when the atlas repacks.
+        if (text.getGeneration() != demoTextGeneration) {
+            demoTextGeneration = text.getGeneration();
+            for (WidgetId label : demoLabels) {
+                widgets.repaint(label);
+            }
+        }
+
+        // The texture cache may evict the background and load it again, so its slot follows the view.
+        const Texture* background = useBackground ? textures.acquire(BACKGROUND_TEXTURE) : nullptr;
+        const VkImageView view = background != nullptr ? background->imageView : VK_NULL_HANDLE;
+        if (view != backgroundView) {
+            if (backgroundTexture != UINT32_MAX) {
+                bindless.remove(backgroundTexture);
+            }
+            backgroundView = view;
+            backgroundTexture = view != VK_NULL_HANDLE ? bindless.add(view) : UINT32_MAX;
+
+            WidgetStyle rootStyle = widgets.getStyle(widgets.getRoot());
+            rootStyle.texture = backgroundTexture;
+            widgets.setStyle(widgets.getRoot(), rootStyle);
+        }
+
+        for (int i = 0; i < (int)demoIcons.size(); i++) {
+            WidgetStyle style = widgets.getStyle(demoIcons[i]);
+            if (std::optional<AtlasRegion> icon = findDemoIcon(i)) {
+                style.texture = icon->layer;
+                style.uv = icon->uv;
+            }
+            else {
+                style.texture = UINT32_MAX;
+            }
+            widgets.setStyle(demoIcons[i], style);
+        }
+    }
+
+    // Tools in immediate mode: a button that pauses the grid, and swatches that color the title bar.
+    void updateDemoTools() {
+        const glm::vec4 accents[] = {
+            { 0.30f, 0.32f, 0.38f, 1.0f },
+            { 0.55f, 0.22f, 0.25f, 1.0f },
+            { 0.22f, 0.45f, 0.30f, 1.0f },
+            { 0.60f, 0.45f, 0.15f, 1.0f },
+        };
+
+        double mouseX, mouseY;
+        glfwGetCursorPos(window, &mouseX, &mouseY);
+
+        UiInput input;
+        input.mouse = { (float)mouseX, (float)mouseY };
+        input.mouseDown = glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_LEFT) == GLFW_PRESS;
+        demoTools.beginFrame(input);
+
+        WidgetStyle pause;
+        pause.height = 28.0f;
+        pause.background = demoScrollPaused ? glm::vec4(0.80f, 0.50f, 0.20f, 1.0f) : glm::vec4(0.26f, 0.45f, 0.80f, 1.0f);
+        if (demoTools.button("pause", pause)) {
+            demoScrollPaused = !demoScrollPaused;
+        }
+
+        WidgetStyle swatches;
+        swatches.direction = LayoutDirection::Row;
+        swatches.gap = 8.0f;
+        demoTools.beginContainer("swatches", swatches);
+        for (uint32_t i = 0; i < 4; i++) {
+            WidgetStyle swatch;
+            swatch.height = 24.0f;
+            swatch.grow = 1.0f;
+            swatch.basis = 0.0f;
+            swatch.background = accents[i];
+            swatch.background.a = i == demoAccent ? 1.0f : 0.5f;
+
+            demoTools.pushId(i);
+            if (demoTools.button("swatch", swatch)) {
+                demoAccent = i;
+            }
+            demoTools.popId();
+        }
+        demoTools.endContainer();
+
+        demoTools.endFrame();
+
+        WidgetStyle titleBar = widgets.getStyle(demoTitleBar);
+        titleBar.background = accents[demoAccent];
+        widgets.setStyle(demoTitleBar, titleBar);
+    }
+
+    // Rings of increasing thickness, generated on first use.
+    std::optional<AtlasRegion> findDemoIcon(int index) {
+        const uint64_t key = 0x1C0000 + index;
+        if (std::optional<AtlasRegion> region = atlas.find(key)) {
+            return region;
+        }
+
+        const uint32_t size = 24;
+        std::vector<uint8_t> pixels(size * size * 4);
+        for (uint32_t y = 0; y < size; y++) {
+            for (uint32_t x = 0; x < size; x++) {
+                const float distance = glm::length(glm::vec2(x + 0.5f, y + 0.5f) - size * 0.5f);
+                const float inner = 9.0f - index;
+                const float coverage = glm::clamp(10.5f - distance, 0.0f, 1.0f) * glm::clamp(distance - inner + 0.5f, 0.0f, 1.0f);
+
+                uint8_t* pixel = &pixels[(y * size + x) * 4];
+                pixel[0] = pixel[1] = pixel[2] = 255;
+                pixel[3] = static_cast<uint8_t>(coverage * 255.0f + 0.5f);
+            }
+        }
+
+        return atlas.insert(key, size, size, pixels);
+    }
+
     void recordCommandBuffer(VkCommandBuffer commandBuffer, uint32_t imageIndex) {
         VkCommandBufferBeginInfo beginInfo{};
         beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
@@ -672,6 +1049,19 @@ private:
             throw std::runtime_error("failed to begin recording command buffer!");
         }
 
+        transfers.recordAcquires(commandBuffer);
+
+        // The scene is updated first so new atlas entries are uploaded before the pass samples them.
+        updateDemoScene();
+        atlas.recordUploads(commandBuffer, uploadRing);
+
+        if (widgets.update(quadBatch)) {
+            std::span<const QuadInstance> instances = quadBatch.getInstances();
+            quadInstances.resize(instances.size_bytes());
+            quadInstances.write(0, instances);
+        }
+        quadInstances.update(currentFrame, commandBuffer, uploadRing);
+
         VkRenderPassBeginInfo renderPassInfo{};
         renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
         renderPassInfo.renderPass = renderPass;
@@ -685,7 +1075,8 @@ private:
 
         vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
 
-        vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipeline);
+        GraphicsPipelineCache::BindState bindState;
+        pipelines.bind(commandBuffer, quads.getPipelineDesc(), bindState);
 
         VkViewport viewport{};
         viewport.x = 0.0f;
@@ -694,14 +1085,15 @@ private:
         viewport.height = (float)swapChainExtent.height;
         viewport.minDepth = 0.0f;
         viewport.maxDepth = 1.0f;
-        vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
 
         VkRect2D scissor{};
         scissor.offset = { 0, 0 };
         scissor.extent = swapChainExtent;
+
+        vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
         vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
 
-        vkCmdDraw(commandBuffer, 3, 1, 0, 0);
+        quads.draw(commandBuffer, quadBatch, quadInstances.getBuffer(), 0, uploadRing, swapChainExtent);
 
         vkCmdEndRenderPass(commandBuffer);
 
@@ -715,6 +1107,10 @@ private:
 
     // Create Sync Objects ----------------------------------------------------------------------------------------
     void createSyncObjects() {
+        imageAvailableSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
+        renderFinishedSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
+        inFlightFences.resize(MAX_FRAMES_IN_FLIGHT);
+
         VkSemaphoreCreateInfo semaphoreInfo{};
         semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
 
@@ -722,12 +1118,13 @@ private:
         fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
         fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
 
-        if (vkCreateSemaphore(device, &semaphoreInfo, nullptr, &imageAvailableSemaphore) != VK_SUCCESS ||
-            vkCreateSemaphore(device, &semaphoreInfo, nullptr, &renderFinishedSemaphore) != VK_SUCCESS ||
-            vkCreateFence(device, &fenceInfo, nullptr, &inFlightFence) != VK_SUCCESS) {
-            throw std::runtime_error("failed to create synchronization objects for a frame!");
+        for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+            if (vkCreateSemaphore(device, &semaphoreInfo, hostAllocator.callbacks(HostAllocationTag::Sync), &imageAvailableSemaphores[i]) != VK_SUCCESS ||
+                vkCreateSemaphore(device, &semaphoreInfo, hostAllocator.callbacks(HostAllocationTag::Sync), &renderFinishedSemaphores[i]) != VK_SUCCESS ||
+                vkCreateFence(device, &fenceInfo, hostAllocator.callbacks(HostAllocationTag::Sync), &inFlightFences[i]) != VK_SUCCESS) {
+                throw std::runtime_error("failed to create synchronization objects for a frame!");
+            }
         }
-
     }
 
 
@@ -738,32 +1135,48 @@ private:
     // Draw Frame ----------------------------------------------------------------------------------------
     void drawFrame()
     {
-        vkWaitForFences(device, 1, &inFlightFence, VK_TRUE, UINT64_MAX);
-        vkResetFences(device, 1, &inFlightFence);
+        vkWaitForFences(device, 1, &inFlightFences[currentFrame], VK_TRUE, UINT64_MAX);
+        vkResetFences(device, 1, &inFlightFences[currentFrame]);
+
+        // Everything the previous use of this frame slot wrote is no longer read by the GPU.
+        hostAllocator.beginFrame();
+        deletionQueue.beginFrame(frameNumber);
+        pipelines.beginFrame();
+        gpuAllocator.beginFrame(frameNumber);
+        uploadRing.beginFrame(currentFrame);
+        descriptors.beginFrame(currentFrame);
+        atlas.beginFrame(frameNumber);
+        text.beginFrame();
+        transfers.beginFrame(frameNumber);
+        textures.beginFrame();
+        memoryBudget.beginFrame();
 
         uint32_t imageIndex;
-        vkAcquireNextImageKHR(device, swapChain, UINT64_MAX, imageAvailableSemaphore, VK_NULL_HANDLE, &imageIndex);
+        vkAcquireNextImageKHR(device, swapChain, UINT64_MAX, imageAvailableSemaphores[currentFrame], VK_NULL_HANDLE, &imageIndex);
+
+        TransferQueue::Submission transferSubmission = transfers.submit();
 
-        vkResetCommandBuffer(commandBuffer, /*VkCommandBufferResetFlagBits*/ 0);
-        recordCommandBuffer(commandBuffer, imageIndex);
+        vkResetCommandBuffer(commandBuffers[currentFrame], /*VkCommandBufferResetFlagBits*/ 0);
+        recordCommandBuffer(commandBuffers[currentFrame], imageIndex);
+        uploadRing.flush();
 
         VkSubmitInfo submitInfo{};
         submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
 
-        VkSemaphore waitSemaphores[] = { imageAvailableSemaphore };
-        VkPipelineStageFlags waitStages[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
-        submitInfo.waitSemaphoreCount = 1;
+        VkSemaphore waitSemaphores[] = { imageAvailableSemaphores[currentFrame], transferSubmission.semaphore };
+        VkPipelineStageFlags waitStages[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, transferSubmission.waitStageMask };
+        submitInfo.waitSemaphoreCount = transferSubmission.semaphore != VK_NULL_HANDLE ? 2 : 1;
         submitInfo.pWaitSemaphores = waitSemaphores;
         submitInfo.pWaitDstStageMask = waitStages;
 
         submitInfo.commandBufferCount = 1;
-        submitInfo.pCommandBuffers = &commandBuffer;
+        submitInfo.pCommandBuffers = &commandBuffers[currentFrame];
 
-        VkSemaphore signalSemaphores[] = { renderFinishedSemaphore };
+        VkSemaphore signalSemaphores[] = { renderFinishedSemaphores[currentFrame] };
         submitInfo.signalSemaphoreCount = 1;
         submitInfo.pSignalSemaphores = signalSemaphores;
 
-        if (vkQueueSubmit(graphicsQueue, 1, &submitInfo, inFlightFence) != VK_SUCCESS) {
+        if (vkQueueSubmit(graphicsQueue, 1, &submitInfo, inFlightFences[currentFrame]) != VK_SUCCESS) {
             throw std::runtime_error("failed to submit draw command buffer!");
         }
 
@@ -779,26 +1192,33 @@ private:
 
         presentInfo.pImageIndices = &imageIndex;
 
-        vkQueuePresentKHR(presentQueue, &presentInfo);
-    }
-
-
+        // Only the damaged parts of the image changed; the compositor may copy just those. Without
+        // damage the batch was left as it is, and the hint is left out.
+        std::vector<VkRectLayerKHR> damageRects;
+        VkPresentRegionKHR presentRegion{};
+        VkPresentRegionsKHR presentRegions{};
+        if (deviceCapabilities.incrementalPresent && !widgets.getDamage().empty()) {
+            for (const glm::vec4& rect : widgets.getDamage()) {
+                VkRectLayerKHR damageRect{};
+                damageRect.offset = { (int32_t)std::floor(rect.x), (int32_t)std::floor(rect.y) };
+                damageRect.extent = { (uint32_t)std::ceil(rect.z) - damageRect.offset.x, (uint32_t)std::ceil(rect.w) - damageRect.offset.y };
+                damageRects.push_back(damageRect);
+            }
 
-    // Create Shader Module ----------------------------------------------------------------------------------------
-    VkShaderModule createShaderModule(const std::vector<char>& code) {
-        VkShaderModuleCreateInfo createInfo{};
-        createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-        createInfo.codeSize = code.size();
-        createInfo.pCode = reinterpret_cast<const uint32_t*>(code.data());
+            presentRegion.rectangleCount = static_cast<uint32_t>(damageRects.size());
+            presentRegion.pRectangles = damageRects.data();
 
-        VkShaderModule shaderModule;
-        if (vkCreateShaderModule(device, &createInfo, nullptr, &shaderModule) != VK_SUCCESS) {
-            throw std::runtime_error("failed to create shader module!");
+            presentRegions.sType = VK_STRUCTURE_TYPE_PRESENT_REGIONS_KHR;
+            presentRegions.swapchainCount = 1;
+            presentRegions.pRegions = &presentRegion;
+            presentInfo.pNext = &presentRegions;
         }
 
-        return shaderModule;
-    }
+        vkQueuePresentKHR(presentQueue, &presentInfo);
 
+        currentFrame = (currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
+        frameNumber++;
+    }
 
 
 
@@ -884,6 +1304,12 @@ private:
 
     // Is Device Suitable ----------------------------------------------------------------------------------------
     bool isDeviceSuitable(VkPhysicalDevice device) {
+        VkPhysicalDeviceProperties properties;
+        vkGetPhysicalDeviceProperties(device, &properties);
+        if (properties.apiVersion < VK_API_VERSION_1_1) {
+            return false;
+        }
+
         QueueFamilyIndices indices = findQueueFamilies(device);
 
         bool extensionsSupported = checkDeviceExtensionSupport(device);
@@ -931,6 +1357,16 @@ private:
         std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
         vkGetPhysicalDeviceQueueFamilyProperties(device, &queueFamilyCount, queueFamilies.data());
 
+        // Prefer a transfer-only family (the copy engine), then an async compute family.
+        for (uint32_t family = 0; family < queueFamilyCount; family++) {
+            const VkQueueFlags flags = queueFamilies[family].queueFlags;
+            if (!(flags & VK_QUEUE_GRAPHICS_BIT) && (flags & (VK_QUEUE_TRANSFER_BIT | VK_QUEUE_COMPUTE_BIT))) {
+                if (!indices.transferFamily.has_value() || !(flags & VK_QUEUE_COMPUTE_BIT)) {
+                    indices.transferFamily = family;
+                }
+            }
+        }
+
         int i = 0;
         for (const auto& queueFamily : queueFamilies) {
             if (queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) {
@@ -1007,27 +1443,6 @@ private:
 
 
 
-    // Read File ----------------------------------------------------------------------------------------
-    static std::vector<char> readFile(const std::string& filename) {
-        std::ifstream file(filename, std::ios::ate | std::ios::binary);
-
-        if (!file.is_open()) {
-            throw std::runtime_error("failed to open file!");
-        }
-
-        size_t fileSize = (size_t)file.tellg();
-        std::vector<char> buffer(fileSize);
-
-        file.seekg(0);
-        file.read(buffer.data(), fileSize);
-
-        file.close();
-
-        return buffer;
-    }
-
-
-
     // Debug Call Back ----------------------------------------------------------------------------------------
     static VKAPI_ATTR VkBool32 VKAPI_CALL debugCallback(VkDebugUtilsMessageSeverityFlagBitsEXT messageSeverity, VkDebugUtilsMessageTypeFlagsEXT messageType, const VkDebugUtilsMessengerCallbackDataEXT* pCallbackData, void* pUserData) {
         std::cerr << "validation layer: " << pCallbackData->pMessage << std::endl;
@@ -1040,7 +1455,12 @@ private:
 
 
 // MAIN :::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
-int main() {
+int main(int argc, char** argv) {
+    // Layout needs no window or device.
+    if (argc > 1 && strcmp(argv[1], "--bench-layout") == 0) {
+        return runLayoutBenchmark();
+    }
+
     HelloTriangleApplication app;
 
     try {
@@ -1,3 +1,2 @@
-%~dp0glslc.exe shader.vert -o vert.spv
-%~dp0glslc.exe shader.frag -o frag.spv
+python "%~dp0..\..\tools\compile_shaders.py" %*
 pause
\ No newline at end of file
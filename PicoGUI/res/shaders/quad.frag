@@ -0,0 +1,79 @@
+#version 450
+
+#ifdef BINDLESS
+#extension GL_EXT_nonuniform_qualifier : require
+#endif
+
+const uint PAINT_SOLID = 0u;
+const uint PAINT_IMAGE = 1u;                // color * texel
+const uint PAINT_MASK = 2u;                 // color with alpha scaled by texel alpha
+const uint PAINT_MSDF = 3u;                 // color with alpha from a multi-channel distance field
+
+// Distance range of the fields in texels; MSDF_RANGE in Msdf.h.
+const float MSDF_RANGE = 4.0;
+
+layout(location = 0) in vec4 fragColor;
+layout(location = 1) in vec2 fragUv;
+layout(location = 2) flat in uint fragPaint;
+layout(location = 3) flat in uint fragTexture;
+
+#ifdef BINDLESS
+// Any mix of textures in one draw; the index differs between instances, hence nonuniformEXT.
+layout(set = 1, binding = 0) uniform texture2D textures[];
+layout(set = 1, binding = 1) uniform sampler textureSampler;
+
+vec4 sampleTexture(vec2 uv) {
+    return texture(sampler2D(textures[nonuniformEXT(fragTexture)], textureSampler), uv);
+}
+
+vec2 getTextureSize() {
+    return vec2(textureSize(textures[nonuniformEXT(fragTexture)], 0));
+}
+#else
+layout(set = 0, binding = 1) uniform sampler2DArray atlas;
+
+vec4 sampleTexture(vec2 uv) {
+    return texture(atlas, vec3(uv, float(fragTexture)));
+}
+
+vec2 getTextureSize() {
+    return vec2(textureSize(atlas, 0).xy);
+}
+#endif
+
+layout(location = 0) out vec4 outColor;
+
+float median(vec3 v) {
+    return max(min(v.r, v.g), min(max(v.r, v.g), v.b));
+}
+
+// Coverage of a pixel: the distance to the edge, converted from field units to screen pixels.
+float sampleMsdf(vec2 uv) {
+    float distance = median(sampleTexture(uv).rgb) - 0.5;
+    vec2 unitRange = vec2(MSDF_RANGE) / getTextureSize();
+    vec2 screenTexSize = vec2(1.0) / fwidth(uv);
+    float screenPxRange = max(0.5 * dot(unitRange, screenTexSize), 1.0);
+    return clamp(distance * screenPxRange + 0.5, 0.0, 1.0);
+}
+
+void main() {
+    vec4 color = fragColor;
+
+    switch (fragPaint) {
+    case PAINT_IMAGE:
+        color *= sampleTexture(fragUv);
+        break;
+    case PAINT_MASK:
+        color.a *= sampleTexture(fragUv).a;
+        break;
+    case PAINT_MSDF:
+        color.a *= sampleMsdf(fragUv);
+        break;
+    case PAINT_SOLID:
+    default:
+        break;
+    }
+
+    // Quads are blended with premultiplied alpha.
+    outColor = vec4(color.rgb * color.a, color.a);
+}
\ No newline at end of file
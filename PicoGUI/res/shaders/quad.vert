@@ -0,0 +1,41 @@
+#version 450
+
+// One instance per quad. The four corners of a triangle strip are generated from gl_VertexIndex.
+layout(location = 0) in vec4 inRect;        // x, y, width, height in pixels
+layout(location = 1) in vec4 inUv;          // u0, v0, u1, v1
+layout(location = 2) in vec4 inColor;       // straight alpha
+layout(location = 3) in uint inClipIndex;
+layout(location = 4) in uint inPaint;
+layout(location = 5) in uint inTexture;     // atlas layer, or bindless texture index
+
+// x0, y0, x1, y1 in pixels; index 0 covers the whole viewport.
+layout(set = 0, binding = 0, std430) readonly buffer ClipRects {
+    vec4 clipRects[];
+};
+
+layout(push_constant) uniform PushConstants {
+    vec2 viewportScale;                     // 2 / viewport size
+} pc;
+
+layout(location = 0) out vec4 fragColor;
+layout(location = 1) out vec2 fragUv;
+layout(location = 2) flat out uint fragPaint;
+layout(location = 3) flat out uint fragTexture;
+
+void main() {
+    vec2 corner = vec2(gl_VertexIndex & 1, gl_VertexIndex >> 1);
+
+    // Axis-aligned clipping shrinks the quad itself, so clipped pixels are never shaded.
+    vec4 clip = clipRects[inClipIndex];
+    vec2 p0 = max(inRect.xy, clip.xy);
+    vec2 p1 = max(min(inRect.xy + inRect.zw, clip.zw), p0);
+    vec2 position = mix(p0, p1, corner);
+
+    vec2 t = (position - inRect.xy) / max(inRect.zw, vec2(1e-6));
+
+    gl_Position = vec4(position * pc.viewportScale - 1.0, 0.0, 1.0);
+    fragColor = inColor;
+    fragUv = mix(inUv.xy, inUv.zw, t);
+    fragPaint = inPaint;
+    fragTexture = inTexture;
+}
\ No newline at end of file
@@ -0,0 +1,2 @@
+python "%~dp0..\..\tools\encode_textures.py" %*
+pause
\ No newline at end of file
@@ -0,0 +1,162 @@
+#!/usr/bin/env python3
+"""Compiles the GLSL shaders listed in res/shaders/shaders.json to optimized SPIR-V.
+
+For every shader and every permutation of its variant defines:
+    glslc -O  ->  spirv-opt -O  [--strip-debug in Release]  ->  res/shaders/<output>
+
+glslc writes a depfile per output, so a shader is only rebuilt when its source, one
+of its #include files, the manifest or the build configuration changed.
+Intermediate files live in res/shaders/.build/.
+
+usage: compile_shaders.py [--config Debug|Release] [--force] [--jobs N]
+"""
+
+import argparse
+import concurrent.futures
+import itertools
+import json
+import os
+import re
+import shutil
+import subprocess
+import sys
+
+ROOT = os.path.normpath(os.path.join(os.path.dirname(os.path.abspath(__file__)), '..'))
+SHADER_DIR = os.path.join(ROOT, 'res', 'shaders')
+BUILD_DIR = os.path.join(SHADER_DIR, '.build')
+MANIFEST = os.path.join(SHADER_DIR, 'shaders.json')
+STATE = os.path.join(BUILD_DIR, 'state.json')
+
+
+def find_tool(name):
+    exe = name + ('.exe' if os.name == 'nt' else '')
+    candidates = [os.path.join(SHADER_DIR, exe)]
+    sdk = os.environ.get('VULKAN_SDK')
+    if sdk:
+        candidates += [os.path.join(sdk, 'Bin', exe), os.path.join(sdk, 'bin', exe)]
+    for candidate in candidates:
+        if os.path.isfile(candidate):
+            return candidate
+    found = shutil.which(name)
+    if not found:
+        sys.exit('%s not found; install the Vulkan SDK or put it on PATH' % name)
+    return found
+
+
+def variant_output(output, defines):
+    """frag.spv + [BINDLESS, SDF] -> frag.bindless.sdf.spv"""
+    if not defines:
+        return output
+    stem, ext = os.path.splitext(output)
+    return '.'.join([stem] + [d.split('=')[0].lower() for d in defines]) + ext
+
+
+def permutations(shader):
+    toggles = shader.get('variants', [])
+    for count in range(len(toggles) + 1):
+        for combination in itertools.combinations(toggles, count):
+            yield list(combination)
+
+
+def read_depfile(path):
+    """Make-style depfile from glslc -MD: 'target: dep dep \\<newline> dep'."""
+    try:
+        with open(path, 'r') as f:
+            text = f.read().replace('\\\n', ' ')
+    except OSError:
+        return None
+    _, _, deps = text.partition(': ')
+    return [os.path.join(SHADER_DIR, d.replace('\\ ', ' ')) for d in re.findall(r'(?:\\ |\S)+', deps)]
+
+
+def is_stale(job, state):
+    output = os.path.join(SHADER_DIR, job['output'])
+    if not os.path.isfile(output) or state.get(job['output']) != job['key']:
+        return True
+    deps = read_depfile(job['depfile'])
+    if deps is None:
+        return True
+    newest = max([os.path.getmtime(MANIFEST)] + [os.path.getmtime(d) for d in deps if os.path.exists(d)])
+    return os.path.getmtime(output) < newest
+
+
+def compile_job(job, glslc, spirv_opt):
+    unoptimized = os.path.join(BUILD_DIR, job['output'] + '.unopt')
+    output = os.path.join(SHADER_DIR, job['output'])
+
+    subprocess.run([glslc, job['source'], '-o', unoptimized, '-MD', '-MF', job['depfile']] + job['glslc'],
+                   check=True, cwd=SHADER_DIR)
+    subprocess.run([spirv_opt, unoptimized, '-o', output] + job['spirv_opt'], check=True)
+    return job['output']
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Compile GLSL shaders to optimized SPIR-V.')
+    parser.add_argument('--config', default='Debug')
+    parser.add_argument('--force', action='store_true')
+    parser.add_argument('--jobs', type=int, default=os.cpu_count())
+    args = parser.parse_args()
+
+    release = args.config.lower() == 'release'
+
+    with open(MANIFEST, 'r') as f:
+        manifest = json.load(f)
+
+    os.makedirs(BUILD_DIR, exist_ok=True)
+    try:
+        with open(STATE, 'r') as f:
+            state = json.load(f)
+    except (OSError, ValueError):
+        state = {}
+
+    jobs = []
+    for shader in manifest['shaders']:
+        target = shader.get('target', 'vulkan1.0')
+        for defines in permutations(shader):
+            glslc_args = ['-O', '--target-env=' + target] + ['-D' + d for d in defines]
+            if not release:
+                glslc_args.append('-g')
+            spirv_opt_args = ['-O', '--target-env=' + target]
+            if release:
+                spirv_opt_args.append('--strip-debug')
+
+            output = variant_output(shader['output'], defines)
+            jobs.append({
+                'source': shader['source'],
+                'output': output,
+                'depfile': os.path.join(BUILD_DIR, output + '.d'),
+                'glslc': glslc_args,
+                'spirv_opt': spirv_opt_args,
+                'key': ' '.join(glslc_args + spirv_opt_args),
+            })
+
+    stale = [job for job in jobs if args.force or is_stale(job, state)]
+    if not stale:
+        print('shaders are up to date (%d outputs)' % len(jobs))
+        return
+
+    glslc = find_tool('glslc')
+    spirv_opt = find_tool('spirv-opt')
+
+    failed = False
+    with concurrent.futures.ThreadPoolExecutor(max_workers=max(1, args.jobs)) as pool:
+        futures = {pool.submit(compile_job, job, glslc, spirv_opt): job for job in stale}
+        for future in concurrent.futures.as_completed(futures):
+            job = futures[future]
+            try:
+                future.result()
+                state[job['output']] = job['key']
+                print('compiled %s -> %s' % (job['source'], job['output']))
+            except subprocess.CalledProcessError:
+                state.pop(job['output'], None)
+                failed = True
+
+    with open(STATE, 'w') as f:
+        json.dump(state, f, indent=2, sort_keys=True)
+
+    if failed:
+        sys.exit('shader compilation failed')
+
+
+if __name__ == '__main__':
+    main()
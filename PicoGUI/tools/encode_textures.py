@@ -0,0 +1,409 @@
+#!/usr/bin/env python3
+"""Encodes the images listed in res/textures/textures.json to block-compressed DDS files.
+
+For every texture:
+    PNG  ->  RGBA8 mip chain (alpha-weighted box filter)  ->  BC1 / BC3 / BC4 / BC7  ->  res/textures/<output>
+
+Formats:
+    bc1    RGB, 1-bit alpha (texels with alpha < 128 become transparent black)   8 bytes / 4x4 block
+    bc3    RGBA                                                                 16 bytes / 4x4 block
+    bc4    single channel, taken from red (masks, glyph coverage)                8 bytes / 4x4 block
+    bc7    RGBA, higher quality than bc3; written in mode 6 only                16 bytes / 4x4 block
+    rgba8  uncompressed
+
+The DDS files always carry a DX10 header, read back by parseDds() in TextureCompression.cpp.
+A texture is only re-encoded when its source, its manifest entry or this script changed.
+
+usage: encode_textures.py [--force] [--jobs N]
+"""
+
+import argparse
+import concurrent.futures
+import json
+import os
+import struct
+import sys
+import zlib
+
+ROOT = os.path.normpath(os.path.join(os.path.dirname(os.path.abspath(__file__)), '..'))
+TEXTURE_DIR = os.path.join(ROOT, 'res', 'textures')
+BUILD_DIR = os.path.join(TEXTURE_DIR, '.build')
+MANIFEST = os.path.join(TEXTURE_DIR, 'textures.json')
+STATE = os.path.join(BUILD_DIR, 'state.json')
+
+# DXGI_FORMAT values, unorm / srgb
+DXGI_FORMATS = {
+    'rgba8': (28, 29),
+    'bc1': (71, 72),
+    'bc3': (77, 78),
+    'bc4': (80, 80),
+    'bc7': (98, 99),
+}
+
+DDS_MAGIC = 0x20534444
+DDSD_CAPS, DDSD_HEIGHT, DDSD_WIDTH, DDSD_PIXELFORMAT, DDSD_MIPMAPCOUNT, DDSD_LINEARSIZE = 0x1, 0x2, 0x4, 0x1000, 0x20000, 0x80000
+DDPF_FOURCC = 0x4
+DDSCAPS_COMPLEX, DDSCAPS_TEXTURE, DDSCAPS_MIPMAP = 0x8, 0x1000, 0x400000
+D3D10_RESOURCE_DIMENSION_TEXTURE2D = 3
+
+BC7_WEIGHTS4 = [0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64]
+
+
+# PNG ----------------------------------------------------------------------------------------
+def read_png(path):
+    """8-bit, non-interlaced PNG -> (width, height, RGBA bytearray)."""
+    with open(path, 'rb') as f:
+        data = f.read()
+    if data[:8] != b'\x89PNG\r\n\x1a\n':
+        raise ValueError('%s is not a PNG file' % path)
+
+    pos, idat, palette, transparency = 8, bytearray(), None, None
+    while pos < len(data):
+        length, kind = struct.unpack('>I4s', data[pos:pos + 8])
+        chunk = data[pos + 8:pos + 8 + length]
+        pos += 12 + length
+        if kind == b'IHDR':
+            width, height, depth, color_type, _, _, interlace = struct.unpack('>IIBBBBB', chunk)
+        elif kind == b'PLTE':
+            palette = chunk
+        elif kind == b'tRNS':
+            transparency = chunk
+        elif kind == b'IDAT':
+            idat += chunk
+        elif kind == b'IEND':
+            break
+
+    channels = {0: 1, 2: 3, 3: 1, 4: 2, 6: 4}.get(color_type)
+    if depth != 8 or interlace != 0 or channels is None:
+        raise ValueError('%s: only 8-bit, non-interlaced PNGs are supported' % path)
+
+    raw = zlib.decompress(bytes(idat))
+    stride = width * channels
+    rows, previous, pos = [], bytearray(stride), 0
+    for _ in range(height):
+        kind, line = raw[pos], bytearray(raw[pos + 1:pos + 1 + stride])
+        pos += 1 + stride
+        for i in range(stride):
+            left = line[i - channels] if i >= channels else 0
+            up = previous[i]
+            upper_left = previous[i - channels] if i >= channels else 0
+            if kind == 1:
+                line[i] = (line[i] + left) & 0xFF
+            elif kind == 2:
+                line[i] = (line[i] + up) & 0xFF
+            elif kind == 3:
+                line[i] = (line[i] + ((left + up) >> 1)) & 0xFF
+            elif kind == 4:
+                p = left + up - upper_left
+                pa, pb, pc = abs(p - left), abs(p - up), abs(p - upper_left)
+                predictor = left if pa <= pb and pa <= pc else (up if pb <= pc else upper_left)
+                line[i] = (line[i] + predictor) & 0xFF
+        rows.append(line)
+        previous = line
+
+    rgba = bytearray(width * height * 4)
+    for y, line in enumerate(rows):
+        for x in range(width):
+            o = (y * width + x) * 4
+            if color_type == 6:
+                rgba[o:o + 4] = line[x * 4:x * 4 + 4]
+            elif color_type == 2:
+                rgba[o:o + 4] = line[x * 3:x * 3 + 3] + b'\xff'
+            elif color_type == 4:
+                rgba[o:o + 4] = bytes((line[x * 2],) * 3 + (line[x * 2 + 1],))
+            elif color_type == 0:
+                rgba[o:o + 4] = bytes((line[x],) * 3 + (255,))
+            else:
+                index = line[x]
+                alpha = transparency[index] if transparency and index < len(transparency) else 255
+                rgba[o:o + 4] = palette[index * 3:index * 3 + 3] + bytes((alpha,))
+    return width, height, rgba
+
+
+# Mips ----------------------------------------------------------------------------------------
+def downsample(width, height, rgba):
+    """Halves an image with a box filter; color is weighted by alpha so transparent texels do not bleed."""
+    w, h = max(1, width // 2), max(1, height // 2)
+    out = bytearray(w * h * 4)
+    for y in range(h):
+        for x in range(w):
+            r = g = b = a = 0
+            for sy in (min(2 * y, height - 1), min(2 * y + 1, height - 1)):
+                for sx in (min(2 * x, width - 1), min(2 * x + 1, width - 1)):
+                    o = (sy * width + sx) * 4
+                    alpha = rgba[o + 3]
+                    r += rgba[o] * alpha
+                    g += rgba[o + 1] * alpha
+                    b += rgba[o + 2] * alpha
+                    a += alpha
+            o = (y * w + x) * 4
+            if a:
+                out[o:o + 4] = bytes(((r + a // 2) // a, (g + a // 2) // a, (b + a // 2) // a, (a + 2) // 4))
+    return w, h, out
+
+
+# Block Encoders ----------------------------------------------------------------------------------------
+def principal_axis(pixels, channels):
+    """Endpoints at the extremes of the pixels projected on their principal axis."""
+    count = len(pixels)
+    mean = [sum(p[c] for p in pixels) / count for c in range(channels)]
+    cov = [[0.0] * channels for _ in range(channels)]
+    for p in pixels:
+        d = [p[c] - mean[c] for c in range(channels)]
+        for i in range(channels):
+            for j in range(i, channels):
+                cov[i][j] += d[i] * d[j]
+    for i in range(channels):
+        for j in range(i):
+            cov[i][j] = cov[j][i]
+
+    axis = [1.0] * channels
+    for _ in range(8):
+        axis = [sum(cov[i][j] * axis[j] for j in range(channels)) for i in range(channels)]
+        norm = max(abs(v) for v in axis)
+        if norm < 1e-9:
+            axis = [1.0] * channels
+            break
+        axis = [v / norm for v in axis]
+
+    projections = [sum((p[c] - mean[c]) * axis[c] for c in range(channels)) for p in pixels]
+    low, high = min(projections), max(projections)
+    length = sum(v * v for v in axis)
+    e0 = [mean[c] + axis[c] * low / length for c in range(channels)]
+    e1 = [mean[c] + axis[c] * high / length for c in range(channels)]
+    return e0, e1
+
+
+def nearest(palette, pixel, channels):
+    best, best_error = 0, None
+    for index, entry in enumerate(palette):
+        error = sum((entry[c] - pixel[c]) ** 2 for c in range(channels))
+        if best_error is None or error < best_error:
+            best, best_error = index, error
+    return best
+
+
+def clamp(value, high=255):
+    return max(0, min(high, int(round(value))))
+
+
+def pack565(color):
+    return (clamp(color[0]) >> 3 << 11) | (clamp(color[1]) >> 2 << 5) | (clamp(color[2]) >> 3)
+
+
+def unpack565(value):
+    r, g, b = (value >> 11) & 31, (value >> 5) & 63, value & 31
+    return ((r << 3) | (r >> 2), (g << 2) | (g >> 4), (b << 3) | (b >> 2))
+
+
+def encode_bc1(pixels, allow_transparency=True):
+    transparent = [allow_transparency and p[3] < 128 for p in pixels]
+    opaque = [p for p, t in zip(pixels, transparent) if not t]
+    if not opaque:
+        return struct.pack('<HHI', 0, 0, 0xFFFFFFFF)
+
+    e0, e1 = principal_axis(opaque, 3)
+    c0, c1 = pack565(e1), pack565(e0)
+    three_color = any(transparent)
+
+    # Four-color mode needs c0 > c1, three-color mode c0 <= c1.
+    if (c0 < c1) != three_color and c0 != c1:
+        c0, c1 = c1, c0
+    if c0 == c1 and not three_color:
+        return struct.pack('<HHI', c0, c1, 0)
+
+    p0, p1 = unpack565(c0), unpack565(c1)
+    if three_color:
+        palette = [p0, p1, tuple((a + b) // 2 for a, b in zip(p0, p1))]
+    else:
+        palette = [p0, p1, tuple((2 * a + b) // 3 for a, b in zip(p0, p1)), tuple((a + 2 * b) // 3 for a, b in zip(p0, p1))]
+
+    indices = 0
+    for i, p in enumerate(pixels):
+        index = 3 if transparent[i] else nearest(palette, p, 3)
+        indices |= index << (2 * i)
+    return struct.pack('<HHI', c0, c1, indices)
+
+
+def encode_bc4(values):
+    high, low = max(values), min(values)
+    if high == low:
+        return bytes((high, low)) + bytes(6)
+
+    palette = [high, low] + [((7 - i) * high + i * low) // 7 for i in range(1, 7)]
+    indices = 0
+    for i, v in enumerate(values):
+        index = min(range(8), key=lambda k: abs(palette[k] - v))
+        indices |= index << (3 * i)
+    return bytes((high, low)) + indices.to_bytes(6, 'little')
+
+
+def encode_bc3(pixels):
+    color = encode_bc1([(p[0], p[1], p[2], 255) for p in pixels], allow_transparency=False)
+    return encode_bc4([p[3] for p in pixels]) + color
+
+
+def quantize_bc7_mode6(endpoint, opaque):
+    """RGBA endpoint -> (7-bit channels, p-bit) with the smaller error. Only p-bit 1 reaches alpha 255."""
+    best = None
+    for pbit in ((1,) if opaque else (0, 1)):
+        channels = [max(0, min(127, int(round((v - pbit) / 2)))) for v in endpoint]
+        error = sum(((c << 1 | pbit) - v) ** 2 for c, v in zip(channels, endpoint))
+        if best is None or error < best[0]:
+            best = (error, channels, pbit)
+    return best[1], best[2]
+
+
+def encode_bc7(pixels):
+    e0, e1 = principal_axis(pixels, 4)
+    opaque = all(p[3] == 255 for p in pixels)
+    q0, p0 = quantize_bc7_mode6(e0, opaque)
+    q1, p1 = quantize_bc7_mode6(e1, opaque)
+    a = [c << 1 | p0 for c in q0]
+    b = [c << 1 | p1 for c in q1]
+    palette = [tuple(((64 - w) * a[c] + w * b[c] + 32) >> 6 for c in range(4)) for w in BC7_WEIGHTS4]
+    indices = [nearest(palette, p, 4) for p in pixels]
+
+    # The anchor index has an implicit 0 high bit.
+    if indices[0] >= 8:
+        q0, q1, p0, p1 = q1, q0, p1, p0
+        indices = [15 - i for i in indices]
+
+    bits, shift = 1 << 6, 7
+    for c in range(4):
+        bits |= q0[c] << shift
+        bits |= q1[c] << (shift + 7)
+        shift += 14
+    bits |= p0 << shift
+    bits |= p1 << (shift + 1)
+    shift += 2
+    for i, index in enumerate(indices):
+        bits |= index << shift
+        shift += 3 if i == 0 else 4
+    return bits.to_bytes(16, 'little')
+
+
+ENCODERS = {'bc1': encode_bc1, 'bc3': encode_bc3, 'bc4': lambda pixels: encode_bc4([p[0] for p in pixels]), 'bc7': encode_bc7}
+
+
+def encode_level(width, height, rgba, fmt):
+    if fmt == 'rgba8':
+        return bytes(rgba)
+
+    encode = ENCODERS[fmt]
+    out = bytearray()
+    for by in range(0, height, 4):
+        for bx in range(0, width, 4):
+            # Partial edge blocks repeat their last row and column.
+            pixels = []
+            for y in range(4):
+                for x in range(4):
+                    o = (min(by + y, height - 1) * width + min(bx + x, width - 1)) * 4
+                    pixels.append(tuple(rgba[o:o + 4]))
+            out += encode(pixels)
+    return bytes(out)
+
+
+# DDS ----------------------------------------------------------------------------------------
+def write_dds(path, width, height, fmt, srgb, levels):
+    dxgi = DXGI_FORMATS[fmt][1 if srgb else 0]
+    flags = DDSD_CAPS | DDSD_HEIGHT | DDSD_WIDTH | DDSD_PIXELFORMAT | DDSD_LINEARSIZE
+    caps = DDSCAPS_TEXTURE
+    if len(levels) > 1:
+        flags |= DDSD_MIPMAPCOUNT
+        caps |= DDSCAPS_COMPLEX | DDSCAPS_MIPMAP
+
+    pixel_format = struct.pack('<II4sIIIII', 32, DDPF_FOURCC, b'DX10', 0, 0, 0, 0, 0)
+    header = struct.pack('<IIIIIII44s', 124, flags, height, width, len(levels[0]), 0, len(levels), bytes(44))
+    header += pixel_format + struct.pack('<IIIII', caps, 0, 0, 0, 0)
+    dx10 = struct.pack('<IIIII', dxgi, D3D10_RESOURCE_DIMENSION_TEXTURE2D, 0, 1, 0)
+
+    tmp = path + '.tmp'
+    with open(tmp, 'wb') as out:
+        out.write(struct.pack('<I', DDS_MAGIC))
+        out.write(header)
+        out.write(dx10)
+        for level in levels:
+            out.write(level)
+    os.replace(tmp, path)
+
+
+def encode_texture(job):
+    width, height, rgba = read_png(job['source'])
+    size = (width, height)
+    levels = []
+    while True:
+        levels.append(encode_level(width, height, rgba, job['format']))
+        if not job['mips'] or (width == 1 and height == 1):
+            break
+        width, height, rgba = downsample(width, height, rgba)
+
+    write_dds(job['output'], *size, job['format'], job['srgb'], levels)
+    return job['name']
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Encode textures to block-compressed DDS.')
+    parser.add_argument('--force', action='store_true')
+    parser.add_argument('--jobs', type=int, default=os.cpu_count())
+    args = parser.parse_args()
+
+    with open(MANIFEST, 'r') as f:
+        manifest = json.load(f)
+
+    os.makedirs(BUILD_DIR, exist_ok=True)
+    try:
+        with open(STATE, 'r') as f:
+            state = json.load(f)
+    except (OSError, ValueError):
+        state = {}
+
+    script_time = os.path.getmtime(os.path.abspath(__file__))
+    jobs = []
+    for texture in manifest['textures']:
+        fmt = texture.get('format', 'bc7')
+        if fmt not in DXGI_FORMATS:
+            sys.exit('%s: unknown format %s' % (texture['source'], fmt))
+
+        job = {
+            'name': texture['output'],
+            'source': os.path.join(TEXTURE_DIR, texture['source']),
+            'output': os.path.join(TEXTURE_DIR, texture['output']),
+            'format': fmt,
+            'srgb': texture.get('srgb', False),
+            'mips': texture.get('mips', True),
+        }
+        job['key'] = '%s srgb=%d mips=%d' % (fmt, job['srgb'], job['mips'])
+
+        stale = (args.force or state.get(job['name']) != job['key'] or not os.path.isfile(job['output'])
+                 or os.path.getmtime(job['output']) < max(os.path.getmtime(job['source']), script_time))
+        if stale:
+            jobs.append(job)
+
+    if not jobs:
+        print('textures are up to date (%d outputs)' % len(manifest['textures']))
+        return
+
+    failed = False
+    with concurrent.futures.ProcessPoolExecutor(max_workers=max(1, args.jobs)) as pool:
+        futures = {pool.submit(encode_texture, job): job for job in jobs}
+        for future in concurrent.futures.as_completed(futures):
+            job = futures[future]
+            try:
+                future.result()
+                state[job['name']] = job['key']
+                print('encoded %s -> %s (%s)' % (os.path.basename(job['source']), job['name'], job['format']))
+            except (OSError, ValueError) as error:
+                print('%s: %s' % (job['source'], error), file=sys.stderr)
+                state.pop(job['name'], None)
+                failed = True
+
+    with open(STATE, 'w') as f:
+        json.dump(state, f, indent=2, sort_keys=True)
+
+    if failed:
+        sys.exit('texture encoding failed')
+
+
+if __name__ == '__main__':
+    main()
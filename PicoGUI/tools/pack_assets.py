@@ -0,0 +1,177 @@
+#!/usr/bin/env python3
+"""Packs the runtime assets under res/ into a single indexed file (res.pak).
+
+Layout (little endian), mirrored by AssetPack.h:
+    header   magic 'PGPK', version, entry count, reserved       (16 bytes)
+    index    entry count * (hash u64, offset u64, stored size u32,
+             raw size u32, flags u32, reserved u32)            (32 bytes each, sorted by hash)
+    payloads each starting on a 16-byte boundary
+
+Names are the path relative to res/ with '/' separators, hashed with 64-bit FNV-1a.
+
+usage: pack_assets.py <res dir> <output.pak> [--lz4]
+"""
+
+import argparse
+import json
+import os
+import struct
+import sys
+
+MAGIC = 0x4B504750
+VERSION = 1
+ALIGNMENT = 16
+ENTRY_LZ4 = 1 << 0
+
+HEADER = struct.Struct('<IIII')
+ENTRY = struct.Struct('<QQIIII')
+
+# Runtime assets only; shader sources and build scripts stay out of the pack.
+PACKED_EXTENSIONS = {
+    '.spv',                                  # shaders
+    '.ttf', '.otf',                          # fonts
+    '.png', '.jpg', '.jpeg', '.dds', '.ktx', # images
+    '.json', '.xml', '.ui',                  # ui descriptions
+}
+
+# Formats that are already entropy coded gain nothing from LZ4.
+INCOMPRESSIBLE_EXTENSIONS = {'.png', '.jpg', '.jpeg'}
+
+
+def fnv1a64(name):
+    h = 0xcbf29ce484222325
+    for b in name.encode('utf-8'):
+        h ^= b
+        h = (h * 0x100000001b3) & 0xFFFFFFFFFFFFFFFF
+    return h
+
+
+def lz4_compress(src):
+    """Greedy LZ4 block compressor (no frame), decoded by decompressLz4Block()."""
+    n = len(src)
+    out = bytearray()
+
+    def emit(literals, match_length=0, offset=0):
+        ll = len(literals)
+        ml = match_length - 4 if match_length else 0
+        out.append((min(ll, 15) << 4) | min(ml, 15))
+        if ll >= 15:
+            rest = ll - 15
+            while rest >= 255:
+                out.append(255)
+                rest -= 255
+            out.append(rest)
+        out.extend(literals)
+        if match_length:
+            out.extend(offset.to_bytes(2, 'little'))
+            if ml >= 15:
+                rest = ml - 15
+                while rest >= 255:
+                    out.append(255)
+                    rest -= 255
+                out.append(rest)
+
+    # The last match must start 12 bytes before the end and the last 5 bytes are literals.
+    match_limit = n - 12
+    end_limit = n - 5
+    table = {}
+    anchor = 0
+    i = 0
+    while i <= match_limit:
+        key = src[i:i + 4]
+        candidate = table.get(key)
+        table[key] = i
+        if candidate is not None and i - candidate <= 0xFFFF:
+            length = 4
+            while i + length < end_limit and src[candidate + length] == src[i + length]:
+                length += 1
+            emit(src[anchor:i], length, i - candidate)
+            i += length
+            anchor = i
+        else:
+            i += 1
+
+    emit(src[anchor:n])
+    return bytes(out)
+
+
+def texture_sources(root):
+    """Images encode_textures.py turns into DDS files; only the DDS files are loaded at runtime."""
+    try:
+        with open(os.path.join(root, 'textures', 'textures.json'), 'r') as f:
+            return {'textures/' + t['source'] for t in json.load(f)['textures']}
+    except OSError:
+        return set()
+
+
+def collect(root):
+    assets = []
+    skipped = texture_sources(root)
+    for directory, _, files in os.walk(root):
+        for filename in files:
+            if os.path.splitext(filename)[1].lower() not in PACKED_EXTENSIONS:
+                continue
+            path = os.path.join(directory, filename)
+            name = os.path.relpath(path, root).replace(os.sep, '/')
+            if name in skipped:
+                continue
+            assets.append((name, path))
+    return assets
+
+
+def align(value):
+    return (value + ALIGNMENT - 1) & ~(ALIGNMENT - 1)
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Pack res/ into an indexed asset pack.')
+    parser.add_argument('root')
+    parser.add_argument('output')
+    parser.add_argument('--lz4', action='store_true', help='LZ4-compress entries that shrink by at least 10%%')
+    args = parser.parse_args()
+
+    entries = []
+    seen = {}
+    for name, path in collect(args.root):
+        h = fnv1a64(name)
+        if h in seen:
+            sys.exit('hash collision between %s and %s' % (seen[h], name))
+        seen[h] = name
+
+        with open(path, 'rb') as f:
+            raw = f.read()
+
+        data, flags = raw, 0
+        ext = os.path.splitext(name)[1].lower()
+        if args.lz4 and ext not in INCOMPRESSIBLE_EXTENSIONS and len(raw) > 64:
+            packed = lz4_compress(raw)
+            if len(packed) <= len(raw) * 0.9:
+                data, flags = packed, ENTRY_LZ4
+
+        entries.append((h, name, data, len(raw), flags))
+
+    entries.sort(key=lambda e: e[0])
+
+    offset = align(HEADER.size + ENTRY.size * len(entries))
+    index = bytearray()
+    payload_offsets = []
+    for h, name, data, raw_size, flags in entries:
+        payload_offsets.append(offset)
+        index += ENTRY.pack(h, offset, len(data), raw_size, flags, 0)
+        offset = align(offset + len(data))
+
+    tmp = args.output + '.tmp'
+    with open(tmp, 'wb') as out:
+        out.write(HEADER.pack(MAGIC, VERSION, len(entries), 0))
+        out.write(index)
+        for (h, name, data, raw_size, flags), payload_offset in zip(entries, payload_offsets):
+            out.write(b'\0' * (payload_offset - out.tell()))
+            out.write(data)
+    os.replace(tmp, args.output)
+
+    total = sum(e[3] for e in entries)
+    print('packed %d assets (%d bytes) into %s (%d bytes)' % (len(entries), total, args.output, os.path.getsize(args.output)))
+
+
+if __name__ == '__main__':
+    main()